@@ -0,0 +1,366 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_all_neighbor.hpp
+ *  Provides the search of the k nearest neighbors of every element of a
+ *  container, by traversing the tree of the container against itself.
+ */
+
+#ifndef SPATIAL_ALL_NEIGHBOR_HPP
+#define SPATIAL_ALL_NEIGHBOR_HPP
+
+#include <limits> // numeric_limits max()
+#include <vector>
+#include <utility> // std::pair
+#include <algorithm> // std::push_heap, std::pop_heap, std::sort_heap
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include "../metric.hpp"
+#include "spatial_dual_tree.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Holds the state of a dual-tree search of the k nearest neighbors of
+     *  every element of a container.
+     *
+     *  The tree is traversed against itself: pairs made of a query cell and a
+     *  reference cell are discarded as soon as the lower bound of the distance
+     *  between the two cells is not smaller than the largest k-th nearest
+     *  distance found so far for any element of the query cell. The
+     *  candidates of each element are kept in a bounded max-heap of size k.
+     *
+     *  Query cells that are not ancestors of one another only ever modify
+     *  their own candidates; when built with OpenMP, the query tree is cut into
+     *  such independent sub-trees which are searched in parallel.
+     */
+    template <typename Container, typename Metric>
+    class All_neighbor_search
+    {
+    public:
+      typedef Cell_tree<Container>                    cell_tree;
+      typedef typename Metric::distance_type          distance_type;
+      typedef std::pair<distance_type, std::size_t>   candidate;
+
+      All_neighbor_search(const cell_tree& tree, const Metric& met,
+                          size_type k)
+        : _tree(tree), _met(met), _k(k), _heaps(tree.size() * k),
+          _count(tree.size(), 0),
+          _bound(tree.size(), (std::numeric_limits<distance_type>::max)())
+      { }
+
+      //! Find the k nearest neighbors of all the cells in the tree.
+      void run()
+      {
+        if (_k == 0) return;
+#ifdef _OPENMP
+        const std::size_t target
+          = 8 * static_cast<std::size_t>(omp_get_max_threads());
+#else
+        const std::size_t target = 1;
+#endif
+        std::vector<std::size_t> upper, tasks;
+        partition_cells(_tree, target, upper, tasks);
+        const long upper_size = static_cast<long>(upper.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (long i = 0; i < upper_size; ++i)
+          {
+            std::size_t q = upper[static_cast<std::size_t>(i)];
+            single(q, 0, key_cell_distance(_tree.key(q), _tree, 0, _met));
+          }
+        const long tasks_size = static_cast<long>(tasks.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (long i = 0; i < tasks_size; ++i)
+          {
+            std::size_t q = tasks[static_cast<std::size_t>(i)];
+            dual(q, 0, cell_distance(_tree, q, _tree, 0, _met));
+          }
+      }
+
+      /**
+       *  Sort the candidates of the cell \c q from the nearest to the
+       *  furthest and return the number of candidates found.
+       */
+      std::size_t sort(std::size_t q)
+      {
+        std::sort_heap(_heaps.begin() + static_cast<std::ptrdiff_t>(q * _k),
+                       _heaps.begin()
+                       + static_cast<std::ptrdiff_t>(q * _k + _count[q]));
+        return _count[q];
+      }
+
+      //! The \c n-th candidate of the cell \c q.
+      const candidate& get(std::size_t q, std::size_t n) const
+      { return _heaps[q * _k + n]; }
+
+    private:
+      //! The largest distance among the candidates of the cell \c q.
+      distance_type point_bound(std::size_t q) const
+      {
+        return _count[q] < _k ? (std::numeric_limits<distance_type>::max)()
+          : _heaps[q * _k].first;
+      }
+
+      //! Recompute the bound of the sub-tree \c q from its children.
+      void refresh_bound(std::size_t q)
+      {
+        const typename cell_tree::Cell& cell = _tree[q];
+        distance_type bound = point_bound(q);
+        if (cell.left != cell_tree::none && bound < _bound[cell.left])
+          { bound = _bound[cell.left]; }
+        if (cell.right != cell_tree::none && bound < _bound[cell.right])
+          { bound = _bound[cell.right]; }
+        _bound[q] = bound;
+      }
+
+      //! Offer the element of the cell \c r as a candidate to the cell \c q.
+      void update(std::size_t q, std::size_t r)
+      {
+        if (q == r) return;
+        distance_type dist
+          = _met.distance_to_key(_tree.rank()(), _tree.key(q), _tree.key(r));
+        typename std::vector<candidate>::iterator first
+          = _heaps.begin() + static_cast<std::ptrdiff_t>(q * _k);
+        if (_count[q] < _k)
+          {
+            *(first + static_cast<std::ptrdiff_t>(_count[q]))
+              = candidate(dist, r);
+            ++_count[q];
+            std::push_heap(first,
+                           first + static_cast<std::ptrdiff_t>(_count[q]));
+          }
+        else if (dist < first->first)
+          {
+            typename std::vector<candidate>::iterator last
+              = first + static_cast<std::ptrdiff_t>(_k);
+            std::pop_heap(first, last);
+            *(last - 1) = candidate(dist, r);
+            std::push_heap(first, last);
+          }
+      }
+
+      //! Search the element of the cell \c q in the sub-tree \c r.
+      void single(std::size_t q, std::size_t r, distance_type lower)
+      {
+        if (!(lower < point_bound(q))) return;
+        update(q, r);
+        const typename cell_tree::Cell& cell = _tree[r];
+        if (cell.left != cell_tree::none && cell.right != cell_tree::none)
+          {
+            distance_type left_lower
+              = key_cell_distance(_tree.key(q), _tree, cell.left, _met);
+            distance_type right_lower
+              = key_cell_distance(_tree.key(q), _tree, cell.right, _met);
+            if (left_lower < right_lower)
+              {
+                single(q, cell.left, left_lower);
+                single(q, cell.right, right_lower);
+              }
+            else
+              {
+                single(q, cell.right, right_lower);
+                single(q, cell.left, left_lower);
+              }
+          }
+        else if (cell.left != cell_tree::none)
+          {
+            single(q, cell.left,
+                   key_cell_distance(_tree.key(q), _tree, cell.left, _met));
+          }
+        else if (cell.right != cell_tree::none)
+          {
+            single(q, cell.right,
+                   key_cell_distance(_tree.key(q), _tree, cell.right, _met));
+          }
+      }
+
+      //! Offer the element of the cell \c r to all elements in the sub-tree
+      //! \c q.
+      void reverse(std::size_t q, std::size_t r, distance_type lower)
+      {
+        if (!(lower < _bound[q])) return;
+        update(q, r);
+        const typename cell_tree::Cell& cell = _tree[q];
+        if (cell.left != cell_tree::none)
+          {
+            reverse(cell.left, r,
+                    key_cell_distance(_tree.key(r), _tree, cell.left, _met));
+          }
+        if (cell.right != cell_tree::none)
+          {
+            reverse(cell.right, r,
+                    key_cell_distance(_tree.key(r), _tree, cell.right, _met));
+          }
+        refresh_bound(q);
+      }
+
+      //! Search all the elements of the sub-tree \c q in the sub-tree \c r.
+      void dual(std::size_t q, std::size_t r, distance_type lower)
+      {
+        if (!(lower < _bound[q])) return;
+        const typename cell_tree::Cell& query = _tree[q];
+        const typename cell_tree::Cell& reference = _tree[r];
+        if (query.size >= reference.size)
+          {
+            // Split the query cell
+            single(q, r, key_cell_distance(_tree.key(q), _tree, r, _met));
+            if (query.left != cell_tree::none)
+              {
+                dual(query.left, r,
+                     cell_distance(_tree, query.left, _tree, r, _met));
+              }
+            if (query.right != cell_tree::none)
+              {
+                dual(query.right, r,
+                     cell_distance(_tree, query.right, _tree, r, _met));
+              }
+            refresh_bound(q);
+          }
+        else
+          {
+            // Split the reference cell, visiting the nearest child first
+            reverse(q, r, key_cell_distance(_tree.key(r), _tree, q, _met));
+            if (reference.left != cell_tree::none
+                && reference.right != cell_tree::none)
+              {
+                distance_type left_lower
+                  = cell_distance(_tree, q, _tree, reference.left, _met);
+                distance_type right_lower
+                  = cell_distance(_tree, q, _tree, reference.right, _met);
+                if (left_lower < right_lower)
+                  {
+                    dual(q, reference.left, left_lower);
+                    dual(q, reference.right, right_lower);
+                  }
+                else
+                  {
+                    dual(q, reference.right, right_lower);
+                    dual(q, reference.left, left_lower);
+                  }
+              }
+            else if (reference.left != cell_tree::none)
+              {
+                dual(q, reference.left,
+                     cell_distance(_tree, q, _tree, reference.left, _met));
+              }
+            else if (reference.right != cell_tree::none)
+              {
+                dual(q, reference.right,
+                     cell_distance(_tree, q, _tree, reference.right, _met));
+              }
+          }
+      }
+
+      const cell_tree& _tree;
+      const Metric& _met;
+      std::size_t _k;
+      std::vector<candidate> _heaps;
+      std::vector<std::size_t> _count;
+      std::vector<distance_type> _bound;
+    };
+  } // namespace details
+
+  /**
+   *  Finds the \c k nearest neighbors of every element in \c container,
+   *  according to \c metric, and report them to \c visitor.
+   *
+   *  Rather than searching the neighbors of each element independently, the
+   *  tree of the container is traversed against itself and pairs of
+   *  sub-trees that are too far apart are discarded at once. This is
+   *  significantly faster than calling \ref neighbor_begin() for each element
+   *  of the container. When the library is compiled with OpenMP support, the
+   *  search is performed in parallel over independent sub-trees.
+   *
+   *  For each element of the container, \c visitor is called once, in no
+   *  particular order, as:
+   *
+   *  \code
+   *  visitor(element, neighbors);
+   *  \endcode
+   *
+   *  Where \c element is a \c Container::const_iterator pointing to the
+   *  element and \c neighbors is a \c std::vector of \c std::pair made of a
+   *  \c Container::const_iterator and the distance to \c element. The
+   *  neighbors are sorted from the nearest to the furthest, and do not
+   *  include \c element itself. If the container holds less than \c k + 1
+   *  elements, all other elements are listed. Elements with the same key as
+   *  \c element are listed with a null distance.
+   *
+   *  The container must not be modified during the search.
+   *
+   *  \param container The container in which the neighbors must be found.
+   *  \param metric The metric to use in search of the neighbors.
+   *  \param k The number of neighbors to find for each element.
+   *  \param visitor The functor receiving the neighbors of each element.
+   *  \return A copy of \c visitor, after it was called for each element.
+   */
+  template <typename Container, typename Metric, typename Visitor>
+  inline Visitor
+  all_neighbors(const Container& container, const Metric& metric,
+                size_type k, Visitor visitor)
+  {
+    if (container.empty()) return visitor;
+    typedef details::Cell_tree<Container> cell_tree;
+    typedef typename Container::const_iterator const_iterator;
+    typedef typename Metric::distance_type distance_type;
+    cell_tree tree(container);
+    details::All_neighbor_search<Container, Metric> search(tree, metric, k);
+    search.run();
+    std::vector<std::pair<const_iterator, distance_type> > neighbors;
+    neighbors.reserve(k);
+    for (std::size_t q = 0; q < tree.size(); ++q)
+      {
+        neighbors.clear();
+        std::size_t count = search.sort(q);
+        for (std::size_t n = 0; n < count; ++n)
+          {
+            neighbors.push_back
+              (std::make_pair
+               (const_iterator(tree[search.get(q, n).second].node),
+                search.get(q, n).first));
+          }
+        visitor(const_iterator(tree[q].node), neighbors);
+      }
+    return visitor;
+  }
+
+  /**
+   *  Finds the \c k nearest neighbors of every element in \c container,
+   *  assuming an euclidian metric with distances expressed in double. It
+   *  requires that the container used was defined with a built-in key compare
+   *  functor.
+   *
+   *  \param container The container in which the neighbors must be found.
+   *  \param k The number of neighbors to find for each element.
+   *  \param visitor The functor receiving the neighbors of each element.
+   *  \return A copy of \c visitor, after it was called for each element.
+   *  \see all_neighbors(const Container&, const Metric&, size_type, Visitor)
+   */
+  template <typename Container, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  all_neighbors(const Container& container, size_type k, Visitor visitor)
+  {
+    return all_neighbors
+      (container,
+       euclidian<Container, double,
+                 typename details::with_builtin_difference<Container>::type>
+       (details::with_builtin_difference<Container>()(container)),
+       k, visitor);
+  }
+} // namespace spatial
+
+#endif // SPATIAL_ALL_NEIGHBOR_HPP
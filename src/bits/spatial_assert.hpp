@@ -71,7 +71,8 @@ namespace spatial
               typename Alloc>
     class Kdtree;
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     class Relaxed_kdtree;
 
     template <typename Value>
@@ -340,11 +341,12 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline void assert_inspect
     (const char* msg, const char* filename, unsigned int line,
-     const details::Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>&
-     tree) throw()
+     const details::Relaxed_kdtree
+     <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& tree) throw()
     {
       try
         {
@@ -0,0 +1,280 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_box_neighbor.hpp
+ *  Contains the definition of box neighbor iterators. These iterators walk
+ *  through the boxes of a container in order from the closest to the
+ *  furthest away from a given point, where the distance to a box is the
+ *  distance to its closest point, using a \ref box_euclidian metric.
+ *
+ *  \see neighbor_iterator
+ */
+
+#ifndef SPATIAL_BOX_NEIGHBOR_HPP
+#define SPATIAL_BOX_NEIGHBOR_HPP
+
+#include "spatial_neighbor.hpp"
+#include "spatial_neighbor_visit.hpp"
+#include "spatial_except.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  The \ref box_euclidian metric used by default by the box neighbor
+     *  iterators, with distances expressed in double.
+     */
+    template <typename Container, typename Layout>
+    struct box_neighbor_metric
+    {
+      typedef box_euclidian
+      <typename mutate<Container>::type, double,
+       typename with_builtin_difference<Container>::type, Layout> type;
+
+      type operator()(const Container& container) const
+      { return type(with_builtin_difference<Container>()(container)); }
+    };
+  } // namespace details
+
+  /**
+   *  Facilitate the creation of neighbor iterator over a container of
+   *  boxes, that gives the boxes in order of their distance to a point,
+   *  using a \ref box_euclidian metric.
+   *
+   *  This class has an associated group of functions designed to initialize
+   *  the iterator position at the beginning, end, lower bound or upper bound
+   *  of the container to iterate. They require that the container was
+   *  defined with a built-in key compare functor; other containers can use
+   *  \ref neighbor_begin() with a \ref box_euclidian metric.
+   *
+   *  \tparam Container The container of boxes to iterate.
+   *  \tparam Layout One of \ref llhh_layout_tag, \ref lhlh_layout_tag, \ref
+   *  hhll_layout_tag or \ref hlhl_layout_tag.
+   */
+  ///@{
+  template <typename Container, typename Layout = llhh_layout_tag>
+  struct box_neighbor_iterator
+    : neighbor_iterator
+      <Container,
+       typename details::box_neighbor_metric<Container, Layout>::type>
+  {
+    /// defctor
+    box_neighbor_iterator() { }
+
+    box_neighbor_iterator
+    (const neighbor_iterator
+     <Container,
+      typename details::box_neighbor_metric<Container, Layout>::type>& other)
+      : neighbor_iterator
+        <Container,
+         typename details::box_neighbor_metric<Container, Layout>::type>
+        (other) { }
+  };
+
+  template <typename Container, typename Layout>
+  struct box_neighbor_iterator<const Container, Layout>
+    : neighbor_iterator
+      <const Container,
+       typename details::box_neighbor_metric<Container, Layout>::type>
+  {
+    /// defctor
+    box_neighbor_iterator() { }
+
+    box_neighbor_iterator
+    (const neighbor_iterator
+     <const Container,
+      typename details::box_neighbor_metric<Container, Layout>::type>& other)
+      : neighbor_iterator
+        <const Container,
+         typename details::box_neighbor_metric<Container, Layout>::type>
+        (other) { }
+
+    box_neighbor_iterator
+    (const neighbor_iterator
+     <Container,
+      typename details::box_neighbor_metric<Container, Layout>::type>& other)
+      : neighbor_iterator
+        <const Container,
+         typename details::box_neighbor_metric<Container, Layout>::type>
+        (other) { }
+  };
+  ///@}
+
+  /**
+   *  Returns a \ref box_neighbor_iterator pointing past-the-end.
+   *
+   *  \param container The container of boxes to iterate.
+   *  \param target The point, given as a box with equal lower and higher
+   *  coordinates, from which distances are computed.
+   *  \param layout The layout of the boxes in \c container.
+   */
+  ///@{
+  template <typename Container, typename Layout>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container, Layout> >::type
+  box_neighbor_end(Container& container,
+                   const typename Container::key_type& target,
+                   const Layout& layout)
+  {
+    except::check_box(container, target, layout);
+    return neighbor_end
+      (container,
+       details::box_neighbor_metric<Container, Layout>()(container), target);
+  }
+
+  template <typename Container>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container> >::type
+  box_neighbor_end(Container& container,
+                   const typename Container::key_type& target)
+  { return box_neighbor_end(container, target, llhh_layout_tag()); }
+  ///@}
+
+  /**
+   *  Returns a \ref box_neighbor_iterator pointing to the box closest to \c
+   *  target. Any box that contains \c target is at a null distance from it.
+   *
+   *  \param container The container of boxes to iterate.
+   *  \param target The point, given as a box with equal lower and higher
+   *  coordinates, from which distances are computed.
+   *  \param layout The layout of the boxes in \c container.
+   */
+  ///@{
+  template <typename Container, typename Layout>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container, Layout> >::type
+  box_neighbor_begin(Container& container,
+                     const typename Container::key_type& target,
+                     const Layout& layout)
+  {
+    except::check_box(container, target, layout);
+    return neighbor_begin
+      (container,
+       details::box_neighbor_metric<Container, Layout>()(container), target);
+  }
+
+  template <typename Container>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container> >::type
+  box_neighbor_begin(Container& container,
+                     const typename Container::key_type& target)
+  { return box_neighbor_begin(container, target, llhh_layout_tag()); }
+  ///@}
+
+  /**
+   *  Returns a \ref box_neighbor_iterator pointing to the box closest to \c
+   *  target that is at least as far as \c bound.
+   *
+   *  \param container The container of boxes to iterate.
+   *  \param target The point, given as a box with equal lower and higher
+   *  coordinates, from which distances are computed.
+   *  \param bound The minimum distance at which a box should be found.
+   *  \param layout The layout of the boxes in \c container.
+   */
+  ///@{
+  template <typename Container, typename Layout>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container, Layout> >::type
+  box_neighbor_lower_bound(Container& container,
+                           const typename Container::key_type& target,
+                           double bound, const Layout& layout)
+  {
+    except::check_box(container, target, layout);
+    return neighbor_lower_bound
+      (container,
+       details::box_neighbor_metric<Container, Layout>()(container), target,
+       bound);
+  }
+
+  template <typename Container>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container> >::type
+  box_neighbor_lower_bound(Container& container,
+                           const typename Container::key_type& target,
+                           double bound)
+  {
+    return box_neighbor_lower_bound(container, target, bound,
+                                    llhh_layout_tag());
+  }
+  ///@}
+
+  /**
+   *  Returns a \ref box_neighbor_iterator pointing to the box closest to \c
+   *  target that is strictly further than \c bound.
+   *
+   *  \param container The container of boxes to iterate.
+   *  \param target The point, given as a box with equal lower and higher
+   *  coordinates, from which distances are computed.
+   *  \param bound The distance beyond which a box should be found.
+   *  \param layout The layout of the boxes in \c container.
+   */
+  ///@{
+  template <typename Container, typename Layout>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container, Layout> >::type
+  box_neighbor_upper_bound(Container& container,
+                           const typename Container::key_type& target,
+                           double bound, const Layout& layout)
+  {
+    except::check_box(container, target, layout);
+    return neighbor_upper_bound
+      (container,
+       details::box_neighbor_metric<Container, Layout>()(container), target,
+       bound);
+  }
+
+  template <typename Container>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            box_neighbor_iterator<Container> >::type
+  box_neighbor_upper_bound(Container& container,
+                           const typename Container::key_type& target,
+                           double bound)
+  {
+    return box_neighbor_upper_bound(container, target, bound,
+                                    llhh_layout_tag());
+  }
+  ///@}
+
+  /**
+   *  Calls \c visitor for each box of \c container, from the closest to the
+   *  furthest away from the point \c target, until \c visitor returns false.
+   *  The distances are computed with a \ref box_euclidian metric, in double.
+   *
+   *  \see for_each_neighbor(Container&, const Metric&,
+   *  const typename Container::key_type&, Visitor)
+   */
+  ///@{
+  template <typename Container, typename Layout, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_box_neighbor(Container& container,
+                        const typename Container::key_type& target,
+                        const Layout& layout, Visitor visitor)
+  {
+    except::check_box(container, target, layout);
+    return for_each_neighbor
+      (container,
+       details::box_neighbor_metric<Container, Layout>()(container), target,
+       visitor);
+  }
+
+  template <typename Container, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_box_neighbor(Container& container,
+                        const typename Container::key_type& target,
+                        Visitor visitor)
+  {
+    return for_each_box_neighbor(container, target, llhh_layout_tag(),
+                                 visitor);
+  }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_BOX_NEIGHBOR_HPP
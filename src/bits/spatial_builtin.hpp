@@ -14,6 +14,7 @@
 #ifndef SPATIAL_COMPARE_BUILTIN_HPP
 #define SPATIAL_COMPARE_BUILTIN_HPP
 
+#include <iterator> // std::advance
 #include "spatial_import_type_traits.hpp"
 #include "spatial_check_concept.hpp"
 
@@ -247,6 +248,51 @@ namespace spatial
     struct rebind_builtin_difference<accessor_minus<Accessor, Tp, Unit>,
                                      DistanceType>
     { typedef accessor_minus<Accessor, Tp, DistanceType> type; };
+
+    /**
+     *  Returns the coordinate of \c key along \c dim in the type \c Unit,
+     *  read in the same way as the difference functor \c diff reads it. It
+     *  is used by the metrics that need the coordinates of the keys rather
+     *  than their differences, such as \ref great_circle.
+     *
+     *  A user-defined difference functor used with these metrics must
+     *  provide a member \c coordinate(dim, key) returning the coordinate.
+     */
+    ///@{
+    template <typename Unit, typename Diff, typename Key>
+    inline Unit
+    coordinate(const Diff& diff, dimension_type dim, const Key& key)
+    { return diff.coordinate(dim, key); }
+
+    template <typename Unit, typename Tp, typename AnyUnit>
+    inline Unit
+    coordinate(const bracket_minus<Tp, AnyUnit>&, dimension_type dim,
+               const Tp& key)
+    { return static_cast<Unit>(key[dim]); }
+
+    template <typename Unit, typename Tp, typename AnyUnit>
+    inline Unit
+    coordinate(const paren_minus<Tp, AnyUnit>&, dimension_type dim,
+               const Tp& key)
+    { return static_cast<Unit>(key(dim)); }
+
+    template <typename Unit, typename Tp, typename AnyUnit>
+    inline Unit
+    coordinate(const iterator_minus<Tp, AnyUnit>&, dimension_type dim,
+               const Tp& key)
+    {
+      typename Tp::const_iterator i = key.begin();
+      std::advance(i, static_cast<typename std::iterator_traits
+                   <typename Tp::const_iterator>::difference_type>(dim));
+      return static_cast<Unit>(*i);
+    }
+
+    template <typename Unit, typename Accessor, typename Tp, typename AnyUnit>
+    inline Unit
+    coordinate(const accessor_minus<Accessor, Tp, AnyUnit>& diff,
+               dimension_type dim, const Tp& key)
+    { return static_cast<Unit>(diff.accessor()(dim, key)); }
+    ///@}
   }
 }
 
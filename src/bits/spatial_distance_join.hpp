@@ -0,0 +1,329 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_distance_join.hpp
+ *  Provides the search of all pairs of elements from 2 containers that are
+ *  within a given distance of each other.
+ */
+
+#ifndef SPATIAL_DISTANCE_JOIN_HPP
+#define SPATIAL_DISTANCE_JOIN_HPP
+
+#include <vector>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include "../metric.hpp"
+#include "spatial_except.hpp"
+#include "spatial_dual_tree.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Walks the trees of 2 containers simultaneously and reports all pairs
+     *  of cells whose keys are within \c radius of each other.
+     *
+     *  Pairs of sub-trees are discarded as soon as the lower bound of the
+     *  distance between them exceeds the radius. Pairs are reported to a \c
+     *  Reporter functor as the indices of the cells in each tree, followed by
+     *  their distance.
+     */
+    template <typename ContainerA, typename ContainerB, typename Metric>
+    class Distance_join
+    {
+    public:
+      typedef Cell_tree<ContainerA>                   cell_tree_a;
+      typedef Cell_tree<ContainerB>                   cell_tree_b;
+      typedef typename Metric::distance_type          distance_type;
+
+      Distance_join(const cell_tree_a& a, const cell_tree_b& b,
+                    const Metric& met, distance_type radius)
+        : _a(a), _b(b), _met(met), _radius(radius) { }
+
+      //! Report all pairs in the sub-tree \c i of a and \c j of b.
+      template <typename Reporter>
+      void dual(std::size_t i, std::size_t j, Reporter& report) const
+      {
+        if (_radius < cell_distance(_a, i, _b, j, _met)) return;
+        const typename cell_tree_a::Cell& cell_a = _a[i];
+        const typename cell_tree_b::Cell& cell_b = _b[j];
+        if (cell_a.size >= cell_b.size)
+          {
+            single(i, j, report);
+            if (cell_a.left != cell_tree_a::none)
+              { dual(cell_a.left, j, report); }
+            if (cell_a.right != cell_tree_a::none)
+              { dual(cell_a.right, j, report); }
+          }
+        else
+          {
+            reverse(i, j, report);
+            if (cell_b.left != cell_tree_b::none)
+              { dual(i, cell_b.left, report); }
+            if (cell_b.right != cell_tree_b::none)
+              { dual(i, cell_b.right, report); }
+          }
+      }
+
+      //! Report all pairs made of the key of the cell \c i of a and the
+      //! sub-tree \c j of b.
+      template <typename Reporter>
+      void single(std::size_t i, std::size_t j, Reporter& report) const
+      {
+        if (_radius < key_cell_distance(_a.key(i), _b, j, _met)) return;
+        test(i, j, report);
+        const typename cell_tree_b::Cell& cell = _b[j];
+        if (cell.left != cell_tree_b::none) single(i, cell.left, report);
+        if (cell.right != cell_tree_b::none) single(i, cell.right, report);
+      }
+
+    private:
+      //! Report all pairs made of the sub-tree \c i of a and the key of the
+      //! cell \c j of b.
+      template <typename Reporter>
+      void reverse(std::size_t i, std::size_t j, Reporter& report) const
+      {
+        if (_radius < key_cell_distance(_b.key(j), _a, i, _met)) return;
+        test(i, j, report);
+        const typename cell_tree_a::Cell& cell = _a[i];
+        if (cell.left != cell_tree_a::none) reverse(cell.left, j, report);
+        if (cell.right != cell_tree_a::none) reverse(cell.right, j, report);
+      }
+
+      //! Report the pair made of the cell \c i of a and \c j of b if
+      //! their keys are within the radius.
+      template <typename Reporter>
+      void test(std::size_t i, std::size_t j, Reporter& report) const
+      {
+        distance_type dist
+          = _met.distance_to_key(_a.rank()(), _a.key(i), _b.key(j));
+        if (!(_radius < dist)) report(i, j, dist);
+      }
+
+      const cell_tree_a& _a;
+      const cell_tree_b& _b;
+      const Metric& _met;
+      distance_type _radius;
+    };
+
+    /**
+     *  Translates the cells reported by \ref Distance_join into iterators
+     *  that are given to the user's visitor.
+     */
+    template <typename ContainerA, typename ContainerB, typename Metric,
+              typename Visitor>
+    struct Distance_join_visitor
+    {
+      Distance_join_visitor(const Cell_tree<ContainerA>& a,
+                            const Cell_tree<ContainerB>& b,
+                            Visitor& visitor)
+        : _a(a), _b(b), _visitor(visitor) { }
+
+      void operator()(std::size_t i, std::size_t j,
+                      typename Metric::distance_type dist)
+      {
+        _visitor(typename ContainerA::const_iterator(_a[i].node),
+                 typename ContainerB::const_iterator(_b[j].node), dist);
+      }
+
+    private:
+      const Cell_tree<ContainerA>& _a;
+      const Cell_tree<ContainerB>& _b;
+      Visitor& _visitor;
+    };
+
+    /**
+     *  Stores the cells reported by \ref Distance_join, so they can be
+     *  visited after the parallel search.
+     */
+    template <typename DistanceType>
+    struct Distance_join_buffer
+    {
+      struct Pair
+      {
+        std::size_t first;
+        std::size_t second;
+        DistanceType distance;
+      };
+
+      void operator()(std::size_t i, std::size_t j, DistanceType dist)
+      {
+        Pair pair;
+        pair.first = i;
+        pair.second = j;
+        pair.distance = dist;
+        pairs.push_back(pair);
+      }
+
+      std::vector<Pair> pairs;
+    };
+  } // namespace details
+
+  /**
+   *  Finds all pairs made of an element of \c a and an element of \c b that
+   *  are within \c radius of each other, according to \c metric, and report
+   *  them to \c visitor as soon as they are found.
+   *
+   *  The trees of both containers are walked simultaneously and pairs of
+   *  sub-trees that are too far apart are discarded at once, which avoids
+   *  repeating the same work near the root of \c b for each element of \c a.
+   *  For each pair found, \c visitor is called, in no particular order, as:
+   *
+   *  \code
+   *  visitor(element_a, element_b, distance);
+   *  \endcode
+   *
+   *  Where \c element_a is a \c ContainerA::const_iterator, \c element_b is a
+   *  \c ContainerB::const_iterator and \c distance is the distance between
+   *  them, which is less than or equal to \c radius. Both containers must
+   *  have the same key type, the same rank and must not be modified during
+   *  the search.
+   *
+   *  \param a The first container of the join.
+   *  \param b The second container of the join.
+   *  \param metric The metric used to compute distances between elements.
+   *  \param radius The largest distance between the elements of a pair.
+   *  \param visitor The functor receiving each pair.
+   *  \return A copy of \c visitor, after it was called for each pair.
+   *  \throws invalid_rank If the ranks of \c a and \c b are different.
+   *  \see parallel_distance_join()
+   */
+  template <typename ContainerA, typename ContainerB, typename Metric,
+            typename Visitor>
+  inline Visitor
+  distance_join(const ContainerA& a, const ContainerB& b, const Metric& metric,
+                typename Metric::distance_type radius, Visitor visitor)
+  {
+    except::check_same_rank(a.dimension(), b.dimension());
+    if (a.empty() || b.empty()) return visitor;
+    details::Cell_tree<ContainerA> tree_a(a);
+    details::Cell_tree<ContainerB> tree_b(b);
+    details::Distance_join<ContainerA, ContainerB, Metric>
+      join(tree_a, tree_b, metric, radius);
+    details::Distance_join_visitor<ContainerA, ContainerB, Metric, Visitor>
+      report(tree_a, tree_b, visitor);
+    join.dual(0, 0, report);
+    return visitor;
+  }
+
+  /**
+   *  Finds all pairs made of an element of \c a and an element of \c b that
+   *  are within \c radius of each other, assuming an euclidian metric with
+   *  distances expressed in double. It requires that the containers used
+   *  were defined with a built-in key compare functor.
+   *
+   *  \see distance_join(const ContainerA&, const ContainerB&, const Metric&,
+   *  typename Metric::distance_type, Visitor)
+   */
+  template <typename ContainerA, typename ContainerB, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<ContainerA>,
+                            Visitor>::type
+  distance_join(const ContainerA& a, const ContainerB& b, double radius,
+                Visitor visitor)
+  {
+    return distance_join
+      (a, b,
+       euclidian<ContainerA, double,
+                 typename details::with_builtin_difference<ContainerA>::type>
+       (details::with_builtin_difference<ContainerA>()(a)),
+       radius, visitor);
+  }
+
+  /**
+   *  Finds all pairs made of an element of \c a and an element of \c b that
+   *  are within \c radius of each other, like \ref distance_join(), but
+   *  splits the search in independent tasks that are run in parallel when
+   *  the library is compiled with OpenMP.
+   *
+   *  The pairs found by each task are buffered, and \c visitor is called for
+   *  all of them from the calling thread once the search is complete;
+   *  therefore \c visitor does not need to be thread-safe.
+   *
+   *  \see distance_join(const ContainerA&, const ContainerB&, const Metric&,
+   *  typename Metric::distance_type, Visitor)
+   */
+  template <typename ContainerA, typename ContainerB, typename Metric,
+            typename Visitor>
+  inline Visitor
+  parallel_distance_join(const ContainerA& a, const ContainerB& b,
+                         const Metric& metric,
+                         typename Metric::distance_type radius,
+                         Visitor visitor)
+  {
+    except::check_same_rank(a.dimension(), b.dimension());
+    if (a.empty() || b.empty()) return visitor;
+    typedef details::Distance_join_buffer<typename Metric::distance_type>
+      buffer_type;
+    details::Cell_tree<ContainerA> tree_a(a);
+    details::Cell_tree<ContainerB> tree_b(b);
+    details::Distance_join<ContainerA, ContainerB, Metric>
+      join(tree_a, tree_b, metric, radius);
+#ifdef _OPENMP
+    const std::size_t target
+      = 8 * static_cast<std::size_t>(omp_get_max_threads());
+#else
+    const std::size_t target = 1;
+#endif
+    std::vector<std::size_t> upper, tasks;
+    details::partition_cells(tree_a, target, upper, tasks);
+    std::vector<buffer_type> buffers(upper.size() + tasks.size());
+    const long upper_size = static_cast<long>(upper.size());
+    const long tasks_size = static_cast<long>(tasks.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (long i = 0; i < upper_size + tasks_size; ++i)
+      {
+        std::size_t n = static_cast<std::size_t>(i);
+        if (i < upper_size)
+          { join.single(upper[n], 0, buffers[n]); }
+        else
+          { join.dual(tasks[n - upper.size()], 0, buffers[n]); }
+      }
+    for (typename std::vector<buffer_type>::const_iterator
+           i = buffers.begin(); i != buffers.end(); ++i)
+      {
+        for (typename std::vector<typename buffer_type::Pair>::const_iterator
+               j = i->pairs.begin(); j != i->pairs.end(); ++j)
+          {
+            visitor(typename ContainerA::const_iterator(tree_a[j->first].node),
+                    typename ContainerB::const_iterator
+                    (tree_b[j->second].node), j->distance);
+          }
+      }
+    return visitor;
+  }
+
+  /**
+   *  Finds all pairs made of an element of \c a and an element of \c b that
+   *  are within \c radius of each other, in parallel, assuming an euclidian
+   *  metric with distances expressed in double. It requires that the
+   *  containers used were defined with a built-in key compare functor.
+   *
+   *  \see parallel_distance_join(const ContainerA&, const ContainerB&,
+   *  const Metric&, typename Metric::distance_type, Visitor)
+   */
+  template <typename ContainerA, typename ContainerB, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<ContainerA>,
+                            Visitor>::type
+  parallel_distance_join(const ContainerA& a, const ContainerB& b,
+                         double radius, Visitor visitor)
+  {
+    return parallel_distance_join
+      (a, b,
+       euclidian<ContainerA, double,
+                 typename details::with_builtin_difference<ContainerA>::type>
+       (details::with_builtin_difference<ContainerA>()(a)),
+       radius, visitor);
+  }
+} // namespace spatial
+
+#endif // SPATIAL_DISTANCE_JOIN_HPP
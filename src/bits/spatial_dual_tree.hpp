@@ -0,0 +1,268 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_dual_tree.hpp
+ *
+ *  Contains the definition of \ref spatial::details::Cell_tree, a flattened
+ *  view of a container's tree where each sub-tree knows the extent of the keys
+ *  it holds. This view is shared by the algorithms that walk two trees at the
+ *  same time, such as the all nearest neighbors search or the distance join.
+ */
+
+#ifndef SPATIAL_DUAL_TREE_HPP
+#define SPATIAL_DUAL_TREE_HPP
+
+#include <vector>
+#include <cstddef> // std::size_t
+#include "spatial_node.hpp"
+#include "spatial_assert.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  A read-only, flattened copy of the structure of a container's tree.
+     *
+     *  The nodes of the tree are stored in pre-order, so that all the nodes
+     *  of a sub-tree are found in a contiguous range of cells starting with the
+     *  root of that sub-tree. For each cell, the extent of the keys held by the
+     *  sub-tree is recorded: in each dimension, the cell points to the key with
+     *  the lowest coordinate and to the key with the highest coordinate. The
+     *  extent is computed from the keys themselves and not from the splitting
+     *  planes of the ancestors, therefore it is valid for both the strict and
+     *  the relaxed invariants of the trees.
+     *
+     *  The cells only hold pointers to the keys in the container. The
+     *  container must not be modified while the cell tree is in use.
+     *
+     *  \tparam Container The type of container being represented.
+     */
+    template <typename Container>
+    struct Cell_tree
+    {
+      typedef typename Container::key_type             key_type;
+      typedef typename Container::key_compare          key_compare;
+      typedef typename Container::rank_type            rank_type;
+      typedef typename Container::mode_type::const_node_ptr node_ptr;
+
+      //! The value used to indicate that a cell has no left or right child.
+      static const std::size_t none = 0;
+
+      //! The structure of the tree for one node.
+      struct Cell
+      {
+        //! The node this cell represents.
+        node_ptr node;
+        //! Index of the left child cell, or \c none.
+        std::size_t left;
+        //! Index of the right child cell, or \c none.
+        std::size_t right;
+        //! Index of the parent cell. The root cell is its own parent.
+        std::size_t parent;
+        //! Number of nodes in the sub-tree rooted at this cell.
+        std::size_t size;
+      };
+
+      /**
+       *  Build the cell tree for all the nodes of \c container, which must not
+       *  be empty.
+       */
+      explicit Cell_tree(const Container& container)
+        : _rank(container.rank()), _key_comp(container.key_comp())
+      {
+        SPATIAL_ASSERT_CHECK(!container.empty());
+        const std::size_t n = container.size();
+        const dimension_type dims = _rank();
+        _cells.reserve(n);
+        _bounds.reserve(n * 2 * dims);
+        // Number the cells in pre-order, iteratively.
+        node_ptr node = container.end().node->parent;
+        std::vector<std::size_t> index_of_parent;
+        while (!header(node))
+          {
+            Cell cell;
+            cell.node = node;
+            cell.left = cell.right = none;
+            cell.parent = 0;
+            cell.size = 1;
+            std::size_t current = _cells.size();
+            if (current != 0)
+              {
+                // The parent of a node is the most recent cell that has
+                // this node as a child, found by walking back from the top.
+                while (_cells[index_of_parent.back()].node != node->parent)
+                  { index_of_parent.pop_back(); }
+                cell.parent = index_of_parent.back();
+                if (node->parent->left == node)
+                  { _cells[cell.parent].left = current; }
+                else
+                  { _cells[cell.parent].right = current; }
+              }
+            _cells.push_back(cell);
+            index_of_parent.push_back(current);
+            const key_type* key = &const_key(node);
+            for (dimension_type i = 0; i < dims; ++i)
+              {
+                _bounds.push_back(key);
+                _bounds.push_back(key);
+              }
+            node = preorder_increment(node);
+          }
+        // Merge the extent of the children into their parent, in reverse
+        // pre-order so that children are complete before being merged.
+        for (std::size_t i = _cells.size() - 1; i != 0; --i)
+          {
+            std::size_t p = _cells[i].parent;
+            _cells[p].size += _cells[i].size;
+            for (dimension_type d = 0; d < dims; ++d)
+              {
+                if (_key_comp(d, *low(i, d), *low(p, d)))
+                  { _bounds[2 * (p * dims + d)] = low(i, d); }
+                if (_key_comp(d, *high(p, d), *high(i, d)))
+                  { _bounds[2 * (p * dims + d) + 1] = high(i, d); }
+              }
+          }
+      }
+
+      //! The number of cells in the tree.
+      std::size_t size() const { return _cells.size(); }
+
+      //! The cell at index \c i.
+      const Cell& operator[](std::size_t i) const { return _cells[i]; }
+
+      //! The key held by the node of cell \c i.
+      const key_type& key(std::size_t i) const
+      { return const_key(_cells[i].node); }
+
+      //! The key with the lowest coordinate along \c d in the cell \c i.
+      const key_type* low(std::size_t i, dimension_type d) const
+      { return _bounds[2 * (i * _rank() + d)]; }
+
+      //! The key with the highest coordinate along \c d in the cell \c i.
+      const key_type* high(std::size_t i, dimension_type d) const
+      { return _bounds[2 * (i * _rank() + d) + 1]; }
+
+      //! The rank of the container represented.
+      rank_type rank() const { return _rank; }
+
+      //! The key comparator of the container represented.
+      const key_compare& key_comp() const { return _key_comp; }
+
+    private:
+      rank_type _rank;
+      key_compare _key_comp;
+      std::vector<Cell> _cells;
+      std::vector<const key_type*> _bounds;
+    };
+
+    template <typename Container>
+    const std::size_t Cell_tree<Container>::none;
+
+    /**
+     *  Cut \c tree in at least \c target sub-trees that do not contain one
+     *  another, unless there are not enough nodes in the tree.
+     *
+     *  The tree is cut level by level, starting from the root. The roots of
+     *  the resulting sub-trees are stored in \c tasks, while the cells found
+     *  above the cut are stored in \c upper; together, they cover the tree
+     *  exactly once.
+     */
+    template <typename CellTree>
+    inline void
+    partition_cells(const CellTree& tree, std::size_t target,
+                    std::vector<std::size_t>& upper,
+                    std::vector<std::size_t>& tasks)
+    {
+      upper.clear();
+      tasks.assign(1, 0);
+      while (tasks.size() < target)
+        {
+          std::vector<std::size_t> next;
+          const std::size_t split = upper.size();
+          for (std::vector<std::size_t>::const_iterator
+                 i = tasks.begin(); i != tasks.end(); ++i)
+            {
+              const typename CellTree::Cell& cell = tree[*i];
+              if (cell.left == CellTree::none && cell.right == CellTree::none)
+                { next.push_back(*i); continue; }
+              upper.push_back(*i);
+              if (cell.left != CellTree::none) next.push_back(cell.left);
+              if (cell.right != CellTree::none) next.push_back(cell.right);
+            }
+          if (upper.size() == split) break; // only leaves remain
+          tasks.swap(next);
+        }
+    }
+
+    /**
+     *  Returns a lower bound of the distance between any key in the cell \c i
+     *  of \c a and any key in the cell \c j of \c b, using the metric \c met.
+     *
+     *  The bound is the largest distance to plane among the dimensions in
+     *  which both cells do not overlap, thus it relies on the same property of
+     *  \metric that makes \c distance_to_plane usable for pruning in the
+     *  nearest neighbor search. The result is 0 when the cells overlap.
+     */
+    template <typename CellTreeA, typename CellTreeB, typename Metric>
+    inline typename Metric::distance_type
+    cell_distance(const CellTreeA& a, std::size_t i,
+                  const CellTreeB& b, std::size_t j, const Metric& met)
+    {
+      typename Metric::distance_type best = typename Metric::distance_type();
+      const dimension_type dims = a.rank()();
+      for (dimension_type d = 0; d < dims; ++d)
+        {
+          if (a.key_comp()(d, *a.high(i, d), *b.low(j, d)))
+            {
+              typename Metric::distance_type gap = met.distance_to_plane
+                (a.rank()(), d, *a.high(i, d), *b.low(j, d));
+              if (best < gap) { best = gap; }
+            }
+          else if (a.key_comp()(d, *b.high(j, d), *a.low(i, d)))
+            {
+              typename Metric::distance_type gap = met.distance_to_plane
+                (a.rank()(), d, *a.low(i, d), *b.high(j, d));
+              if (best < gap) { best = gap; }
+            }
+        }
+      return best;
+    }
+
+    /**
+     *  Returns a lower bound of the distance between \c key and any key in the
+     *  cell \c j of \c b, using the metric \c met. See \ref cell_distance().
+     */
+    template <typename CellTree, typename Metric>
+    inline typename Metric::distance_type
+    key_cell_distance(const typename CellTree::key_type& key,
+                      const CellTree& b, std::size_t j, const Metric& met)
+    {
+      typename Metric::distance_type best = typename Metric::distance_type();
+      const dimension_type dims = b.rank()();
+      for (dimension_type d = 0; d < dims; ++d)
+        {
+          if (b.key_comp()(d, key, *b.low(j, d)))
+            {
+              typename Metric::distance_type gap = met.distance_to_plane
+                (b.rank()(), d, key, *b.low(j, d));
+              if (best < gap) { best = gap; }
+            }
+          else if (b.key_comp()(d, *b.high(j, d), key))
+            {
+              typename Metric::distance_type gap = met.distance_to_plane
+                (b.rank()(), d, key, *b.high(j, d));
+              if (best < gap) { best = gap; }
+            }
+        }
+      return best;
+    }
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_DUAL_TREE_HPP
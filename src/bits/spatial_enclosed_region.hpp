@@ -80,6 +80,26 @@ namespace spatial
       return enclose_bounds_impl(dim, rank, key, Layout());
     }
 
+    /**
+     *  Returns \c true if the box \c key is below the target box along \c
+     *  dim, which is the same as the operator returning \ref below, with a
+     *  single comparison.
+     */
+    bool
+    less_than_lower_bound(dimension_type dim, dimension_type rank,
+                          const Key& key) const
+    { return enclose_below_impl(dim, rank, key, Layout()); }
+
+    /**
+     *  Returns \c true if the box \c key is above the target box along \c
+     *  dim, which is the same as the operator returning \ref above, with a
+     *  single comparison.
+     */
+    bool
+    greater_than_upper_bound(dimension_type dim, dimension_type rank,
+                             const Key& key) const
+    { return enclose_above_impl(dim, rank, key, Layout()); }
+
   private:
     /**
      *  The box value that will be used for the enclosing comparison.
@@ -137,8 +157,87 @@ namespace spatial
            ? above : (Compare::operator()(dim, key, _target)
                       ? below : matching));
     }
+
+    bool enclose_below_impl
+    (dimension_type dim, dimension_type rank, const Key& key, llhh_layout_tag)
+    const
+    {
+      return (dim < (rank >> 1))
+        ? Compare::operator()(dim, key, _target)
+        : Compare::operator()(dim, key, dim - (rank >> 1), _target);
+    }
+
+    bool enclose_above_impl
+    (dimension_type dim, dimension_type rank, const Key& key, llhh_layout_tag)
+    const
+    {
+      return (dim < (rank >> 1))
+        ? Compare::operator()(dim + (rank >> 1), _target, dim, key)
+        : Compare::operator()(dim, _target, key);
+    }
+
+    bool enclose_below_impl
+    (dimension_type dim, dimension_type, const Key& key, lhlh_layout_tag)
+    const
+    {
+      return ((dim % 2) == 0)
+        ? Compare::operator()(dim, key, _target)
+        : Compare::operator()(dim, key, dim - 1, _target);
+    }
+
+    bool enclose_above_impl
+    (dimension_type dim, dimension_type, const Key& key, lhlh_layout_tag)
+    const
+    {
+      return ((dim % 2) == 0)
+        ? Compare::operator()(dim + 1, _target, dim, key)
+        : Compare::operator()(dim, _target, key);
+    }
+
+    bool enclose_below_impl
+    (dimension_type dim, dimension_type rank, const Key& key, hhll_layout_tag)
+    const
+    {
+      return (dim < (rank >> 1))
+        ? Compare::operator()(dim, key, dim + (rank >> 1), _target)
+        : Compare::operator()(dim, key, _target);
+    }
+
+    bool enclose_above_impl
+    (dimension_type dim, dimension_type rank, const Key& key, hhll_layout_tag)
+    const
+    {
+      return (dim < (rank >> 1))
+        ? Compare::operator()(dim, _target, key)
+        : Compare::operator()(dim - (rank >> 1), _target, dim, key);
+    }
+
+    bool enclose_below_impl
+    (dimension_type dim, dimension_type, const Key& key, hlhl_layout_tag)
+    const
+    {
+      return ((dim % 2) == 0)
+        ? Compare::operator()(dim, key, dim + 1, _target)
+        : Compare::operator()(dim, key, _target);
+    }
+
+    bool enclose_above_impl
+    (dimension_type dim, dimension_type, const Key& key, hlhl_layout_tag)
+    const
+    {
+      return ((dim % 2) == 0)
+        ? Compare::operator()(dim, _target, key)
+        : Compare::operator()(dim - 1, _target, dim, key);
+    }
   };
 
+  namespace details
+  {
+    template <typename Key, typename Compare, typename Layout>
+    struct is_two_sided_predicate<enclosed_bounds<Key, Compare, Layout> >
+      : import::true_type { };
+  } // namespace details
+
   /**
    *  Enclosed bounds factory that takes in a \c container, a \c key and
    *  returns an \ref enclosed_bounds type.
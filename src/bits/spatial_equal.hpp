@@ -15,6 +15,7 @@
 #ifndef SPATIAL_EQUAL_HPP
 #define SPATIAL_EQUAL_HPP
 
+#include <vector>
 #include "spatial_import_tuple.hpp"
 #include "spatial_assert.hpp"
 
@@ -79,6 +80,86 @@ namespace spatial
         }
     }
 
+    /**
+     *  Counts the nodes equal to a key, while keeping track, for each
+     *  dimension, of whether the sub-tree being visited is bounded below and
+     *  above by ancestors whose coordinate equals that of the key. When it
+     *  is so on every dimension, all the keys in the sub-tree are equal to
+     *  the key, and the sub-tree is counted at once with \ref subtree_size(),
+     *  which is done in constant time in a relaxed \kdtree.
+     *
+     *  Since the coordinates of the ancestors that bound a sub-tree only get
+     *  closer to the key as the walk goes down, a sub-tree whose bound equals
+     *  the key on one side keeps it for all of its descendants.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key>
+    class Equal_count
+    {
+    public:
+      Equal_count(Rank rank, const KeyCompare& key_comp, const Key& key)
+        : _rank(rank), _key_comp(key_comp), _key(key),
+          _low(rank(), false), _high(rank(), false), _pinned(0) { }
+
+      //! Returns the number of nodes equal to the key in the sub-tree of
+      //! \c node, where \c dim is the dimension of \c node.
+      size_type run(NodePtr node, dimension_type dim)
+      {
+        SPATIAL_ASSERT_CHECK(dim < _rank());
+        SPATIAL_ASSERT_CHECK(node != 0);
+        SPATIAL_ASSERT_CHECK(!header(node));
+        if (_pinned == _rank()) return subtree_size(node);
+        bool walk_left = !_key_comp(dim, const_key(node), _key);
+        bool walk_right = !_key_comp(dim, _key, const_key(node));
+        bool equal = walk_left && walk_right;
+        size_type count = 0;
+        if (equal)
+          {
+            dimension_type test = 0;
+            for (; test < _rank()
+                   && (test == dim
+                       || !(_key_comp(test, _key, const_key(node))
+                            || _key_comp(test, const_key(node), _key)));
+                 ++test);
+            if (test == _rank()) ++count;
+          }
+        dimension_type child_dim = incr_dim(_rank, dim);
+        if (walk_left && node->left != 0)
+          {
+            bool save = _high[dim];
+            pin(_high, dim, save || equal);
+            count += run(node->left, child_dim);
+            pin(_high, dim, save);
+          }
+        if (walk_right && node->right != 0)
+          {
+            bool save = _low[dim];
+            pin(_low, dim, save || equal);
+            count += run(node->right, child_dim);
+            pin(_low, dim, save);
+          }
+        return count;
+      }
+
+    private:
+      //! Sets one of the bounds along \c dim as equal to the key or not, and
+      //! update the number of dimensions pinned to the key on both sides.
+      void pin(std::vector<bool>& bounds, dimension_type dim, bool equal)
+      {
+        bool was_pinned = _low[dim] && _high[dim];
+        bounds[dim] = equal;
+        bool pinned = _low[dim] && _high[dim];
+        if (pinned && !was_pinned) ++_pinned;
+        else if (was_pinned && !pinned) --_pinned;
+      }
+
+      Rank _rank;
+      KeyCompare _key_comp;
+      const Key& _key;
+      std::vector<bool> _low;
+      std::vector<bool> _high;
+      dimension_type _pinned;
+    };
   } // namespace details
 } // namespace spatial
 
@@ -0,0 +1,228 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2014.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_equal_index.hpp
+ *  Contains the definition of the hash index that a relaxed \kdtree may keep
+ *  next to its nodes, to find the nodes equal to a key without walking the
+ *  tree.
+ */
+
+#ifndef SPATIAL_EQUAL_INDEX_HPP
+#define SPATIAL_EQUAL_INDEX_HPP
+
+#include <vector>
+#include <algorithm> // std::swap
+#include "spatial_mutate.hpp"
+#include "spatial_node.hpp"
+#include "spatial_rank.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Tells whether 2 keys are equal along the dimensions given by \ref
+     *  for_each_dim().
+     */
+    template <typename KeyCompare, typename Key>
+    struct Equal_dim
+    {
+      Equal_dim(const KeyCompare& key_comp_, const Key& a_, const Key& b_)
+        : key_comp(key_comp_), a(a_), b(b_) { }
+
+      bool operator()(dimension_type dim) const
+      { return !(key_comp(dim, a, b) || key_comp(dim, b, a)); }
+
+      const KeyCompare& key_comp;
+      const Key& a;
+      const Key& b;
+    };
+
+    /**
+     *  The link allocated by a relaxed \kdtree that keeps an \ref
+     *  Equal_index: \c Link extended with the position of the node in the
+     *  chain of its bucket.
+     */
+    template <typename Link>
+    struct Indexed_kdtree_link : Link
+    {
+      //! \empty
+      Indexed_kdtree_link() { }
+
+      //! The position of the node in the chain of its bucket.
+      size_type index_position;
+
+    private:
+      //! The link_type is a non-assignable type.
+      Indexed_kdtree_link<Link>& operator= (const Indexed_kdtree_link<Link>&);
+    };
+
+    /**
+     *  A hash table of the nodes of a relaxed \kdtree, where the nodes with
+     *  equal keys are stored in the same bucket. The tree adds each node to
+     *  the index when it is created, and removes it when it is destroyed;
+     *  since nodes keep their value when the tree is rebalanced, the index
+     *  never needs to be updated otherwise.
+     *
+     *  The nodes are chained in vectors, one per bucket, and the number of
+     *  buckets doubles when it falls below the number of nodes. Each node
+     *  stores its position in the chain, so that it is removed in constant
+     *  time, however many nodes share its key. The specialization for \c
+     *  void stores nothing and does nothing.
+     *
+     *  \tparam Hash A default constructible functor returning a \c
+     *  std::size_t for a key, such that equal keys give equal results.
+     *  \tparam Link The link that the tree would allocate without an index.
+     */
+    template <typename Key, typename Value, typename Hash, typename Link>
+    class Equal_index : private Hash
+    {
+    public:
+      typedef Node<Relaxed_kdtree_link<Key, Value> >* node_ptr;
+
+      //! The type of link allocated by the tree.
+      typedef Indexed_kdtree_link<Link> link_type;
+
+      //! True when the index holds the nodes of the tree.
+      static const bool enabled = true;
+
+      Equal_index() : Hash(), _size(0) { }
+
+      //! Copies the hash functor, but not the nodes: the tree copied adds
+      //! its own nodes as they are cloned.
+      Equal_index(const Equal_index& other) : Hash(other), _size(0) { }
+
+      //! Adds \c node to the index.
+      void insert(node_ptr node)
+      {
+        if (_size >= _buckets.size()) rehash(_size < 8 ? 16 : 2 * _size);
+        std::vector<node_ptr>& chain = _buckets[bucket(const_key(node))];
+        chain.push_back(node);
+        position(node) = chain.size() - 1;
+        ++_size;
+      }
+
+      //! Removes \c node from the index, in constant time.
+      void erase(node_ptr node)
+      {
+        std::vector<node_ptr>& chain = _buckets[bucket(const_key(node))];
+        size_type i = position(node);
+        SPATIAL_ASSERT_CHECK(i < chain.size() && chain[i] == node);
+        chain[i] = chain.back();
+        position(chain[i]) = i;
+        chain.pop_back();
+        --_size;
+      }
+
+      //! Returns one of the nodes equal to \c key, or null if there is none.
+      template <typename Rank, typename KeyCompare>
+      node_ptr find(Rank rank, const KeyCompare& key_comp,
+                    const typename mutate<Key>::type& key) const
+      {
+        if (_size == 0) return 0;
+        const std::vector<node_ptr>& chain = _buckets[bucket(key)];
+        for (typename std::vector<node_ptr>::const_iterator i = chain.begin();
+             i != chain.end(); ++i)
+          { if (equal(rank, key_comp, const_key(*i), key)) return *i; }
+        return 0;
+      }
+
+      //! Appends all nodes equal to \c key to \c nodes.
+      template <typename Rank, typename KeyCompare>
+      void equal_nodes(Rank rank, const KeyCompare& key_comp,
+                       const typename mutate<Key>::type& key,
+                       std::vector<node_ptr>& nodes) const
+      {
+        if (_size == 0) return;
+        const std::vector<node_ptr>& chain = _buckets[bucket(key)];
+        for (typename std::vector<node_ptr>::const_iterator i = chain.begin();
+             i != chain.end(); ++i)
+          {
+            if (equal(rank, key_comp, const_key(*i), key))
+              nodes.push_back(*i);
+          }
+      }
+
+      void swap(Equal_index& other)
+      {
+        _buckets.swap(other._buckets);
+        std::swap(_size, other._size);
+      }
+
+    private:
+      const Hash& hash() const { return *this; }
+
+      size_type bucket(const typename mutate<Key>::type& key) const
+      { return bucket(key, _buckets.size()); }
+
+      size_type bucket(const typename mutate<Key>::type& key,
+                       size_type count) const
+      { return static_cast<size_type>(hash()(key) % count); }
+
+      static size_type& position(node_ptr node)
+      { return static_cast<link_type*>(link(node))->index_position; }
+
+      template <typename Rank, typename KeyCompare, typename AnyKey>
+      static bool equal(Rank rank, const KeyCompare& key_comp,
+                        const AnyKey& a, const AnyKey& b)
+      {
+        Equal_dim<KeyCompare, AnyKey> op(key_comp, a, b);
+        return for_each_dim(rank, op);
+      }
+
+      //! Moves the nodes to \c count buckets. The new buckets are filled
+      //! before they replace the current ones, so that the index is left
+      //! unchanged if an allocation throws.
+      void rehash(size_type count)
+      {
+        std::vector<std::vector<node_ptr> > buckets(count);
+        for (typename std::vector<std::vector<node_ptr> >::const_iterator
+               i = _buckets.begin(); i != _buckets.end(); ++i)
+          for (typename std::vector<node_ptr>::const_iterator
+                 j = i->begin(); j != i->end(); ++j)
+            buckets[bucket(const_key(*j), count)].push_back(*j);
+        _buckets.swap(buckets);
+        for (typename std::vector<std::vector<node_ptr> >::const_iterator
+               i = _buckets.begin(); i != _buckets.end(); ++i)
+          for (size_type j = 0; j < i->size(); ++j)
+            position((*i)[j]) = j;
+      }
+
+      std::vector<std::vector<node_ptr> > _buckets;
+      size_type _size;
+    };
+
+    template <typename Key, typename Value, typename Link>
+    struct Equal_index<Key, Value, void, Link>
+    {
+      typedef Node<Relaxed_kdtree_link<Key, Value> >* node_ptr;
+
+      typedef Link link_type;
+
+      static const bool enabled = false;
+
+      void insert(node_ptr) { }
+
+      void erase(node_ptr) { }
+
+      template <typename Rank, typename KeyCompare>
+      node_ptr find(Rank, const KeyCompare&,
+                    const typename mutate<Key>::type&) const
+      { return 0; }
+
+      template <typename Rank, typename KeyCompare>
+      void equal_nodes(Rank, const KeyCompare&,
+                       const typename mutate<Key>::type&,
+                       std::vector<node_ptr>&) const { }
+
+      void swap(Equal_index&) { }
+    };
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_EQUAL_INDEX_HPP
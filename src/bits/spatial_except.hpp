@@ -42,6 +42,20 @@ namespace spatial
         }
     }
 
+    /**
+     *  Checks that the ranks \c rank1 and \c rank2 of 2 containers are equal.
+     *  \throws invalid_rank is thrown if checks fails.
+     */
+    inline void check_same_rank(dimension_type rank1, dimension_type rank2)
+    {
+      if (rank1 != rank2)
+        {
+          std::stringstream out;
+          out << rank1 << " is different from " << rank2;
+          throw invalid_rank(out.str());
+        }
+    }
+
     /**
      *  Checks that \c dimension is not greater or equal to \c rank.
      *  \throws invalid_dimension is thrown if checks fails.
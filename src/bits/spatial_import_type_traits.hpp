@@ -46,6 +46,8 @@ namespace spatial
     using SPATIAL_TYPE_TRAITS_NAMESPACE::is_floating_point;
     using SPATIAL_TYPE_TRAITS_NAMESPACE::true_type;
     using SPATIAL_TYPE_TRAITS_NAMESPACE::false_type;
+    using SPATIAL_TYPE_TRAITS_NAMESPACE::integral_constant;
+    using SPATIAL_TYPE_TRAITS_NAMESPACE::is_same;
   }
 }
 
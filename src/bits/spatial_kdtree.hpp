@@ -564,6 +564,26 @@ namespace spatial
       }
       ///@}
 
+      /**
+       *  Returns the number of elements that match with \c key.
+       *
+       *  The sub-trees whose elements are all known to be equal to \c key,
+       *  from the coordinates of their ancestors, are not compared with \c
+       *  key, but since nodes of this tree do not store the weight of their
+       *  sub-tree, their elements are still counted one by one.
+       *
+       *  \param key The value searched.
+       *  \return The number of elements equal to \c key on all dimensions.
+       */
+      size_type
+      count(const key_type& key) const
+      {
+        if (empty()) return 0;
+        Equal_count<const_node_ptr, rank_type, key_compare, key_type>
+          walk(rank(), key_comp(), key);
+        return walk.run(get_root(), 0);
+      }
+
       /**
        *  Deletes the node pointed to by the iterator.
        *
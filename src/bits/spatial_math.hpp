@@ -23,11 +23,16 @@
 #define SPATIAL_MATH_HPP
 
 #include <limits>
+#include <algorithm> // std::min
 #include <cmath>
 #include <sstream>
+#include <stdint.h> // int64_t
 #include "spatial_import_type_traits.hpp"
 #include "../exception.hpp"
 #include "spatial_check_concept.hpp"
+#include "spatial_simd.hpp"
+#include "spatial_rank.hpp"
+#include "spatial_builtin.hpp"
 
 namespace spatial
 {
@@ -205,7 +210,9 @@ namespace spatial
      *  \p key.
      */
     template <typename Key, typename Difference, typename Unit>
-    inline typename enable_if<import::is_arithmetic<Unit>, Unit>::type
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
     square_euclid_distance_to_key
     (dimension_type rank, const Key& origin, const Key& key, Difference diff)
     {
@@ -225,6 +232,22 @@ namespace spatial
       return sum;
     }
 
+#ifdef SPATIAL_SIMD_SSE2
+    /**
+     *  Compute the square value of the distance between \p origin and \p
+     *  key, when their coordinates are stored contiguously, with a
+     *  vectorized kernel.
+     *
+     *  \see contiguous_key
+     */
+    template <typename Key, typename Difference, typename Unit>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    square_euclid_distance_to_key
+    (dimension_type rank, const Key& origin, const Key& key, Difference)
+    { return details::simd::sum_squares(&origin[0], &key[0], rank); }
+#endif
+
     /**
      *  Compute the distance between the \p origin and the closest point to the
      *  plane orthogonal to the axis of dimension \c dim and passing by \c key.
@@ -315,7 +338,9 @@ namespace spatial
      *  Compute the manhattan distance between \p origin and \p key.
      */
     template <typename Key, typename Difference, typename Unit>
-    inline typename enable_if<import::is_arithmetic<Unit>, Unit>::type
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
     manhattan_distance_to_key
     (dimension_type rank, const Key& origin, const Key& key, Difference diff)
     {
@@ -335,14 +360,1328 @@ namespace spatial
       return sum;
     }
 
-    /*
-      // For a future implementation where we take earth-like spheroid as an
-      // example for non-euclidian spaces, or manifolds.
-      math::great_circle_distance_to_key
-      math::great_circle_distance_to_plane
-      math::vincenty_distance_to_key
-      math::vincenty_distance_to_plane
-    */
+#ifdef SPATIAL_SIMD_SSE2
+    /**
+     *  Compute the manhattan distance between \p origin and \p key, when
+     *  their coordinates are stored contiguously, with a vectorized kernel.
+     *
+     *  \see contiguous_key
+     */
+    template <typename Key, typename Difference, typename Unit>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    manhattan_distance_to_key
+    (dimension_type rank, const Key& origin, const Key& key, Difference)
+    { return details::simd::sum_abs(&origin[0], &key[0], rank); }
+#endif
+
+  } // namespace math
+
+  namespace details
+  {
+    /**
+     *  Adds up the square distances to the planes along the dimensions given
+     *  by \ref for_each_dim().
+     */
+    template <typename Key, typename Difference, typename Unit>
+    struct Square_sum
+    {
+      Square_sum(const Key& origin_, const Key& key_, Difference diff_)
+        : origin(origin_), key(key_), diff(diff_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+#ifdef SPATIAL_SAFER_ARITHMETICS
+        sum = except::check_positive_add
+          (math::square_euclid_distance_to_plane<Key, Difference, Unit>
+           (dim, origin, key, diff), sum);
+#else
+        sum += math::square_euclid_distance_to_plane<Key, Difference, Unit>
+          (dim, origin, key, diff);
+#endif
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      Unit sum;
+    };
+
+    /**
+     *  Adds up the manhattan distances to the planes along the dimensions
+     *  given by \ref for_each_dim().
+     */
+    template <typename Key, typename Difference, typename Unit>
+    struct Manhattan_sum
+    {
+      Manhattan_sum(const Key& origin_, const Key& key_, Difference diff_)
+        : origin(origin_), key(key_), diff(diff_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+#ifdef SPATIAL_SAFER_ARITHMETICS
+        sum = except::check_positive_add
+          (math::manhattan_distance_to_plane<Key, Difference, Unit>
+           (dim, origin, key, diff), sum);
+#else
+        sum += math::manhattan_distance_to_plane<Key, Difference, Unit>
+          (dim, origin, key, diff);
+#endif
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      Unit sum;
+    };
+
+    /**
+     *  Adds up the square distances to the planes along the dimensions given
+     *  by \ref for_each_dim(), each multiplied by the weight of its
+     *  dimension.
+     */
+    template <typename Key, typename Difference, typename Unit>
+    struct Weighted_square_sum
+    {
+      Weighted_square_sum(const Key& origin_, const Key& key_,
+                          Difference diff_, const Unit* weight_)
+        : origin(origin_), key(key_), diff(diff_), weight(weight_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+#ifdef SPATIAL_SAFER_ARITHMETICS
+        sum = except::check_positive_add
+          (except::check_positive_mul
+           (weight[dim],
+            math::square_euclid_distance_to_plane<Key, Difference, Unit>
+            (dim, origin, key, diff)), sum);
+#else
+        sum += weight[dim]
+          * math::square_euclid_distance_to_plane<Key, Difference, Unit>
+          (dim, origin, key, diff);
+#endif
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      const Unit* weight;
+      Unit sum;
+    };
+
+    /**
+     *  Adds up the manhattan distances to the planes along the dimensions
+     *  given by \ref for_each_dim(), each multiplied by the weight of its
+     *  dimension.
+     */
+    template <typename Key, typename Difference, typename Unit>
+    struct Weighted_manhattan_sum
+    {
+      Weighted_manhattan_sum(const Key& origin_, const Key& key_,
+                             Difference diff_, const Unit* weight_)
+        : origin(origin_), key(key_), diff(diff_), weight(weight_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+#ifdef SPATIAL_SAFER_ARITHMETICS
+        sum = except::check_positive_add
+          (except::check_positive_mul
+           (weight[dim],
+            math::manhattan_distance_to_plane<Key, Difference, Unit>
+            (dim, origin, key, diff)), sum);
+#else
+        sum += weight[dim]
+          * math::manhattan_distance_to_plane<Key, Difference, Unit>
+          (dim, origin, key, diff);
+#endif
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      const Unit* weight;
+      Unit sum;
+    };
+
+    /**
+     *  Adds up the squares of the differences along the dimensions given by
+     *  \ref for_each_dim(), where each difference is computed in \c Unit
+     *  and rounded to the narrower type \c Narrow, in which it is squared
+     *  and added. The sum is only an estimate, which is never checked for
+     *  overflows.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              typename Narrow>
+    struct Narrow_square_sum
+    {
+      Narrow_square_sum(const Key& origin_, const Key& key_,
+                        Difference diff_)
+        : origin(origin_), key(key_), diff(diff_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+        Narrow d = static_cast<Narrow>(diff(dim, origin, key));
+        sum += d * d;
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      Narrow sum;
+    };
+
+    /**
+     *  Adds up the absolute differences along the dimensions given by \ref
+     *  for_each_dim(), each rounded to the narrower type \c Narrow.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              typename Narrow>
+    struct Narrow_manhattan_sum
+    {
+      Narrow_manhattan_sum(const Key& origin_, const Key& key_,
+                           Difference diff_)
+        : origin(origin_), key(key_), diff(diff_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+        sum += static_cast<Narrow>(std::abs(diff(dim, origin, key)));
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      Narrow sum;
+    };
+
+    /**
+     *  Gives in \c type the integral type in which the squares of the
+     *  differences of coordinates of type \c Unit are added up. Since the
+     *  differences are computed in \c int, their squares take at most 64
+     *  bits, and the sum is exact in \c int64_t for coordinates of at most
+     *  16 bits, for all ranks below 2^29. For \c int coordinates, the sum is
+     *  exact as long as it stays below 2^63, such as for any differences that
+     *  fit in an \c int in 2 dimensions, or differences below 2^30 in up to 8
+     *  dimensions. Wider coordinates have no wider type.
+     */
+    ///@{
+    template <typename Unit>
+    struct wide_integer { };
+
+    template <> struct wide_integer<signed char> { typedef int64_t type; };
+    template <> struct wide_integer<short> { typedef int64_t type; };
+    template <> struct wide_integer<int> { typedef int64_t type; };
+    ///@}
+
+    /**
+     *  Keeps the largest of the distances to the planes along the dimensions
+     *  given by \ref for_each_dim(). The largest distance is kept in \c
+     *  sum, so that it can be bounded by \ref for_each_dim_bounded() like
+     *  the sums.
+     */
+    template <typename Key, typename Difference, typename Unit>
+    struct Chebyshev_max
+    {
+      Chebyshev_max(const Key& origin_, const Key& key_, Difference diff_)
+        : origin(origin_), key(key_), diff(diff_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+        Unit d = math::manhattan_distance_to_plane<Key, Difference, Unit>
+          (dim, origin, key, diff);
+        if (d > sum) sum = d;
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      Unit sum;
+    };
+
+    /**
+     *  Raises \c x, which is positive, to the power \c P by repeated
+     *  squaring, unrolled at compile time. \c checked() throws \ref
+     *  arithmetic_error on overflow instead.
+     */
+    ///@{
+    template <unsigned int P>
+    struct Power
+    {
+      template <typename Unit>
+      static Unit of(Unit x)
+      {
+        Unit y = Power<P / 2>::of(x);
+        return (P % 2) ? y * y * x : y * y;
+      }
+
+      template <typename Unit>
+      static Unit checked(Unit x)
+      {
+        Unit y = Power<P / 2>::checked(x);
+        y = except::check_positive_mul(y, y);
+        return (P % 2) ? except::check_positive_mul(y, x) : y;
+      }
+    };
+
+    template <>
+    struct Power<1>
+    {
+      template <typename Unit> static Unit of(Unit x) { return x; }
+      template <typename Unit> static Unit checked(Unit x) { return x; }
+    };
+    ///@}
+
+    /**
+     *  Returns the root of order \c P of \c x, which is positive. The roots
+     *  of order 1, 2 and 4 are computed without \c std::pow(), and are exact
+     *  for exact powers.
+     *
+     *  \c under() returns \c x, deflated by a few ulps when the root is
+     *  computed with \c std::pow(), whose result may be a little less than
+     *  \c x for the power \c P of \c x.
+     */
+    ///@{
+    template <unsigned int P>
+    struct Root
+    {
+      template <typename Unit>
+      static Unit of(Unit x)
+      { return std::pow(x, static_cast<Unit>(1) / static_cast<Unit>(P)); }
+
+      template <typename Unit>
+      static Unit under(Unit x)
+      { return x * (1 - 4 * std::numeric_limits<Unit>::epsilon()); }
+    };
+
+    template <>
+    struct Root<1>
+    {
+      template <typename Unit> static Unit of(Unit x) { return x; }
+      template <typename Unit> static Unit under(Unit x) { return x; }
+    };
+
+    template <>
+    struct Root<2>
+    {
+      template <typename Unit>
+      static Unit of(Unit x) { return std::sqrt(x); }
+      template <typename Unit> static Unit under(Unit x) { return x; }
+    };
+
+    template <>
+    struct Root<4>
+    {
+      template <typename Unit>
+      static Unit of(Unit x) { return std::sqrt(std::sqrt(x)); }
+      template <typename Unit> static Unit under(Unit x) { return x; }
+    };
+    ///@}
+
+    /**
+     *  Adds up the distances to the planes along the dimensions given by \ref
+     *  for_each_dim(), each raised to the power \c P.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P>
+    struct Minkowski_sum
+    {
+      Minkowski_sum(const Key& origin_, const Key& key_, Difference diff_)
+        : origin(origin_), key(key_), diff(diff_), sum() { }
+
+      bool operator()(dimension_type dim)
+      {
+        Unit d = math::manhattan_distance_to_plane<Key, Difference, Unit>
+          (dim, origin, key, diff);
+#ifdef SPATIAL_SAFER_ARITHMETICS
+        sum = except::check_positive_add(Power<P>::checked(d), sum);
+#else
+        sum += Power<P>::of(d);
+#endif
+        return true;
+      }
+
+      const Key& origin;
+      const Key& key;
+      Difference diff;
+      Unit sum;
+    };
+
+    //! Returns the number of radians in a degree.
+    template <typename Unit>
+    inline Unit radian_per_degree()
+    { return std::atan(static_cast<Unit>(1)) / 45; }
+
+    //! Returns the difference of longitude \c x, between 0 and 360 degrees,
+    //! as the shortest difference around the sphere.
+    template <typename Unit>
+    inline Unit wrap_longitude(Unit x) { return (x > 180) ? 360 - x : x; }
+
+    /**
+     *  Returns the angle, in radians, between a point of the sphere at
+     *  latitude \c lat, not negative, and the closest point of the meridian
+     *  at \c dlon radians of longitude from it, between 0 and pi. Beyond a
+     *  right angle, the closest point of the meridian is the pole.
+     */
+    template <typename Unit>
+    inline Unit angle_to_meridian(Unit lat, Unit dlon)
+    {
+      if (2 * dlon >= 4 * std::atan(static_cast<Unit>(1)))
+        return 2 * std::atan(static_cast<Unit>(1)) - lat;
+      Unit sin_lat = std::sin(lat);
+      Unit cos_lat = std::cos(lat);
+      Unit cos_dlon = std::cos(dlon);
+      return std::atan2(cos_lat * std::sin(dlon),
+                        std::sqrt(sin_lat * sin_lat
+                                  + cos_lat * cos_lat * cos_dlon * cos_dlon));
+    }
+
+    //! Deflates a lower bound of an angle by a few ulps, so that rounding
+    //! never makes it greater than the angle computed to a key.
+    template <typename Unit>
+    inline Unit deflate_angle(Unit x)
+    { return x * (1 - 16 * std::numeric_limits<Unit>::epsilon()); }
+
+    /**
+     *  Calls \c op, such as \ref Square_sum, on the dimensions from 0 to \c
+     *  rank() - 1, and stops once \c op.sum is greater than \c bound. The sum
+     *  is only tested every 4 dimensions: a test after each dimension costs
+     *  more in mispredicted branches than the dimensions it skips.
+     */
+    template <typename Rank, typename Op, typename Unit>
+    inline void
+    for_each_dim_bounded(Rank rank, Op& op, Unit bound)
+    {
+      dimension_type dim = 0;
+      for (; dim + 4 <= rank(); dim += 4)
+        {
+          op(dim); op(dim + 1); op(dim + 2); op(dim + 3);
+          if (op.sum > bound) return;
+        }
+      for (; dim < rank(); ++dim) op(dim);
+    }
+  } // namespace details
+
+  namespace math
+  {
+    /**
+     *  Compute the distances between \p origin and \p key when the rank is
+     *  a \static_rank, by unrolling the loop over the dimensions at compile
+     *  time. The vectorized kernels are preferred, when they apply.
+     *
+     *  \see details::for_each_dim
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              dimension_type Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    square_euclid_distance_to_key
+    (details::Static_rank<Rank> rank, const Key& origin, const Key& key,
+     Difference diff)
+    {
+      details::Square_sum<Key, Difference, Unit> op(origin, key, diff);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              dimension_type Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    manhattan_distance_to_key
+    (details::Static_rank<Rank> rank, const Key& origin, const Key& key,
+     Difference diff)
+    {
+      details::Manhattan_sum<Key, Difference, Unit> op(origin, key, diff);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              dimension_type Rank>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    square_euclid_distance_to_key
+    (details::Static_rank<Rank>, const Key& origin, const Key& key,
+     Difference)
+    { return details::simd::sum_squares(&origin[0], &key[0], Rank); }
+
+    template <typename Key, typename Difference, typename Unit,
+              dimension_type Rank>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    manhattan_distance_to_key
+    (details::Static_rank<Rank>, const Key& origin, const Key& key,
+     Difference)
+    { return details::simd::sum_abs(&origin[0], &key[0], Rank); }
+#endif
+
+    template <typename Key, typename Difference, typename Unit,
+              dimension_type Rank>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    euclid_distance_to_key
+    (details::Static_rank<Rank> rank, const Key& origin, const Key& key,
+     Difference diff)
+    {
+#ifdef SPATIAL_SAFER_ARITHMETICS
+      return euclid_distance_to_key<Key, Difference, Unit>
+        (rank(), origin, key, diff);
+#else
+      return std::sqrt(square_euclid_distance_to_key<Key, Difference, Unit>
+                       (rank, origin, key, diff));
+#endif
+    }
+    ///@}
+
+    /**
+     *  Compute the distances between \p origin and \p key as long as they
+     *  are not greater than \c bound. Once the sum of the terms along the
+     *  dimensions visited exceeds \c bound, the remaining dimensions are
+     *  skipped and the partial sum is returned: it is then greater than \c
+     *  bound, and not greater than the distance. Otherwise, the distance is
+     *  returned.
+     *
+     *  \c rank is a \static_rank or a \dynamic_rank. The vectorized kernels
+     *  compute the whole distance, which is cheaper than testing the bound
+     *  as they go.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    square_euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     Unit bound)
+    {
+      details::Square_sum<Key, Difference, Unit> op(origin, key, diff);
+      details::for_each_dim_bounded(rank, op, bound);
+      return op.sum;
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_floating_point<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     Unit bound)
+    {
+#ifdef SPATIAL_SAFER_ARITHMETICS
+      static_cast<void>(bound);
+      return euclid_distance_to_key<Key, Difference, Unit>
+        (rank(), origin, key, diff);
+#else
+      details::Square_sum<Key, Difference, Unit> op(origin, key, diff);
+      // Inflated by a few ulps, so that rounding never stops the sum of a
+      // distance that is not greater than bound.
+      details::for_each_dim_bounded
+        (rank, op, bound * bound
+         * (1 + 4 * std::numeric_limits<Unit>::epsilon()));
+      return std::sqrt(op.sum);
+#endif
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    manhattan_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     Unit bound)
+    {
+      details::Manhattan_sum<Key, Difference, Unit> op(origin, key, diff);
+      details::for_each_dim_bounded(rank, op, bound);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    square_euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference, Unit)
+    { return details::simd::sum_squares(&origin[0], &key[0], rank()); }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference, Unit)
+    {
+      return std::sqrt(details::simd::sum_squares(&origin[0], &key[0],
+                                                  rank()));
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    manhattan_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference, Unit)
+    { return details::simd::sum_abs(&origin[0], &key[0], rank()); }
+#endif
+    ///@}
+
+    /**
+     *  Compute the distances between \p origin and \p key, where the term
+     *  of each dimension is multiplied by the weight of that dimension in \p
+     *  weight, an array of \c rank() positive values. \c rank is a
+     *  \static_rank or a \dynamic_rank.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_weighted_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    weighted_square_euclid_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     const Unit* weight)
+    {
+      details::Weighted_square_sum<Key, Difference, Unit>
+        op(origin, key, diff, weight);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_weighted_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    weighted_manhattan_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     const Unit* weight)
+    {
+      details::Weighted_manhattan_sum<Key, Difference, Unit>
+        op(origin, key, diff, weight);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_weighted_distance
+                              <Key, Difference, Unit>, Unit>::type
+    weighted_square_euclid_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference,
+     const Unit* weight)
+    {
+      return details::simd::weighted_sum_squares(&origin[0], &key[0], weight,
+                                                 rank());
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_weighted_distance
+                              <Key, Difference, Unit>, Unit>::type
+    weighted_manhattan_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference,
+     const Unit* weight)
+    {
+      return details::simd::weighted_sum_abs(&origin[0], &key[0], weight,
+                                             rank());
+    }
+#endif
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    weighted_euclid_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     const Unit* weight)
+    {
+      return std::sqrt(weighted_square_euclid_distance_to_key
+                       <Key, Difference, Unit>
+                       (rank, origin, key, diff, weight));
+    }
+    ///@}
+
+    /**
+     *  Compute the weighted distances between \p origin and \p key as long
+     *  as they are not greater than \c bound, in the same way as \ref
+     *  square_euclid_distance_to_key_bounded() and its siblings.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_weighted_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    weighted_square_euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     const Unit* weight, Unit bound)
+    {
+      details::Weighted_square_sum<Key, Difference, Unit>
+        op(origin, key, diff, weight);
+      details::for_each_dim_bounded(rank, op, bound);
+      return op.sum;
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_floating_point<Unit>::value
+                                && !details::simd_weighted_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    weighted_euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     const Unit* weight, Unit bound)
+    {
+      details::Weighted_square_sum<Key, Difference, Unit>
+        op(origin, key, diff, weight);
+      details::for_each_dim_bounded
+        (rank, op, bound * bound
+         * (1 + 4 * std::numeric_limits<Unit>::epsilon()));
+      return std::sqrt(op.sum);
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_weighted_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    weighted_manhattan_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     const Unit* weight, Unit bound)
+    {
+      details::Weighted_manhattan_sum<Key, Difference, Unit>
+        op(origin, key, diff, weight);
+      details::for_each_dim_bounded(rank, op, bound);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_weighted_distance
+                              <Key, Difference, Unit>, Unit>::type
+    weighted_square_euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference,
+     const Unit* weight, Unit)
+    {
+      return details::simd::weighted_sum_squares(&origin[0], &key[0], weight,
+                                                 rank());
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_weighted_distance
+                              <Key, Difference, Unit>, Unit>::type
+    weighted_euclid_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference,
+     const Unit* weight, Unit)
+    {
+      return std::sqrt(details::simd::weighted_sum_squares
+                       (&origin[0], &key[0], weight, rank()));
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_weighted_distance
+                              <Key, Difference, Unit>, Unit>::type
+    weighted_manhattan_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference,
+     const Unit* weight, Unit)
+    {
+      return details::simd::weighted_sum_abs(&origin[0], &key[0], weight,
+                                             rank());
+    }
+#endif
+    ///@}
+
+    /**
+     *  Compute, in the narrower floating point type \c Narrow, the sum of
+     *  the squares or of the absolute values of the differences between \p
+     *  origin and \p key. The differences are computed in \c Unit, then
+     *  rounded to \c Narrow, so that the result is within <tt>(rank + 3) *
+     *  epsilon</tt> of the exact sum, relatively, as long as it is a normal
+     *  value of \c Narrow. \c rank is a \static_rank or a \dynamic_rank.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              typename Narrow, typename Rank>
+    inline typename enable_if_c<!details::simd_narrow
+                                <Key, Difference, Unit, Narrow>::value,
+                                Narrow>::type
+    narrow_square_sum_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff)
+    {
+      details::Narrow_square_sum<Key, Difference, Unit, Narrow>
+        op(origin, key, diff);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Narrow, typename Rank>
+    inline typename enable_if_c<!details::simd_narrow
+                                <Key, Difference, Unit, Narrow>::value,
+                                Narrow>::type
+    narrow_manhattan_sum_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff)
+    {
+      details::Narrow_manhattan_sum<Key, Difference, Unit, Narrow>
+        op(origin, key, diff);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              typename Narrow, typename Rank>
+    inline typename enable_if<details::simd_narrow
+                              <Key, Difference, Unit, Narrow>, Narrow>::type
+    narrow_square_sum_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference)
+    {
+      return details::simd::narrow_sum_squares(&origin[0], &key[0],
+                                                rank());
+    }
+
+    template <typename Key, typename Difference, typename Unit,
+              typename Narrow, typename Rank>
+    inline typename enable_if<details::simd_narrow
+                              <Key, Difference, Unit, Narrow>, Narrow>::type
+    narrow_manhattan_sum_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference)
+    { return details::simd::narrow_sum_abs(&origin[0], &key[0], rank()); }
+#endif
+    ///@}
+
+    /**
+     *  Compute the square of the distance between \p origin and \p key in
+     *  the integral type \c Wide, wider than the coordinates of the keys,
+     *  in which \p diff returns the differences, so that their squares never
+     *  overflow. \c rank is a \static_rank or a \dynamic_rank.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Wide,
+              typename Rank>
+    inline typename enable_if_c<!details::simd_wide
+                                <Key, Difference, Wide>::value,
+                                Wide>::type
+    wide_square_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff)
+    {
+      details::Square_sum<Key, Difference, Wide> op(origin, key, diff);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+    template <typename Key, typename Difference, typename Wide,
+              typename Rank>
+    inline typename enable_if_c<!details::simd_wide
+                                <Key, Difference, Wide>::value,
+                                Wide>::type
+    wide_square_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     Wide bound)
+    {
+      details::Square_sum<Key, Difference, Wide> op(origin, key, diff);
+      details::for_each_dim_bounded(rank, op, bound);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Wide,
+              typename Rank>
+    inline typename enable_if<details::simd_wide
+                              <Key, Difference, Wide>, Wide>::type
+    wide_square_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference)
+    {
+      return details::simd::wide_sum_squares(&origin[0], &key[0],
+                                              rank());
+    }
+
+    template <typename Key, typename Difference, typename Wide,
+              typename Rank>
+    inline typename enable_if<details::simd_wide
+                              <Key, Difference, Wide>, Wide>::type
+    wide_square_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference, Wide)
+    {
+      return details::simd::wide_sum_squares(&origin[0], &key[0],
+                                              rank());
+    }
+#endif
+    ///@}
+
+    /**
+     *  Compute the chebyshev distance between \p origin and \p key: the
+     *  largest of the absolute differences along each dimension. \c rank is
+     *  a \static_rank or a \dynamic_rank.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    chebyshev_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff)
+    {
+      details::Chebyshev_max<Key, Difference, Unit> op(origin, key, diff);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    chebyshev_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference)
+    { return details::simd::max_abs(&origin[0], &key[0], rank()); }
+#endif
+    ///@}
+
+    /**
+     *  Compute the chebyshev distance between \p origin and \p key as long
+     *  as it is not greater than \c bound, in the same way as \ref
+     *  manhattan_distance_to_key_bounded().
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_distance
+                                <Key, Difference, Unit>::value, Unit>::type
+    chebyshev_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     Unit bound)
+    {
+      details::Chebyshev_max<Key, Difference, Unit> op(origin, key, diff);
+      details::for_each_dim_bounded(rank, op, bound);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              typename Rank>
+    inline typename enable_if<details::simd_distance<Key, Difference, Unit>,
+                              Unit>::type
+    chebyshev_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference, Unit)
+    { return details::simd::max_abs(&origin[0], &key[0], rank()); }
+#endif
+    ///@}
+
+    /**
+     *  Compute the sum of the absolute differences between \p origin and \p
+     *  key along each dimension, raised to the power \c P: the Minkowski
+     *  distance of order \c P, raised to the power \c P. The powers are
+     *  unrolled at compile time, and the orders 1 and 2 use the kernels of
+     *  the manhattan and euclidian distances.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P, typename Rank>
+    inline typename enable_if_c<import::is_arithmetic<Unit>::value
+                                && !details::simd_minkowski
+                                <Key, Difference, Unit, P>::value, Unit>::type
+    minkowski_power_sum_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff)
+    {
+      details::Minkowski_sum<Key, Difference, Unit, P> op(origin, key, diff);
+      details::for_each_dim(rank, op);
+      return op.sum;
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P, typename Rank>
+    inline typename enable_if_c<details::simd_minkowski
+                                <Key, Difference, Unit, P>::value
+                                && P == 1, Unit>::type
+    minkowski_power_sum_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference)
+    { return details::simd::sum_abs(&origin[0], &key[0], rank()); }
+
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P, typename Rank>
+    inline typename enable_if_c<details::simd_minkowski
+                                <Key, Difference, Unit, P>::value
+                                && P == 2, Unit>::type
+    minkowski_power_sum_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference)
+    { return details::simd::sum_squares(&origin[0], &key[0], rank()); }
+#endif
+    ///@}
+
+    /**
+     *  Compute the distance between \p origin and the closest point to the
+     *  plane orthogonal to the axis of dimension \c dim and passing by \c
+     *  key, never greater than the Minkowski distance of order \c P between
+     *  \p origin and any key on the plane.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    minkowski_distance_to_plane
+    (dimension_type dim, const Key& origin, const Key& key, Difference diff)
+    {
+      return details::Root<P>::under
+        (manhattan_distance_to_plane<Key, Difference, Unit>
+         (dim, origin, key, diff));
+    }
+
+    /**
+     *  Compute the Minkowski distance of order \c P between \p origin and
+     *  \p key. \c rank is a \static_rank or a \dynamic_rank.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P, typename Rank>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    minkowski_distance_to_key
+    (Rank rank, const Key& origin, const Key& key, Difference diff)
+    {
+      return details::Root<P>::of
+        (minkowski_power_sum_to_key<Key, Difference, Unit, P>
+         (rank, origin, key, diff));
+    }
+
+    /**
+     *  Compute the Minkowski distance of order \c P between \p origin and
+     *  \p key as long as it is not greater than \c bound, in the same way
+     *  as \ref euclid_distance_to_key_bounded().
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P, typename Rank>
+    inline typename enable_if_c<import::is_floating_point<Unit>::value
+                                && !details::simd_minkowski
+                                <Key, Difference, Unit, P>::value, Unit>::type
+    minkowski_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff,
+     Unit bound)
+    {
+      details::Minkowski_sum<Key, Difference, Unit, P> op(origin, key, diff);
+      // Inflated by a few ulps for each multiplication, so that rounding
+      // never stops the sum of a distance that is not greater than bound.
+      details::for_each_dim_bounded
+        (rank, op, details::Power<P>::of(bound)
+         * (1 + static_cast<Unit>(4 * P)
+            * std::numeric_limits<Unit>::epsilon()));
+      return details::Root<P>::of(op.sum);
+    }
+
+#ifdef SPATIAL_SIMD_SSE2
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P, typename Rank>
+    inline typename enable_if<details::simd_minkowski
+                              <Key, Difference, Unit, P>, Unit>::type
+    minkowski_distance_to_key_bounded
+    (Rank rank, const Key& origin, const Key& key, Difference diff, Unit)
+    {
+      return minkowski_distance_to_key<Key, Difference, Unit, P>
+        (rank, origin, key, diff);
+    }
+#endif
+    ///@}
+
+    /**
+     *  Returns the dimensions of the lower and higher coordinates of the
+     *  box along \c axis, for each layout. \c rank is the rank of the box
+     *  keys, twice the number of axes.
+     */
+    ///@{
+    inline dimension_type
+    box_low_dim(dimension_type axis, dimension_type, llhh_layout_tag)
+    { return axis; }
+
+    inline dimension_type
+    box_high_dim(dimension_type axis, dimension_type rank, llhh_layout_tag)
+    { return axis + (rank >> 1); }
+
+    inline dimension_type
+    box_low_dim(dimension_type axis, dimension_type, lhlh_layout_tag)
+    { return axis << 1; }
+
+    inline dimension_type
+    box_high_dim(dimension_type axis, dimension_type, lhlh_layout_tag)
+    { return (axis << 1) + 1; }
+
+    inline dimension_type
+    box_low_dim(dimension_type axis, dimension_type rank, hhll_layout_tag)
+    { return axis + (rank >> 1); }
+
+    inline dimension_type
+    box_high_dim(dimension_type axis, dimension_type, hhll_layout_tag)
+    { return axis; }
+
+    inline dimension_type
+    box_low_dim(dimension_type axis, dimension_type, hlhl_layout_tag)
+    { return (axis << 1) + 1; }
+
+    inline dimension_type
+    box_high_dim(dimension_type axis, dimension_type, hlhl_layout_tag)
+    { return axis << 1; }
+    ///@}
+
+    /**
+     *  Returns \c true if the dimension \c dim holds a lower coordinate of
+     *  the boxes, for each layout.
+     */
+    ///@{
+    inline bool
+    is_box_low_dim(dimension_type dim, dimension_type rank, llhh_layout_tag)
+    { return dim < (rank >> 1); }
+
+    inline bool
+    is_box_low_dim(dimension_type dim, dimension_type, lhlh_layout_tag)
+    { return (dim % 2) == 0; }
+
+    inline bool
+    is_box_low_dim(dimension_type dim, dimension_type rank, hhll_layout_tag)
+    { return dim >= (rank >> 1); }
+
+    inline bool
+    is_box_low_dim(dimension_type dim, dimension_type, hlhl_layout_tag)
+    { return (dim % 2) != 0; }
+    ///@}
+
+    /**
+     *  Returns the axis of the box along which the dimension \c dim holds a
+     *  coordinate, for each layout.
+     */
+    ///@{
+    inline dimension_type
+    box_axis(dimension_type dim, dimension_type rank, llhh_layout_tag)
+    { return (dim < (rank >> 1)) ? dim : dim - (rank >> 1); }
+
+    inline dimension_type
+    box_axis(dimension_type dim, dimension_type, lhlh_layout_tag)
+    { return dim >> 1; }
+
+    inline dimension_type
+    box_axis(dimension_type dim, dimension_type rank, hhll_layout_tag)
+    { return (dim < (rank >> 1)) ? dim : dim - (rank >> 1); }
+
+    inline dimension_type
+    box_axis(dimension_type dim, dimension_type, hlhl_layout_tag)
+    { return dim >> 1; }
+    ///@}
+
+    /**
+     *  Compute the gap between the box \p origin and the box \p key along \c
+     *  axis: the amount by which \p key must be extended along \c axis to
+     *  enclose \p origin. When \p origin is a point, with equal lower and
+     *  higher coordinates, this is the distance from the point to the
+     *  closest side of \p key along \c axis, and it is null when the point is
+     *  between the sides.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              typename Layout>
+    inline typename enable_if<import::is_arithmetic<Unit>, Unit>::type
+    box_gap_to_key
+    (dimension_type rank, dimension_type axis, const Key& origin,
+     const Key& key, Difference diff, Layout tag)
+    {
+      Unit d = diff(box_low_dim(axis, rank, tag), key, origin);
+      if (d > Unit()) return d;
+      d = diff(box_high_dim(axis, rank, tag), origin, key);
+      return (d > Unit()) ? d : Unit();
+    }
+
+    /**
+     *  Compute a lower bound of the gap between the box \p origin and any
+     *  box whose coordinate along \c dim lies on the other side of \p key
+     *  than the coordinate of \p origin.
+     *
+     *  If \c dim holds lower coordinates, only the boxes beyond \p key,
+     *  whose lower sides are even further away, are separated from \p
+     *  origin; the boxes before \p key may still enclose \p origin. The
+     *  converse holds when \c dim holds higher coordinates.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              typename Layout>
+    inline typename enable_if<import::is_arithmetic<Unit>, Unit>::type
+    box_gap_to_plane
+    (dimension_type rank, dimension_type dim, const Key& origin,
+     const Key& key, Difference diff, Layout tag)
+    {
+      Unit d = is_box_low_dim(dim, rank, tag)
+        ? diff(dim, key, origin) : diff(dim, origin, key);
+      return (d > Unit()) ? d : Unit();
+    }
+
+    /**
+     *  Compute the square value of the distance between the point \p origin,
+     *  expressed as a box, and the closest point of the box \p key.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              typename Layout>
+    inline typename enable_if<import::is_arithmetic<Unit>, Unit>::type
+    square_box_distance_to_key
+    (dimension_type rank, const Key& origin, const Key& key, Difference diff,
+     Layout tag)
+    {
+      Unit sum = Unit();
+      for (dimension_type i = 0; i < (rank >> 1); ++i)
+        {
+          Unit d = box_gap_to_key<Key, Difference, Unit>
+            (rank, i, origin, key, diff, tag);
+#ifdef SPATIAL_SAFER_ARITHMETICS
+          sum = except::check_positive_add(except::check_square(d), sum);
+#else
+          sum += d * d;
+#endif
+        }
+      return sum;
+    }
+
+    /**
+     *  Compute the manhattan distance between the point \p origin, expressed
+     *  as a box, and the closest point of the box \p key.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              typename Layout>
+    inline typename enable_if<import::is_arithmetic<Unit>, Unit>::type
+    manhattan_box_distance_to_key
+    (dimension_type rank, const Key& origin, const Key& key, Difference diff,
+     Layout tag)
+    {
+      Unit sum = Unit();
+      for (dimension_type i = 0; i < (rank >> 1); ++i)
+        {
+#ifdef SPATIAL_SAFER_ARITHMETICS
+          sum = except::check_positive_add
+            (box_gap_to_key<Key, Difference, Unit>
+             (rank, i, origin, key, diff, tag), sum);
+#else
+          sum += box_gap_to_key<Key, Difference, Unit>
+            (rank, i, origin, key, diff, tag);
+#endif
+        }
+      return sum;
+    }
+
+    /**
+     *  Compute the angle, in radians, between the points of the sphere \p
+     *  origin and \p key, whose latitudes and longitudes are given in
+     *  degrees along the dimensions 0 and 1.
+     *
+     *  The haversine formula gives \c a, the square of the sine of half the
+     *  angle. Rather than taking the arc sine of the square root of \c a,
+     *  which is ill-conditioned for nearly antipodal points, \c 1 - \c a is
+     *  expanded into a sum of positive terms, and the angle is computed with
+     *  the arc tangent of their ratio, accurate to a few ulps for all
+     *  points.
+     */
+    template <typename Key, typename Difference, typename Unit>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    great_circle_distance_to_key
+    (const Key& origin, const Key& key, Difference diff)
+    {
+      const Unit rad = details::radian_per_degree<Unit>();
+      Unit lat1 = details::coordinate<Unit>(diff, 0, origin) * rad;
+      Unit lat2 = details::coordinate<Unit>(diff, 0, key) * rad;
+      // Differences of coordinates are taken before the conversion to
+      // radians, where they would cancel the rounding of each coordinate
+      Unit half_dlat = diff(0, key, origin) * rad / 2;
+      Unit half_dlon = diff(1, key, origin) * rad / 2;
+      Unit sin_dlat = std::sin(half_dlat);
+      Unit cos_dlat = std::cos(half_dlat);
+      Unit sin_dlon = std::sin(half_dlon);
+      Unit cos_dlon = std::cos(half_dlon);
+      Unit sin_mid = std::sin((lat1 + lat2) / 2);
+      Unit a = sin_dlat * sin_dlat
+        + std::cos(lat1) * std::cos(lat2) * sin_dlon * sin_dlon;
+      Unit b = cos_dlat * cos_dlat * cos_dlon * cos_dlon
+        + sin_mid * sin_mid * sin_dlon * sin_dlon;
+      return 2 * std::atan2(std::sqrt(a), std::sqrt(b));
+    }
+
+    /**
+     *  Compute a lower bound of the angle, in radians, between the point of
+     *  the sphere \p origin and any point whose coordinate along \c dim is
+     *  on the other side of the coordinate of \p key.
+     *
+     *  Beyond a latitude, the bound is the difference of latitudes. Beyond a
+     *  longitude, the points lie in the lune between the meridian of \p key
+     *  and the antimeridian, at +/-180 degrees: the bound is the angle to the
+     *  closest of these 2 meridians, which accounts for the points reached
+     *  across the antimeridian. Other dimensions do not bound the angle.
+     */
+    template <typename Key, typename Difference, typename Unit>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    great_circle_distance_to_plane
+    (dimension_type dim, const Key& origin, const Key& key, Difference diff)
+    {
+      const Unit rad = details::radian_per_degree<Unit>();
+      if (dim == 0)
+        { return details::deflate_angle(std::abs(diff(0, key, origin)) * rad); }
+      if (dim != 1) return Unit();
+      Unit lat = std::abs(details::coordinate<Unit>(diff, 0, origin)) * rad;
+      Unit lon = details::coordinate<Unit>(diff, 1, origin);
+      Unit to_key = details::wrap_longitude(std::abs(diff(1, key, origin)));
+      Unit to_antimeridian = 180 - std::abs(lon);
+      return details::deflate_angle
+        ((std::min)(details::angle_to_meridian(lat, to_key * rad),
+                    details::angle_to_meridian(lat, to_antimeridian * rad)));
+    }
+
+    /**
+     *  Compute the equirectangular approximation of the angle, in radians,
+     *  between the points of the sphere \p origin and \p key, whose
+     *  latitudes and longitudes are given in degrees along the dimensions 0
+     *  and 1: the euclidian distance in the plane tangent to the sphere at \p
+     *  origin, where differences of longitude are scaled by the cosine of the
+     *  latitude of \p origin.
+     */
+    template <typename Key, typename Difference, typename Unit>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    equirectangular_distance_to_key
+    (const Key& origin, const Key& key, Difference diff)
+    {
+      const Unit rad = details::radian_per_degree<Unit>();
+      Unit dlat = diff(0, key, origin) * rad;
+      Unit dlon = details::wrap_longitude(std::abs(diff(1, key, origin))) * rad
+        * std::cos(details::coordinate<Unit>(diff, 0, origin) * rad);
+      return std::sqrt(dlat * dlat + dlon * dlon);
+    }
+
+    /**
+     *  Compute a lower bound of the equirectangular approximation of the
+     *  angle, in radians, between the point of the sphere \p origin and any
+     *  point whose coordinate along \c dim is on the other side of the
+     *  coordinate of \p key, in the same way as \ref
+     *  great_circle_distance_to_plane().
+     */
+    template <typename Key, typename Difference, typename Unit>
+    inline typename enable_if<import::is_floating_point<Unit>, Unit>::type
+    equirectangular_distance_to_plane
+    (dimension_type dim, const Key& origin, const Key& key, Difference diff)
+    {
+      const Unit rad = details::radian_per_degree<Unit>();
+      if (dim == 0)
+        { return details::deflate_angle(std::abs(diff(0, key, origin)) * rad); }
+      if (dim != 1) return Unit();
+      Unit to_key = details::wrap_longitude(std::abs(diff(1, key, origin)));
+      Unit to_antimeridian
+        = 180 - std::abs(details::coordinate<Unit>(diff, 1, origin));
+      return details::deflate_angle
+        ((std::min)(to_key, to_antimeridian) * rad
+         * std::cos(details::coordinate<Unit>(diff, 0, origin) * rad));
+    }
   } // namespace math
 }
 
@@ -13,7 +13,9 @@
 #ifndef SPATIAL_NEIGHBOR_HPP
 #define SPATIAL_NEIGHBOR_HPP
 
+#include <algorithm> // reverse
 #include <limits> // numeric_limits min() and max()
+#include <vector>
 
 #include "spatial_import_tuple.hpp"
 #include "../metric.hpp"
@@ -998,14 +1000,9 @@ namespace spatial
       SPATIAL_ASSERT_CHECK(dim < rank());
       SPATIAL_ASSERT_CHECK(!header(node));
       SPATIAL_ASSERT_CHECK(node != 0);
-      // Finding the maximum is, for lack of a better algorithm, equivalent to a
-      // O(n) search. An alternative has been explored: being able to find if a
-      // node is in a cell that is smaller than the current 'far_node' node
-      // found.  However, with the data at hand, computing the cell turned out
-      // to be more expensive than doing a simple iteration over all nodes in
-      // the tree.  Maybe, one day we'll find a better algorithm that also has
-      // no impact on the memory footprint of the tree (although I doubt these 2
-      // conditions will ever be met. Probably there will be a tradeoff.)
+      // Without a furthest_bound for the metric, nothing is known of the
+      // largest distance to the nodes of a sub-tree, and finding the maximum
+      // is equivalent to a O(n) search. See Last_neighbor_search otherwise.
       //
       // Seeks the last node in near-pre-order.
       NodePtr best = node->parent;
@@ -1046,10 +1043,212 @@ namespace spatial
         }
     }
 
+    /**
+     *  Sub-trees are bounded on both sides along all dimensions only deeper
+     *  than twice the rank in the tree: each dimension must have been split
+     *  once toward each side by their ancestors. The pruning by \ref
+     *  furthest_bound pays for the cost of tracking the bounds only when
+     *  these sub-trees still hold many nodes, that is when the tree is
+     *  deeper than this many times the rank.
+     */
+    const dimension_type furthest_bound_depth = 3;
+
+    /**
+     *  Returns true if the tree whose root is \c root is deep enough for the
+     *  pruning of \ref Last_neighbor_search to pay for itself. Only the
+     *  left-most path of the tree is measured.
+     */
+    template <typename NodePtr, typename Rank>
+    inline bool
+    furthest_bound_pays(NodePtr root, Rank rank)
+    {
+      dimension_type depth = 0;
+      for (NodePtr left = root;
+           left != 0 && depth <= furthest_bound_depth * rank();
+           left = left->left)
+        { ++depth; }
+      return depth > furthest_bound_depth * rank();
+    }
+
+    /**
+     *  Finds the last node in near-pre-order among the furthest nodes from
+     *  the target, without visiting the sub-trees that cannot hold a node
+     *  further than the best node found so far.
+     *
+     *  The nodes are visited in reverse near-pre-order, far sub-trees first,
+     *  so that large distances are found early. The bounds of each sub-tree,
+     *  along each dimension, are given by the keys of its ancestors. Once a
+     *  sub-tree is bounded on all sides, \ref furthest_bound gives an upper
+     *  bound of the distance to any of its nodes. Sub-trees that are on the
+     *  outer edges of the tree are never bounded and always visited.
+     *
+     *  When built with a limit node, the search finds the node that precedes
+     *  the limit in the order of the neighbor iterators instead: the node
+     *  that is closer than the limit, or at the same distance and before it
+     *  in near-pre-order. Far sub-trees further than the limit along a single
+     *  dimension are then skipped as well. The sub-trees that hold the limit
+     *  are always visited, since the nodes at the same distance are only
+     *  known to precede the limit once the limit has been visited.
+     */
     template <typename NodePtr, typename Rank, typename KeyCompare,
               typename Key, typename Metric>
-    inline import::tuple<NodePtr, dimension_type,
-                         typename Metric::distance_type>
+    class Last_neighbor_search
+    {
+    public:
+      typedef typename Metric::distance_type distance_type;
+
+      Last_neighbor_search(Rank rank, const KeyCompare& key_comp,
+                           const Metric& met, const Key& target)
+        : _rank(rank), _key_comp(key_comp), _met(met), _target(target),
+          _low(rank(), static_cast<const Key*>(0)),
+          _high(rank(), static_cast<const Key*>(0)),
+          _terms(rank(), distance_type()), _bounded_count(0),
+          _path(), _depth(0), _limit_dist(), _passed(false), _done(false),
+          best(0), best_dim(0), best_dist() { }
+
+      //! Build a search for the node that precedes \c limit, where \c root
+      //! is the root of the tree and \c limit_dist the distance of \c limit.
+      Last_neighbor_search(Rank rank, const KeyCompare& key_comp,
+                           const Metric& met, const Key& target,
+                           NodePtr root, NodePtr limit,
+                           distance_type limit_dist)
+        : _rank(rank), _key_comp(key_comp), _met(met), _target(target),
+          _low(rank(), static_cast<const Key*>(0)),
+          _high(rank(), static_cast<const Key*>(0)),
+          _terms(rank(), distance_type()), _bounded_count(0),
+          _path(), _depth(0), _limit_dist(limit_dist), _passed(false),
+          _done(false), best(0), best_dim(0), best_dist()
+      {
+        for (NodePtr node = limit; node != root; node = node->parent)
+          { _path.push_back(node); }
+        _path.push_back(root);
+        std::reverse(_path.begin(), _path.end());
+      }
+
+      //! Visit the sub-tree of \c node, where \c dim is the dimension of
+      //! \c node.
+      void run(NodePtr node, dimension_type dim)
+      {
+        SPATIAL_ASSERT_CHECK(dim < _rank());
+        SPATIAL_ASSERT_CHECK(node != 0);
+        SPATIAL_ASSERT_CHECK(!header(node));
+        dimension_type child_dim = incr_dim(_rank, dim);
+        if (_key_comp(dim, const_key(node), _target))
+          {
+            if (node->left != 0 && near_limit(node->left, dim))
+              { visit(_high, node->left, dim, child_dim); }
+            if (node->right != 0) visit(_low, node->right, dim, child_dim);
+          }
+        else
+          {
+            if (node->right != 0 && near_limit(node->right, dim))
+              { visit(_low, node->right, dim, child_dim); }
+            if (node->left != 0) visit(_high, node->left, dim, child_dim);
+          }
+        if (_done) return;
+        if (!_path.empty() && node == _path.back())
+          { _passed = true; return; }
+        distance_type test_dist
+          = _met.distance_to_key(_rank(), _target, const_key(node));
+        if (!_path.empty()
+            && !(test_dist < _limit_dist
+                 || (_passed && test_dist == _limit_dist)))
+          return;
+        if (best == 0 || test_dist > best_dist)
+          {
+            best = node;
+            best_dim = dim;
+            best_dist = test_dist;
+            // Nothing visited afterward can be closer to the limit
+            if (!_path.empty() && test_dist == _limit_dist) { _done = true; }
+          }
+      }
+
+    private:
+      //! Bound \c child by the key of its parent along \c dim, then visit
+      //! it if it may hold a node further than the best one.
+      void visit(std::vector<const Key*>& bounds, NodePtr child,
+                 dimension_type dim, dimension_type child_dim)
+      {
+        if (_done) return;
+        const Key* save = bounds[dim];
+        distance_type save_term = _terms[dim];
+        bound(bounds, dim, &const_key(child->parent));
+        ++_depth;
+        if (best == 0 || _bounded_count != _rank()
+            || best_dist < furthest_bound<Metric>::combine(_terms)
+            || on_path(child, _depth))
+          { run(child, child_dim); }
+        --_depth;
+        bound(bounds, dim, save);
+        _terms[dim] = save_term;
+      }
+
+      //! Returns false if \c child, the far child of its parent along
+      //! \c dim, cannot hold a node as close as the limit.
+      bool near_limit(NodePtr child, dimension_type dim) const
+      {
+        return _path.empty() || on_path(child, _depth + 1)
+          || !(_limit_dist < _met.distance_to_plane(_rank(), dim, _target,
+                                                    const_key(child->parent)));
+      }
+
+      //! Returns true if \c node, at \c depth in the tree, is the limit or
+      //! one of its ancestors.
+      bool on_path(NodePtr node, size_type depth) const
+      { return depth < _path.size() && _path[depth] == node; }
+
+      //! Set one of the bounds along \c dim, and compute the largest
+      //! distance to the bounds along \c dim if both are set.
+      void bound(std::vector<const Key*>& bounds, dimension_type dim,
+                 const Key* key)
+      {
+        bool was_bounded = _low[dim] != 0 && _high[dim] != 0;
+        bounds[dim] = key;
+        bool is_bounded = _low[dim] != 0 && _high[dim] != 0;
+        if (is_bounded)
+          {
+            distance_type low
+              = _met.distance_to_plane(_rank(), dim, _target, *_low[dim]);
+            distance_type high
+              = _met.distance_to_plane(_rank(), dim, _target, *_high[dim]);
+            _terms[dim] = low < high ? high : low;
+          }
+        if (is_bounded && !was_bounded) { ++_bounded_count; }
+        else if (!is_bounded && was_bounded) { --_bounded_count; }
+      }
+
+      Rank _rank;
+      const KeyCompare& _key_comp;
+      const Metric& _met;
+      const Key& _target;
+      std::vector<const Key*> _low;
+      std::vector<const Key*> _high;
+      std::vector<distance_type> _terms;
+      dimension_type _bounded_count;
+      std::vector<NodePtr> _path;
+      size_type _depth;
+      distance_type _limit_dist;
+      bool _passed;
+      bool _done;
+
+    public:
+      NodePtr best;
+      dimension_type best_dim;
+      distance_type best_dist;
+    };
+
+    /**
+     *  Returns the last node in near-pre-order among the furthest nodes from
+     *  the target, when the metric does not provide a \ref furthest_bound:
+     *  all nodes are visited.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key, typename Metric>
+    inline typename enable_if_c<!furthest_bound<Metric>::value,
+                                import::tuple<NodePtr, dimension_type,
+                                              typename Metric::distance_type>
+                                >::type
     last_neighbor(NodePtr node, dimension_type dim, Rank rank,
                   KeyCompare key_comp, const Metric& met, const Key& target)
     {
@@ -1057,13 +1256,195 @@ namespace spatial
                                typename Metric::distance_type());
     }
 
+    /**
+     *  Returns the last node in near-pre-order among the furthest nodes from
+     *  the target, pruning the sub-trees that cannot hold a further node.
+     *  \see Last_neighbor_search
+     */
     template <typename NodePtr, typename Rank, typename KeyCompare,
               typename Key, typename Metric>
+    inline typename enable_if<furthest_bound<Metric>,
+                              import::tuple<NodePtr, dimension_type,
+                                            typename Metric::distance_type>
+                              >::type
+    last_neighbor(NodePtr node, dimension_type dim, Rank rank,
+                  KeyCompare key_comp, const Metric& met, const Key& target)
+    {
+      if (!furthest_bound_pays(node, rank))
+        {
+          return last_neighbor_sub(node, dim, rank, key_comp, met, target,
+                                   typename Metric::distance_type());
+        }
+      Last_neighbor_search<NodePtr, Rank, KeyCompare, Key, Metric>
+        search(rank, key_comp, met, target);
+      search.run(node, dim);
+      return import::make_tuple(search.best, search.best_dim,
+                                search.best_dist);
+    }
+
+    /**
+     *  Bounds the distance from the target to the nodes of the far sub-tree
+     *  of a node by the distance to the plane of that node only. Used when
+     *  the metric does not provide a \ref nearest_bound.
+     */
+    template <typename Rank, typename Key, typename Metric>
+    class Plane_bound
+    {
+    public:
+      typedef typename Metric::distance_type distance_type;
+
+      Plane_bound(Rank rank, const Metric& met, const Key& target)
+        : _rank(rank), _met(met), _target(target) { }
+
+      //! Returns a lower bound of the distance to the nodes of the far
+      //! sub-tree of \c node, where \c dim is the dimension of \c node.
+      template <typename NodePtr>
+      distance_type far(NodePtr node, dimension_type dim) const
+      { return _met.distance_to_plane(_rank(), dim, _target, const_key(node)); }
+
+      //! Enters the far sub-tree of \c node.
+      template <typename NodePtr>
+      void enter_far(NodePtr, dimension_type) { }
+
+      //! Leaves the far sub-tree entered last.
+      void leave_far() { }
+
+      //! Enters the far sub-trees on the path from the root to \c node,
+      //! where \c dim is the dimension of \c node.
+      template <typename NodePtr, typename KeyCompare>
+      void enter_path(NodePtr, dimension_type, const KeyCompare&) { }
+
+      //! Returns a mark to give to \ref restore().
+      size_type top() const { return 0; }
+
+      //! Leaves the far sub-trees entered since \ref top() returned \c mark.
+      void restore(size_type) { }
+
+    private:
+      Rank _rank;
+      const Metric& _met;
+      const Key& _target;
+    };
+
+    /**
+     *  Bounds the distance from the target to the nodes of the far sub-tree
+     *  of a node by the distance to the cell that holds the sub-tree, after
+     *  Arya and Mount. The term of \ref nearest_bound for the distance to the
+     *  plane that bounds the current sub-tree on the side of the target is
+     *  kept along each dimension, together with the sum of the terms:
+     *  entering a far sub-tree replaces a single term, so the bound is
+     *  updated in constant time at each level, instead of accounting for the
+     *  plane of the parent only.
+     *
+     *  The terms replaced are saved, and put back when the search returns
+     *  from the sub-trees, with \ref restore().
+     */
+    template <typename Rank, typename Key, typename Metric>
+    class Cell_bound
+    {
+    public:
+      typedef typename Metric::distance_type distance_type;
+
+      Cell_bound(Rank rank, const Metric& met, const Key& target)
+        : _rank(rank), _met(met), _target(target),
+          _terms(rank(), distance_type()), _sum() { }
+
+      template <typename NodePtr>
+      distance_type far(NodePtr node, dimension_type dim) const
+      {
+        distance_type plane
+          = _met.distance_to_plane(_rank(), dim, _target, const_key(node));
+        distance_type term = nearest_bound<Metric>::term(plane);
+        if (!(_terms[dim] < term)) return plane;
+        distance_type cell
+          = nearest_bound<Metric>::combine(_sum + (term - _terms[dim]));
+        return cell < plane ? plane : cell;
+      }
+
+      template <typename NodePtr>
+      void enter_far(NodePtr node, dimension_type dim)
+      {
+        distance_type term = nearest_bound<Metric>::term
+          (_met.distance_to_plane(_rank(), dim, _target, const_key(node)));
+        _saved.push_back(Saved(dim, _terms[dim], _sum));
+        // Along each dimension, the plane furthest from the target bounds
+        // the cell
+        if (!(_terms[dim] < term)) return;
+        _sum += term - _terms[dim];
+        _terms[dim] = term;
+      }
+
+      void leave_far()
+      {
+        _terms[_saved.back().dim] = _saved.back().term;
+        _sum = _saved.back().sum;
+        _saved.pop_back();
+      }
+
+      template <typename NodePtr, typename KeyCompare>
+      void enter_path(NodePtr node, dimension_type dim,
+                      const KeyCompare& key_comp)
+      {
+        NodePtr parent = node->parent;
+        if (header(parent)) return;
+        dimension_type parent_dim = decr_dim(_rank, dim);
+        enter_path(parent, parent_dim, key_comp);
+        if (node == (key_comp(parent_dim, const_key(parent), _target)
+                     ? parent->left : parent->right))
+          { enter_far(parent, parent_dim); }
+      }
+
+      size_type top() const { return _saved.size(); }
+
+      void restore(size_type mark)
+      { while (_saved.size() > mark) leave_far(); }
+
+    private:
+      struct Saved
+      {
+        Saved(dimension_type dim_, distance_type term_, distance_type sum_)
+          : dim(dim_), term(term_), sum(sum_) { }
+        dimension_type dim;
+        distance_type term;
+        distance_type sum;
+      };
+
+      Rank _rank;
+      const Metric& _met;
+      const Key& _target;
+      std::vector<distance_type> _terms;
+      distance_type _sum;
+      std::vector<Saved> _saved;
+    };
+
+    /**
+     *  The bound on the distance to the far sub-trees used in the search for
+     *  the nearest neighbor: \ref Cell_bound when the metric provides a \ref
+     *  nearest_bound, \ref Plane_bound otherwise.
+     */
+    template <typename Rank, typename Key, typename Metric,
+              bool = nearest_bound<Metric>::value>
+    struct Nearest_bound
+    { typedef Cell_bound<Rank, Key, Metric> type; };
+
+    template <typename Rank, typename Key, typename Metric>
+    struct Nearest_bound<Rank, Key, Metric, false>
+    { typedef Plane_bound<Rank, Key, Metric> type; };
+
+    /**
+     *  In fewer dimensions, the distance to the plane of the parent of a
+     *  sub-tree is nearly as tight as the distance to its cell, and cheaper
+     *  to compute.
+     */
+    const dimension_type min_cell_bound_rank = 4;
+
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key, typename Metric, typename Bound>
     inline import::tuple<NodePtr, dimension_type,
                          typename Metric::distance_type>
     first_neighbor_sub(NodePtr node, dimension_type dim, Rank rank,
                        const KeyCompare& key_comp, const Metric& met,
-                       const Key& target,
+                       const Key& target, Bound& cell,
                        typename Metric::distance_type best_dist)
     {
       SPATIAL_ASSERT_CHECK(dim < rank());
@@ -1072,10 +1453,12 @@ namespace spatial
       // Finds the nearest in near-pre-order fashion. Uses semi-recursiveness.
       NodePtr best = node->parent;
       dimension_type best_dim = 0;
+      size_type mark = cell.top();
       for (;;)
         {
           typename Metric::distance_type test_dist
-            = met.distance_to_key(rank(), target, const_key(node));
+            = distance_to_key_bounded(met, rank(), target, const_key(node),
+                                      best_dist);
           if (test_dist < best_dist)
             {
               best = node;
@@ -1086,8 +1469,8 @@ namespace spatial
           import::tie(near, far) = key_comp(dim, const_key(node), target)
             ? import::make_tuple(node->right, node->left)
             : import::make_tuple(node->left, node->right);
-          if (far != 0 && (met.distance_to_plane
-                           (rank(), dim, target, const_key(node)) < best_dist))
+          typename Metric::distance_type far_dist;
+          if (far != 0 && ((far_dist = cell.far(node, dim)) < best_dist))
             {
               dimension_type child_dim = incr_dim(rank, dim);
               if (near != 0)
@@ -1095,24 +1478,26 @@ namespace spatial
                   import::tuple<NodePtr, dimension_type,
                                 typename Metric::distance_type>
                     triplet = first_neighbor_sub(near, child_dim, rank,
-                                                 key_comp, met, target,
+                                                 key_comp, met, target, cell,
                                                  best_dist);
                   if (import::get<0>(triplet) != node)
                     {
                       // If I can't go right after exploring left, I'm done
-                      if (!(met.distance_to_plane
-                            (rank(), dim, target, const_key(node))
-                            < import::get<2>(triplet)))
-                        { return triplet; }
+                      if (!(far_dist < import::get<2>(triplet)))
+                        { cell.restore(mark); return triplet; }
                       import::tie(best, best_dim, best_dist) = triplet;
                     }
                 }
+              cell.enter_far(node, dim);
               node = far; dim = child_dim;
             }
           else if (near != 0)
             { node = near; dim = incr_dim(rank, dim); }
           else
-            { return import::make_tuple(best, best_dim, best_dist); }
+            {
+              cell.restore(mark);
+              return import::make_tuple(best, best_dim, best_dist);
+            }
         }
     }
 
@@ -1123,18 +1508,26 @@ namespace spatial
     first_neighbor(NodePtr node, dimension_type dim, Rank rank,
                    const KeyCompare& key_comp, const Metric& met, const Key& target)
     {
+      if (rank() < min_cell_bound_rank)
+        {
+          Plane_bound<Rank, Key, Metric> plane(rank, met, target);
+          return first_neighbor_sub
+            (node, dim, rank, key_comp, met, target, plane,
+             (std::numeric_limits<typename Metric::distance_type>::max)());
+        }
+      typename Nearest_bound<Rank, Key, Metric>::type cell(rank, met, target);
       return first_neighbor_sub
-        (node, dim, rank, key_comp, met, target,
+        (node, dim, rank, key_comp, met, target, cell,
          (std::numeric_limits<typename Metric::distance_type>::max)());
     }
 
     template <typename NodePtr, typename Rank, typename KeyCompare,
-              typename Key, typename Metric>
+              typename Key, typename Metric, typename Bound>
     inline import::tuple<NodePtr, dimension_type,
                          typename Metric::distance_type>
     lower_bound_neighbor_sub(NodePtr node, dimension_type dim, Rank rank,
                              KeyCompare key_comp, const Metric& met,
-                             const Key& target,
+                             const Key& target, Bound& cell,
                              typename Metric::distance_type bound,
                              typename Metric::distance_type best_dist)
     {
@@ -1144,10 +1537,12 @@ namespace spatial
       SPATIAL_ASSERT_CHECK(!header(node));
       NodePtr best = node->parent;
       dimension_type best_dim = decr_dim(rank, dim);
+      size_type mark = cell.top();
       for (;;)
         {
           typename Metric::distance_type test_dist
-            = met.distance_to_key(rank(), target, const_key(node));
+            = distance_to_key_bounded(met, rank(), target, const_key(node),
+                                      best_dist);
           if (test_dist > bound)
             {
               if (test_dist < best_dist)
@@ -1158,13 +1553,16 @@ namespace spatial
                 }
             }
           else if (test_dist == bound)
-            { return import::make_tuple(node, dim, test_dist); }
+            {
+              cell.restore(mark);
+              return import::make_tuple(node, dim, test_dist);
+            }
           NodePtr near, far;
           import::tie(near, far) = key_comp(dim, const_key(node), target)
             ? import::make_tuple(node->right, node->left)
             : import::make_tuple(node->left, node->right);
-          if (far != 0 && (met.distance_to_plane
-                           (rank(), dim, target, const_key(node)) < best_dist))
+          typename Metric::distance_type far_dist;
+          if (far != 0 && ((far_dist = cell.far(node, dim)) < best_dist))
             {
               dimension_type child_dim = incr_dim(rank, dim);
               if (near != 0)
@@ -1173,24 +1571,26 @@ namespace spatial
                                 typename Metric::distance_type>
                     triplet = lower_bound_neighbor_sub(near, child_dim, rank,
                                                        key_comp, met, target,
-                                                       bound, best_dist);
+                                                       cell, bound, best_dist);
                   if (import::get<0>(triplet) != node)
                     {
                       if (import::get<2>(triplet) == bound
                           // If I can't go right after exploring left, I'm done
-                          || !(met.distance_to_plane
-                               (rank(), dim, target, const_key(node))
-                               < import::get<2>(triplet)))
-                        { return triplet; }
+                          || !(far_dist < import::get<2>(triplet)))
+                        { cell.restore(mark); return triplet; }
                       import::tie(best, best_dim, best_dist) = triplet;
                     }
                 }
+              cell.enter_far(node, dim);
               node = far; dim = child_dim;
             }
           else if (near != 0)
             { node = near; dim = incr_dim(rank, dim); }
           else
-            { return import::make_tuple(best, best_dim, best_dist); }
+            {
+              cell.restore(mark);
+              return import::make_tuple(best, best_dim, best_dist);
+            }
         }
     }
 
@@ -1203,18 +1603,26 @@ namespace spatial
                          const Key& target,
                          typename Metric::distance_type bound)
     {
+      if (rank() < min_cell_bound_rank)
+        {
+          Plane_bound<Rank, Key, Metric> plane(rank, met, target);
+          return lower_bound_neighbor_sub
+            (node, dim, rank, key_comp, met, target, plane, bound,
+             (std::numeric_limits<typename Metric::distance_type>::max)());
+        }
+      typename Nearest_bound<Rank, Key, Metric>::type cell(rank, met, target);
       return lower_bound_neighbor_sub
-        (node, dim, rank, key_comp, met, target, bound,
+        (node, dim, rank, key_comp, met, target, cell, bound,
          (std::numeric_limits<typename Metric::distance_type>::max)());
     }
 
     template <typename NodePtr, typename Rank, typename KeyCompare,
-              typename Key, typename Metric>
+              typename Key, typename Metric, typename Bound>
     inline import::tuple<NodePtr, dimension_type,
                          typename Metric::distance_type>
     upper_bound_neighbor_sub(NodePtr node, dimension_type dim, Rank rank,
                              KeyCompare key_comp, Metric met, const Key& target,
-                             typename Metric::distance_type bound,
+                             Bound& cell, typename Metric::distance_type bound,
                              typename Metric::distance_type best_dist)
     {
       SPATIAL_ASSERT_CHECK(dim < rank());
@@ -1223,10 +1631,12 @@ namespace spatial
       // Finds upper bound in left-pre-order fashion. Uses semi-recursiveness.
       NodePtr best = node->parent;
       dimension_type best_dim = decr_dim(rank, dim);
+      size_type mark = cell.top();
       for (;;)
         {
           typename Metric::distance_type test_dist
-            = met.distance_to_key(rank(), target, const_key(node));
+            = distance_to_key_bounded(met, rank(), target, const_key(node),
+                                      best_dist);
           if (test_dist > bound && test_dist < best_dist)
             {
               best = node;
@@ -1237,8 +1647,8 @@ namespace spatial
           import::tie(near, far) = key_comp(dim, const_key(node), target)
             ? import::make_tuple(node->right, node->left)
             : import::make_tuple(node->left, node->right);
-          if (far != 0 && (met.distance_to_plane
-                           (rank(), dim, target, const_key(node)) < best_dist))
+          typename Metric::distance_type far_dist;
+          if (far != 0 && ((far_dist = cell.far(node, dim)) < best_dist))
             {
               dimension_type child_dim = incr_dim(rank, dim);
               if (near != 0)
@@ -1247,23 +1657,25 @@ namespace spatial
                                 typename Metric::distance_type>
                     triplet = upper_bound_neighbor_sub(near, child_dim, rank,
                                                        key_comp, met, target,
-                                                       bound, best_dist);
+                                                       cell, bound, best_dist);
                   if (import::get<0>(triplet) != node)
                     {
                       // If I can't go right after exploring left, I'm done
-                      if (!(met.distance_to_plane
-                            (rank(), dim, target, const_key(node))
-                            < import::get<2>(triplet)))
-                        { return triplet; }
+                      if (!(far_dist < import::get<2>(triplet)))
+                        { cell.restore(mark); return triplet; }
                       import::tie(best, best_dim, best_dist) = triplet;
                     }
                 }
+              cell.enter_far(node, dim);
               node = far; dim = child_dim;
             }
           else if (near != 0)
             { node = near; dim = incr_dim(rank, dim); }
           else
-            { return import::make_tuple(best, best_dim, best_dist); }
+            {
+              cell.restore(mark);
+              return import::make_tuple(best, best_dim, best_dist);
+            }
         }
     }
 
@@ -1276,18 +1688,26 @@ namespace spatial
                          const Key& target,
                          typename Metric::distance_type bound)
     {
+      if (rank() < min_cell_bound_rank)
+        {
+          Plane_bound<Rank, Key, Metric> plane(rank, met, target);
+          return upper_bound_neighbor_sub
+            (node, dim, rank, key_comp, met, target, plane, bound,
+             (std::numeric_limits<typename Metric::distance_type>::max)());
+        }
+      typename Nearest_bound<Rank, Key, Metric>::type cell(rank, met, target);
       return upper_bound_neighbor_sub
-        (node, dim, rank, key_comp, met, target, bound,
+        (node, dim, rank, key_comp, met, target, cell, bound,
          (std::numeric_limits<typename Metric::distance_type>::max)());
     }
 
     template <typename NodePtr, typename Rank, typename KeyCompare,
-              typename Key, typename Metric>
+              typename Key, typename Metric, typename Bound>
     inline import::tuple<NodePtr, dimension_type,
                          typename Metric::distance_type>
     increment_neighbor(NodePtr node, dimension_type dim, Rank rank,
                        KeyCompare key_comp, const Metric& met,
-                       const Key& target,
+                       const Key& target, Bound& cell,
                        typename Metric::distance_type node_dist)
     {
       SPATIAL_ASSERT_CHECK(dim < rank());
@@ -1298,6 +1718,7 @@ namespace spatial
       NodePtr best = 0;
       dimension_type best_dim = dim;
       typename Metric::distance_type best_dist = node_dist;
+      cell.enter_path(node, dim, key_comp);
       // Looks forward to find an equal or greater next best. If an equal next
       // best is found, then no need to look further. 'Forward' and 'backward'
       // refer to tree walking in near-pre-order.
@@ -1310,34 +1731,38 @@ namespace spatial
           if (near != 0)
             { node = near; dim = incr_dim(rank, dim); }
           else if (far != 0
-                   && (best == 0
-                       || met.distance_to_plane
-                       (rank(), dim, target, const_key(node)) < best_dist))
-            { node = far; dim = incr_dim(rank, dim); }
+                   && (best == 0 || cell.far(node, dim) < best_dist))
+            {
+              cell.enter_far(node, dim);
+              node = far; dim = incr_dim(rank, dim);
+            }
           else
             {
-              NodePtr prev_node = node;
-              node = node->parent; dim = decr_dim(rank, dim);
-              while (!header(node)
-                     && (prev_node
-                         == (far = key_comp(dim, const_key(node), target)
-                             ? node->left : node->right)
-                         || far == 0
-                         || !(best == 0
-                              || (met.distance_to_plane
-                                  (rank(), dim, target, const_key(node))
-                                  < best_dist))))
+              for (;;)
                 {
-                  prev_node = node;
+                  NodePtr prev_node = node;
                   node = node->parent; dim = decr_dim(rank, dim);
+                  if (header(node)) break;
+                  far = key_comp(dim, const_key(node), target)
+                    ? node->left : node->right;
+                  if (prev_node == far) { cell.leave_far(); continue; }
+                  if (far != 0
+                      && (best == 0 || cell.far(node, dim) < best_dist))
+                    break;
                 }
               if (!header(node))
-                { node = far; dim = incr_dim(rank, dim); }
+                {
+                  cell.enter_far(node, dim);
+                  node = far; dim = incr_dim(rank, dim);
+                }
               else break;
             }
           // Test node here and stops as soon as it finds an equal
           typename Metric::distance_type test_dist
-            = met.distance_to_key(rank(), target, const_key(node));
+            = distance_to_key_bounded
+            (met, rank(), target, const_key(node), best == 0
+             ? (std::numeric_limits<typename Metric::distance_type>::max)()
+             : best_dist);
           if (test_dist == node_dist)
             {
               SPATIAL_ASSERT_CHECK(dim < rank());
@@ -1387,7 +1812,10 @@ namespace spatial
             }
           // Test node here for new best
           typename Metric::distance_type test_dist
-            = met.distance_to_key(rank(), target, const_key(node));
+            = distance_to_key_bounded
+            (met, rank(), target, const_key(node), best == 0
+             ? (std::numeric_limits<typename Metric::distance_type>::max)()
+             : best_dist);
           if (test_dist > node_dist && (best == 0 || test_dist <= best_dist))
             {
               best = node;
@@ -1409,13 +1837,37 @@ namespace spatial
               typename Key, typename Metric>
     inline import::tuple<NodePtr, dimension_type,
                          typename Metric::distance_type>
-    decrement_neighbor(NodePtr node, dimension_type dim, Rank rank,
+    increment_neighbor(NodePtr node, dimension_type dim, Rank rank,
                        KeyCompare key_comp, const Metric& met,
                        const Key& target,
                        typename Metric::distance_type node_dist)
     {
-      if (header(node))
-        { return last_neighbor(node->parent, 0, rank, key_comp, met, target); }
+      if (rank() < min_cell_bound_rank)
+        {
+          Plane_bound<Rank, Key, Metric> plane(rank, met, target);
+          return increment_neighbor(node, dim, rank, key_comp, met, target,
+                                    plane, node_dist);
+        }
+      typename Nearest_bound<Rank, Key, Metric>::type cell(rank, met, target);
+      return increment_neighbor(node, dim, rank, key_comp, met, target, cell,
+                                node_dist);
+    }
+
+    /**
+     *  Returns the node that precedes \c node in the order of the neighbor
+     *  iterators, by walking the tree back and forth from \c node. Only the
+     *  far sub-trees further than \c node along a single dimension are
+     *  skipped.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key, typename Metric>
+    inline import::tuple<NodePtr, dimension_type,
+                         typename Metric::distance_type>
+    decrement_neighbor_sub(NodePtr node, dimension_type dim, Rank rank,
+                           KeyCompare key_comp, const Metric& met,
+                           const Key& target,
+                           typename Metric::distance_type node_dist)
+    {
       SPATIAL_ASSERT_CHECK(dim < rank());
       SPATIAL_ASSERT_CHECK(node != 0);
       NodePtr orig = node;
@@ -1528,6 +1980,65 @@ namespace spatial
       return import::make_tuple(node, dim, best_dist);
     }
 
+    /**
+     *  Returns the node that precedes \c node in the order of the neighbor
+     *  iterators, when the metric does not provide a \ref furthest_bound.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key, typename Metric>
+    inline typename enable_if_c<!furthest_bound<Metric>::value,
+                                import::tuple<NodePtr, dimension_type,
+                                              typename Metric::distance_type>
+                                >::type
+    decrement_neighbor(NodePtr node, dimension_type dim, Rank rank,
+                       KeyCompare key_comp, const Metric& met,
+                       const Key& target,
+                       typename Metric::distance_type node_dist)
+    {
+      if (header(node))
+        { return last_neighbor(node->parent, 0, rank, key_comp, met, target); }
+      return decrement_neighbor_sub(node, dim, rank, key_comp, met, target,
+                                    node_dist);
+    }
+
+    /**
+     *  Returns the node that precedes \c node in the order of the neighbor
+     *  iterators, pruning the sub-trees that cannot hold a node further than
+     *  the best node found so far, as \ref last_neighbor does.
+     *  \see Last_neighbor_search
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key, typename Metric>
+    inline typename enable_if<furthest_bound<Metric>,
+                              import::tuple<NodePtr, dimension_type,
+                                            typename Metric::distance_type>
+                              >::type
+    decrement_neighbor(NodePtr node, dimension_type dim, Rank rank,
+                       KeyCompare key_comp, const Metric& met,
+                       const Key& target,
+                       typename Metric::distance_type node_dist)
+    {
+      if (header(node))
+        { return last_neighbor(node->parent, 0, rank, key_comp, met, target); }
+      NodePtr root = node;
+      while (!header(root->parent)) { root = root->parent; }
+      if (!furthest_bound_pays(root, rank))
+        {
+          return decrement_neighbor_sub(node, dim, rank, key_comp, met,
+                                        target, node_dist);
+        }
+      Last_neighbor_search<NodePtr, Rank, KeyCompare, Key, Metric>
+        search(rank, key_comp, met, target, root, node, node_dist);
+      search.run(root, 0);
+      if (search.best == 0)
+        {
+          return import::make_tuple(root->parent, decr_dim(rank, 0),
+                                    node_dist);
+        }
+      return import::make_tuple(search.best, search.best_dim,
+                                search.best_dist);
+    }
+
   } // namespace details
 } // namespace spatial
 
@@ -0,0 +1,623 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_neighbor_visit.hpp
+ *  Contains the definition of \ref spatial::for_each_neighbor() and \ref
+ *  spatial::for_each_neighbor_in_region(), which give the elements of a
+ *  container to a visitor, from the nearest to the furthest away from a
+ *  target, in a single traversal of the tree, and of \ref
+ *  spatial::neighbor_in_region_iterator, which returns them one at a time
+ *  from the same traversal.
+ */
+
+#ifndef SPATIAL_NEIGHBOR_VISIT_HPP
+#define SPATIAL_NEIGHBOR_VISIT_HPP
+
+#include <vector>
+#include <algorithm> // std::push_heap, std::pop_heap
+#include <iterator> // std::iterator_traits, std::forward_iterator_tag
+#include <utility> // std::pair
+
+#include "spatial_import_tuple.hpp"
+#include "spatial_region.hpp"
+#include "../metric.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  An entry in the queue of \ref visit_neighbor: either a key, with its
+     *  distance to the target, or a sub-tree, with a lower bound of the
+     *  distance from the target to any of its keys.
+     */
+    template <typename NodePtr, typename DistanceType>
+    struct Neighbor_visit_entry
+    {
+      Neighbor_visit_entry(DistanceType distance_, NodePtr node_,
+                           dimension_type dim_, bool is_key_)
+        : distance(distance_), node(node_), dim(dim_), is_key(is_key_) { }
+
+      //! Entries are ordered such that the heap yields the nearest first,
+      //! and keys before sub-trees at equal distances.
+      bool operator<(const Neighbor_visit_entry& other) const
+      {
+        return other.distance < distance
+          || (!(distance < other.distance) && !is_key && other.is_key);
+      }
+
+      DistanceType distance;
+      NodePtr node;
+      dimension_type dim;
+      bool is_key;
+    };
+
+    /**
+     *  Walks a tree in best-first order and returns its keys one at a time,
+     *  from the nearest to the furthest away from the target.
+     *
+     *  Keys and sub-trees are held in a single priority queue. A sub-tree is
+     *  only expanded when it holds the smallest lower bound in the queue; its
+     *  near child, which shares the lower bound of its parent, is expanded
+     *  immediately, while its far child is bounded by the distance to the
+     *  splitting plane. Thus, only the sub-trees that may hold a key nearer
+     *  than the last key returned are ever expanded.
+     *
+     *  Only the keys that match the predicate, a model of \region_predicate,
+     *  are returned, and the children that lie outside of the predicate are
+     *  never queued. With \ref Any_region, these tests are resolved at
+     *  compile time.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Metric, typename Key, typename Predicate>
+    class Neighbor_visit
+    {
+    public:
+      typedef typename Metric::distance_type distance_type;
+
+      Neighbor_visit(Rank rank, const KeyCompare& key_comp,
+                     const Metric& met, const Key& target,
+                     const Predicate& pred)
+        : _rank(rank), _key_comp(key_comp), _met(met), _target(target),
+          _pred(pred), _queue() { }
+
+      //! Queues the sub-tree of \c node, the root of the tree.
+      void start(NodePtr node)
+      { _queue.push_back(entry_type(distance_type(), node, 0, false)); }
+
+      //! Sets \c node and \c distance to the next key, and returns false
+      //! when all keys were returned.
+      bool next(NodePtr& node, distance_type& distance)
+      {
+        while (!_queue.empty())
+          {
+            std::pop_heap(_queue.begin(), _queue.end());
+            entry_type top = _queue.back();
+            _queue.pop_back();
+            if (top.is_key)
+              {
+                node = top.node;
+                distance = top.distance;
+                return true;
+              }
+            expand(top);
+          }
+        return false;
+      }
+
+      //! The target of the walk.
+      const Key& target() const { return _target; }
+
+      //! The metric of the walk.
+      const Metric& metric() const { return _met; }
+
+      //! The predicate of the walk.
+      const Predicate& predicate() const { return _pred; }
+
+    private:
+      typedef Neighbor_visit_entry<NodePtr, distance_type> entry_type;
+
+      //! Queues the keys on the near path of the sub-tree in \c top, and the
+      //! far children along the way.
+      void expand(entry_type top)
+      {
+        for (NodePtr node = top.node; node != 0;)
+          {
+            SPATIAL_ASSERT_CHECK(top.dim < _rank());
+            SPATIAL_ASSERT_CHECK(!header(node));
+            relative_order rel = _pred(top.dim, _rank(), const_key(node));
+            if (rel == matching
+                && match_key(_rank, const_key(node), _pred, top.dim))
+              {
+                _queue.push_back
+                  (entry_type(_met.distance_to_key(_rank(), _target,
+                                                   const_key(node)),
+                              node, top.dim, true));
+                std::push_heap(_queue.begin(), _queue.end());
+              }
+            NodePtr left = (rel != below) ? node->left : 0;
+            NodePtr right = (rel != above) ? node->right : 0;
+            NodePtr near, far;
+            import::tie(near, far)
+              = _key_comp(top.dim, _target, const_key(node))
+              ? import::make_tuple(left, right)
+              : import::make_tuple(right, left);
+            dimension_type child_dim = incr_dim(_rank, top.dim);
+            if (far != 0)
+              {
+                distance_type plane = _met.distance_to_plane
+                  (_rank(), top.dim, _target, const_key(node));
+                _queue.push_back
+                  (entry_type(top.distance < plane ? plane : top.distance,
+                              far, child_dim, false));
+                std::push_heap(_queue.begin(), _queue.end());
+              }
+            node = near;
+            top.dim = child_dim;
+          }
+      }
+
+      Rank _rank;
+      KeyCompare _key_comp;
+      Metric _met;
+      Key _target;
+      Predicate _pred;
+      std::vector<entry_type> _queue;
+    };
+
+    /**
+     *  Calls \c visitor for each key below \c node, from the nearest to the
+     *  furthest away from \c target, that matches \c pred.
+     *  \see Neighbor_visit
+     */
+    template <typename Iterator, typename Rank, typename KeyCompare,
+              typename Metric, typename Key, typename Predicate,
+              typename Visitor>
+    inline void
+    visit_neighbor(typename Iterator::node_ptr node, Rank rank,
+                   const KeyCompare& key_comp, const Metric& met,
+                   const Key& target, const Predicate& pred,
+                   Visitor& visitor)
+    {
+      Neighbor_visit<typename Iterator::node_ptr, Rank, KeyCompare, Metric,
+                     Key, Predicate> visit(rank, key_comp, met, target, pred);
+      visit.start(node);
+      typename Metric::distance_type distance
+        = typename Metric::distance_type();
+      while (visit.next(node, distance))
+        { if (!visitor(Iterator(node), distance)) return; }
+    }
+
+    //! The iterator of \c Container, or its constant iterator if \c
+    //! Container is constant.
+    ///@{
+    template <typename Container>
+    struct Visit_iterator
+    { typedef typename Container::iterator type; };
+
+    template <typename Container>
+    struct Visit_iterator<const Container>
+    { typedef typename Container::const_iterator type; };
+    ///@}
+
+    //! Deduces the iterator type given to the visitor from \c end, the
+    //! result of \c container.end().
+    template <typename Container, typename Iterator, typename Metric,
+              typename Predicate, typename Visitor>
+    inline void
+    for_each_neighbor(Container& container, Iterator end, const Metric& met,
+                      const typename Container::key_type& target,
+                      const Predicate& pred, Visitor& visitor)
+    {
+      visit_neighbor<Iterator>(end.node->parent, container.rank(),
+                               container.key_comp(), met, target, pred,
+                               visitor);
+    }
+  } // namespace details
+
+  /**
+   *  Calls \c visitor for each element of \c container, from the nearest to
+   *  the furthest away from \c target according to \c metric, until \c
+   *  visitor returns false.
+   *
+   *  The elements are pushed to \c visitor during a single best-first
+   *  traversal of the tree, instead of being pulled one at a time with \ref
+   *  neighbor_begin() and \ref neighbor_end(), which must search the tree
+   *  again from the last element found on each increment. Since \c visitor
+   *  is a template parameter, the call is resolved, and usually inlined, at
+   *  compile time. \c visitor is called as:
+   *
+   *  \code
+   *  bool continue = visitor(element, distance);
+   *  \endcode
+   *
+   *  Where \c element is a \c Container::iterator, or a \c
+   *  Container::const_iterator if \c container is constant, and \c distance
+   *  is its distance to \c target. Elements at the same distance from \c
+   *  target are visited in no particular order. The traversal stops as soon
+   *  as \c visitor returns false, which makes it suitable for k-nearest and
+   *  radius searches. The container must not be modified during the
+   *  traversal.
+   *
+   *  The memory used during the traversal grows with the number of elements
+   *  visited, therefore, when most of the elements of the container are
+   *  visited, iterating with \ref neighbor_begin() is more economical.
+   *
+   *  \param container The container in which elements are visited.
+   *  \param metric The metric used to compute distances to \c target.
+   *  \param target The key from which distances are computed.
+   *  \param visitor The functor receiving each element.
+   *  \return A copy of \c visitor, after it was called for each element.
+   */
+  template <typename Container, typename Metric, typename Visitor>
+  inline Visitor
+  for_each_neighbor(Container& container, const Metric& metric,
+                    const typename Container::key_type& target,
+                    Visitor visitor)
+  {
+    if (container.empty()) return visitor;
+    details::for_each_neighbor(container, container.end(), metric, target,
+                               details::Any_region(), visitor);
+    return visitor;
+  }
+
+  /**
+   *  Calls \c visitor for each element of \c container, from the nearest to
+   *  the furthest away from \c target, assuming an euclidian metric with
+   *  distances expressed in double. It requires that the container used was
+   *  defined with a built-in key compare functor.
+   *
+   *  \see for_each_neighbor(Container&, const Metric&,
+   *  const typename Container::key_type&, Visitor)
+   */
+  template <typename Container, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_neighbor(Container& container,
+                    const typename Container::key_type& target,
+                    Visitor visitor)
+  {
+    return for_each_neighbor
+      (container,
+       euclidian<Container, double,
+                 typename details::with_builtin_difference<Container>::type>
+       (details::with_builtin_difference<Container>()(container)),
+       target, visitor);
+  }
+
+  /**
+   *  Calls \c visitor for each element of \c container that matches \c
+   *  pred, from the nearest to the furthest away from \c target according to
+   *  \c metric, until \c visitor returns false.
+   *
+   *  \c pred is a model of \region_predicate, such as the predicates used by
+   *  \ref region_iterator. The sub-trees that lie outside of \c pred are
+   *  pruned during the traversal itself, and are never queued: this is
+   *  faster than filtering the elements given by \ref for_each_neighbor()
+   *  when few of the nearest elements match \c pred.
+   *
+   *  The memory used is not constant: the queue holds the elements of the
+   *  region reached but not yet visited, and the far sub-trees met on the
+   *  way down to them, up to one per level of the tree for each sub-tree
+   *  expanded. \ref neighbor_in_region_iterator gives the same elements
+   *  one at a time.
+   *
+   *  \see for_each_neighbor(Container&, const Metric&,
+   *  const typename Container::key_type&, Visitor)
+   *
+   *  \param container The container in which elements are visited.
+   *  \param metric The metric used to compute distances to \c target.
+   *  \param target The key from which distances are computed.
+   *  \param pred A model of \region_predicate.
+   *  \param visitor The functor receiving each element.
+   *  \return A copy of \c visitor, after it was called for each element.
+   */
+  template <typename Container, typename Metric, typename Predicate,
+            typename Visitor>
+  inline Visitor
+  for_each_neighbor_in_region(Container& container, const Metric& metric,
+                              const typename Container::key_type& target,
+                              const Predicate& pred, Visitor visitor)
+  {
+    if (container.empty()) return visitor;
+    details::for_each_neighbor(container, container.end(), metric, target,
+                               pred, visitor);
+    return visitor;
+  }
+
+  /**
+   *  Calls \c visitor for each element of \c container that matches \c
+   *  pred, from the nearest to the furthest away from \c target, assuming an
+   *  euclidian metric with distances expressed in double. It requires that
+   *  the container used was defined with a built-in key compare functor.
+   *
+   *  \see for_each_neighbor_in_region(Container&, const Metric&,
+   *  const typename Container::key_type&, const Predicate&, Visitor)
+   */
+  template <typename Container, typename Predicate, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_neighbor_in_region(Container& container,
+                              const typename Container::key_type& target,
+                              const Predicate& pred, Visitor visitor)
+  {
+    return for_each_neighbor_in_region
+      (container,
+       euclidian<Container, double,
+                 typename details::with_builtin_difference<Container>::type>
+       (details::with_builtin_difference<Container>()(container)),
+       target, pred, visitor);
+  }
+
+  /**
+   *  A forward iterator over the elements of a container that match a
+   *  \region_predicate, from the nearest to the furthest away from a target
+   *  according to a \metric.
+   *
+   *  Each increment resumes the best-first traversal of \ref
+   *  for_each_neighbor_in_region() where it stopped, so that iterating over
+   *  the k nearest elements of a region costs the same as visiting them.
+   *  Unlike \ref neighbor_iterator, the iterator cannot go backward, and it
+   *  holds the queue of the traversal: copying it copies the queue. The
+   *  container must not be modified while the iterator is used.
+   *
+   *  \tparam Container The container type bound to the iterator.
+   *  \tparam Predicate A model of \region_predicate.
+   *  \tparam Metric A model of \metric.
+   */
+  template <typename Container, typename Predicate, typename Metric =
+            euclidian<typename details::mutate<Container>::type, double,
+                      typename details::with_builtin_difference<Container>
+                      ::type> >
+  class neighbor_in_region_iterator
+  {
+    typedef typename details::Visit_iterator<Container>::type Iterator;
+    typedef details::Neighbor_visit
+    <typename Iterator::node_ptr, typename Container::rank_type,
+     typename Container::key_compare, Metric,
+     typename Container::key_type, Predicate> Visit;
+    typedef neighbor_in_region_iterator<Container, Predicate, Metric> Self;
+
+  public:
+    typedef typename std::iterator_traits<Iterator>::value_type value_type;
+    typedef typename std::iterator_traits<Iterator>::reference reference;
+    typedef typename std::iterator_traits<Iterator>::pointer pointer;
+    typedef typename std::iterator_traits<Iterator>::difference_type
+    difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename Iterator::node_ptr node_ptr;
+
+    //! The type of the keys of the container.
+    typedef typename Container::key_type key_type;
+
+    //! The metric type used by the iterator
+    typedef Metric metric_type;
+
+    //! The distance type that is read from metric_type
+    typedef typename Metric::distance_type distance_type;
+
+    /**
+     *  Build an iterator to the nearest element of \c container to \c
+     *  target that matches \c pred, or past-the-end if there is none.
+     */
+    neighbor_in_region_iterator(Container& container, const Metric& metric,
+                                const key_type& target,
+                                const Predicate& pred)
+      : node(container.end().node),
+        _visit(container.rank(), container.key_comp(), metric, target,
+               pred),
+        _end(container.end().node), _distance()
+    {
+      if (container.empty()) return;
+      _visit.start(_end->parent);
+      increment();
+    }
+
+    /**
+     *  Build an iterator pointing to \c iter, with nothing left to visit
+     *  after it: this builds the past-the-end iterator when \c iter is \c
+     *  container.end().
+     */
+    neighbor_in_region_iterator(Container& container, const Metric& metric,
+                                const key_type& target,
+                                const Predicate& pred, Iterator iter)
+      : node(iter.node),
+        _visit(container.rank(), container.key_comp(), metric, target,
+               pred),
+        _end(container.end().node), _distance() { }
+
+    //! Dereference the iterator: return the value of the node.
+    reference operator*() const
+    { Iterator i(node); return *i; }
+
+    //! Dereference the iterator: return the pointer to the value of the
+    //! node.
+    pointer operator->() const
+    { Iterator i(node); return &*i; }
+
+    //! Moves to the next nearest element that matches the predicate.
+    Self& operator++()
+    { increment(); return *this; }
+
+    //! Moves to the next nearest element that matches the predicate, and
+    //! returns the iterator value before the move.
+    Self operator++(int)
+    { Self x(*this); increment(); return x; }
+
+    //! Check if 2 iterators point at the same node.
+    bool operator==(const Self& x) const
+    { return node == x.node; }
+
+    //! Check if 2 iterators point at different nodes.
+    bool operator!=(const Self& x) const
+    { return node != x.node; }
+
+    //! The distance of the current element to the target. Only relevant
+    //! if the iterator does not point past-the-end.
+    distance_type distance() const { return _distance; }
+
+    //! The target of the iteration.
+    const key_type& target_key() const { return _visit.target(); }
+
+    //! The metric used by the iterator.
+    const metric_type& metric() const { return _visit.metric(); }
+
+    //! The predicate used by the iterator.
+    const Predicate& predicate() const { return _visit.predicate(); }
+
+    //! The node pointed to by the iterator.
+    node_ptr node;
+
+  private:
+    void increment()
+    { if (!_visit.next(node, _distance)) node = _end; }
+
+    Visit _visit;
+    node_ptr _end;
+    distance_type _distance;
+  };
+
+  /**
+   *  Returns the distance to the target of the element pointed to by \c
+   *  iter. The distance read is only relevant if the iterator does not
+   *  point past-the-end.
+   */
+  template <typename Container, typename Predicate, typename Metric>
+  inline typename Metric::distance_type
+  distance(const neighbor_in_region_iterator<Container, Predicate, Metric>&
+           iter)
+  { return iter.distance(); }
+
+  /**
+   *  Build a \ref neighbor_in_region_iterator pointing to the nearest
+   *  element of \c container to \c target that matches \c pred, using a
+   *  user-defined \metric.
+   *
+   *  \param container The container in which elements are iterated.
+   *  \param metric The metric used to compute distances to \c target.
+   *  \param target The key from which distances are computed.
+   *  \param pred A model of \region_predicate.
+   */
+  template <typename Container, typename Metric, typename Predicate>
+  inline neighbor_in_region_iterator<Container, Predicate, Metric>
+  neighbor_in_region_begin(Container& container, const Metric& metric,
+                           const typename Container::key_type& target,
+                           const Predicate& pred)
+  {
+    return neighbor_in_region_iterator<Container, Predicate, Metric>
+      (container, metric, target, pred);
+  }
+
+  /**
+   *  Build a past-the-end \ref neighbor_in_region_iterator, using a
+   *  user-defined \metric.
+   *
+   *  \param container The container in which elements are iterated.
+   *  \param metric The metric used to compute distances to \c target.
+   *  \param target The key from which distances are computed.
+   *  \param pred A model of \region_predicate.
+   */
+  template <typename Container, typename Metric, typename Predicate>
+  inline neighbor_in_region_iterator<Container, Predicate, Metric>
+  neighbor_in_region_end(Container& container, const Metric& metric,
+                         const typename Container::key_type& target,
+                         const Predicate& pred)
+  {
+    return neighbor_in_region_iterator<Container, Predicate, Metric>
+      (container, metric, target, pred, container.end());
+  }
+
+  /**
+   *  Returns the pair of \ref neighbor_in_region_iterator representing the
+   *  elements of \c container that match \c pred, from the nearest to the
+   *  furthest away from \c target, using a user-defined \metric.
+   *
+   *  \param container The container in which elements are iterated.
+   *  \param metric The metric used to compute distances to \c target.
+   *  \param target The key from which distances are computed.
+   *  \param pred A model of \region_predicate.
+   */
+  template <typename Container, typename Metric, typename Predicate>
+  inline std::pair<neighbor_in_region_iterator<Container, Predicate, Metric>,
+                   neighbor_in_region_iterator<Container, Predicate, Metric> >
+  neighbor_in_region_range(Container& container, const Metric& metric,
+                           const typename Container::key_type& target,
+                           const Predicate& pred)
+  {
+    return std::make_pair
+      (neighbor_in_region_begin(container, metric, target, pred),
+       neighbor_in_region_end(container, metric, target, pred));
+  }
+
+  /**
+   *  Build a \ref neighbor_in_region_iterator pointing to the nearest
+   *  element of \c container to \c target that matches \c pred, assuming
+   *  an euclidian metric with distances expressed in double. It requires
+   *  that the container used was defined with a built-in key compare
+   *  functor.
+   */
+  template <typename Container, typename Predicate>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            neighbor_in_region_iterator<Container, Predicate>
+                            >::type
+  neighbor_in_region_begin(Container& container,
+                           const typename Container::key_type& target,
+                           const Predicate& pred)
+  {
+    return neighbor_in_region_begin
+      (container,
+       euclidian<typename details::mutate<Container>::type, double,
+                 typename details::with_builtin_difference<Container>::type>
+       (details::with_builtin_difference<Container>()(container)),
+       target, pred);
+  }
+
+  /**
+   *  Build a past-the-end \ref neighbor_in_region_iterator, assuming an
+   *  euclidian metric with distances expressed in double. It requires that
+   *  the container used was defined with a built-in key compare functor.
+   */
+  template <typename Container, typename Predicate>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            neighbor_in_region_iterator<Container, Predicate>
+                            >::type
+  neighbor_in_region_end(Container& container,
+                         const typename Container::key_type& target,
+                         const Predicate& pred)
+  {
+    return neighbor_in_region_end
+      (container,
+       euclidian<typename details::mutate<Container>::type, double,
+                 typename details::with_builtin_difference<Container>::type>
+       (details::with_builtin_difference<Container>()(container)),
+       target, pred);
+  }
+
+  /**
+   *  Returns the pair of \ref neighbor_in_region_iterator representing the
+   *  elements of \c container that match \c pred, from the nearest to the
+   *  furthest away from \c target, assuming an euclidian metric with
+   *  distances expressed in double. It requires that the container used was
+   *  defined with a built-in key compare functor.
+   */
+  template <typename Container, typename Predicate>
+  inline typename enable_if
+  <details::is_compare_builtin<Container>,
+   std::pair<neighbor_in_region_iterator<Container, Predicate>,
+             neighbor_in_region_iterator<Container, Predicate> > >::type
+  neighbor_in_region_range(Container& container,
+                           const typename Container::key_type& target,
+                           const Predicate& pred)
+  {
+    return std::make_pair
+      (neighbor_in_region_begin(container, target, pred),
+       neighbor_in_region_end(container, target, pred));
+  }
+} // namespace spatial
+
+#endif // SPATIAL_NEIGHBOR_VISIT_HPP
@@ -365,6 +365,36 @@ namespace spatial
       operator= (const Relaxed_kdtree_link<Key, Value>&);
     };
 
+    /**
+     *  Define a weighted link type for the relaxed \kdtree that also holds
+     *  the aggregate of all the values in the sub-tree of the node, as defined
+     *  by \c Monoid.
+     *
+     *  The nodes of this link are still seen as nodes of a \ref
+     *  Relaxed_kdtree_link by all algorithms. Only the tree that allocates
+     *  them, and \ref const_aggregate(), know about the aggregate.
+     *
+     *  \tparam Key The key type that is held by the link.
+     *  \tparam Value The value type that is held by the link.
+     *  \tparam Monoid The definition of the aggregate, see \ref
+     *  Relaxed_kdtree.
+     */
+    template<typename Key, typename Value, typename Monoid>
+    struct Aggregate_kdtree_link : Relaxed_kdtree_link<Key, Value>
+    {
+      //! \empty
+      Aggregate_kdtree_link() { }
+
+      //! The combination of the value of the node with the aggregates of
+      //! its children.
+      typename Monoid::aggregate_type aggregate;
+
+    private:
+      //! The link_type is a non-assignable type.
+      Aggregate_kdtree_link<Key, Value, Monoid>&
+      operator= (const Aggregate_kdtree_link<Key, Value, Monoid>&);
+    };
+
     /**
      *  This function converts a pointer on a node into a link for a \ref
      *  Kdtree_link type.
@@ -525,6 +555,49 @@ namespace spatial
     }
     ///@}
 
+    /**
+     *  This function returns the aggregate stored in a node of a tree that
+     *  was allocated with \ref Aggregate_kdtree_link. It must be called with
+     *  the same \c Monoid as the one used by the tree.
+     *  \tparam Monoid The definition of the aggregate.
+     *  \tparam Key the key type for the \ref Relaxed_kdtree_link.
+     *  \tparam Value the value type for the \ref Relaxed_kdtree_link.
+     *  \param node the node holding the aggregate of its sub-tree.
+     */
+    template <typename Monoid, typename Key, typename Value>
+    inline const typename Monoid::aggregate_type&
+    const_aggregate(const Node<Relaxed_kdtree_link<Key, Value> >* node)
+    {
+      return static_cast<const Aggregate_kdtree_link<Key, Value, Monoid>*>
+        (const_link(node))->aggregate;
+    }
+
+    /**
+     *  Returns the number of nodes in the sub-tree of \c node. For nodes that
+     *  store the weight of their sub-tree, this is done in constant time,
+     *  otherwise the nodes are counted one by one.
+     */
+    ///@{
+    template <typename Key, typename Value>
+    inline size_type
+    subtree_size(const Node<Relaxed_kdtree_link<Key, Value> >* node)
+    { return static_cast<size_type>(const_link(node)->weight); }
+
+    template <typename Key, typename Value>
+    inline size_type
+    subtree_size(const Node<Kdtree_link<Key, Value> >* node)
+    {
+      size_type count = 0;
+      for (;;)
+        {
+          ++count;
+          if (node->left != 0) { count += subtree_size(node->left); }
+          if (node->right == 0) { return count; }
+          node = node->right;
+        }
+    }
+    ///@}
+
     /**
      *  Swaps nodes position in the tree.
      *
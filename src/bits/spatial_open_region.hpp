@@ -88,6 +88,36 @@ namespace spatial
                  : above));
     }
 
+    /**
+     *  Returns \c true if \c key is below, or equal to, the lower boundary
+     *  along \c dim.
+     */
+    bool
+    less_than_lower_bound(dimension_type dim, dimension_type,
+                          const Key& key) const
+    { return !Compare::operator()(dim, _lower, key); }
+
+    /**
+     *  Returns \c true if \c key is above, or equal to, the upper boundary
+     *  along \c dim.
+     */
+    bool
+    greater_than_upper_bound(dimension_type dim, dimension_type,
+                             const Key& key) const
+    { return !Compare::operator()(dim, key, _upper); }
+
+    /**
+     *  Returns \c true if \c key is within the boundaries on all dimensions.
+     *  \see bounds::match_key()
+     */
+    template <typename Rank>
+    bool match_key(Rank rank, const Key& key, dimension_type tested) const
+    {
+      details::Match_two_sided<open_bounds, Key> op(*this, rank(), key,
+                                                   tested);
+      return details::for_each_dim(rank, op);
+    }
+
   private:
     /**
      *  The lower bound for the orthogonal region iterator.
@@ -100,6 +130,17 @@ namespace spatial
     Key _upper;
   };
 
+  namespace details
+  {
+    template <typename Key, typename Compare>
+    struct is_whole_key_predicate<open_bounds<Key, Compare> >
+      : is_compare_builtin_helper<Compare> { };
+
+    template <typename Key, typename Compare>
+    struct is_two_sided_predicate<open_bounds<Key, Compare> >
+      : import::true_type { };
+  } // namespace details
+
   /**
    *  A \ref open_bounds factory that takes in a \c container, a region defined
    *  by \c lower and \c upper, and returns a constructed \ref open_bounds
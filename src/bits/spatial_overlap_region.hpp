@@ -83,6 +83,26 @@ namespace spatial
       return overlap_bounds_impl(dim, rank, key, Layout());
     }
 
+    /**
+     *  Returns \c true if the box \c key is below the target box along \c
+     *  dim, which is the same as the operator returning \ref below, with a
+     *  single comparison.
+     */
+    bool
+    less_than_lower_bound(dimension_type dim, dimension_type rank,
+                          const Key& key) const
+    { return overlap_below_impl(dim, rank, key, Layout()); }
+
+    /**
+     *  Returns \c true if the box \c key is above the target box along \c
+     *  dim, which is the same as the operator returning \ref above, with a
+     *  single comparison.
+     */
+    bool
+    greater_than_upper_bound(dimension_type dim, dimension_type rank,
+                             const Key& key) const
+    { return overlap_above_impl(dim, rank, key, Layout()); }
+
   private:
     /**
      *  The box value that will be used for overlaping comparison.
@@ -128,8 +148,79 @@ namespace spatial
         ? (Compare::operator()(dim + 1, _target, dim, key) ? matching : below)
         : (Compare::operator()(dim, key, dim - 1, _target) ? matching : above);
     }
+
+    bool overlap_below_impl
+    (dimension_type dim, dimension_type rank, const Key& key, llhh_layout_tag)
+    const
+    {
+      return (dim >= (rank >> 1))
+        && !Compare::operator()(dim - (rank >> 1), _target, dim, key);
+    }
+
+    bool overlap_above_impl
+    (dimension_type dim, dimension_type rank, const Key& key, llhh_layout_tag)
+    const
+    {
+      return (dim < (rank >> 1))
+        && !Compare::operator()(dim, key, dim + (rank >> 1), _target);
+    }
+
+    bool overlap_below_impl
+    (dimension_type dim, dimension_type, const Key& key, lhlh_layout_tag)
+    const
+    {
+      return ((dim % 2) != 0)
+        && !Compare::operator()(dim - 1, _target, dim, key);
+    }
+
+    bool overlap_above_impl
+    (dimension_type dim, dimension_type, const Key& key, lhlh_layout_tag)
+    const
+    {
+      return ((dim % 2) == 0)
+        && !Compare::operator()(dim, key, dim + 1, _target);
+    }
+
+    bool overlap_below_impl
+    (dimension_type dim, dimension_type rank, const Key& key, hhll_layout_tag)
+    const
+    {
+      return (dim < (rank >> 1))
+        && !Compare::operator()(dim + (rank >> 1), _target, dim, key);
+    }
+
+    bool overlap_above_impl
+    (dimension_type dim, dimension_type rank, const Key& key, hhll_layout_tag)
+    const
+    {
+      return (dim >= (rank >> 1))
+        && !Compare::operator()(dim, key, dim - (rank >> 1), _target);
+    }
+
+    bool overlap_below_impl
+    (dimension_type dim, dimension_type, const Key& key, hlhl_layout_tag)
+    const
+    {
+      return ((dim % 2) == 0)
+        && !Compare::operator()(dim + 1, _target, dim, key);
+    }
+
+    bool overlap_above_impl
+    (dimension_type dim, dimension_type, const Key& key, hlhl_layout_tag)
+    const
+    {
+      return ((dim % 2) != 0)
+        && !Compare::operator()(dim, key, dim - 1, _target);
+    }
   };
 
+  namespace details
+  {
+    template <typename Key, typename Compare, typename Layout>
+    struct is_two_sided_predicate<overlap_bounds<Key, Compare, Layout> >
+      : import::true_type { };
+  } // namespace details
+
   /**
    *  Overlap bounds factory that takes in a \c container, a \c key and
    *  returns an \ref overlap_bounds type.
@@ -57,6 +57,107 @@ namespace spatial
       dimension_type _rank;
     };
 
+    /**
+     *  The largest \static_rank for which the loops over all dimensions are
+     *  unrolled at compile time by \ref for_each_dim().
+     */
+    const dimension_type max_unrolled_rank = 16;
+
+    /**
+     *  Calls \c op on the dimensions from 0 to \c Dim - 1, in increasing
+     *  order, until \c op returns false. The calls are unrolled at compile
+     *  time when \c Dim is at most \ref max_unrolled_rank.
+     */
+    ///@{
+    template <dimension_type Dim, bool Unrolled = (Dim <= max_unrolled_rank)>
+    struct Unroll_dims
+    {
+      template <typename Op>
+      static bool apply(Op& op)
+      {
+        for (dimension_type dim = 0; dim < Dim; ++dim)
+          if (!op(dim)) return false;
+        return true;
+      }
+    };
+
+    template <dimension_type Dim>
+    struct Unroll_dims<Dim, true>
+    {
+      template <typename Op>
+      static bool apply(Op& op)
+      { return Unroll_dims<Dim - 1, true>::apply(op) && op(Dim - 1); }
+    };
+
+    template <>
+    struct Unroll_dims<0, true>
+    {
+      template <typename Op>
+      static bool apply(Op&) { return true; }
+    };
+    ///@}
+
+    /**
+     *  Calls \c op on each dimension of \c rank, in increasing order, until
+     *  \c op returns false, and returns \c true if \c op returned \c true
+     *  for all dimensions. \c op is called as:
+     *
+     *  \code
+     *  bool continue = op(dim);
+     *  \endcode
+     *
+     *  With a \static_rank, the number of iterations is known at compile time
+     *  and the calls are unrolled; with a \dynamic_rank, they are made in a
+     *  loop.
+     */
+    ///@{
+    template <typename Rank, typename Op>
+    inline bool
+    for_each_dim(Rank rank, Op& op)
+    {
+      for (dimension_type dim = 0; dim < rank(); ++dim)
+        if (!op(dim)) return false;
+      return true;
+    }
+
+    template <dimension_type Value, typename Op>
+    inline bool
+    for_each_dim(Static_rank<Value>, Op& op)
+    { return Unroll_dims<Value>::apply(op); }
+    ///@}
+
+    /**
+     *  Gives to the functions of \ref math the rank of a container whose
+     *  metric received its magnitude as a \c dimension_type: a \static_rank
+     *  is passed as such, so that the distances can be computed in unrolled
+     *  loops, while the magnitude of a \dynamic_rank is passed unchanged.
+     *  \c make() always returns a rank object, for the functions that take
+     *  the rank of the container as is.
+     */
+    ///@{
+    template <typename Rank>
+    struct Rank_argument
+    {
+      typedef dimension_type type;
+      static type get(dimension_type rank) { return rank; }
+      static Dynamic_rank make(dimension_type rank)
+      { return Dynamic_rank(rank); }
+    };
+
+    template <dimension_type Value>
+    struct Rank_argument<Static_rank<Value> >
+    {
+      typedef Static_rank<Value> type;
+      static type get(dimension_type rank)
+      {
+        SPATIAL_ASSERT_CHECK(rank == Value);
+        static_cast<void>(rank);
+        return type();
+      }
+      static type make(dimension_type rank) { return get(rank); }
+    };
+    ///@}
+
     /**
      *  Increment dimension \c node_dim, given \c rank.
      *  \tparam Rank Either \static_rank or \dynamic_rank.
@@ -0,0 +1,409 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_ray_visit.hpp
+ *  Contains the definition of \ref spatial::for_each_ray_intersection() and
+ *  \ref spatial::for_each_segment_intersection(), which give the boxes of a
+ *  container crossed by a ray or a segment to a visitor, in the order in
+ *  which the ray enters them.
+ */
+
+#ifndef SPATIAL_RAY_VISIT_HPP
+#define SPATIAL_RAY_VISIT_HPP
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm> // std::push_heap, std::pop_heap
+
+#include "spatial_node.hpp"
+#include "spatial_math.hpp"
+#include "spatial_builtin.hpp"
+#include "spatial_except.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  An entry in the queue of \ref Ray_visit: either a box crossed by the
+     *  ray, or a sub-tree, with the cell enclosing all of its boxes.
+     */
+    template <typename NodePtr>
+    struct Ray_visit_entry
+    {
+      Ray_visit_entry(double enter_, NodePtr node_, dimension_type dim_,
+                      size_type cell_, bool is_key_)
+        : enter(enter_), node(node_), dim(dim_), cell(cell_), is_key(is_key_)
+      { }
+
+      //! Entries are ordered such that the heap yields the first entered,
+      //! and keys before sub-trees at equal positions.
+      bool operator<(const Ray_visit_entry& other) const
+      {
+        return other.enter < enter
+          || (!(enter < other.enter) && !is_key && other.is_key);
+      }
+
+      double enter;
+      NodePtr node;
+      dimension_type dim;
+      size_type cell;
+      bool is_key;
+    };
+
+    /**
+     *  Walks a tree of boxes in the order in which a ray, starting at \c
+     *  origin and going through \c through, enters them, and calls the
+     *  visitor for each box crossed before the ray parameter reaches \c
+     *  t_max.
+     *
+     *  All coordinates are taken relative to \c origin. The boxes of a
+     *  sub-tree are enclosed in a cell, bounded below by the lower
+     *  coordinates of the sub-trees entered on their right and above by the
+     *  higher coordinates of the sub-trees entered on their left. The cell
+     *  of the near child is the cell of its parent, so it is walked
+     *  immediately, while the far child is queued with its narrower cell;
+     *  sub-trees whose cell is not crossed by the ray are never visited.
+     */
+    template <typename Iterator, typename Rank, typename Diff, typename Layout,
+              typename Key, typename Visitor>
+    class Ray_visit
+    {
+      typedef typename Iterator::node_ptr node_ptr;
+      typedef Ray_visit_entry<node_ptr> entry_type;
+
+    public:
+      Ray_visit(Rank rank, const Diff& diff, const Key& origin,
+                const Key& through, double t_max, Visitor& visitor)
+        : _rank(rank), _diff(diff), _origin(origin), _t_max(t_max),
+          _scale(0.0), _axes(rank() >> 1), _visitor(visitor)
+      {
+        _dir.reserve(_axes);
+        for (dimension_type i = 0; i < _axes; ++i)
+          {
+            double d = static_cast<double>
+              (_diff(math::box_low_dim(i, _rank(), Layout()), through,
+                     origin));
+            _dir.push_back(d);
+            _scale += d * d;
+          }
+        _scale = std::sqrt(_scale);
+        _cell.resize(_axes << 1);
+        _box.resize(_axes << 1);
+      }
+
+      //! Visit the tree of \c root until the visitor requests to stop.
+      void run(node_ptr root)
+      {
+        std::fill(_cell.begin(), _cell.begin() + _axes,
+                  -std::numeric_limits<double>::infinity());
+        std::fill(_cell.begin() + _axes, _cell.end(),
+                  std::numeric_limits<double>::infinity());
+        double enter;
+        if (!crosses(_cell, enter)) return;
+        push(enter, root, 0);
+        while (!_queue.empty())
+          {
+            std::pop_heap(_queue.begin(), _queue.end());
+            entry_type top = _queue.back();
+            _queue.pop_back();
+            if (top.is_key)
+              {
+                if (!_visitor(Iterator(top.node), top.enter * _scale)) return;
+                continue;
+              }
+            const double* cell = &_cells[top.cell * (_axes << 1)];
+            std::copy(cell, cell + (_axes << 1), _cell.begin());
+            _free.push_back(top.cell);
+            walk(top.node, top.dim);
+          }
+      }
+
+    private:
+      //! Walks down the near children from \c node, queueing the boxes
+      //! crossed and the far children whose cells are crossed.
+      void walk(node_ptr node, dimension_type dim)
+      {
+        while (node != 0)
+          {
+            SPATIAL_ASSERT_CHECK(dim < _rank());
+            SPATIAL_ASSERT_CHECK(!header(node));
+            for (dimension_type i = 0; i < _axes; ++i)
+              {
+                _box[i] = static_cast<double>
+                  (_diff(math::box_low_dim(i, _rank(), Layout()),
+                         const_key(node), _origin));
+                _box[i + _axes] = static_cast<double>
+                  (_diff(math::box_high_dim(i, _rank(), Layout()),
+                         const_key(node), _origin));
+              }
+            double enter;
+            if (crosses(_box, enter))
+              {
+                _queue.push_back(entry_type(enter, node, dim, 0, true));
+                std::push_heap(_queue.begin(), _queue.end());
+              }
+            double split = static_cast<double>
+              (_diff(dim, const_key(node), _origin));
+            dimension_type child_dim = incr_dim(_rank, dim);
+            dimension_type axis = math::box_axis(dim, _rank(), Layout());
+            node_ptr near, far;
+            if (math::is_box_low_dim(dim, _rank(), Layout()))
+              {
+                // Boxes on the right have their lower side above split
+                near = node->left; far = node->right;
+                if (far != 0)
+                  {
+                    double saved = _cell[axis];
+                    if (saved < split) _cell[axis] = split;
+                    if (crosses(_cell, enter)) push(enter, far, child_dim);
+                    _cell[axis] = saved;
+                  }
+              }
+            else
+              {
+                // Boxes on the left have their higher side below split
+                near = node->right; far = node->left;
+                if (far != 0)
+                  {
+                    double saved = _cell[axis + _axes];
+                    if (split < saved) _cell[axis + _axes] = split;
+                    if (crosses(_cell, enter)) push(enter, far, child_dim);
+                    _cell[axis + _axes] = saved;
+                  }
+              }
+            node = near;
+            dim = child_dim;
+          }
+      }
+
+      //! Queues the sub-tree of \c node, with a copy of the current cell.
+      void push(double enter, node_ptr node, dimension_type dim)
+      {
+        size_type cell;
+        if (_free.empty())
+          {
+            cell = _cells.size() / (_axes << 1);
+            _cells.insert(_cells.end(), _cell.begin(), _cell.end());
+          }
+        else
+          {
+            cell = _free.back();
+            _free.pop_back();
+            std::copy(_cell.begin(), _cell.end(),
+                      &_cells[cell * (_axes << 1)]);
+          }
+        _queue.push_back(entry_type(enter, node, dim, cell, false));
+        std::push_heap(_queue.begin(), _queue.end());
+      }
+
+      /**
+       *  Returns \c true if the ray crosses \c box, whose lower coordinates
+       *  are followed by its higher coordinates, before \c _t_max, and sets
+       *  \c enter to the ray parameter at which it enters \c box.
+       */
+      bool crosses(const std::vector<double>& box, double& enter) const
+      {
+        enter = 0.0;
+        double exit = _t_max;
+        for (dimension_type i = 0; i < _axes; ++i)
+          {
+            if (_dir[i] == 0.0)
+              {
+                if (box[i] > 0.0 || box[i + _axes] < 0.0) return false;
+                continue;
+              }
+            double t1 = box[i] / _dir[i];
+            double t2 = box[i + _axes] / _dir[i];
+            if (t2 < t1) std::swap(t1, t2);
+            if (enter < t1) enter = t1;
+            if (t2 < exit) exit = t2;
+            if (exit < enter) return false;
+          }
+        return true;
+      }
+
+      Rank _rank;
+      Diff _diff;
+      const Key& _origin;
+      double _t_max;
+      double _scale;
+      dimension_type _axes;
+      Visitor& _visitor;
+      std::vector<double> _dir;
+      std::vector<double> _cell;
+      std::vector<double> _box;
+      std::vector<double> _cells;
+      std::vector<size_type> _free;
+      std::vector<entry_type> _queue;
+    };
+
+    //! Deduces the iterator type given to the visitor from \c end, the
+    //! result of \c container.end().
+    template <typename Container, typename Iterator, typename Diff,
+              typename Layout, typename Visitor>
+    inline void
+    for_each_ray_intersection(Container& container, Iterator end,
+                              const Diff& diff,
+                              const typename Container::key_type& origin,
+                              const typename Container::key_type& through,
+                              double t_max, Layout, Visitor& visitor)
+    {
+      typedef typename rebind_builtin_difference<Diff, double>::type
+        difference_type;
+      Ray_visit<Iterator, typename Container::rank_type, difference_type,
+                Layout, typename Container::key_type, Visitor>
+        walk(container.rank(), diff, origin, through, t_max, visitor);
+      walk.run(end.node->parent);
+    }
+  } // namespace details
+
+  /**
+   *  Calls \c visitor for each box of \c container crossed by the ray that
+   *  starts at \c origin and goes through \c through, in the order in which
+   *  the ray enters them, until \c visitor returns false.
+   *
+   *  The container must hold boxes, such as \box_multiset or \box_multimap,
+   *  whose coordinates follow \c layout. \c origin and \c through are points,
+   *  given as boxes with equal lower and higher coordinates. The sub-trees
+   *  of the container whose boxes all lie away from the ray are skipped,
+   *  and the traversal stops at the first box if \c visitor returns false,
+   *  which makes it suitable for line-of-sight checks. \c visitor is called
+   *  as:
+   *
+   *  \code
+   *  bool continue = visitor(element, distance);
+   *  \endcode
+   *
+   *  Where \c element is a \c Container::iterator, or a \c
+   *  Container::const_iterator if \c container is constant, and \c distance
+   *  is the euclidian distance, in double, from \c origin to the point where
+   *  the ray enters the box, which is null if \c origin is in the box. The
+   *  container must not be modified during the traversal.
+   *
+   *  \param container The container of boxes in which elements are visited.
+   *  \param diff A model of \difference, used to compute coordinates
+   *  relative to \c origin.
+   *  \param origin The point where the ray starts.
+   *  \param through A point on the ray, distinct from \c origin.
+   *  \param layout The layout of the boxes in \c container.
+   *  \param visitor The functor receiving each element crossed by the ray.
+   *  \return A copy of \c visitor, after it was called for each element.
+   *  \throws invalid_box if \c origin or \c through do not follow \c layout.
+   */
+  ///@{
+  template <typename Container, typename Diff, typename Layout,
+            typename Visitor>
+  inline Visitor
+  for_each_ray_intersection(Container& container, const Diff& diff,
+                            const typename Container::key_type& origin,
+                            const typename Container::key_type& through,
+                            const Layout& layout, Visitor visitor)
+  {
+    except::check_box(container, origin, layout);
+    except::check_box(container, through, layout);
+    if (container.empty()) return visitor;
+    details::for_each_ray_intersection
+      (container, container.end(), diff, origin, through,
+       std::numeric_limits<double>::infinity(), layout, visitor);
+    return visitor;
+  }
+
+  template <typename Container, typename Layout, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_ray_intersection(Container& container,
+                            const typename Container::key_type& origin,
+                            const typename Container::key_type& through,
+                            const Layout& layout, Visitor visitor)
+  {
+    return for_each_ray_intersection
+      (container, details::with_builtin_difference<Container>()(container),
+       origin, through, layout, visitor);
+  }
+
+  template <typename Container, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_ray_intersection(Container& container,
+                            const typename Container::key_type& origin,
+                            const typename Container::key_type& through,
+                            Visitor visitor)
+  {
+    return for_each_ray_intersection(container, origin, through,
+                                     llhh_layout_tag(), visitor);
+  }
+  ///@}
+
+  /**
+   *  Calls \c visitor for each box of \c container crossed by the segment
+   *  that goes from \c first to \c last, in the order in which the segment
+   *  enters them, until \c visitor returns false.
+   *
+   *  This function behaves as \ref for_each_ray_intersection() for a ray
+   *  that starts at \c first and goes through \c last, except that the
+   *  boxes that lie beyond \c last are neither visited nor given to \c
+   *  visitor.
+   *
+   *  \param container The container of boxes in which elements are visited.
+   *  \param diff A model of \difference, used to compute coordinates
+   *  relative to \c first.
+   *  \param first The point where the segment starts.
+   *  \param last The point where the segment ends.
+   *  \param layout The layout of the boxes in \c container.
+   *  \param visitor The functor receiving each element crossed by the
+   *  segment.
+   *  \return A copy of \c visitor, after it was called for each element.
+   *  \throws invalid_box if \c first or \c last do not follow \c layout.
+   */
+  ///@{
+  template <typename Container, typename Diff, typename Layout,
+            typename Visitor>
+  inline Visitor
+  for_each_segment_intersection(Container& container, const Diff& diff,
+                                const typename Container::key_type& first,
+                                const typename Container::key_type& last,
+                                const Layout& layout, Visitor visitor)
+  {
+    except::check_box(container, first, layout);
+    except::check_box(container, last, layout);
+    if (container.empty()) return visitor;
+    details::for_each_ray_intersection
+      (container, container.end(), diff, first, last, 1.0, layout, visitor);
+    return visitor;
+  }
+
+  template <typename Container, typename Layout, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_segment_intersection(Container& container,
+                                const typename Container::key_type& first,
+                                const typename Container::key_type& last,
+                                const Layout& layout, Visitor visitor)
+  {
+    return for_each_segment_intersection
+      (container, details::with_builtin_difference<Container>()(container),
+       first, last, layout, visitor);
+  }
+
+  template <typename Container, typename Visitor>
+  inline typename enable_if<details::is_compare_builtin<Container>,
+                            Visitor>::type
+  for_each_segment_intersection(Container& container,
+                                const typename Container::key_type& first,
+                                const typename Container::key_type& last,
+                                Visitor visitor)
+  {
+    return for_each_segment_intersection(container, first, last,
+                                         llhh_layout_tag(), visitor);
+  }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_RAY_VISIT_HPP
@@ -19,9 +19,39 @@
 #include "spatial_bidirectional.hpp"
 #include "spatial_except.hpp"
 #include "spatial_import_tuple.hpp"
+#include "spatial_builtin.hpp"
+#include "spatial_rank.hpp"
 
 namespace spatial
 {
+  namespace details
+  {
+    /**
+     *  Tells whether a key is within the boundaries of a two-sided \ref
+     *  region_predicate along the dimensions given by \ref for_each_dim(),
+     *  except along \c tested, which is known to match already.
+     */
+    template <typename Predicate, typename Key>
+    struct Match_two_sided
+    {
+      Match_two_sided(const Predicate& pred_, dimension_type rank_,
+                      const Key& key_, dimension_type tested_)
+        : pred(pred_), rank(rank_), key(key_), tested(tested_) { }
+
+      bool operator()(dimension_type dim) const
+      {
+        return dim == tested
+          || (!pred.less_than_lower_bound(dim, rank, key)
+              && !pred.greater_than_upper_bound(dim, rank, key));
+      }
+
+      const Predicate& pred;
+      dimension_type rank;
+      const Key& key;
+      dimension_type tested;
+    };
+  } // namespace details
+
   /**
    *  A model of \region_predicate that defines an orthogonal region and checks
    *  if a value of type \c Key is contained within the boundaries marked by \c
@@ -74,6 +104,40 @@ namespace spatial
                  : above));
     }
 
+    /**
+     *  Returns \c true if \c key is below the lower boundary along \c dim,
+     *  which is the same as the operator returning \ref below, with a single
+     *  comparison.
+     */
+    bool
+    less_than_lower_bound(dimension_type dim, dimension_type,
+                          const Key& key) const
+    { return Compare::operator()(dim, key, _lower); }
+
+    /**
+     *  Returns \c true if \c key is above, or equal to, the upper boundary
+     *  along \c dim, which is the same as the operator returning \ref above,
+     *  with a single comparison.
+     */
+    bool
+    greater_than_upper_bound(dimension_type dim, dimension_type,
+                             const Key& key) const
+    { return !Compare::operator()(dim, key, _upper); }
+
+    /**
+     *  Returns \c true if \c key is within the boundaries on all dimensions
+     *  but \c tested, which the caller has already matched, or \c rank()
+     *  if none was. The comparator is called directly on each dimension,
+     *  rather than through \ref relative_order, and the calls are unrolled
+     *  at compile time when \c rank is a \static_rank.
+     */
+    template <typename Rank>
+    bool match_key(Rank rank, const Key& key, dimension_type tested) const
+    {
+      details::Match_two_sided<bounds, Key> op(*this, rank(), key, tested);
+      return details::for_each_dim(rank, op);
+    }
+
   private:
     /**
      *  The lower bound for the orthogonal region.
@@ -537,6 +601,225 @@ namespace spatial
 
   namespace details
   {
+    /**
+     *  The \region_predicate matched by all keys, given to the algorithms
+     *  that optionally restrict their search to a region when no region is
+     *  given. Since its result is known at compile time, the tests against
+     *  it are optimized away.
+     */
+    struct Any_region
+    {
+      template <typename Key>
+      relative_order
+      operator()(dimension_type, dimension_type, const Key&) const
+      { return matching; }
+
+      template <typename Rank, typename Key>
+      bool match_key(Rank, const Key&, dimension_type) const { return true; }
+    };
+
+    /**
+     *  Tells whether a \region_predicate provides a \c match_key() function
+     *  that tests all dimensions of a key at once. This is true of \ref
+     *  bounds, \ref closed_bounds and \ref open_bounds, when defined with one
+     *  of the built-in comparators.
+     */
+    ///@{
+    template <typename Predicate>
+    struct is_whole_key_predicate : import::false_type { };
+
+    template <typename Key, typename Compare>
+    struct is_whole_key_predicate<bounds<Key, Compare> >
+      : is_compare_builtin_helper<Compare> { };
+
+    template <>
+    struct is_whole_key_predicate<Any_region> : import::true_type { };
+    ///@}
+
+    /**
+     *  Tells whether a \region_predicate provides, in addition to its
+     *  operator, the 2 functions:
+     *
+     *  \code
+     *  bool less_than_lower_bound(dimension_type dim, dimension_type rank,
+     *                             const Key& key) const;
+     *  bool greater_than_upper_bound(dimension_type dim, dimension_type rank,
+     *                                const Key& key) const;
+     *  \endcode
+     *
+     *  Which return \c true when the operator would return respectively \ref
+     *  below and \ref above, but only compute one side of the test. This is
+     *  true of all the predicates provided by the library, and may be
+     *  specialized for other predicates.
+     */
+    ///@{
+    template <typename Predicate>
+    struct is_two_sided_predicate : import::false_type { };
+
+    template <typename Key, typename Compare>
+    struct is_two_sided_predicate<bounds<Key, Compare> >
+      : import::true_type { };
+    ///@}
+
+    /**
+     *  Returns \c true if \c key is below the interval of \c pred along \c
+     *  dim. Only the lower side of the interval is tested if \c pred provides
+     *  it.
+     */
+    ///@{
+    template <typename Key, typename Predicate>
+    inline typename enable_if_c<!is_two_sided_predicate<Predicate>::value,
+                                bool>::type
+    is_below(dimension_type dim, dimension_type rank, const Key& key,
+             const Predicate& pred)
+    { return pred(dim, rank, key) == below; }
+
+    template <typename Key, typename Predicate>
+    inline typename enable_if<is_two_sided_predicate<Predicate>, bool>::type
+    is_below(dimension_type dim, dimension_type rank, const Key& key,
+             const Predicate& pred)
+    { return pred.less_than_lower_bound(dim, rank, key); }
+    ///@}
+
+    /**
+     *  Returns \c true if \c key is above the interval of \c pred along \c
+     *  dim. Only the upper side of the interval is tested if \c pred provides
+     *  it.
+     */
+    ///@{
+    template <typename Key, typename Predicate>
+    inline typename enable_if_c<!is_two_sided_predicate<Predicate>::value,
+                                bool>::type
+    is_above(dimension_type dim, dimension_type rank, const Key& key,
+             const Predicate& pred)
+    { return pred(dim, rank, key) == above; }
+
+    template <typename Key, typename Predicate>
+    inline typename enable_if<is_two_sided_predicate<Predicate>, bool>::type
+    is_above(dimension_type dim, dimension_type rank, const Key& key,
+             const Predicate& pred)
+    { return pred.greater_than_upper_bound(dim, rank, key); }
+    ///@}
+
+    /**
+     *  Returns the child of \c node that is walked first when seeking the
+     *  first matching node in pre-order transversal: the left child if it
+     *  may contain matching nodes, the right child otherwise, or null if
+     *  neither may.
+     */
+    ///@{
+    template <typename NodePtr, typename Predicate>
+    inline typename enable_if_c<!is_two_sided_predicate<Predicate>::value,
+                                NodePtr>::type
+    first_child(NodePtr node, dimension_type dim, dimension_type rank,
+                const Predicate& pred)
+    {
+      relative_order rel = pred(dim, rank, const_key(node));
+      if (rel != below && node->left != 0) return node->left;
+      if (rel != above && node->right != 0) return node->right;
+      return 0;
+    }
+
+    template <typename NodePtr, typename Predicate>
+    inline typename enable_if<is_two_sided_predicate<Predicate>,
+                              NodePtr>::type
+    first_child(NodePtr node, dimension_type dim, dimension_type rank,
+                const Predicate& pred)
+    {
+      if (node->left != 0 && !is_below(dim, rank, const_key(node), pred))
+        return node->left;
+      if (node->right != 0 && !is_above(dim, rank, const_key(node), pred))
+        return node->right;
+      return 0;
+    }
+    ///@}
+
+    /**
+     *  Returns the child of \c node that is walked first when seeking the
+     *  last matching node in pre-order transversal: the right child if it may
+     *  contain matching nodes, the left child otherwise, or null if neither
+     *  may.
+     */
+    ///@{
+    template <typename NodePtr, typename Predicate>
+    inline typename enable_if_c<!is_two_sided_predicate<Predicate>::value,
+                                NodePtr>::type
+    last_child(NodePtr node, dimension_type dim, dimension_type rank,
+               const Predicate& pred)
+    {
+      relative_order rel = pred(dim, rank, const_key(node));
+      if (rel != above && node->right != 0) return node->right;
+      if (rel != below && node->left != 0) return node->left;
+      return 0;
+    }
+
+    template <typename NodePtr, typename Predicate>
+    inline typename enable_if<is_two_sided_predicate<Predicate>,
+                              NodePtr>::type
+    last_child(NodePtr node, dimension_type dim, dimension_type rank,
+               const Predicate& pred)
+    {
+      if (node->right != 0 && !is_above(dim, rank, const_key(node), pred))
+        return node->right;
+      if (node->left != 0 && !is_below(dim, rank, const_key(node), pred))
+        return node->left;
+      return 0;
+    }
+    ///@}
+
+    /**
+     *  Tells whether a key matches a \region_predicate along the dimensions
+     *  given by \ref for_each_dim(), except along \c tested, which is known
+     *  to match already.
+     */
+    template <typename Predicate, typename Key>
+    struct Match_dim
+    {
+      Match_dim(const Predicate& pred_, dimension_type rank_, const Key& key_,
+                dimension_type tested_)
+        : pred(pred_), rank(rank_), key(key_), tested(tested_) { }
+
+      bool operator()(dimension_type dim) const
+      { return dim == tested || pred(dim, rank, key) == matching; }
+
+      const Predicate& pred;
+      dimension_type rank;
+      const Key& key;
+      dimension_type tested;
+    };
+
+    /**
+     *  Returns \c true if \c key matches \c pred on all dimensions. Unless \c
+     *  pred tests all dimensions at once, the dimensions are given to \c pred
+     *  one at a time, until one of them does not match.
+     *
+     *  Walks that have just compared \c key to \c pred along the dimension
+     *  of its node give that dimension as \c tested, so that it is not
+     *  compared again.
+     */
+    ///@{
+    template <typename Rank, typename Key, typename Predicate>
+    inline typename enable_if_c<!is_whole_key_predicate<Predicate>::value,
+                                bool>::type
+    match_key(const Rank rank, const Key& key, const Predicate& pred,
+              dimension_type tested)
+    {
+      Match_dim<Predicate, Key> op(pred, rank(), key, tested);
+      return for_each_dim(rank, op);
+    }
+
+    template <typename Rank, typename Key, typename Predicate>
+    inline typename enable_if<is_whole_key_predicate<Predicate>, bool>::type
+    match_key(const Rank rank, const Key& key, const Predicate& pred,
+              dimension_type tested)
+    { return pred.match_key(rank, key, tested); }
+
+    template <typename Rank, typename Key, typename Predicate>
+    inline bool
+    match_key(const Rank rank, const Key& key, const Predicate& pred)
+    { return match_key(rank, key, pred, rank()); }
+    ///@}
+
     /**
      *  In the children of the node pointed to by \c node, find the first
      *  matching node in the region delimited by \c Predicate, with pre-order
@@ -562,22 +845,8 @@ namespace spatial
         {
           dimension_type dim = kth % rank();
           relative_order rel = pred(dim, rank(), const_key(node));
-          if (rel == matching)
-            {
-              dimension_type test = 0;
-              for (; test < dim
-                     && pred(test, rank(), const_key(node)) == matching;
-                   ++test);
-              if (test == dim)
-                {
-                  test = dim + 1;
-                  for (; test < rank()
-                         && pred(test, rank(), const_key(node)) == matching;
-                       ++test);
-                  if (test == rank())
-                    { return std::make_pair(node, kth); }
-                }
-            }
+          if (rel == matching && match_key(rank, const_key(node), pred, dim))
+            { return std::make_pair(node, kth); }
           if (rel != above && node->right != 0)
             {
               ++kth;
@@ -619,37 +888,28 @@ namespace spatial
       SPATIAL_ASSERT_CHECK(node != 0);
       for (;;)
         {
-          relative_order rel = pred(kth % rank(), rank(), const_key(node));
-          if (rel != above && node->right != 0)
-            { node = node->right; ++kth; }
-          else if (rel != below && node->left != 0)
-            { node = node->left; ++kth; }
-          else break;
+          NodePtr child = last_child(node, kth % rank(), rank(), pred);
+          if (child == 0) break;
+          node = child; ++kth;
         }
       for (;;)
         {
-          dimension_type test = 0;
-          for(; test < rank()
-                && pred(test, rank(), const_key(node)) == matching; ++test);
-          if (test == rank())
+          if (match_key(rank, const_key(node), pred))
             { return std::make_pair(node, kth); }
           NodePtr prev_node = node;
           node = node->parent; --kth;
           if (header(node))
             { return std::make_pair(node, kth); }
-          if (node->right == prev_node
-              && pred(kth % rank(), rank(), const_key(node)) != below
-              && node->left != 0)
+          if (node->right == prev_node && node->left != 0
+              && !is_below(kth % rank(), rank(), const_key(node), pred))
             {
               node = node->left; ++kth;
               for (;;)
                 {
-                  relative_order rel = pred(kth % rank(), rank(), const_key(node));
-                  if (rel != above && node->right != 0)
-                    { node = node->right; ++kth; }
-                  else if (rel != below && node->left != 0)
-                    { node = node->left; ++kth; }
-                  else break;
+                  NodePtr child = last_child(node, kth % rank(), rank(),
+                                             pred);
+                  if (child == 0) break;
+                  node = child; ++kth;
                 }
             }
         }
@@ -675,20 +935,18 @@ namespace spatial
       SPATIAL_ASSERT_CHECK(node != 0);
       for (;;)
         {
-          relative_order rel = pred(kth % rank(), rank(), const_key(node));
-          if (rel != below && node->left != 0)
-            { node = node->left; ++kth; }
-          else if (rel != above && node->right != 0)
-            { node = node->right; ++kth; }
+          NodePtr child = first_child(node, kth % rank(), rank(), pred);
+          if (child != 0)
+            { node = child; ++kth; }
           else
             {
               NodePtr prev_node = node;
               node = node->parent; --kth;
               while (!header(node)
                      && (prev_node == node->right
-                         || pred(kth % rank(), rank(),
-                                 const_key(node)) == above
-                         || node->right == 0))
+                         || node->right == 0
+                         || is_above(kth % rank(), rank(), const_key(node),
+                                     pred)))
                 {
                   prev_node = node;
                   node = node->parent; --kth;
@@ -697,10 +955,7 @@ namespace spatial
                 { node = node->right; ++kth; }
               else { return std::make_pair(node, kth); }
             }
-          dimension_type test = 0;
-          for(; test < rank()
-                && pred(test, rank(), const_key(node)) == matching; ++test);
-          if (test == rank())
+          if (match_key(rank, const_key(node), pred))
             { return std::make_pair(node, kth); }
         }
     }
@@ -728,25 +983,19 @@ namespace spatial
       node = node->parent; --kth;
       while (!header(node))
         {
-          if (node->right == prev_node
-              && pred(kth % rank(), rank(), const_key(node)) != below
-              && node->left != 0)
+          if (node->right == prev_node && node->left != 0
+              && !is_below(kth % rank(), rank(), const_key(node), pred))
             {
               node = node->left; ++kth;
               for (;;)
                 {
-                  relative_order rel = pred(kth % rank(), rank(), const_key(node));
-                  if (rel != above && node->right != 0)
-                    { node = node->right; ++kth; }
-                  else if (rel != below && node->left != 0)
-                    { node = node->left; ++kth; }
-                  else break;
+                  NodePtr child = last_child(node, kth % rank(), rank(),
+                                             pred);
+                  if (child == 0) break;
+                  node = child; ++kth;
                 }
             }
-          dimension_type test = 0;
-          for(; test < rank()
-                && pred(test, rank(), const_key(node)) == matching; ++test);
-          if (test == rank()) break;
+          if (match_key(rank, const_key(node), pred)) break;
           prev_node = node;
           node = node->parent; --kth;
         }
@@ -0,0 +1,91 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_region_aggregate.hpp
+ *  Contains the definition of \ref spatial::region_aggregate(), which
+ *  combines the values of the elements of a container that match a
+ *  \region_predicate, using the aggregates held in the nodes of the
+ *  container.
+ */
+
+#ifndef SPATIAL_REGION_AGGREGATE_HPP
+#define SPATIAL_REGION_AGGREGATE_HPP
+
+#include "spatial_region_count.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    //! Combines the nodes given by \ref Region_accumulate, with the
+    //! aggregates of the sub-trees when they are given at once.
+    template <typename Monoid>
+    struct Region_aggregate
+    {
+      explicit Region_aggregate(const Monoid& m)
+        : monoid(m), aggregate(m.identity()) { }
+
+      template <typename NodePtr>
+      void node(NodePtr node)
+      { aggregate = monoid.combine(aggregate, monoid.map(const_value(node))); }
+
+      template <typename NodePtr>
+      void subtree(NodePtr node)
+      {
+        aggregate = monoid.combine(aggregate,
+                                   const_aggregate<Monoid>(node));
+      }
+
+      Monoid monoid;
+      typename Monoid::aggregate_type aggregate;
+    };
+  } // namespace details
+
+  /**
+   *  Returns the combination of the values of all elements in \c container
+   *  that match \c pred, a model of \region_predicate, as defined by the
+   *  \c Monoid of the container.
+   *
+   *  This function is only available for \point_multiset, \point_multimap,
+   *  \box_multiset and \box_multimap defined with a \c Monoid, whose nodes
+   *  hold the aggregate of their sub-tree. When all the elements of a sub-tree
+   *  are known to be in the region, the aggregate of the sub-tree is used in
+   *  constant time, instead of visiting each element. See \ref
+   *  details::Relaxed_kdtree for the requirements on \c Monoid.
+   *
+   *  \param container The container in which elements are aggregated.
+   *  \param pred A model of \region_predicate.
+   *  \return The aggregate of the elements matching \c pred, or the identity
+   *  of the \c Monoid if no element matches.
+   */
+  ///@{
+  template <typename Container, typename Predicate>
+  inline typename Container::monoid_type::aggregate_type
+  region_aggregate(const Container& container, const Predicate& pred)
+  {
+    typedef typename Container::monoid_type monoid_type;
+    details::Region_aggregate<monoid_type> acc(container.monoid());
+    if (container.empty()) return acc.aggregate;
+    details::Region_accumulate<typename Container::mode_type::const_node_ptr,
+                               typename Container::rank_type,
+                               typename Container::key_type, Predicate>
+      walk(container.rank(), pred);
+    walk.run(container.end().node->parent, 0, acc);
+    return acc.aggregate;
+  }
+
+  template <typename Container>
+  inline typename Container::monoid_type::aggregate_type
+  region_aggregate(const Container& container,
+                   const typename Container::key_type& lower,
+                   const typename Container::key_type& upper)
+  { return region_aggregate(container, make_bounds(container, lower, upper)); }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_REGION_AGGREGATE_HPP
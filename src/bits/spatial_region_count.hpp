@@ -0,0 +1,164 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_region_count.hpp
+ *  Contains the definition of \ref spatial::region_count(), which counts the
+ *  elements of a container that match a \region_predicate without iterating
+ *  over each of them, when the container allows it.
+ */
+
+#ifndef SPATIAL_REGION_COUNT_HPP
+#define SPATIAL_REGION_COUNT_HPP
+
+#include <vector>
+#include "spatial_region.hpp"
+#include "spatial_rank.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Walks the nodes of a tree that may match a \region_predicate, while
+     *  keeping track of the bounds of the sub-tree being visited. These bounds
+     *  are given by the keys of the ancestors that separate the sub-tree from
+     *  the rest of the tree. When, on every dimension, both bounds of a
+     *  sub-tree match the predicate, all the keys in the sub-tree are known to
+     *  match, and the sub-tree is given to the accumulator in one step.
+     *
+     *  Since ancestors only bound a sub-tree on the side they split it, the
+     *  sub-trees that are on the outer edges of the tree, along any dimension,
+     *  are never given in one step. Thus, the benefit is largest for regions
+     *  that are small compared to the extent of the container.
+     *
+     *  The \c Accumulator must provide the following 2 functions:
+     *
+     *  \code
+     *  void node(NodePtr node);    // node matches the predicate
+     *  void subtree(NodePtr node); // all nodes in node's sub-tree match
+     *  \endcode
+     */
+    template <typename NodePtr, typename Rank, typename Key,
+              typename Predicate>
+    class Region_accumulate
+    {
+    public:
+      Region_accumulate(Rank rank, const Predicate& pred)
+        : _rank(rank), _pred(pred),
+          _low(rank(), static_cast<const Key*>(0)),
+          _high(rank(), static_cast<const Key*>(0)),
+          _inside(rank(), false), _inside_count(0) { }
+
+      //! Visit the sub-tree of \c node, where \c dim is the dimension of
+      //! \c node.
+      template <typename Accumulator>
+      void run(NodePtr node, dimension_type dim, Accumulator& acc)
+      {
+        SPATIAL_ASSERT_CHECK(dim < _rank());
+        SPATIAL_ASSERT_CHECK(node != 0);
+        SPATIAL_ASSERT_CHECK(!header(node));
+        if (_inside_count == _rank()) { acc.subtree(node); return; }
+        if (match_key(_rank, const_key(node), _pred)) { acc.node(node); }
+        relative_order rel = _pred(dim, _rank(), const_key(node));
+        dimension_type child_dim = incr_dim(_rank, dim);
+        if (rel != below && node->left != 0)
+          {
+            const Key* save = _high[dim];
+            bound(_high, dim, &const_key(node));
+            run(node->left, child_dim, acc);
+            bound(_high, dim, save);
+          }
+        if (rel != above && node->right != 0)
+          {
+            const Key* save = _low[dim];
+            bound(_low, dim, &const_key(node));
+            run(node->right, child_dim, acc);
+            bound(_low, dim, save);
+          }
+      }
+
+    private:
+      //! Set one of the bounds along \c dim, and update the number of
+      //! dimensions on which the sub-tree is known to be inside the region.
+      void bound(std::vector<const Key*>& bounds, dimension_type dim,
+                 const Key* key)
+      {
+        bounds[dim] = key;
+        bool inside = _low[dim] != 0 && _high[dim] != 0
+          && !is_below(dim, _rank(), *_low[dim], _pred)
+          && !is_above(dim, _rank(), *_high[dim], _pred);
+        if (inside != _inside[dim])
+          {
+            _inside[dim] = inside;
+            if (inside) { ++_inside_count; } else { --_inside_count; }
+          }
+      }
+
+      Rank _rank;
+      const Predicate& _pred;
+      std::vector<const Key*> _low;
+      std::vector<const Key*> _high;
+      std::vector<bool> _inside;
+      dimension_type _inside_count;
+    };
+
+    //! Counts the nodes given by \ref Region_accumulate.
+    struct Region_count
+    {
+      Region_count() : count(0) { }
+
+      template <typename NodePtr>
+      void node(NodePtr) { ++count; }
+
+      template <typename NodePtr>
+      void subtree(NodePtr node) { count += subtree_size(node); }
+
+      size_type count;
+    };
+  } // namespace details
+
+  /**
+   *  Returns the number of elements in \c container that match \c pred, a
+   *  model of \region_predicate.
+   *
+   *  The result is the same as the distance between \ref region_begin() and
+   *  \ref region_end(), but the elements are not visited one by one: when all
+   *  the elements of a sub-tree are known to be in the region, the sub-tree is
+   *  counted at once. For \point_multiset, \point_multimap, \box_multiset and
+   *  \box_multimap, that store the size of each sub-tree in their nodes, this
+   *  is done in constant time.
+   *
+   *  \param container The container in which elements are counted.
+   *  \param pred A model of \region_predicate.
+   *  \return The number of elements matching \c pred.
+   */
+  ///@{
+  template <typename Container, typename Predicate>
+  inline typename Container::size_type
+  region_count(const Container& container, const Predicate& pred)
+  {
+    if (container.empty()) return 0;
+    details::Region_accumulate<typename Container::mode_type::const_node_ptr,
+                               typename Container::rank_type,
+                               typename Container::key_type, Predicate>
+      walk(container.rank(), pred);
+    details::Region_count acc;
+    walk.run(container.end().node->parent, 0, acc);
+    return acc.count;
+  }
+
+  template <typename Container>
+  inline typename Container::size_type
+  region_count(const Container& container,
+               const typename Container::key_type& lower,
+               const typename Container::key_type& upper)
+  { return region_count(container, make_bounds(container, lower, upper)); }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_REGION_COUNT_HPP
@@ -0,0 +1,260 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_region_visit.hpp
+ *  Contains the definition of \ref spatial::for_each_in_region(), which
+ *  gives all the elements of a container that match a \region_predicate to
+ *  a visitor, in a single traversal of the tree, and of \ref
+ *  spatial::for_each_in_regions(), which does the same for many predicates
+ *  at once.
+ */
+
+#ifndef SPATIAL_REGION_VISIT_HPP
+#define SPATIAL_REGION_VISIT_HPP
+
+#include <vector>
+#include <iterator> // std::iterator_traits
+#include "spatial_region.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Walks the sub-tree of \c node in pre-order and calls \c visitor for
+     *  each node that matches \c pred on all dimensions. Sub-trees that lie
+     *  outside of \c pred along the dimension of their parent are skipped.
+     *
+     *  \return false if \c visitor requested the walk to stop, true
+     *  otherwise.
+     */
+    template <typename Iterator, typename Rank, typename Predicate,
+              typename Visitor>
+    inline bool
+    visit_region(typename Iterator::node_ptr node, dimension_type dim,
+                 Rank rank, const Predicate& pred, Visitor& visitor)
+    {
+      for (;;)
+        {
+          SPATIAL_ASSERT_CHECK(dim < rank());
+          SPATIAL_ASSERT_CHECK(node != 0);
+          SPATIAL_ASSERT_CHECK(!header(node));
+          relative_order rel = pred(dim, rank(), const_key(node));
+          if (rel == matching && match_key(rank, const_key(node), pred, dim)
+              && !visitor(Iterator(node))) return false;
+          dimension_type child_dim = incr_dim(rank, dim);
+          bool left = rel != below && node->left != 0;
+          bool right = rel != above && node->right != 0;
+          if (left && right)
+            {
+              if (!visit_region<Iterator>(node->left, child_dim, rank, pred,
+                                          visitor)) return false;
+              node = node->right;
+            }
+          else if (left) { node = node->left; }
+          else if (right) { node = node->right; }
+          else { return true; }
+          dim = child_dim;
+        }
+    }
+
+    //! Deduces the iterator type given to the visitor from \c end, the
+    //! result of \c container.end().
+    template <typename Container, typename Iterator, typename Predicate,
+              typename Visitor>
+    inline void
+    for_each_in_region(Container& container, Iterator end,
+                       const Predicate& pred, Visitor& visitor)
+    {
+      visit_region<Iterator>(end.node->parent, 0, container.rank(), pred,
+                             visitor);
+    }
+
+    /**
+     *  Walks the tree once for several \region_predicate and calls the
+     *  visitor with the index of each predicate matched by a node.
+     *
+     *  Each sub-tree is walked with the subset of predicates that may still
+     *  match some of its nodes. These subsets are stored one after the other
+     *  in a single stack, that grows as the walk goes down the tree and
+     *  shrinks as it returns.
+     */
+    template <typename Iterator, typename Rank, typename Predicate,
+              typename Visitor>
+    class Regions_visit
+    {
+    public:
+      Regions_visit(Rank rank, const std::vector<Predicate>& preds,
+                    Visitor& visitor)
+        : _rank(rank), _preds(preds), _visitor(visitor)
+      {
+        _active.reserve(preds.size());
+        for (size_type i = 0; i < preds.size(); ++i) _active.push_back(i);
+      }
+
+      //! Visit the sub-tree of \c node, where \c dim is the dimension of
+      //! \c node, with all predicates.
+      bool run(typename Iterator::node_ptr node, dimension_type dim)
+      { return run(node, dim, 0, _active.size()); }
+
+    private:
+      //! Visit the sub-tree of \c node with the predicates whose indices are
+      //! stored between \c first and \c last in the stack.
+      //! \return false if the visitor requested the walk to stop.
+      bool run(typename Iterator::node_ptr node, dimension_type dim,
+               size_type first, size_type last)
+      {
+        size_type top = _active.size();
+        for (;;)
+          {
+            SPATIAL_ASSERT_CHECK(dim < _rank());
+            SPATIAL_ASSERT_CHECK(node != 0);
+            SPATIAL_ASSERT_CHECK(!header(node));
+            size_type left_first = _active.size();
+            _right.clear();
+            for (size_type i = first; i < last; ++i)
+              {
+                size_type q = _active[i];
+                relative_order rel = _preds[q](dim, _rank(), const_key(node));
+                if (rel == matching
+                    && match_key(_rank, const_key(node), _preds[q], dim)
+                    && !_visitor(q, Iterator(node)))
+                  { _active.resize(top); return false; }
+                if (rel != below && node->left != 0) _active.push_back(q);
+                if (rel != above && node->right != 0) _right.push_back(q);
+              }
+            size_type right_first = _active.size();
+            _active.insert(_active.end(), _right.begin(), _right.end());
+            dimension_type child_dim = incr_dim(_rank, dim);
+            if (left_first != right_first
+                && !run(node->left, child_dim, left_first, right_first))
+              { _active.resize(top); return false; }
+            if (right_first == _active.size())
+              { _active.resize(top); return true; }
+            node = node->right;
+            dim = child_dim;
+            first = right_first;
+            last = _active.size();
+          }
+      }
+
+      Rank _rank;
+      const std::vector<Predicate>& _preds;
+      Visitor& _visitor;
+      std::vector<size_type> _active;
+      std::vector<size_type> _right;
+    };
+
+    //! Deduces the iterator type given to the visitor from \c end, the
+    //! result of \c container.end().
+    template <typename Container, typename Iterator, typename Predicate,
+              typename Visitor>
+    inline void
+    for_each_in_regions(Container& container, Iterator end,
+                        const std::vector<Predicate>& preds,
+                        Visitor& visitor)
+    {
+      Regions_visit<Iterator, typename Container::rank_type, Predicate,
+                    Visitor> walk(container.rank(), preds, visitor);
+      walk.run(end.node->parent, 0);
+    }
+  } // namespace details
+
+  /**
+   *  Calls \c visitor for each element of \c container that matches \c pred,
+   *  a model of \region_predicate, until \c visitor returns false.
+   *
+   *  The elements are pushed to \c visitor during a single traversal of the
+   *  tree, instead of being pulled one at a time with \ref region_begin() and
+   *  \ref region_end(), which must retrace their steps through the tree on
+   *  each increment. Since \c visitor is a template parameter, the call is
+   *  resolved, and usually inlined, at compile time. \c visitor is called, in
+   *  pre-order, as:
+   *
+   *  \code
+   *  bool continue = visitor(element);
+   *  \endcode
+   *
+   *  Where \c element is a \c Container::iterator, or a \c
+   *  Container::const_iterator if \c container is constant. The traversal
+   *  stops as soon as \c visitor returns false. The container must not be
+   *  modified during the traversal.
+   *
+   *  \param container The container in which elements are visited.
+   *  \param pred A model of \region_predicate.
+   *  \param visitor The functor receiving each element matching \c pred.
+   *  \return A copy of \c visitor, after it was called for each element.
+   */
+  ///@{
+  template <typename Container, typename Predicate, typename Visitor>
+  inline Visitor
+  for_each_in_region(Container& container, const Predicate& pred,
+                     Visitor visitor)
+  {
+    if (container.empty()) return visitor;
+    details::for_each_in_region(container, container.end(), pred, visitor);
+    return visitor;
+  }
+
+  template <typename Container, typename Visitor>
+  inline Visitor
+  for_each_in_region(Container& container,
+                     const typename Container::key_type& lower,
+                     const typename Container::key_type& upper,
+                     Visitor visitor)
+  {
+    return for_each_in_region(container, make_bounds(container, lower, upper),
+                              visitor);
+  }
+  ///@}
+
+  /**
+   *  Calls \c visitor for each pair made of a predicate in the range [\c
+   *  first, \c last) and an element of \c container that matches it, until
+   *  \c visitor returns false.
+   *
+   *  The predicates must be models of \region_predicate and all have the
+   *  same type, such as \ref closed_bounds, \ref open_bounds, \ref
+   *  overlap_bounds or \ref enclosed_bounds. The tree is walked only once,
+   *  and each sub-tree is only visited with the predicates that may match
+   *  some of its elements. Compared to calling \ref region_begin() for each
+   *  predicate, the top of the tree is not read again for every predicate,
+   *  which is most beneficial for many small regions. \c visitor is called
+   *  as:
+   *
+   *  \code
+   *  bool continue = visitor(index, element);
+   *  \endcode
+   *
+   *  Where \c index is the position of the predicate in the range, as a \ref
+   *  size_type, and \c element is a \c Container::iterator, or a \c
+   *  Container::const_iterator if \c container is constant. The pairs are
+   *  given in pre-order of the elements, and the traversal stops as soon as
+   *  \c visitor returns false. The container must not be modified during the
+   *  traversal.
+   *
+   *  \param container The container in which elements are visited.
+   *  \param first The first predicate of the range.
+   *  \param last The end of the range of predicates.
+   *  \param visitor The functor receiving each pair.
+   *  \return A copy of \c visitor, after it was called for each pair.
+   */
+  template <typename Container, typename PredicateIterator, typename Visitor>
+  inline Visitor
+  for_each_in_regions(Container& container, PredicateIterator first,
+                      PredicateIterator last, Visitor visitor)
+  {
+    if (container.empty() || first == last) return visitor;
+    std::vector<typename std::iterator_traits<PredicateIterator>::value_type>
+      preds(first, last);
+    details::for_each_in_regions(container, container.end(), preds, visitor);
+    return visitor;
+  }
+} // namespace spatial
+
+#endif // SPATIAL_REGION_VISIT_HPP
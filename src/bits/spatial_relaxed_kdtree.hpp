@@ -30,12 +30,14 @@
 #define SPATIAL_RELAXED_KDTREE_HPP
 
 #include <utility> // for std::pair
+#include <vector>
 #include <algorithm> // for std::min, std::max, std::equal,
                      // std::lexicographical_compare
 
 #include "spatial_ordered.hpp"
 #include "spatial_mapping.hpp"
 #include "spatial_equal.hpp"
+#include "spatial_equal_index.hpp"
 #include "spatial_rank.hpp"
 #include "spatial_compress.hpp"
 #include "spatial_value_compare.hpp"
@@ -138,18 +140,107 @@ namespace spatial
 
   namespace details
   {
+    /**
+     *  Maintains the aggregate stored in the nodes of a relaxed \kdtree, for
+     *  a given \c Monoid. The specialization for \c void stores nothing and
+     *  does nothing.
+     */
+    template <typename Key, typename Value, typename Monoid>
+    struct Link_aggregate
+    {
+      //! The type of link allocated by the tree.
+      typedef Aggregate_kdtree_link<Key, Value, Monoid> link_type;
+
+      //! Recompute the aggregate of \c node from its value and the
+      //! aggregates of its children.
+      void update(Node<Relaxed_kdtree_link<Key, Value> >* node) const
+      {
+        typename Monoid::aggregate_type aggregate
+          = monoid.map(const_value(node));
+        if (node->left != 0)
+          {
+            aggregate = monoid.combine
+              (aggregate, const_aggregate<Monoid>(node->left));
+          }
+        if (node->right != 0)
+          {
+            aggregate = monoid.combine
+              (aggregate, const_aggregate<Monoid>(node->right));
+          }
+        static_cast<link_type*>(link(node))->aggregate = aggregate;
+      }
+
+      //! Copy the aggregate of \c source into \c target.
+      void copy(const Node<Relaxed_kdtree_link<Key, Value> >* source,
+                Node<Relaxed_kdtree_link<Key, Value> >* target) const
+      {
+        static_cast<link_type*>(link(target))->aggregate
+          = const_aggregate<Monoid>(source);
+      }
+
+      Monoid monoid;
+    };
+
+    template <typename Key, typename Value>
+    struct Link_aggregate<Key, Value, void>
+    {
+      typedef Relaxed_kdtree_link<Key, Value> link_type;
+
+      void update(Node<Relaxed_kdtree_link<Key, Value> >*) const { }
+
+      void copy(const Node<Relaxed_kdtree_link<Key, Value> >*,
+                Node<Relaxed_kdtree_link<Key, Value> >*) const { }
+    };
+
     /**
      *  Detailed implementation of the kd-tree. Used by point_set,
      *  point_multiset, point_map, point_multimap, box_set, box_multiset and
      *  their equivalent in variant orders: variant_pointer_set, as chosen by
      *  the templates.
+     *
+     *  When \c Monoid is not \c void, each node also holds the aggregate of
+     *  the values in its sub-tree, which is kept up to date on insertion,
+     *  deletion and rebalancing, at the cost of recomputing the aggregates
+     *  along the path that was modified. \c Monoid must be default
+     *  constructible and provide:
+     *
+     *  \code
+     *  typedef ... aggregate_type;
+     *  aggregate_type identity() const;
+     *  aggregate_type map(const value_type& value) const;
+     *  aggregate_type combine(const aggregate_type& a,
+     *                         const aggregate_type& b) const;
+     *  \endcode
+     *
+     *  \c combine must be associative and commutative, and \c identity must
+     *  be its neutral element, since aggregates of sub-trees are combined in
+     *  no particular order. A sum, a count, a minimum or a maximum satisfy
+     *  these requirements. \see region_aggregate()
+     *
+     *  When \c Hash is not \c void, the tree also keeps a hash index of its
+     *  nodes, with which find() and erase(const key_type&) reach the nodes
+     *  equal to a key without walking the tree. This is most useful when
+     *  many elements share coordinates, since the walk must then explore
+     *  both sides of every node whose coordinate equals the key. The
+     *  iterators of \ref equal_range() are not covered by the index: they
+     *  visit the equal elements in the order of the tree, and move from one
+     *  to the next by walking it. \c Hash must be default constructible and
+     *  provide:
+     *
+     *  \code
+     *  std::size_t operator()(const key_type& key) const;
+     *  \endcode
+     *
+     *  which returns the same value for keys that are equal on all
+     *  dimensions according to \c Compare. \see Equal_index
      */
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid = void,
+              typename Hash = void>
     class Relaxed_kdtree
     {
       typedef Relaxed_kdtree<Rank, Key, Value, Compare, Balancing,
-                             Alloc>                   Self;
+                             Alloc, Monoid, Hash>     Self;
 
     public:
       // Container intrincsic types
@@ -161,6 +252,8 @@ namespace spatial
       typedef ValueCompare<value_type, key_compare>   value_compare;
       typedef Alloc                                   allocator_type;
       typedef Balancing                               balancing_policy;
+      typedef Monoid                                  monoid_type;
+      typedef Hash                                    hasher;
 
       // Container iterator related types
       typedef Value*                                  pointer;
@@ -179,8 +272,12 @@ namespace spatial
       typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
 
     private:
+      typedef Link_aggregate<Key, Value, Monoid>      Aggregate;
+      typedef Equal_index<Key, Value, Hash,
+                          typename Aggregate::link_type> Index;
+      typedef typename Index::link_type               Allocated_link;
       typedef typename Alloc::template rebind
-      <Relaxed_kdtree_link<Key, Value> >::other       Link_allocator;
+      <Allocated_link>::other                         Link_allocator;
       typedef typename Alloc::template rebind
       <value_type>::other                             Value_allocator;
 
@@ -199,15 +296,16 @@ namespace spatial
        *  header class also contains the pointer to the left most node of the
        *  tree, since the place is already used by the header node marker.
        */
-      struct Implementation : rank_type
+      struct Implementation : rank_type, Aggregate, Index
       {
         Implementation(const rank_type& rank, const key_compare& compare,
                        const Balancing& balance, const Link_allocator& alloc)
-          : Rank(rank), _compare(balance, compare),
+          : Rank(rank), Aggregate(), Index(), _compare(balance, compare),
             _header(alloc, Node<mode_type>()) { initialize(); }
 
         Implementation(const Implementation& impl)
-          : Rank(impl), _compare(impl._compare.base(), impl._compare()),
+          : Rank(impl), Aggregate(impl), Index(impl),
+            _compare(impl._compare.base(), impl._compare()),
             _header(impl._header.base()) { initialize(); }
 
         void initialize()
@@ -273,17 +371,27 @@ namespace spatial
       Value_allocator get_value_allocator() const
       { return _impl._header.base(); }
 
+      const Aggregate& get_aggregate() const
+      { return _impl; }
+
+      Index& get_index()
+      { return _impl; }
+
+      const Index& get_index() const
+      { return _impl; }
+
     private:
       // Allocation/Deallocation of nodes
       struct safe_allocator // RAII for exception-safe memory management
       {
         Link_allocator* alloc;
-        link_ptr link;
+        Allocated_link* link;
         safe_allocator(Link_allocator& a)
           : alloc(&a), link(0)
         { link = alloc->allocate(1); } // may throw
         ~safe_allocator() { if (link) { alloc->deallocate(link, 1); } }
-        link_ptr release() { link_ptr p = link; link=0; return p; }
+        Allocated_link* release()
+        { Allocated_link* p = link; link=0; return p; }
       };
 
       node_ptr
@@ -298,6 +406,15 @@ namespace spatial
         node->left = 0;
         node->right = 0;
         node->weight = 1;
+        get_aggregate().update(node);
+        try { get_index().insert(node); }
+        catch (...)
+          {
+            get_value_allocator().destroy(mutate_pointer(&node->value));
+            get_link_allocator().deallocate
+              (static_cast<Allocated_link*>(node), 1);
+            throw;
+          }
         return node; // silently cast into base type node_ptr.
       }
 
@@ -306,6 +423,7 @@ namespace spatial
       {
         node_ptr new_node = create_node(const_value(node));
         link(new_node)->weight = const_link(node)->weight;
+        get_aggregate().copy(node, new_node);
         return new_node; // silently cast into base type node_ptr.
       }
 
@@ -315,8 +433,10 @@ namespace spatial
       void
       destroy_node(node_ptr node)
       {
+        get_index().erase(node);
         get_value_allocator().destroy(mutate_pointer(&value(node)));
-        get_link_allocator().deallocate(link(node), 1);
+        get_link_allocator().deallocate
+          (static_cast<Allocated_link*>(link(node)), 1);
       }
 
       /**
@@ -434,6 +554,13 @@ namespace spatial
       balancing_policy balancing() const
       { return _impl._compare.base(); }
 
+      /**
+       *  Returns the definition of the aggregate held by each node, when the
+       *  container was defined with a \c Monoid.
+       */
+      monoid_type monoid() const
+      { return get_aggregate().monoid; }
+
       /**
        *  Returns the rank type used internally to get the number of dimensions
        *  in the container.
@@ -516,6 +643,11 @@ namespace spatial
       find(const key_type& key)
       {
         if (empty()) return end();
+        if (Index::enabled)
+          {
+            node_ptr node = get_index().find(rank(), key_comp(), key);
+            return node != 0 ? iterator(node) : end();
+          }
         return iterator(first_equal(get_root(), 0, rank(), key_comp(), key)
                         .first);
       }
@@ -524,12 +656,36 @@ namespace spatial
       find(const key_type& key) const
       {
         if (empty()) return end();
+        if (Index::enabled)
+          {
+            const_node_ptr node = get_index().find(rank(), key_comp(), key);
+            return node != 0 ? const_iterator(node) : end();
+          }
         return const_iterator(first_equal(get_root(), 0, rank(), key_comp(),
                                           key)
                               .first);
       }
       ///@}
 
+      /**
+       *  Returns the number of elements that match with \c key.
+       *
+       *  The sub-trees whose elements are all known to be equal to \c key,
+       *  from the coordinates of their ancestors, are counted at once from
+       *  the weight of their root, instead of one element at a time.
+       *
+       *  \param key The value searched.
+       *  \return The number of elements equal to \c key on all dimensions.
+       */
+      size_type
+      count(const key_type& key) const
+      {
+        if (empty()) return 0;
+        Equal_count<const_node_ptr, rank_type, key_compare, key_type>
+          walk(rank(), key_comp(), key);
+        return walk.run(get_root(), 0);
+      }
+
     public:
       Relaxed_kdtree()
         : _impl(rank_type(), key_compare(), balancing_policy(),
@@ -618,6 +774,7 @@ namespace spatial
           (get_balancing(), other.get_balancing());
         template_member_swap<Link_allocator>::do_it
           (get_link_allocator(), other.get_link_allocator());
+        get_index().swap(other.get_index());
         if (_impl._header().parent == &_impl._header())
           {
             _impl._header().parent = &other._impl._header();
@@ -706,10 +863,13 @@ namespace spatial
      *  Swap the content of the relaxed \kdtree \p left and \p right.
      */
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline void swap
-    (Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& left,
-     Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& right)
+    (Relaxed_kdtree
+     <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& left,
+     Relaxed_kdtree
+     <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& right)
     { left.swap(right); }
 
     /**
@@ -726,12 +886,13 @@ namespace spatial
      */
     ///@{
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline bool
     operator==(const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& lhs,
                const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& rhs)
     {
       return lhs.size() == rhs.size()
         && std::equal(ordered_begin(lhs), ordered_end(lhs),
@@ -739,12 +900,13 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline bool
     operator!=(const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& lhs,
                const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& rhs)
     { return !(lhs == rhs); }
     ///@}
 
@@ -762,12 +924,13 @@ namespace spatial
      */
     ///@{
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline bool
     operator<(const Relaxed_kdtree
-              <Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+              <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& lhs,
               const Relaxed_kdtree
-              <Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+              <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& rhs)
     {
       return std::lexicographical_compare
         (ordered_begin(lhs), ordered_end(lhs),
@@ -775,37 +938,41 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline bool
     operator>(const Relaxed_kdtree
-              <Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+              <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& lhs,
               const Relaxed_kdtree
-              <Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+              <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& rhs)
     { return rhs < lhs; }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline bool
     operator<=(const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& lhs,
                const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& rhs)
     { return !(rhs < lhs); }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline bool
     operator>=(const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& lhs,
                const Relaxed_kdtree
-               <Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+               <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>& rhs)
     { return !(lhs < rhs); }
     ///@}
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline void
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::destroy_all_nodes()
     {
       node_ptr node = get_root();
@@ -836,9 +1003,10 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline void
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::copy_structure
     (const Self& other)
     {
@@ -901,10 +1069,12 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline
-    typename Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>::node_ptr
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    typename Relaxed_kdtree
+    <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>::node_ptr
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::balance_node
     (dimension_type node_dim, node_ptr node)
     {
@@ -920,15 +1090,19 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline
-    typename Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>::iterator
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    typename Relaxed_kdtree
+    <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>::iterator
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::insert_node
     (dimension_type node_dim, node_ptr node, node_ptr target_node)
     {
       SPATIAL_ASSERT_CHECK(node != 0);
       SPATIAL_ASSERT_CHECK(!header(node));
+      // The parent of node is not modified, even when node is balanced.
+      const_node_ptr top = node->parent;
       while (true)
         {
           SPATIAL_ASSERT_CHECK
@@ -1005,15 +1179,19 @@ namespace spatial
       SPATIAL_ASSERT_CHECK(target_node->right == 0);
       SPATIAL_ASSERT_CHECK(target_node->left == 0);
       SPATIAL_ASSERT_CHECK(target_node->parent != 0);
+      for (node = target_node; node != top; node = node->parent)
+        { get_aggregate().update(node); }
       return iterator(target_node);
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline
-    typename Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    typename Relaxed_kdtree
+    <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::node_ptr
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::erase_node
     (dimension_type node_dim, node_ptr node)
     {
@@ -1075,6 +1253,7 @@ namespace spatial
           node_dim = decr_dim(rank(), node_dim);
           SPATIAL_ASSERT_CHECK(const_link(node)->weight > 1);
           --link(node)->weight;
+          get_aggregate().update(node);
           if(balancing()
              (rank(),
               (node->left ? const_link(node->left)->weight : 0),
@@ -1089,9 +1268,10 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline void
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::erase_node_balance
     (dimension_type node_dim, node_ptr node)
     {
@@ -1114,6 +1294,7 @@ namespace spatial
             {
               SPATIAL_ASSERT_CHECK(const_link(p)->weight > 1);
               --link(p)->weight;
+              get_aggregate().update(p);
               if(balancing()
                  (rank(),
                   (node->left ? const_link(node->left)->weight : 0),
@@ -1126,9 +1307,10 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline void
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::erase
     (iterator target)
     {
@@ -1147,14 +1329,25 @@ namespace spatial
     }
 
     template <typename Rank, typename Key, typename Value, typename Compare,
-              typename Balancing, typename Alloc>
+              typename Balancing, typename Alloc, typename Monoid,
+              typename Hash>
     inline
-    typename Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    typename Relaxed_kdtree
+    <Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::size_type
-    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    Relaxed_kdtree<Rank, Key, Value, Compare, Balancing, Alloc, Monoid, Hash>
     ::erase
     (const key_type& key)
     {
+      if (Index::enabled)
+        {
+          std::vector<node_ptr> nodes;
+          get_index().equal_nodes(rank(), key_comp(), key, nodes);
+          for (typename std::vector<node_ptr>::const_iterator i
+                 = nodes.begin(); i != nodes.end(); ++i)
+            { erase(iterator(*i)); }
+          return nodes.size();
+        }
       size_type cnt = 0;
       while (!empty())
         {
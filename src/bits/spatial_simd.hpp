@@ -0,0 +1,1138 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2014.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_simd.hpp
+ *  Contains the vectorized kernels used by the euclidian, quadrance,
+ *  manhattan and chebyshev metrics, the weighted versions of the first
+ *  three, the single precision estimates of mixed_precision and the 64 bits
+ *  sums of wide_quadrance, to compute distances between keys whose
+ *  coordinates are stored contiguously.
+ *
+ *  The instruction set is chosen at compile time, from the macros defined by
+ *  the compiler: AVX-512, AVX or AVX2, and SSE2 or SSE4.1 are used when
+ *  available, and the kernels are otherwise disabled. Define
+ *  SPATIAL_DISABLE_SIMD to always compute distances one coordinate at a
+ *  time. The kernels are also disabled when SPATIAL_SAFER_ARITHMETICS is
+ *  defined, since they do not check for overflows.
+ */
+
+#ifndef SPATIAL_SIMD_HPP
+#define SPATIAL_SIMD_HPP
+
+#include <cstddef> // std::size_t
+#include <vector>
+#include <stdint.h> // int64_t
+#if __cplusplus >= 201103L
+#  include <array>
+#endif
+#ifdef __GLIBCXX__
+#  include <tr1/array>
+#endif
+#include "spatial_import_type_traits.hpp"
+#include "../spatial.hpp"
+
+#if !defined(SPATIAL_DISABLE_SIMD) && !defined(SPATIAL_SAFER_ARITHMETICS) \
+  && defined(__SSE2__)
+#  define SPATIAL_SIMD_SSE2
+#  include <emmintrin.h>
+#  if defined(__SSE4_1__)
+#    define SPATIAL_SIMD_SSE4_1
+#    include <smmintrin.h>
+#  endif
+#  if defined(__AVX__)
+#    define SPATIAL_SIMD_AVX
+#    include <immintrin.h>
+#  endif
+#  if defined(__AVX2__)
+#    define SPATIAL_SIMD_AVX2
+#  endif
+#  if defined(__AVX512F__)
+#    define SPATIAL_SIMD_AVX512F
+#  endif
+#endif
+
+namespace boost
+{
+  template <typename Tp, std::size_t N> class array;
+}
+
+namespace spatial
+{
+  template<typename Tp, typename Unit> struct bracket_minus;
+
+  /**
+   *  Tells whether the coordinates of \c Key are stored contiguously, such
+   *  that for a key \c k of rank \c r, the coordinates \c k[0] to \c k[r-1]
+   *  are the \c r consecutive elements of an array of \c value_type
+   *  starting at \c &k[0].
+   *
+   *  When it is so, and the metric uses \ref bracket_minus with a distance
+   *  type equal to \c value_type, distances are computed with vectorized
+   *  kernels. \c std::vector, C arrays, \c boost::array, \c std::array
+   *  with C++11 and \c std::tr1::array with libstdc++ are contiguous;
+   *  specialize this type to enable the kernels for other keys, such as:
+   *
+   *  \code
+   *  namespace spatial
+   *  {
+   *    template <> struct contiguous_key<my_point>
+   *      : import::true_type { typedef double value_type; };
+   *  }
+   *  \endcode
+   */
+  ///@{
+  template <typename Key>
+  struct contiguous_key : import::false_type { };
+
+  template <typename Tp, typename Alloc>
+  struct contiguous_key<std::vector<Tp, Alloc> > : import::true_type
+  { typedef Tp value_type; };
+
+  template <typename Tp, std::size_t N>
+  struct contiguous_key<Tp[N]> : import::true_type
+  { typedef Tp value_type; };
+
+  template <typename Tp, std::size_t N>
+  struct contiguous_key<boost::array<Tp, N> > : import::true_type
+  { typedef Tp value_type; };
+
+#if __cplusplus >= 201103L
+  template <typename Tp, std::size_t N>
+  struct contiguous_key<std::array<Tp, N> > : import::true_type
+  { typedef Tp value_type; };
+#endif
+
+#ifdef __GLIBCXX__
+  template <typename Tp, std::size_t N>
+  struct contiguous_key<std::tr1::array<Tp, N> > : import::true_type
+  { typedef Tp value_type; };
+#endif
+  ///@}
+
+  namespace details
+  {
+    /**
+     *  Tells whether a kernel is available for \c Unit with the instruction
+     *  sets enabled.
+     */
+    ///@{
+    template <typename Unit>
+    struct simd_unit : import::false_type { };
+#ifdef SPATIAL_SIMD_SSE2
+    template <> struct simd_unit<double> : import::true_type { };
+    template <> struct simd_unit<float> : import::true_type { };
+#endif
+#ifdef SPATIAL_SIMD_SSE4_1
+    template <> struct simd_unit<int> : import::true_type { };
+#endif
+    ///@}
+
+    template <typename Key, typename Unit, bool Contiguous>
+    struct simd_key_helper : import::false_type { };
+
+    template <typename Key, typename Unit>
+    struct simd_key_helper<Key, Unit, true>
+      : import::integral_constant
+        <bool, import::is_same<typename contiguous_key<Key>::value_type,
+                               Unit>::value && simd_unit<Unit>::value> { };
+
+    /**
+     *  Tells whether the distance between keys of type \c Key, computed with
+     *  \c Difference into \c Unit, is computed with a vectorized kernel.
+     */
+    ///@{
+    template <typename Key, typename Difference, typename Unit>
+    struct simd_distance : import::false_type { };
+
+    template <typename Key, typename Unit>
+    struct simd_distance<Key, bracket_minus<Key, Unit>, Unit>
+      : simd_key_helper<Key, Unit, contiguous_key<Key>::value> { };
+    ///@}
+
+    /**
+     *  Tells whether the weighted distance between keys of type \c Key is
+     *  computed with a vectorized kernel. Only floating point coordinates
+     *  have weighted kernels.
+     */
+    template <typename Key, typename Difference, typename Unit>
+    struct simd_weighted_distance
+      : import::integral_constant
+        <bool, simd_distance<Key, Difference, Unit>::value
+               && import::is_floating_point<Unit>::value> { };
+
+    /**
+     *  Tells whether the Minkowski distance of order \c P between keys of
+     *  type \c Key is computed with a vectorized kernel, which is only the
+     *  case for the orders 1 and 2.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              unsigned int P>
+    struct simd_minkowski
+      : import::integral_constant
+        <bool, simd_distance<Key, Difference, Unit>::value
+               && (P == 1 || P == 2)> { };
+
+    /**
+     *  Tells whether the differences between keys of type \c Key, computed
+     *  in \c Unit, are narrowed to \c Narrow and added up with a vectorized
+     *  kernel, which is only the case from \c double to \c float.
+     */
+    template <typename Key, typename Difference, typename Unit,
+              typename Narrow>
+    struct simd_narrow
+      : import::integral_constant
+        <bool, simd_distance<Key, Difference, Unit>::value
+               && import::is_same<Unit, double>::value
+               && import::is_same<Narrow, float>::value> { };
+
+    /**
+     *  Tells whether the squares of the differences between keys of type \c
+     *  Key are added up in \c Wide with a vectorized kernel, which is the
+     *  case for contiguous \c short and \c int coordinates added up in \c
+     *  int64_t.
+     */
+    ///@{
+    template <typename Unit>
+    struct simd_wide_unit : import::false_type { };
+#ifdef SPATIAL_SIMD_SSE2
+    template <> struct simd_wide_unit<short> : import::true_type { };
+    template <> struct simd_wide_unit<int> : import::true_type { };
+#endif
+
+    template <typename Key, bool Contiguous>
+    struct simd_wide_key_helper : import::false_type { };
+
+    template <typename Key>
+    struct simd_wide_key_helper<Key, true>
+      : simd_wide_unit<typename contiguous_key<Key>::value_type> { };
+
+    template <typename Key, typename Difference, typename Wide>
+    struct simd_wide : import::false_type { };
+
+    template <typename Key>
+    struct simd_wide<Key, bracket_minus<Key, int64_t>, int64_t>
+      : simd_wide_key_helper<Key, contiguous_key<Key>::value> { };
+    ///@}
+
+#ifdef SPATIAL_SIMD_SSE2
+    namespace simd
+    {
+      inline double hsum(__m128d x)
+      { return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x))); }
+
+      inline float hsum(__m128 x)
+      {
+        x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+        return _mm_cvtss_f32(_mm_add_ss(x, _mm_shuffle_ps(x, x, 1)));
+      }
+
+      inline double hmax(__m128d x)
+      { return _mm_cvtsd_f64(_mm_max_sd(x, _mm_unpackhi_pd(x, x))); }
+
+      inline float hmax(__m128 x)
+      {
+        x = _mm_max_ps(x, _mm_movehl_ps(x, x));
+        return _mm_cvtss_f32(_mm_max_ss(x, _mm_shuffle_ps(x, x, 1)));
+      }
+
+      inline __m128d abs(__m128d x)
+      { return _mm_andnot_pd(_mm_set1_pd(-0.0), x); }
+
+      inline __m128 abs(__m128 x)
+      { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+
+#ifdef SPATIAL_SIMD_SSE4_1
+      inline int hsum(__m128i x)
+      {
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(x);
+      }
+
+      inline int hmax(__m128i x)
+      {
+        x = _mm_max_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+        x = _mm_max_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(x);
+      }
+#endif
+#ifdef SPATIAL_SIMD_AVX
+      inline double hsum(__m256d x)
+      {
+        return hsum(_mm_add_pd(_mm256_castpd256_pd128(x),
+                               _mm256_extractf128_pd(x, 1)));
+      }
+
+      inline float hsum(__m256 x)
+      {
+        return hsum(_mm_add_ps(_mm256_castps256_ps128(x),
+                               _mm256_extractf128_ps(x, 1)));
+      }
+
+      inline double hmax(__m256d x)
+      {
+        return hmax(_mm_max_pd(_mm256_castpd256_pd128(x),
+                               _mm256_extractf128_pd(x, 1)));
+      }
+
+      inline float hmax(__m256 x)
+      {
+        return hmax(_mm_max_ps(_mm256_castps256_ps128(x),
+                               _mm256_extractf128_ps(x, 1)));
+      }
+
+      inline __m256d abs(__m256d x)
+      { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x); }
+
+      inline __m256 abs(__m256 x)
+      { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+#endif
+#ifdef SPATIAL_SIMD_AVX2
+      inline int hsum(__m256i x)
+      {
+        return hsum(_mm_add_epi32(_mm256_castsi256_si128(x),
+                                  _mm256_extracti128_si256(x, 1)));
+      }
+
+      inline int hmax(__m256i x)
+      {
+        return hmax(_mm_max_epi32(_mm256_castsi256_si128(x),
+                                  _mm256_extracti128_si256(x, 1)));
+      }
+#endif
+
+      /**
+       *  Returns the sum of the squares of the differences between the \c n
+       *  coordinates of \c a and \c b, using the widest registers available,
+       *  then narrower ones for the remaining coordinates.
+       */
+      ///@{
+      inline double
+      sum_squares(const double* a, const double* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        double sum = 0.0;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 8)
+          {
+            __m512d acc = _mm512_setzero_pd();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m512d d = _mm512_sub_pd(_mm512_loadu_pd(a + i),
+                                          _mm512_loadu_pd(b + i));
+                acc = _mm512_add_pd(acc, _mm512_mul_pd(d, d));
+              }
+            sum += _mm512_reduce_add_pd(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 4 <= n)
+          {
+            __m256d acc = _mm256_setzero_pd();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i),
+                                          _mm256_loadu_pd(b + i));
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 2 <= n)
+          {
+            __m128d acc = _mm_setzero_pd();
+            for (; i + 2 <= n; i += 2)
+              {
+                __m128d d = _mm_sub_pd(_mm_loadu_pd(a + i),
+                                       _mm_loadu_pd(b + i));
+                acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+              }
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) { double d = a[i] - b[i]; sum += d * d; }
+        return sum;
+      }
+
+      inline float
+      sum_squares(const float* a, const float* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        float sum = 0.0f;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 16)
+          {
+            __m512 acc = _mm512_setzero_ps();
+            for (; i + 16 <= n; i += 16)
+              {
+                __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i),
+                                         _mm512_loadu_ps(b + i));
+                acc = _mm512_add_ps(acc, _mm512_mul_ps(d, d));
+              }
+            sum += _mm512_reduce_add_ps(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 8 <= n)
+          {
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i),
+                                         _mm256_loadu_ps(b + i));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i),
+                                      _mm_loadu_ps(b + i));
+                acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+              }
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) { float d = a[i] - b[i]; sum += d * d; }
+        return sum;
+      }
+
+#ifdef SPATIAL_SIMD_SSE4_1
+      inline int
+      sum_squares(const int* a, const int* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        int sum = 0;
+#if defined(SPATIAL_SIMD_AVX2)
+        if (n >= 8)
+          {
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m256i d = _mm256_sub_epi32
+                  (_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(d, d));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128i acc = _mm_setzero_si128();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m128i d = _mm_sub_epi32
+                  (_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+                acc = _mm_add_epi32(acc, _mm_mullo_epi32(d, d));
+              }
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) { int d = a[i] - b[i]; sum += d * d; }
+        return sum;
+      }
+#endif
+      ///@}
+
+      /**
+       *  Returns the sum of the absolute differences between the \c n
+       *  coordinates of \c a and \c b.
+       */
+      ///@{
+      inline double
+      sum_abs(const double* a, const double* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        double sum = 0.0;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 8)
+          {
+            __m512d acc = _mm512_setzero_pd();
+            for (; i + 8 <= n; i += 8)
+              acc = _mm512_add_pd(acc, _mm512_abs_pd
+                                  (_mm512_sub_pd(_mm512_loadu_pd(a + i),
+                                                 _mm512_loadu_pd(b + i))));
+            sum += _mm512_reduce_add_pd(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 4 <= n)
+          {
+            __m256d acc = _mm256_setzero_pd();
+            for (; i + 4 <= n; i += 4)
+              acc = _mm256_add_pd(acc, abs(_mm256_sub_pd
+                                           (_mm256_loadu_pd(a + i),
+                                            _mm256_loadu_pd(b + i))));
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 2 <= n)
+          {
+            __m128d acc = _mm_setzero_pd();
+            for (; i + 2 <= n; i += 2)
+              acc = _mm_add_pd(acc, abs(_mm_sub_pd(_mm_loadu_pd(a + i),
+                                                   _mm_loadu_pd(b + i))));
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) sum += a[i] < b[i] ? b[i] - a[i] : a[i] - b[i];
+        return sum;
+      }
+
+      inline float
+      sum_abs(const float* a, const float* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        float sum = 0.0f;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 16)
+          {
+            __m512 acc = _mm512_setzero_ps();
+            for (; i + 16 <= n; i += 16)
+              acc = _mm512_add_ps(acc, _mm512_abs_ps
+                                  (_mm512_sub_ps(_mm512_loadu_ps(a + i),
+                                                 _mm512_loadu_ps(b + i))));
+            sum += _mm512_reduce_add_ps(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 8 <= n)
+          {
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8)
+              acc = _mm256_add_ps(acc, abs(_mm256_sub_ps
+                                           (_mm256_loadu_ps(a + i),
+                                            _mm256_loadu_ps(b + i))));
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              acc = _mm_add_ps(acc, abs(_mm_sub_ps(_mm_loadu_ps(a + i),
+                                                   _mm_loadu_ps(b + i))));
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) sum += a[i] < b[i] ? b[i] - a[i] : a[i] - b[i];
+        return sum;
+      }
+
+#ifdef SPATIAL_SIMD_SSE4_1
+      inline int
+      sum_abs(const int* a, const int* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        int sum = 0;
+#if defined(SPATIAL_SIMD_AVX2)
+        if (n >= 8)
+          {
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 8 <= n; i += 8)
+              acc = _mm256_add_epi32
+                (acc, _mm256_abs_epi32(_mm256_sub_epi32
+                  (_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                   _mm256_loadu_si256
+                   (reinterpret_cast<const __m256i*>(b + i)))));
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128i acc = _mm_setzero_si128();
+            for (; i + 4 <= n; i += 4)
+              acc = _mm_add_epi32
+                (acc, _mm_abs_epi32(_mm_sub_epi32
+                  (_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)))));
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) sum += a[i] < b[i] ? b[i] - a[i] : a[i] - b[i];
+        return sum;
+      }
+#endif
+      ///@}
+      /**
+       *  Returns the largest of the absolute differences between the \c n
+       *  coordinates of \c a and \c b.
+       */
+      ///@{
+      inline double
+      max_abs(const double* a, const double* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        double max = 0.0;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 8)
+          {
+            __m512d acc = _mm512_setzero_pd();
+            for (; i + 8 <= n; i += 8)
+              acc = _mm512_max_pd(acc, _mm512_abs_pd
+                                  (_mm512_sub_pd(_mm512_loadu_pd(a + i),
+                                                 _mm512_loadu_pd(b + i))));
+            max = _mm512_reduce_max_pd(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 4 <= n)
+          {
+            __m256d acc = _mm256_set1_pd(max);
+            for (; i + 4 <= n; i += 4)
+              acc = _mm256_max_pd(acc, abs(_mm256_sub_pd
+                                           (_mm256_loadu_pd(a + i),
+                                            _mm256_loadu_pd(b + i))));
+            max = hmax(acc);
+          }
+#endif
+        if (i + 2 <= n)
+          {
+            __m128d acc = _mm_set1_pd(max);
+            for (; i + 2 <= n; i += 2)
+              acc = _mm_max_pd(acc, abs(_mm_sub_pd(_mm_loadu_pd(a + i),
+                                                   _mm_loadu_pd(b + i))));
+            max = hmax(acc);
+          }
+        for (; i < n; ++i)
+          {
+            double d = a[i] < b[i] ? b[i] - a[i] : a[i] - b[i];
+            if (d > max) max = d;
+          }
+        return max;
+      }
+
+      inline float
+      max_abs(const float* a, const float* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        float max = 0.0f;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 16)
+          {
+            __m512 acc = _mm512_setzero_ps();
+            for (; i + 16 <= n; i += 16)
+              acc = _mm512_max_ps(acc, _mm512_abs_ps
+                                  (_mm512_sub_ps(_mm512_loadu_ps(a + i),
+                                                 _mm512_loadu_ps(b + i))));
+            max = _mm512_reduce_max_ps(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 8 <= n)
+          {
+            __m256 acc = _mm256_set1_ps(max);
+            for (; i + 8 <= n; i += 8)
+              acc = _mm256_max_ps(acc, abs(_mm256_sub_ps
+                                           (_mm256_loadu_ps(a + i),
+                                            _mm256_loadu_ps(b + i))));
+            max = hmax(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_set1_ps(max);
+            for (; i + 4 <= n; i += 4)
+              acc = _mm_max_ps(acc, abs(_mm_sub_ps(_mm_loadu_ps(a + i),
+                                                   _mm_loadu_ps(b + i))));
+            max = hmax(acc);
+          }
+        for (; i < n; ++i)
+          {
+            float d = a[i] < b[i] ? b[i] - a[i] : a[i] - b[i];
+            if (d > max) max = d;
+          }
+        return max;
+      }
+
+#ifdef SPATIAL_SIMD_SSE4_1
+      inline int
+      max_abs(const int* a, const int* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        int max = 0;
+#if defined(SPATIAL_SIMD_AVX2)
+        if (n >= 8)
+          {
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 8 <= n; i += 8)
+              acc = _mm256_max_epi32
+                (acc, _mm256_abs_epi32(_mm256_sub_epi32
+                  (_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                   _mm256_loadu_si256
+                   (reinterpret_cast<const __m256i*>(b + i)))));
+            max = hmax(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128i acc = _mm_set1_epi32(max);
+            for (; i + 4 <= n; i += 4)
+              acc = _mm_max_epi32
+                (acc, _mm_abs_epi32(_mm_sub_epi32
+                  (_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)))));
+            max = hmax(acc);
+          }
+        for (; i < n; ++i)
+          {
+            int d = a[i] < b[i] ? b[i] - a[i] : a[i] - b[i];
+            if (d > max) max = d;
+          }
+        return max;
+      }
+#endif
+      ///@}
+
+      /**
+       *  Returns the sum of the squares of the differences between the \c n
+       *  coordinates of \c a and \c b, each multiplied by the weight of its
+       *  dimension in \c w.
+       */
+      ///@{
+      inline double
+      weighted_sum_squares(const double* a, const double* b, const double* w,
+                           dimension_type n)
+      {
+        dimension_type i = 0;
+        double sum = 0.0;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 8)
+          {
+            __m512d acc = _mm512_setzero_pd();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m512d d = _mm512_sub_pd(_mm512_loadu_pd(a + i),
+                                          _mm512_loadu_pd(b + i));
+                acc = _mm512_add_pd(acc, _mm512_mul_pd(_mm512_loadu_pd(w + i),
+                                                       _mm512_mul_pd(d, d)));
+              }
+            sum += _mm512_reduce_add_pd(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 4 <= n)
+          {
+            __m256d acc = _mm256_setzero_pd();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i),
+                                          _mm256_loadu_pd(b + i));
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(w + i),
+                                                       _mm256_mul_pd(d, d)));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 2 <= n)
+          {
+            __m128d acc = _mm_setzero_pd();
+            for (; i + 2 <= n; i += 2)
+              {
+                __m128d d = _mm_sub_pd(_mm_loadu_pd(a + i),
+                                       _mm_loadu_pd(b + i));
+                acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(w + i),
+                                                 _mm_mul_pd(d, d)));
+              }
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) { double d = a[i] - b[i]; sum += w[i] * d * d; }
+        return sum;
+      }
+
+      inline float
+      weighted_sum_squares(const float* a, const float* b, const float* w,
+                           dimension_type n)
+      {
+        dimension_type i = 0;
+        float sum = 0.0f;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 16)
+          {
+            __m512 acc = _mm512_setzero_ps();
+            for (; i + 16 <= n; i += 16)
+              {
+                __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i),
+                                         _mm512_loadu_ps(b + i));
+                acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_loadu_ps(w + i),
+                                                       _mm512_mul_ps(d, d)));
+              }
+            sum += _mm512_reduce_add_ps(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 8 <= n)
+          {
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i),
+                                         _mm256_loadu_ps(b + i));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(w + i),
+                                                       _mm256_mul_ps(d, d)));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i),
+                                      _mm_loadu_ps(b + i));
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(w + i),
+                                                 _mm_mul_ps(d, d)));
+              }
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i) { float d = a[i] - b[i]; sum += w[i] * d * d; }
+        return sum;
+      }
+      ///@}
+
+      /**
+       *  Returns the sum of the absolute differences between the \c n
+       *  coordinates of \c a and \c b, each multiplied by the weight of its
+       *  dimension in \c w.
+       */
+      ///@{
+      inline double
+      weighted_sum_abs(const double* a, const double* b, const double* w,
+                       dimension_type n)
+      {
+        dimension_type i = 0;
+        double sum = 0.0;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 8)
+          {
+            __m512d acc = _mm512_setzero_pd();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m512d d = _mm512_sub_pd(_mm512_loadu_pd(a + i),
+                                          _mm512_loadu_pd(b + i));
+                acc = _mm512_add_pd(acc, _mm512_mul_pd(_mm512_loadu_pd(w + i),
+                                                       _mm512_abs_pd(d)));
+              }
+            sum += _mm512_reduce_add_pd(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 4 <= n)
+          {
+            __m256d acc = _mm256_setzero_pd();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i),
+                                          _mm256_loadu_pd(b + i));
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(w + i),
+                                                       abs(d)));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 2 <= n)
+          {
+            __m128d acc = _mm_setzero_pd();
+            for (; i + 2 <= n; i += 2)
+              {
+                __m128d d = _mm_sub_pd(_mm_loadu_pd(a + i),
+                                       _mm_loadu_pd(b + i));
+                acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(w + i),
+                                                 abs(d)));
+              }
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i)
+          sum += w[i] * (a[i] < b[i] ? b[i] - a[i] : a[i] - b[i]);
+        return sum;
+      }
+
+      inline float
+      weighted_sum_abs(const float* a, const float* b, const float* w,
+                       dimension_type n)
+      {
+        dimension_type i = 0;
+        float sum = 0.0f;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 16)
+          {
+            __m512 acc = _mm512_setzero_ps();
+            for (; i + 16 <= n; i += 16)
+              {
+                __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i),
+                                         _mm512_loadu_ps(b + i));
+                acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_loadu_ps(w + i),
+                                                       _mm512_abs_ps(d)));
+              }
+            sum += _mm512_reduce_add_ps(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 8 <= n)
+          {
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i),
+                                         _mm256_loadu_ps(b + i));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(w + i),
+                                                       abs(d)));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i),
+                                      _mm_loadu_ps(b + i));
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(w + i),
+                                                 abs(d)));
+              }
+            sum += hsum(acc);
+          }
+        for (; i < n; ++i)
+          sum += w[i] * (a[i] < b[i] ? b[i] - a[i] : a[i] - b[i]);
+        return sum;
+      }
+      ///@}
+
+      /**
+       *  Returns the sum of the squares of the differences between the \c n
+       *  coordinates of \c a and \c b, where the differences are computed
+       *  in double precision, then converted to single precision in which
+       *  they are squared and added, with twice as many lanes per register.
+       */
+      inline float
+      narrow_sum_squares(const double* a, const double* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        float sum = 0.0f;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 8)
+          {
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8)
+              {
+                __m256 d = _mm512_cvtpd_ps
+                  (_mm512_sub_pd(_mm512_loadu_pd(a + i),
+                                 _mm512_loadu_pd(b + i)));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+              }
+            sum += hsum(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m128 d = _mm256_cvtpd_ps
+                  (_mm256_sub_pd(_mm256_loadu_pd(a + i),
+                                 _mm256_loadu_pd(b + i)));
+                acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+              }
+            sum += hsum(acc);
+          }
+#else
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m128 d = _mm_movelh_ps
+                  (_mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(a + i),
+                                           _mm_loadu_pd(b + i))),
+                   _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(a + i + 2),
+                                           _mm_loadu_pd(b + i + 2))));
+                acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        for (; i < n; ++i)
+          { float d = static_cast<float>(a[i] - b[i]); sum += d * d; }
+        return sum;
+      }
+
+      /**
+       *  Returns the sum of the absolute differences between the \c n
+       *  coordinates of \c a and \c b, where the differences are computed
+       *  in double precision, then converted to single precision in which
+       *  they are added.
+       */
+      inline float
+      narrow_sum_abs(const double* a, const double* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        float sum = 0.0f;
+#if defined(SPATIAL_SIMD_AVX512F)
+        if (n >= 8)
+          {
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8)
+              acc = _mm256_add_ps(acc, abs(_mm512_cvtpd_ps
+                                           (_mm512_sub_pd
+                                            (_mm512_loadu_pd(a + i),
+                                             _mm512_loadu_pd(b + i)))));
+            sum += hsum(acc);
+          }
+#endif
+#if defined(SPATIAL_SIMD_AVX)
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              acc = _mm_add_ps(acc, abs(_mm256_cvtpd_ps
+                                        (_mm256_sub_pd
+                                         (_mm256_loadu_pd(a + i),
+                                          _mm256_loadu_pd(b + i)))));
+            sum += hsum(acc);
+          }
+#else
+        if (i + 4 <= n)
+          {
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4)
+              {
+                __m128 d = _mm_movelh_ps
+                  (_mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(a + i),
+                                           _mm_loadu_pd(b + i))),
+                   _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(a + i + 2),
+                                           _mm_loadu_pd(b + i + 2))));
+                acc = _mm_add_ps(acc, abs(d));
+              }
+            sum += hsum(acc);
+          }
+#endif
+        for (; i < n; ++i)
+          sum += static_cast<float>(a[i] < b[i] ? b[i] - a[i] : a[i] - b[i]);
+        return sum;
+      }
+
+      //! Returns the sum of the 64 bits lanes of \c x.
+      inline int64_t hsum64(__m128i x)
+      {
+        int64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), x);
+        return lanes[0] + lanes[1];
+      }
+
+      //! Adds the squares of the 32 bits lanes of \c d to the 64 bits lanes
+      //! of \c acc. The absolute values are squared as unsigned integers, so
+      //! that the square of the smallest \c int is also exact.
+      inline __m128i add_squares64(__m128i acc, __m128i d)
+      {
+        __m128i sign = _mm_srai_epi32(d, 31);
+        __m128i x = _mm_sub_epi32(_mm_xor_si128(d, sign), sign);
+        acc = _mm_add_epi64(acc, _mm_mul_epu32(x, x));
+        x = _mm_srli_epi64(x, 32);
+        return _mm_add_epi64(acc, _mm_mul_epu32(x, x));
+      }
+
+      //! Returns the 4 \c short at \c p, sign extended to 32 bits.
+      inline __m128i load4_epi16(const short* p)
+      {
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+      }
+
+#ifdef SPATIAL_SIMD_AVX2
+      inline int64_t hsum64(__m256i x)
+      {
+        return hsum64(_mm_add_epi64(_mm256_castsi256_si128(x),
+                                    _mm256_extracti128_si256(x, 1)));
+      }
+
+      inline __m256i add_squares64(__m256i acc, __m256i d)
+      {
+        __m256i x = _mm256_abs_epi32(d);
+        acc = _mm256_add_epi64(acc, _mm256_mul_epu32(x, x));
+        x = _mm256_srli_epi64(x, 32);
+        return _mm256_add_epi64(acc, _mm256_mul_epu32(x, x));
+      }
+#endif
+
+      /**
+       *  Returns the sum of the squares of the differences between the \c n
+       *  coordinates of \c a and \c b, where the differences are computed in
+       *  32 bits, and their squares are added in 64 bits.
+       */
+      ///@{
+      inline int64_t
+      wide_sum_squares(const int* a, const int* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        int64_t sum = 0;
+#if defined(SPATIAL_SIMD_AVX2)
+        if (n >= 8)
+          {
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 8 <= n; i += 8)
+              acc = add_squares64
+                (acc, _mm256_sub_epi32
+                 (_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+            sum += hsum64(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128i acc = _mm_setzero_si128();
+            for (; i + 4 <= n; i += 4)
+              acc = add_squares64
+                (acc, _mm_sub_epi32
+                 (_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+            sum += hsum64(acc);
+          }
+        for (; i < n; ++i) { int64_t d = a[i] - b[i]; sum += d * d; }
+        return sum;
+      }
+
+      inline int64_t
+      wide_sum_squares(const short* a, const short* b, dimension_type n)
+      {
+        dimension_type i = 0;
+        int64_t sum = 0;
+#if defined(SPATIAL_SIMD_AVX2)
+        if (n >= 8)
+          {
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 8 <= n; i += 8)
+              acc = add_squares64
+                (acc, _mm256_sub_epi32
+                 (_mm256_cvtepi16_epi32
+                  (_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i))),
+                  _mm256_cvtepi16_epi32
+                  (_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)))));
+            sum += hsum64(acc);
+          }
+#endif
+        if (i + 4 <= n)
+          {
+            __m128i acc = _mm_setzero_si128();
+            for (; i + 4 <= n; i += 4)
+              acc = add_squares64(acc, _mm_sub_epi32(load4_epi16(a + i),
+                                                     load4_epi16(b + i)));
+            sum += hsum64(acc);
+          }
+        for (; i < n; ++i) { int64_t d = a[i] - b[i]; sum += d * d; }
+        return sum;
+      }
+      ///@}
+    } // namespace simd
+#endif
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_SIMD_HPP
@@ -0,0 +1,221 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2014.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_skyline.hpp
+ *  Contains the definition of \ref spatial::skyline(), which finds the
+ *  elements of a container that are not dominated by any other element, in
+ *  a single traversal of the tree.
+ */
+
+#ifndef SPATIAL_SKYLINE_HPP
+#define SPATIAL_SKYLINE_HPP
+
+#include <vector>
+#include <utility> // std::pair
+#include "spatial_region.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Walks the tree once, in order, and retains the nodes that are not
+     *  dominated by any of the nodes seen so far, removing the nodes retained
+     *  earlier that are dominated by a new one.
+     *
+     *  While walking down the tree, the lowest node found on a right branch
+     *  for each dimension is kept: all nodes of the current sub-tree are
+     *  greater or equal to it along that dimension. When every dimension has
+     *  such a lower bound and one of the nodes retained dominates all of the
+     *  lower bounds together, it also dominates every node of the sub-tree,
+     *  which is skipped.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Predicate>
+    class Skyline
+    {
+    public:
+      Skyline(Rank rank, const KeyCompare& key_comp, const Predicate& pred)
+        : _rank(rank), _key_comp(key_comp), _pred(pred),
+          _low(rank(), NodePtr(0)), _bounded(0) { }
+
+      //! Walks the sub-tree of \c node, where \c dim is the dimension of
+      //! \c node.
+      void run(NodePtr node, dimension_type dim)
+      {
+        size_type top = _saved.size();
+        for (;;)
+          {
+            SPATIAL_ASSERT_CHECK(dim < _rank());
+            SPATIAL_ASSERT_CHECK(node != 0);
+            SPATIAL_ASSERT_CHECK(!header(node));
+            relative_order rel = _pred(dim, _rank(), const_key(node));
+            dimension_type child_dim = incr_dim(_rank, dim);
+            if (rel != below && node->left != 0) run(node->left, child_dim);
+            if (rel == matching
+                && match_key(_rank, const_key(node), _pred, dim))
+              offer(node);
+            if (rel == above || node->right == 0) break;
+            _saved.push_back(std::make_pair(dim, _low[dim]));
+            if (_low[dim] == 0) ++_bounded;
+            _low[dim] = node;
+            if (_bounded == _rank() && covered()) break;
+            node = node->right;
+            dim = child_dim;
+          }
+        for (size_type i = _saved.size(); i > top; --i)
+          {
+            if (_saved[i - 1].second == 0) --_bounded;
+            _low[_saved[i - 1].first] = _saved[i - 1].second;
+          }
+        _saved.resize(top);
+      }
+
+      //! Writes the iterators to the nodes retained into \c out.
+      template <typename Iterator, typename OutputIterator>
+      OutputIterator write(OutputIterator out) const
+      {
+        for (typename std::vector<NodePtr>::const_iterator i = _sky.begin();
+             i != _sky.end(); ++i)
+          { *out = Iterator(*i); ++out; }
+        return out;
+      }
+
+    private:
+      //! Compares \c a and \c b on all dimensions and tells whether \c a is
+      //! smaller than \c b on some dimension, in \c a_less, and whether \c b
+      //! is smaller than \c a on some dimension, in \c b_less.
+      template <typename Key>
+      void compare(const Key& a, const Key& b, bool& a_less,
+                   bool& b_less) const
+      {
+        a_less = b_less = false;
+        for (dimension_type dim = 0; dim < _rank() && !(a_less && b_less);
+             ++dim)
+          {
+            if (_key_comp(dim, a, b)) a_less = true;
+            else if (_key_comp(dim, b, a)) b_less = true;
+          }
+      }
+
+      //! Retains \c node unless it is dominated, and removes the nodes it
+      //! dominates. Since the nodes retained never dominate each other, \c
+      //! node cannot both be dominated and dominate a node retained.
+      void offer(NodePtr node)
+      {
+        bool sky_less, node_less;
+        for (size_type i = 0; i < _sky.size();)
+          {
+            compare(const_key(_sky[i]), const_key(node), sky_less, node_less);
+            if (sky_less && !node_less) return;
+            if (node_less && !sky_less)
+              { _sky[i] = _sky.back(); _sky.pop_back(); }
+            else ++i;
+          }
+        _sky.push_back(node);
+      }
+
+      //! Returns \c true if a node retained dominates the lower bounds of the
+      //! current sub-tree.
+      bool covered() const
+      {
+        for (typename std::vector<NodePtr>::const_iterator i = _sky.begin();
+             i != _sky.end(); ++i)
+          {
+            bool strict = false;
+            dimension_type dim = 0;
+            for (; dim < _rank(); ++dim)
+              {
+                if (_key_comp(dim, const_key(_low[dim]), const_key(*i)))
+                  break;
+                if (!strict
+                    && _key_comp(dim, const_key(*i), const_key(_low[dim])))
+                  strict = true;
+              }
+            if (dim == _rank() && strict) return true;
+          }
+        return false;
+      }
+
+      Rank _rank;
+      KeyCompare _key_comp;
+      Predicate _pred;
+      std::vector<NodePtr> _low;
+      dimension_type _bounded;
+      std::vector<std::pair<dimension_type, NodePtr> > _saved;
+      std::vector<NodePtr> _sky;
+    };
+
+    //! Deduces the iterator type written into \c out from \c end, the
+    //! result of \c container.end().
+    template <typename Container, typename Iterator, typename Predicate,
+              typename OutputIterator>
+    inline OutputIterator
+    skyline(Container& container, Iterator end, const Predicate& pred,
+            OutputIterator out)
+    {
+      Skyline<typename Iterator::node_ptr, typename Container::rank_type,
+              typename Container::key_compare, Predicate>
+        walk(container.rank(), container.key_comp(), pred);
+      walk.run(end.node->parent, 0);
+      return walk.template write<Iterator>(out);
+    }
+  } // namespace details
+
+  /**
+   *  Writes into \c out the iterators to the elements of \c container that
+   *  are not dominated by any other element, also known as the skyline or
+   *  the Pareto frontier of the container.
+   *
+   *  An element \c a dominates an element \c b if, according to the key
+   *  compare functor of the container, \c a is not greater than \c b on any
+   *  dimension, and smaller than \c b on at least one dimension; smaller
+   *  coordinates are preferred on all dimensions. In order to prefer larger
+   *  coordinates on some dimensions, define the container with a key compare
+   *  functor that reverses the comparison on these dimensions. Elements with
+   *  equal keys do not dominate each other, and are all written if they are
+   *  not dominated.
+   *
+   *  The tree is walked once and the sub-trees whose elements are all
+   *  dominated by an element already found are skipped, instead of comparing
+   *  each element of the container with every other. The elements are
+   *  written in no particular order.
+   *
+   *  When \c pred, a model of \region_predicate, is given, the skyline of the
+   *  elements that match \c pred is written instead, and the sub-trees
+   *  outside of \c pred are skipped: elements outside of \c pred do not
+   *  dominate the elements that match it.
+   *
+   *  \param container The container in which elements are searched.
+   *  \param pred A model of \region_predicate.
+   *  \param out An output iterator receiving a \c Container::iterator, or a
+   *  \c Container::const_iterator if \c container is constant, for each
+   *  element found.
+   *  \return \c out, after the last element was written.
+   */
+  ///@{
+  template <typename Container, typename OutputIterator>
+  inline OutputIterator
+  skyline(Container& container, OutputIterator out)
+  {
+    if (container.empty()) return out;
+    return details::skyline(container, container.end(), details::Any_region(),
+                            out);
+  }
+
+  template <typename Container, typename Predicate, typename OutputIterator>
+  inline OutputIterator
+  skyline(Container& container, const Predicate& pred, OutputIterator out)
+  {
+    if (container.empty()) return out;
+    return details::skyline(container, container.end(), pred, out);
+  }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_SKYLINE_HPP
@@ -0,0 +1,287 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2014.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_top_k_mapping.hpp
+ *  Contains the definition of \ref spatial::top_k_mapping() and \ref
+ *  spatial::bottom_k_mapping(), which find the elements of a container with
+ *  the k largest or smallest coordinates along a dimension, in a single
+ *  traversal of the tree.
+ */
+
+#ifndef SPATIAL_TOP_K_MAPPING_HPP
+#define SPATIAL_TOP_K_MAPPING_HPP
+
+#include <vector>
+#include <algorithm> // std::push_heap, std::pop_heap, std::sort_heap
+#include "spatial_except.hpp"
+#include "spatial_region.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Orders the nodes along the dimension \c map, such that the nodes with
+     *  the largest coordinates come first when \c top is \c true, and the
+     *  nodes with the smallest coordinates come first otherwise.
+     */
+    template <typename KeyCompare>
+    struct Mapping_better
+    {
+      Mapping_better(const KeyCompare& key_comp_, dimension_type map_,
+                     bool top_)
+        : key_comp(key_comp_), map(map_), top(top_) { }
+
+      template <typename NodePtr>
+      bool operator()(NodePtr a, NodePtr b) const
+      {
+        return top ? key_comp(map, const_key(b), const_key(a))
+          : key_comp(map, const_key(a), const_key(b));
+      }
+
+      KeyCompare key_comp;
+      dimension_type map;
+      bool top;
+    };
+
+    /**
+     *  Walks the tree once and retains the \c k nodes that come first along
+     *  the dimension \c map, in a heap whose front is the last of the nodes
+     *  retained.
+     *
+     *  On nodes whose dimension is \c map, the child on the side of the
+     *  better coordinates is walked first; the other child can only hold
+     *  nodes that are not better than the current node, and it is skipped
+     *  once the heap is full and the current node is not better than its
+     *  front.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare>
+    class K_mapping
+    {
+    public:
+      K_mapping(Rank rank, const KeyCompare& key_comp, dimension_type map,
+                size_type k, bool top)
+        : _rank(rank), _better(key_comp, map, top), _k(k)
+      { _heap.reserve(k); }
+
+      //! Walks the sub-tree of \c node, where \c dim is the dimension of
+      //! \c node.
+      void run(NodePtr node, dimension_type dim)
+      {
+        for (;;)
+          {
+            SPATIAL_ASSERT_CHECK(dim < _rank());
+            SPATIAL_ASSERT_CHECK(node != 0);
+            SPATIAL_ASSERT_CHECK(!header(node));
+            offer(node);
+            NodePtr near = _better.top ? node->right : node->left;
+            NodePtr far = _better.top ? node->left : node->right;
+            dimension_type child_dim = incr_dim(_rank, dim);
+            if (near != 0 && far != 0) run(near, child_dim);
+            else if (near != 0) { node = near; dim = child_dim; continue; }
+            if (far == 0 || (dim == _better.map && !improves(node))) return;
+            node = far;
+            dim = child_dim;
+          }
+      }
+
+      //! Walks the sub-tree of \c node, retaining only the nodes that match
+      //! \c pred, a model of \region_predicate.
+      template <typename Predicate>
+      void run(NodePtr node, dimension_type dim, const Predicate& pred)
+      {
+        for (;;)
+          {
+            SPATIAL_ASSERT_CHECK(dim < _rank());
+            SPATIAL_ASSERT_CHECK(node != 0);
+            SPATIAL_ASSERT_CHECK(!header(node));
+            relative_order rel = pred(dim, _rank(), const_key(node));
+            if (rel == matching
+                && match_key(_rank, const_key(node), pred, dim))
+              offer(node);
+            NodePtr left = (rel != below) ? node->left : 0;
+            NodePtr right = (rel != above) ? node->right : 0;
+            NodePtr near = _better.top ? right : left;
+            NodePtr far = _better.top ? left : right;
+            dimension_type child_dim = incr_dim(_rank, dim);
+            if (near != 0 && far != 0) run(near, child_dim, pred);
+            else if (near != 0) { node = near; dim = child_dim; continue; }
+            if (far == 0 || (dim == _better.map && !improves(node))) return;
+            node = far;
+            dim = child_dim;
+          }
+      }
+
+      //! Writes the iterators to the nodes retained into \c out, from the
+      //! first to the last along the dimension \c map.
+      template <typename Iterator, typename OutputIterator>
+      OutputIterator write(OutputIterator out)
+      {
+        std::sort_heap(_heap.begin(), _heap.end(), _better);
+        for (typename std::vector<NodePtr>::const_iterator i = _heap.begin();
+             i != _heap.end(); ++i)
+          { *out = Iterator(*i); ++out; }
+        return out;
+      }
+
+    private:
+      //! Returns \c true if \c node would be retained.
+      bool improves(NodePtr node) const
+      { return _heap.size() < _k || _better(node, _heap.front()); }
+
+      void offer(NodePtr node)
+      {
+        if (_heap.size() < _k)
+          {
+            _heap.push_back(node);
+            std::push_heap(_heap.begin(), _heap.end(), _better);
+          }
+        else if (_better(node, _heap.front()))
+          {
+            std::pop_heap(_heap.begin(), _heap.end(), _better);
+            _heap.back() = node;
+            std::push_heap(_heap.begin(), _heap.end(), _better);
+          }
+      }
+
+      Rank _rank;
+      Mapping_better<KeyCompare> _better;
+      size_type _k;
+      std::vector<NodePtr> _heap;
+    };
+
+    //! Deduces the iterator type written into \c out from \c end, the
+    //! result of \c container.end().
+    ///@{
+    template <typename Container, typename Iterator, typename OutputIterator>
+    inline OutputIterator
+    k_mapping(Container& container, Iterator end, dimension_type map,
+              size_type k, bool top, OutputIterator out)
+    {
+      K_mapping<typename Iterator::node_ptr, typename Container::rank_type,
+                typename Container::key_compare>
+        walk(container.rank(), container.key_comp(), map,
+             (std::min)(k, container.size()), top);
+      walk.run(end.node->parent, 0);
+      return walk.template write<Iterator>(out);
+    }
+
+    template <typename Container, typename Iterator, typename Predicate,
+              typename OutputIterator>
+    inline OutputIterator
+    k_mapping(Container& container, Iterator end, dimension_type map,
+              size_type k, bool top, const Predicate& pred,
+              OutputIterator out)
+    {
+      K_mapping<typename Iterator::node_ptr, typename Container::rank_type,
+                typename Container::key_compare>
+        walk(container.rank(), container.key_comp(), map,
+             (std::min)(k, container.size()), top);
+      walk.run(end.node->parent, 0, pred);
+      return walk.template write<Iterator>(out);
+    }
+    ///@}
+  } // namespace details
+
+  /**
+   *  Writes into \c out the iterators to the \c k elements of \c container
+   *  with the largest coordinates along the dimension \c mapping_dim, from
+   *  the largest to the smallest.
+   *
+   *  The elements are found in a single traversal of the tree, while
+   *  retaining the best \c k elements in a bounded heap. The sub-trees that
+   *  can only hold smaller coordinates than the \c k elements retained are
+   *  skipped. This is faster than iterating from \ref mapping_end(), since
+   *  each decrement of a \ref mapping_iterator walks through the tree again.
+   *  Among elements with equal coordinates, which ones are retained is
+   *  unspecified. If \c container holds fewer than \c k elements, all of them
+   *  are written.
+   *
+   *  When \c pred, a model of \region_predicate, is given, only the elements
+   *  that match \c pred are considered, and the sub-trees outside of \c pred
+   *  are skipped.
+   *
+   *  \param container The container in which elements are searched.
+   *  \param mapping_dim The dimension along which elements are compared.
+   *  \param k The number of elements to find.
+   *  \param pred A model of \region_predicate.
+   *  \param out An output iterator receiving a \c Container::iterator, or a
+   *  \c Container::const_iterator if \c container is constant, for each
+   *  element found.
+   *  \return \c out, after the last element was written.
+   *  \throw invalid_dimension If \c mapping_dim is larger than the dimension
+   *  from the rank of the container.
+   */
+  ///@{
+  template <typename Container, typename OutputIterator>
+  inline OutputIterator
+  top_k_mapping(Container& container, dimension_type mapping_dim,
+                size_type k, OutputIterator out)
+  {
+    except::check_dimension(container.dimension(), mapping_dim);
+    if (container.empty() || k == 0) return out;
+    return details::k_mapping(container, container.end(), mapping_dim, k,
+                              true, out);
+  }
+
+  template <typename Container, typename Predicate, typename OutputIterator>
+  inline OutputIterator
+  top_k_mapping(Container& container, dimension_type mapping_dim,
+                size_type k, const Predicate& pred, OutputIterator out)
+  {
+    except::check_dimension(container.dimension(), mapping_dim);
+    if (container.empty() || k == 0) return out;
+    return details::k_mapping(container, container.end(), mapping_dim, k,
+                              true, pred, out);
+  }
+  ///@}
+
+  /**
+   *  Writes into \c out the iterators to the \c k elements of \c container
+   *  with the smallest coordinates along the dimension \c mapping_dim, from
+   *  the smallest to the largest.
+   *
+   *  \see top_k_mapping()
+   *
+   *  \param container The container in which elements are searched.
+   *  \param mapping_dim The dimension along which elements are compared.
+   *  \param k The number of elements to find.
+   *  \param pred A model of \region_predicate.
+   *  \param out An output iterator receiving a \c Container::iterator, or a
+   *  \c Container::const_iterator if \c container is constant, for each
+   *  element found.
+   *  \return \c out, after the last element was written.
+   *  \throw invalid_dimension If \c mapping_dim is larger than the dimension
+   *  from the rank of the container.
+   */
+  ///@{
+  template <typename Container, typename OutputIterator>
+  inline OutputIterator
+  bottom_k_mapping(Container& container, dimension_type mapping_dim,
+                   size_type k, OutputIterator out)
+  {
+    except::check_dimension(container.dimension(), mapping_dim);
+    if (container.empty() || k == 0) return out;
+    return details::k_mapping(container, container.end(), mapping_dim, k,
+                              false, out);
+  }
+
+  template <typename Container, typename Predicate, typename OutputIterator>
+  inline OutputIterator
+  bottom_k_mapping(Container& container, dimension_type mapping_dim,
+                   size_type k, const Predicate& pred, OutputIterator out)
+  {
+    except::check_dimension(container.dimension(), mapping_dim);
+    if (container.empty() || k == 0) return out;
+    return details::k_mapping(container, container.end(), mapping_dim, k,
+                              false, pred, out);
+  }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_TOP_K_MAPPING_HPP
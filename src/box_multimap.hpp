@@ -29,11 +29,13 @@ namespace spatial
   template<dimension_type Rank, typename Key, typename Mapped,
            typename Compare = bracket_less<Key>,
            typename BalancingPolicy = loose_balancing,
-           typename Alloc = std::allocator<std::pair<const Key, Mapped> > >
+           typename Alloc = std::allocator<std::pair<const Key, Mapped> >,
+           typename Monoid = void, typename Hash = void>
   class box_multimap
     : public details::Relaxed_kdtree<details::Static_rank<Rank>, const Key,
                                      std::pair<const Key, Mapped>,
-                                     Compare, BalancingPolicy, Alloc>
+                                     Compare, BalancingPolicy, Alloc, Monoid,
+                                     Hash>
   {
   private:
     typedef typename
@@ -41,9 +43,9 @@ namespace spatial
 
     typedef details::Relaxed_kdtree
     <details::Static_rank<Rank>, const Key, std::pair<const Key, Mapped>,
-     Compare, BalancingPolicy, Alloc>         base_type;
+     Compare, BalancingPolicy, Alloc, Monoid, Hash> base_type;
     typedef box_multimap<Rank, Key, Mapped, Compare,
-                   BalancingPolicy, Alloc>    Self;
+                   BalancingPolicy, Alloc, Monoid, Hash> Self;
 
   public:
     typedef Mapped                            mapped_type;
@@ -89,18 +91,19 @@ namespace spatial
   template<typename Key, typename Mapped,
            typename Compare,
            typename BalancingPolicy,
-           typename Alloc>
-  struct box_multimap<0, Key, Mapped, Compare, BalancingPolicy, Alloc>
+           typename Alloc, typename Monoid, typename Hash>
+  struct box_multimap<0, Key, Mapped, Compare, BalancingPolicy, Alloc, Monoid,
+                      Hash>
     : details::Relaxed_kdtree<details::Dynamic_rank, const Key,
                               std::pair<const Key, Mapped>, Compare,
-                              BalancingPolicy, Alloc>
+                              BalancingPolicy, Alloc, Monoid, Hash>
   {
   private:
     typedef details::Relaxed_kdtree
     <details::Dynamic_rank, const Key, std::pair<const Key, Mapped>,
-     Compare, BalancingPolicy, Alloc>         base_type;
+     Compare, BalancingPolicy, Alloc, Monoid, Hash> base_type;
     typedef box_multimap<0, Key, Mapped, Compare,
-                   BalancingPolicy, Alloc>    Self;
+                   BalancingPolicy, Alloc, Monoid, Hash> Self;
 
   public:
     typedef Mapped                            mapped_type;
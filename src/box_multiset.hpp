@@ -34,10 +34,12 @@ namespace spatial
   template<dimension_type Rank, typename Key,
            typename Compare = bracket_less<Key>,
            typename BalancingPolicy = loose_balancing,
-           typename Alloc = std::allocator<Key> >
+           typename Alloc = std::allocator<Key>,
+           typename Monoid = void, typename Hash = void>
   class box_multiset
     : public details::Relaxed_kdtree<details::Static_rank<Rank>, const Key,
-                                     const Key, Compare, BalancingPolicy, Alloc>
+                                     const Key, Compare, BalancingPolicy,
+                                     Alloc, Monoid, Hash>
   {
   private:
     typedef typename
@@ -45,8 +47,9 @@ namespace spatial
 
     typedef details::Relaxed_kdtree
     <details::Static_rank<Rank>, const Key, const Key, Compare,
-                          BalancingPolicy, Alloc> base_type;
-    typedef box_multiset<Rank, Key, Compare, BalancingPolicy, Alloc>  Self;
+                          BalancingPolicy, Alloc, Monoid, Hash> base_type;
+    typedef box_multiset<Rank, Key, Compare, BalancingPolicy, Alloc, Monoid,
+                         Hash> Self;
 
   public:
     box_multiset() { }
@@ -90,16 +93,19 @@ namespace spatial
   template<typename Key,
            typename Compare,
            typename BalancingPolicy,
-           typename Alloc>
-  class box_multiset<0, Key, Compare, BalancingPolicy, Alloc>
+           typename Alloc, typename Monoid, typename Hash>
+  class box_multiset<0, Key, Compare, BalancingPolicy, Alloc, Monoid, Hash>
     : public details::Relaxed_kdtree<details::Dynamic_rank, const Key,
-                                     const Key, Compare, BalancingPolicy, Alloc>
+                                     const Key, Compare, BalancingPolicy,
+                                     Alloc, Monoid, Hash>
   {
   private:
     typedef details::Relaxed_kdtree<details::Dynamic_rank,
                                     const Key, const Key, Compare,
-                                    BalancingPolicy, Alloc> base_type;
-    typedef box_multiset<0, Key, Compare, BalancingPolicy, Alloc> Self;
+                                    BalancingPolicy, Alloc, Monoid, Hash>
+    base_type;
+    typedef box_multiset<0, Key, Compare, BalancingPolicy, Alloc, Monoid, Hash>
+    Self;
 
   public:
     box_multiset() : base_type(details::Dynamic_rank(2)) { }
@@ -0,0 +1,21 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   join.hpp
+ *  Provides the algorithms that pair elements close to each other, within a
+ *  container or across containers, by traversing several trees at once.
+ */
+
+#ifndef SPATIAL_JOIN_HPP
+#define SPATIAL_JOIN_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_all_neighbor.hpp"
+#include "bits/spatial_distance_join.hpp"
+
+#endif // SPATIAL_JOIN_HPP
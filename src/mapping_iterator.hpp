@@ -18,6 +18,7 @@
 #include "bits/spatial_rank.hpp"
 #include "bits/spatial_except.hpp"
 #include "bits/spatial_mapping.hpp"
+#include "bits/spatial_top_k_mapping.hpp"
 #include "bits/spatial_import_tuple.hpp"
 
 namespace spatial
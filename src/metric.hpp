@@ -16,9 +16,13 @@
 #ifndef SPATIAL_METRIC_HPP
 #define SPATIAL_METRIC_HPP
 
+#include <vector>
+#include <limits>
+#include <cmath>
 #include "function.hpp"
 #include "bits/spatial_math.hpp"
 #include "bits/spatial_builtin.hpp"
+#include "bits/spatial_except.hpp"
 
 namespace spatial
 {
@@ -81,8 +85,25 @@ namespace spatial
                     const key_type& origin, const key_type& key) const
     {
       return math::euclid_distance_to_key
-        <key_type, difference_type, DistanceType>(rank, origin, key,
-                                                  difference());
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::get(rank),
+         origin, key, difference());
+    }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::euclid_distance_to_key_bounded
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference(), bound);
     }
 
     /**
@@ -174,8 +195,25 @@ namespace spatial
                     const key_type& origin, const key_type& key) const
     {
       return math::square_euclid_distance_to_key
-        <key_type, difference_type, DistanceType>(rank, origin, key,
-                                                  difference());
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::get(rank),
+         origin, key, difference());
+    }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::square_euclid_distance_to_key_bounded
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference(), bound);
     }
 
     /**
@@ -200,6 +238,118 @@ namespace spatial
     { return *static_cast<const Diff*>(this); }
   };
 
+  /**
+   *  Defines a metric in the Euclidian space over keys with integral
+   *  coordinates, where the square of the distances are computed in a type
+   *  wider than the coordinates: \c int64_t for coordinates of type \c signed
+   *  \c char, \c short or \c int. Unlike \ref quadrance with the same type
+   *  for the distances and the coordinates, the distances stay exact without
+   *  the checks of SPATIAL_SAFER_ARITHMETICS, as long as the sum of the
+   *  squares is below 2^63.
+   *
+   *  \concept_metric
+   *
+   *  This is always the case for coordinates of at most 16 bits. For \c int
+   *  coordinates, it holds in 2 dimensions for any differences that fit in
+   *  an \c int, and in up to 8 dimensions for differences below 2^30. When
+   *  the coordinates are stored contiguously, distances between \c short or
+   *  \c int coordinates are computed with vectorized kernels.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam Unit The integral type of the coordinates.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension. The
+   *  builtin difference functors are rebound to return the differences in
+   *  the wider type.
+   */
+  template<typename Container, typename Unit, typename Diff>
+  class wide_quadrance : Diff
+  {
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, typename details::wide_integer<Unit>::type>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    /**
+     *  The distance type being used for distance calculations, wider than \c
+     *  Unit. There is no such type, and the metric does not compile, if \c
+     *  Unit is not one of \c signed \c char, \c short or \c int.
+     */
+    typedef typename details::wide_integer<Unit>::type distance_type;
+
+    //! The constructors allows you to specify a custom difference type.
+    explicit wide_quadrance(const difference_type& diff = Diff())
+      : Diff(diff) { }
+
+    //! Copy the metric from another metric with any Unit.
+    template <typename AnyUnit>
+    wide_quadrance(const wide_quadrance<Container, AnyUnit, Diff>& other)
+      : Diff(other.difference()) { }
+
+    /**
+     *  Compute the square of the distance between the point of \c origin and
+     *  the \c key.
+     *  \return The resulting square distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::wide_square_distance_to_key
+        <key_type, difference_type, distance_type>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference());
+    }
+
+    /**
+     *  Compute the square of the distance between the point of \c origin and
+     *  the \c key, but stop once it is known to be greater than \c bound.
+     *  \return The square distance if it is not greater than \c bound,
+     *  otherwise a value greater than \c bound and not greater than the
+     *  square distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::wide_square_distance_to_key_bounded
+        <key_type, difference_type, distance_type>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference(), bound);
+    }
+
+    /**
+     *  The square of the distance between the point of \c origin and the
+     *  closest point to the plane orthogonal to the axis of dimension \c dim
+     *  and crossing \c key.
+     *  \return The resulting square distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      return math::square_euclid_distance_to_plane
+        <key_type, difference_type, distance_type>(dim, origin, key,
+                                                   difference());
+    }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+  };
+
   /**
    *  Defines a metric for the a space where distances are the sum
    *  of all the elements of the vector. Also known as the taxicab metric.
@@ -267,8 +417,25 @@ namespace spatial
                     const key_type& origin, const key_type& key) const
     {
       return math::manhattan_distance_to_key
-        <key_type, difference_type, DistanceType>(rank, origin, key,
-                                                  difference());
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::get(rank),
+         origin, key, difference());
+    }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::manhattan_distance_to_key_bounded
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference(), bound);
     }
 
     /**
@@ -294,6 +461,1931 @@ namespace spatial
     { return *static_cast<const Diff*>(this); }
   };
 
+  /**
+   *  Defines a metric for a space where distances are the largest of the
+   *  absolute differences along each dimension. Also known as the
+   *  L-infinity metric, or the max-norm.
+   *
+   *  \concept_metric
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   *
+   *  This metric supports all of the C++'s arithmetic types, and the
+   *  neighbors of a key under this metric are the keys in the smallest cubes
+   *  centered on it. Its distances cannot be converted into Euclidian
+   *  distances.
+   */
+  template<typename Container, typename DistanceType, typename Diff>
+  class chebyshev : Diff
+  {
+    // Check that DistanceType is a fundamental arithmetic type
+    typedef typename enable_if<import::is_arithmetic<DistanceType> >::type
+    check_concept_distance_type_is_arithmetic;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! A constructor that allows you to specify the Difference type.
+    explicit chebyshev(const difference_type& diff = Diff()) : Diff(diff) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    chebyshev(const chebyshev<Container, AnyDistanceType, Diff>& other)
+      : Diff(other.difference()) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key.
+     *  \return The resulting chebyshev distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::chebyshev_distance_to_key
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference());
+    }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::chebyshev_distance_to_key_bounded
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference(), bound);
+    }
+
+    /**
+     *  The distance between the point of \c origin and the closest point to
+     *  the plane orthogonal to the axis of dimension \c dim and crossing \c
+     *  key. It is the absolute difference along \c dim, as with \ref
+     *  manhattan.
+     *
+     *  \return The resulting chebyshev distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      return math::manhattan_distance_to_plane
+        <key_type, difference_type, DistanceType>(dim, origin, key,
+                                                  difference());
+    }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+  };
+
+  /**
+   *  Defines a metric for a space where distances are the Minkowski
+   *  distances of order \c P: the root of order \c P of the sum of the
+   *  absolute differences along each dimension, raised to the power \c P.
+   *  The order 1 gives the same distances as \ref manhattan, and the order 2
+   *  the same distances as \ref euclidian.
+   *
+   *  \concept_metric
+   *
+   *  \attention \c This metric works on floating types only. It will fail
+   *  to compile if given non-floating types as a parameter for the distance.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   *  \tparam P The order of the distance, which must not be null.
+   *
+   *  The powers are computed by repeated multiplications, unrolled at
+   *  compile time. The roots of order 1, 2 and 4 are computed with square
+   *  roots, and the other roots with \c std::pow(). The larger \c P, the
+   *  sooner the computation overflows; see \ref chebyshev for the limit of
+   *  the distances as \c P grows.
+   */
+  template<typename Container, typename DistanceType, typename Diff,
+           unsigned int P>
+  class minkowski : Diff
+  {
+    // Check that DistanceType is a fundamental floating point type
+    typedef typename enable_if<import::is_floating_point<DistanceType> >::type
+    check_concept_distance_type_is_floating_point;
+
+    // Check that the order of the distance is not null
+    typedef typename enable_if_c<(P > 0)>::type
+    check_concept_order_is_not_null;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! A constructor that allows you to specify the Difference type.
+    explicit minkowski(const difference_type& diff = Diff()) : Diff(diff) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    minkowski(const minkowski<Container, AnyDistanceType, Diff, P>& other)
+      : Diff(other.difference()) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::minkowski_distance_to_key
+        <key_type, difference_type, DistanceType, P>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference());
+    }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::minkowski_distance_to_key_bounded
+        <key_type, difference_type, DistanceType, P>
+        (details::Rank_argument<typename Container::rank_type>::make(rank),
+         origin, key, difference(), bound);
+    }
+
+    /**
+     *  The distance between the point of \c origin and the closest point to
+     *  the plane orthogonal to the axis of dimension \c dim and crossing \c
+     *  key. It is the absolute difference along \c dim, whatever \c P.
+     *
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      return math::minkowski_distance_to_plane
+        <key_type, difference_type, DistanceType, P>(dim, origin, key,
+                                                     difference());
+    }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+  };
+
+  /**
+   *  Defines a metric on a sphere, such as the Earth, where the keys are
+   *  points given by their latitude along dimension 0 and their longitude
+   *  along dimension 1, in degrees, and distances are the lengths of the
+   *  shortest arcs of great circles between them, in one of C++'s floating
+   *  point types.
+   *
+   *  \concept_metric
+   *
+   *  \attention \c This metric works on floating types only. It will fail
+   *  to compile if given non-floating types as a parameter for the distance.
+   *
+   *  Latitudes must be between -90 and 90 degrees, and longitudes between
+   *  -180 and 180 degrees; the neighbors of a key are found across the poles
+   *  and the antimeridian. Other dimensions of the keys, if any, are ignored.
+   *  The distances are computed with the haversine formula, in a form that
+   *  stays accurate for nearly antipodal points.
+   *
+   *  Unlike the other metrics, the coordinates of the keys are needed, and
+   *  not only their differences: \c Diff must be one of the builtin
+   *  difference functors, or provide a member \c coordinate(dim, key)
+   *  returning the coordinate of \c key along \c dim.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   */
+  template<typename Container, typename DistanceType, typename Diff>
+  class great_circle : Diff
+  {
+    // Check that DistanceType is a fundamental floating point type
+    typedef typename enable_if<import::is_floating_point<DistanceType> >::type
+    check_concept_distance_type_is_floating_point;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    /**
+     *  Builds a metric on a sphere of the given \c radius, and an optional
+     *  custom difference type. With the default radius, distances are
+     *  angles in radians.
+     *  \throws invalid_distance if \c radius is negative.
+     */
+    explicit great_circle(distance_type radius = distance_type(1),
+                          const difference_type& diff = Diff())
+      : Diff(diff), _radius(radius)
+    { except::check_positive_distance(radius); }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    great_circle(const great_circle<Container, AnyDistanceType, Diff>& other)
+      : Diff(other.difference()),
+        _radius(static_cast<distance_type>(other.radius())) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_key(dimension_type,
+                    const key_type& origin, const key_type& key) const
+    {
+      return _radius * math::great_circle_distance_to_key
+        <key_type, difference_type, DistanceType>(origin, key, difference());
+    }
+
+    /**
+     *  A lower bound of the distance between the point of \c origin and the
+     *  points whose coordinate along \c dim is on the other side of \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      return _radius * math::great_circle_distance_to_plane
+        <key_type, difference_type, DistanceType>(dim, origin, key,
+                                                  difference());
+    }
+
+    //! Returns the radius of the sphere.
+    distance_type radius() const { return _radius; }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+
+  private:
+    distance_type _radius;
+  };
+
+  /**
+   *  Defines a metric on a sphere which approximates \ref great_circle with
+   *  the equirectangular projection centered on the origin of the search:
+   *  the differences of longitude are scaled by the cosine of the latitude
+   *  of the origin, and distances are measured as in a plane, with a single
+   *  trigonometric function per distance.
+   *
+   *  \concept_metric
+   *
+   *  The approximation is good for distances that are small compared to the
+   *  radius of the sphere, away from the poles, which is the common case of
+   *  nearest neighbor searches. Since the projection depends on the origin,
+   *  the distance from \c a to \c b differs in general from the distance
+   *  from \c b to \c a. Keys and difference functors are used as with \ref
+   *  great_circle.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   */
+  template<typename Container, typename DistanceType, typename Diff>
+  class equirectangular : Diff
+  {
+    // Check that DistanceType is a fundamental floating point type
+    typedef typename enable_if<import::is_floating_point<DistanceType> >::type
+    check_concept_distance_type_is_floating_point;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    /**
+     *  Builds a metric on a sphere of the given \c radius, and an optional
+     *  custom difference type. With the default radius, distances are
+     *  angles in radians.
+     *  \throws invalid_distance if \c radius is negative.
+     */
+    explicit equirectangular(distance_type radius = distance_type(1),
+                             const difference_type& diff = Diff())
+      : Diff(diff), _radius(radius)
+    { except::check_positive_distance(radius); }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    equirectangular
+    (const equirectangular<Container, AnyDistanceType, Diff>& other)
+      : Diff(other.difference()),
+        _radius(static_cast<distance_type>(other.radius())) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_key(dimension_type,
+                    const key_type& origin, const key_type& key) const
+    {
+      return _radius * math::equirectangular_distance_to_key
+        <key_type, difference_type, DistanceType>(origin, key, difference());
+    }
+
+    /**
+     *  A lower bound of the distance between the point of \c origin and the
+     *  points whose coordinate along \c dim is on the other side of \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      return _radius * math::equirectangular_distance_to_plane
+        <key_type, difference_type, DistanceType>(dim, origin, key,
+                                                  difference());
+    }
+
+    //! Returns the radius of the sphere.
+    distance_type radius() const { return _radius; }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+
+  private:
+    distance_type _radius;
+  };
+
+  /**
+   *  Defines a metric for containers of boxes, such as \box_multiset or
+   *  \box_multimap, giving the euclidian distance between a point and the
+   *  closest point of each box, in one of C++'s floating point types.
+   *
+   *  \concept_metric
+   *
+   *  The point is given as a box whose lower and higher coordinates are
+   *  equal, and the distance is null when the point is inside the box. The
+   *  metrics \ref euclidian, \ref quadrance and \ref manhattan would instead
+   *  treat the boxes as points with twice as many dimensions.
+   *
+   *  More generally, when the target box is not reduced to a point, the
+   *  distance measures by how much each box falls short of enclosing the
+   *  target box, and is null when the box encloses the target box.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   *  \tparam Layout One of \ref llhh_layout_tag, \ref lhlh_layout_tag, \ref
+   *  hhll_layout_tag or \ref hlhl_layout_tag.
+   */
+  template<typename Container, typename DistanceType, typename Diff,
+           typename Layout = llhh_layout_tag>
+  class box_euclidian : Diff
+  {
+    // Check that DistanceType is a fundamental floating point type
+    typedef typename enable_if<import::is_floating_point<DistanceType> >::type
+    check_concept_distance_type_is_floating_point;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! The constructors allows you to specify a custom difference type.
+    explicit box_euclidian(const difference_type& diff = Diff())
+      : Diff(diff) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    box_euclidian
+    (const box_euclidian<Container, AnyDistanceType, Diff, Layout>& other)
+      : Diff(other.difference()) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the closest
+     *  point of the box \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return std::sqrt(math::square_box_distance_to_key
+                       <key_type, difference_type, DistanceType>
+                       (rank, origin, key, difference(), Layout()));
+    }
+
+    /**
+     *  A lower bound of the distance between the point of \c origin and the
+     *  boxes whose coordinate along \c dim is on the other side of \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type rank, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      return math::box_gap_to_plane
+        <key_type, difference_type, DistanceType>(rank, dim, origin, key,
+                                                  difference(), Layout());
+    }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+  };
+
+  /**
+   *  Defines a metric for containers of boxes giving the square of the
+   *  euclidian distance between a point and the closest point of each box,
+   *  in any of C++'s arithmetic types.
+   *
+   *  \concept_metric
+   *
+   *  This metric relates to \ref box_euclidian as \ref quadrance relates to
+   *  \ref euclidian; see \ref box_euclidian for the interpretation of the
+   *  keys.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   *  \tparam Layout One of \ref llhh_layout_tag, \ref lhlh_layout_tag, \ref
+   *  hhll_layout_tag or \ref hlhl_layout_tag.
+   */
+  template<typename Container, typename DistanceType, typename Diff,
+           typename Layout = llhh_layout_tag>
+  class box_quadrance : Diff
+  {
+    // Check that DistanceType is a fundamental arithmetic type
+    typedef typename enable_if<import::is_arithmetic<DistanceType> >::type
+    check_concept_distance_type_is_arithmetic;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! The constructor allows you to specify a custom difference type.
+    explicit box_quadrance(const difference_type& diff = Diff())
+      : Diff(diff) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    box_quadrance
+    (const box_quadrance<Container, AnyDistanceType, Diff, Layout>& other)
+      : Diff(other.difference()) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the closest
+     *  point of the box \c key.
+     *  \return The resulting square distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::square_box_distance_to_key
+        <key_type, difference_type, DistanceType>(rank, origin, key,
+                                                  difference(), Layout());
+    }
+
+    /**
+     *  A lower bound of the distance between the point of \c origin and the
+     *  boxes whose coordinate along \c dim is on the other side of \c key.
+     *  \return The resulting square distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type rank, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      DistanceType d = math::box_gap_to_plane
+        <key_type, difference_type, DistanceType>(rank, dim, origin, key,
+                                                  difference(), Layout());
+#ifdef SPATIAL_SAFER_ARITHMETICS
+      return except::check_square(d);
+#else
+      return d * d;
+#endif
+    }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+  };
+
+  /**
+   *  Defines a metric for containers of boxes giving the manhattan distance
+   *  between a point and the closest point of each box, in any of C++'s
+   *  arithmetic types.
+   *
+   *  \concept_metric
+   *
+   *  This metric relates to \ref box_euclidian as \ref manhattan relates to
+   *  \ref euclidian; see \ref box_euclidian for the interpretation of the
+   *  keys.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   *  \tparam Layout One of \ref llhh_layout_tag, \ref lhlh_layout_tag, \ref
+   *  hhll_layout_tag or \ref hlhl_layout_tag.
+   */
+  template<typename Container, typename DistanceType, typename Diff,
+           typename Layout = llhh_layout_tag>
+  class box_manhattan : Diff
+  {
+    // Check that DistanceType is a fundamental arithmetic type
+    typedef typename enable_if<import::is_arithmetic<DistanceType> >::type
+    check_concept_distance_type_is_arithmetic;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! A constructor that allows you to specify the Difference type.
+    explicit box_manhattan(const difference_type& diff = Diff())
+      : Diff(diff) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    box_manhattan
+    (const box_manhattan<Container, AnyDistanceType, Diff, Layout>& other)
+      : Diff(other.difference()) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the closest
+     *  point of the box \c key.
+     *  \return The resulting manhattan distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::manhattan_box_distance_to_key
+        <key_type, difference_type, DistanceType>(rank, origin, key,
+                                                  difference(), Layout());
+    }
+
+    /**
+     *  A lower bound of the distance between the point of \c origin and the
+     *  boxes whose coordinate along \c dim is on the other side of \c key.
+     *  \return The resulting manhattan distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type rank, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      return math::box_gap_to_plane
+        <key_type, difference_type, DistanceType>(rank, dim, origin, key,
+                                                  difference(), Layout());
+    }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+  };
+
+  namespace details
+  {
+    /**
+     *  Stores the weights of a weighted metric, or the periods of a \ref
+     *  periodic metric, one per dimension of the container. For a
+     *  \dynamic_rank, the weights are kept in a vector.
+     */
+    template <typename Rank, typename DistanceType>
+    class Weights
+    {
+    public:
+      Weights() : _weights() { }
+
+      //! Copies the weights in [\c first, \c last), which must not be
+      //! empty nor negative.
+      template <typename InputIterator>
+      Weights(InputIterator first, InputIterator last)
+        : _weights(first, last)
+      {
+        except::check_rank(size());
+        for (dimension_type i = 0; i < size(); ++i)
+          except::check_positive_distance(_weights[i]);
+      }
+
+      //! Returns the square roots of the weights.
+      Weights root() const
+      {
+        Weights other;
+        other._weights.reserve(_weights.size());
+        for (dimension_type i = 0; i < size(); ++i)
+          other._weights.push_back(std::sqrt(_weights[i]));
+        return other;
+      }
+
+      dimension_type size() const
+      { return static_cast<dimension_type>(_weights.size()); }
+
+      const DistanceType* begin() const { return data(); }
+      const DistanceType* end() const { return data() + size(); }
+
+      const DistanceType* data() const
+      { return _weights.empty() ? 0 : &_weights[0]; }
+
+      const DistanceType& operator[](dimension_type dim) const
+      { return _weights[dim]; }
+
+    private:
+      std::vector<DistanceType> _weights;
+    };
+
+    /**
+     *  For a \static_rank, the weights are kept in an array inside the
+     *  metric, and are all 1 unless given.
+     */
+    template <dimension_type Rank, typename DistanceType>
+    class Weights<Static_rank<Rank>, DistanceType>
+    {
+    public:
+      Weights()
+      {
+        for (dimension_type i = 0; i < Rank; ++i)
+          _weights[i] = DistanceType(1);
+      }
+
+      template <typename InputIterator>
+      Weights(InputIterator first, InputIterator last)
+      {
+        dimension_type count = 0;
+        for (; first != last; ++first, ++count)
+          if (count < Rank) _weights[count] = *first;
+        except::check_same_rank(Rank, count);
+        for (dimension_type i = 0; i < Rank; ++i)
+          except::check_positive_distance(_weights[i]);
+      }
+
+      Weights root() const
+      {
+        Weights other;
+        for (dimension_type i = 0; i < Rank; ++i)
+          other._weights[i] = std::sqrt(_weights[i]);
+        return other;
+      }
+
+      dimension_type size() const { return Rank; }
+
+      const DistanceType* begin() const { return _weights; }
+      const DistanceType* end() const { return _weights + Rank; }
+      const DistanceType* data() const { return _weights; }
+
+      const DistanceType& operator[](dimension_type dim) const
+      { return _weights[dim]; }
+
+    private:
+      DistanceType _weights[Rank];
+    };
+  } // namespace details
+
+  /**
+   *  Defines a metric working on the Euclidian space where each dimension is
+   *  scaled by a weight, and distances are expressed in one of C++'s
+   *  floating point types. The distance between 2 keys \c a and \c b is
+   *  the square root of the sum of <tt>w[i] * (a[i] - b[i])^2</tt> over all
+   *  dimensions \c i. This is also the Mahalanobis distance for a diagonal
+   *  covariance matrix, with weights that are the inverse of the variances.
+   *
+   *  \concept_metric
+   *
+   *  The weights are given when the metric is built, one for each dimension
+   *  of the container, and must not be negative. For a \static_rank, they
+   *  are stored in the metric itself.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   */
+  template<typename Container, typename DistanceType, typename Diff>
+  class weighted_euclidian : Diff
+  {
+    // Check that DistanceType is a fundamental floating point type
+    typedef typename enable_if<import::is_floating_point<DistanceType> >::type
+    check_concept_distance_type_is_floating_point;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+    //! The rank_type of the container being used for calculations.
+    typedef typename Container::rank_type rank_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! The weights of the dimensions, one per dimension of the container.
+    typedef details::Weights<rank_type, DistanceType> weights_type;
+
+    /**
+     *  Builds a metric whose weights are all 1 for a \static_rank, and that
+     *  has no weights otherwise. It must be assigned a metric with weights
+     *  before it is used with a container of \dynamic_rank.
+     */
+    weighted_euclidian() : Diff(), _weight(), _root(_weight.root()) { }
+
+    /**
+     *  Builds a metric with the weights in [\c first, \c last), one for each
+     *  dimension of the container, in order, and an optional custom
+     *  difference type.
+     *  \throws invalid_rank if the number of weights does not match the rank
+     *  of a \static_rank.
+     *  \throws invalid_distance if a weight is negative.
+     */
+    template <typename InputIterator>
+    weighted_euclidian(InputIterator first, InputIterator last,
+                       const difference_type& diff = Diff())
+      : Diff(diff), _weight(first, last), _root(_weight.root()) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    weighted_euclidian
+    (const weighted_euclidian<Container, AnyDistanceType, Diff>& other)
+      : Diff(other.difference()),
+        _weight(other.weights().begin(), other.weights().end()),
+        _root(_weight.root()) { }
+
+    /**
+     *  Compute the weighted distance between the point of \c origin and the
+     *  \c key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::weighted_euclid_distance_to_key
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<rank_type>::make(rank),
+         origin, key, difference(), _weight.data());
+    }
+
+    /**
+     *  Compute the weighted distance between the point of \c origin and the
+     *  \c key, but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::weighted_euclid_distance_to_key_bounded
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<rank_type>::make(rank),
+         origin, key, difference(), _weight.data(), bound);
+    }
+
+    /**
+     *  The weighted distance between the point of \c origin and the closest
+     *  point to the plane orthogonal to the axis of dimension \c dim and
+     *  crossing \c key: the distance to the plane along \c dim, scaled in
+     *  the same way as the term of \c dim in the distance to a key, so that
+     *  it is never greater than the distance to any key on the plane.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      DistanceType d = math::euclid_distance_to_plane
+        <key_type, difference_type, DistanceType>(dim, origin, key,
+                                                  difference());
+#ifdef SPATIAL_SAFER_ARITHMETICS
+      return except::check_positive_mul(_root[dim], d);
+#else
+      return _root[dim] * d;
+#endif
+    }
+
+    //! Returns the weights of the dimensions.
+    const weights_type& weights() const { return _weight; }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+
+  private:
+    weights_type _weight;
+    details::Weights<rank_type, DistanceType> _root;
+  };
+
+  /**
+   *  Defines a metric in the Euclidian space where each dimension is scaled
+   *  by a weight, and only the square of the distances are being computed
+   *  into a scalar value expressed with the DistanceType which is one of
+   *  C++'s arithmetic types. It relates to \ref weighted_euclidian as \ref
+   *  quadrance relates to \ref euclidian.
+   *
+   *  \concept_metric
+   *
+   *  The weights are given when the metric is built, one for each dimension
+   *  of the container, and must not be negative.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   */
+  template<typename Container, typename DistanceType, typename Diff>
+  class weighted_quadrance : Diff
+  {
+    // Check that DistanceType is a fundamental arithmetic type
+    typedef typename enable_if<import::is_arithmetic<DistanceType> >::type
+    check_concept_distance_type_is_arithmetic;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+    //! The rank_type of the container being used for calculations.
+    typedef typename Container::rank_type rank_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! The weights of the dimensions, one per dimension of the container.
+    typedef details::Weights<rank_type, DistanceType> weights_type;
+
+    /**
+     *  Builds a metric whose weights are all 1 for a \static_rank, and that
+     *  has no weights otherwise. It must be assigned a metric with weights
+     *  before it is used with a container of \dynamic_rank.
+     */
+    weighted_quadrance() : Diff() { }
+
+    /**
+     *  Builds a metric with the weights in [\c first, \c last), one for each
+     *  dimension of the container, in order, and an optional custom
+     *  difference type.
+     *  \throws invalid_rank if the number of weights does not match the rank
+     *  of a \static_rank.
+     *  \throws invalid_distance if a weight is negative.
+     */
+    template <typename InputIterator>
+    weighted_quadrance(InputIterator first, InputIterator last,
+                       const difference_type& diff = Diff())
+      : Diff(diff), _weight(first, last) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    weighted_quadrance
+    (const weighted_quadrance<Container, AnyDistanceType, Diff>& other)
+      : Diff(other.difference()),
+        _weight(other.weights().begin(), other.weights().end())
+    { }
+
+    /**
+     *  Compute the weighted distance between the point of \c origin and the
+     *  \c key.
+     *  \return The resulting square distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::weighted_square_euclid_distance_to_key
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<rank_type>::make(rank),
+         origin, key, difference(), _weight.data());
+    }
+
+    /**
+     *  Compute the weighted distance between the point of \c origin and the
+     *  \c key, but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::weighted_square_euclid_distance_to_key_bounded
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<rank_type>::make(rank),
+         origin, key, difference(), _weight.data(), bound);
+    }
+
+    /**
+     *  The weighted distance between the point of \c origin and the closest
+     *  point to the plane orthogonal to the axis of dimension \c dim and
+     *  crossing \c key: the distance to the plane along \c dim, scaled in
+     *  the same way as the term of \c dim in the distance to a key, so that
+     *  it is never greater than the distance to any key on the plane.
+     *  \return The resulting square distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      DistanceType d = math::square_euclid_distance_to_plane
+        <key_type, difference_type, DistanceType>(dim, origin, key,
+                                                  difference());
+#ifdef SPATIAL_SAFER_ARITHMETICS
+      return except::check_positive_mul(_weight[dim], d);
+#else
+      return _weight[dim] * d;
+#endif
+    }
+
+    //! Returns the weights of the dimensions.
+    const weights_type& weights() const { return _weight; }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+
+  private:
+    weights_type _weight;
+  };
+
+  /**
+   *  Defines a metric for a space where distances are the sum of the
+   *  absolute differences along each dimension, each multiplied by the
+   *  weight of its dimension, expressed in any of C++'s arithmetic types.
+   *
+   *  \concept_metric
+   *
+   *  The weights are given when the metric is built, one for each dimension
+   *  of the container, and must not be negative.
+   *
+   *  \tparam Container The container used with this metric.
+   *  \tparam DistanceType The type used to compute distance values.
+   *  \tparam Diff A difference functor that compute the difference between 2
+   *  elements of a the Container's key type, along the same dimension.
+   */
+  template<typename Container, typename DistanceType, typename Diff>
+  class weighted_manhattan : Diff
+  {
+    // Check that DistanceType is a fundamental arithmetic type
+    typedef typename enable_if<import::is_arithmetic<DistanceType> >::type
+    check_concept_distance_type_is_arithmetic;
+
+  public:
+    /**
+     *  The type used to compute the difference between 2 keys along the same
+     *  dimension.
+     */
+    typedef typename details::rebind_builtin_difference
+    <Diff, DistanceType>::type difference_type;
+
+  private:
+    /**
+     *  The key_type of the container being used for calculations.
+     */
+    typedef typename Container::key_type key_type;
+
+    //! The rank_type of the container being used for calculations.
+    typedef typename Container::rank_type rank_type;
+
+  public:
+    typedef DistanceType distance_type;
+
+    //! The weights of the dimensions, one per dimension of the container.
+    typedef details::Weights<rank_type, DistanceType> weights_type;
+
+    /**
+     *  Builds a metric whose weights are all 1 for a \static_rank, and that
+     *  has no weights otherwise. It must be assigned a metric with weights
+     *  before it is used with a container of \dynamic_rank.
+     */
+    weighted_manhattan() : Diff() { }
+
+    /**
+     *  Builds a metric with the weights in [\c first, \c last), one for each
+     *  dimension of the container, in order, and an optional custom
+     *  difference type.
+     *  \throws invalid_rank if the number of weights does not match the rank
+     *  of a \static_rank.
+     *  \throws invalid_distance if a weight is negative.
+     */
+    template <typename InputIterator>
+    weighted_manhattan(InputIterator first, InputIterator last,
+                       const difference_type& diff = Diff())
+      : Diff(diff), _weight(first, last) { }
+
+    //! Copy the metric from another metric with any DistanceType.
+    template <typename AnyDistanceType>
+    weighted_manhattan
+    (const weighted_manhattan<Container, AnyDistanceType, Diff>& other)
+      : Diff(other.difference()),
+        _weight(other.weights().begin(), other.weights().end())
+    { }
+
+    /**
+     *  Compute the weighted distance between the point of \c origin and the
+     *  \c key.
+     *  \return The resulting manhattan distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    {
+      return math::weighted_manhattan_distance_to_key
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<rank_type>::make(rank),
+         origin, key, difference(), _weight.data());
+    }
+
+    /**
+     *  Compute the weighted distance between the point of \c origin and the
+     *  \c key, but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      return math::weighted_manhattan_distance_to_key_bounded
+        <key_type, difference_type, DistanceType>
+        (details::Rank_argument<rank_type>::make(rank),
+         origin, key, difference(), _weight.data(), bound);
+    }
+
+    /**
+     *  The weighted distance between the point of \c origin and the closest
+     *  point to the plane orthogonal to the axis of dimension \c dim and
+     *  crossing \c key: the distance to the plane along \c dim, scaled in
+     *  the same way as the term of \c dim in the distance to a key, so that
+     *  it is never greater than the distance to any key on the plane.
+     *  \return The resulting manhattan distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      DistanceType d = math::manhattan_distance_to_plane
+        <key_type, difference_type, DistanceType>(dim, origin, key,
+                                                  difference());
+#ifdef SPATIAL_SAFER_ARITHMETICS
+      return except::check_positive_mul(_weight[dim], d);
+#else
+      return _weight[dim] * d;
+#endif
+    }
+
+    //! Returns the weights of the dimensions.
+    const weights_type& weights() const { return _weight; }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const
+    { return *static_cast<const Diff*>(this); }
+
+  private:
+    weights_type _weight;
+  };
+
+  namespace details
+  {
+    /**
+     *  A difference functor returning the minimum image of the difference
+     *  of another functor: the difference is moved by one period when it
+     *  is larger than half of the period, in absolute value. It points to
+     *  the periods of a \ref periodic metric and only lives for the time of
+     *  a computation.
+     */
+    template <typename Diff, typename Unit>
+    class Periodic_minus
+    {
+    public:
+      Periodic_minus(const Diff& diff, const Unit* period)
+        : _diff(diff), _period(period) { }
+
+      template <typename Key>
+      Unit operator()(dimension_type dim, const Key& x, const Key& y) const
+      {
+        Unit d = _diff(dim, x, y);
+        if (d + d > _period[dim]) return d - _period[dim];
+        if (-(d + d) > _period[dim]) return d + _period[dim];
+        return d;
+      }
+
+    private:
+      Diff _diff;
+      const Unit* _period;
+    };
+
+    /**
+     *  A difference functor that returns the same value for all keys, used
+     *  to convert a gap along one dimension into the distance to a plane of
+     *  another metric.
+     */
+    template <typename Unit>
+    class Constant_minus
+    {
+    public:
+      explicit Constant_minus(Unit value) : _value(value) { }
+
+      template <typename Key>
+      Unit operator()(dimension_type, const Key&, const Key&) const
+      { return _value; }
+
+    private:
+      Unit _value;
+    };
+
+    /**
+     *  Gives, in \c type, the metric \c Metric with its difference functor
+     *  replaced by \c Diff, and in \c container_type, the container of \c
+     *  Metric. It is specialized for the metrics whose distances only depend
+     *  on the differences between the keys, which can be used with \ref
+     *  periodic.
+     */
+    template <typename Metric, typename Diff>
+    struct rebind_metric_difference { };
+
+    template <typename Ct, typename DistanceType, typename AnyDiff,
+              typename Diff>
+    struct rebind_metric_difference<euclidian<Ct, DistanceType, AnyDiff>,
+                                    Diff>
+    {
+      typedef Ct container_type;
+      typedef euclidian<Ct, DistanceType, Diff> type;
+    };
+
+    template <typename Ct, typename DistanceType, typename AnyDiff,
+              typename Diff>
+    struct rebind_metric_difference<quadrance<Ct, DistanceType, AnyDiff>,
+                                    Diff>
+    {
+      typedef Ct container_type;
+      typedef quadrance<Ct, DistanceType, Diff> type;
+    };
+
+    template <typename Ct, typename DistanceType, typename AnyDiff,
+              typename Diff>
+    struct rebind_metric_difference<manhattan<Ct, DistanceType, AnyDiff>,
+                                    Diff>
+    {
+      typedef Ct container_type;
+      typedef manhattan<Ct, DistanceType, Diff> type;
+    };
+
+    template <typename Ct, typename DistanceType, typename AnyDiff,
+              typename Diff>
+    struct rebind_metric_difference<chebyshev<Ct, DistanceType, AnyDiff>,
+                                    Diff>
+    {
+      typedef Ct container_type;
+      typedef chebyshev<Ct, DistanceType, Diff> type;
+    };
+
+    template <typename Ct, typename DistanceType, typename AnyDiff,
+              unsigned int P, typename Diff>
+    struct rebind_metric_difference
+    <minkowski<Ct, DistanceType, AnyDiff, P>, Diff>
+    {
+      typedef Ct container_type;
+      typedef minkowski<Ct, DistanceType, Diff, P> type;
+    };
+  } // namespace details
+
+  /**
+   *  Defines a metric on a box with periodic boundaries, such as the
+   *  simulation boxes of molecular dynamics: the box wraps around along each
+   *  dimension, and the distance between 2 keys is the distance given by \c
+   *  Metric between the nearest images of the keys, also known as the
+   *  minimum image convention. The neighbors of a key are found across the
+   *  boundaries of the box, without inserting ghost copies of the elements
+   *  near the boundaries in the container.
+   *
+   *  \concept_metric
+   *
+   *  \c Metric must be one of \ref euclidian, \ref quadrance, \ref manhattan,
+   *  \ref chebyshev or \ref minkowski. The periods of the box are given when
+   *  the metric is built, one for each dimension of the container, and the
+   *  coordinates of the keys along each dimension \c i must be in <tt>[0,
+   *  period[i])</tt>. As for \ref great_circle, the coordinates of the keys
+   *  are read with \c Diff.
+   *
+   *  \tparam Metric The metric used between the nearest images of the keys.
+   */
+  template <typename Metric>
+  class periodic
+  {
+  public:
+    typedef typename Metric::distance_type distance_type;
+    typedef typename Metric::difference_type difference_type;
+
+  private:
+    typedef typename details::rebind_metric_difference
+    <Metric, difference_type>::container_type container_type;
+
+    //! The key_type of the container being used for calculations.
+    typedef typename container_type::key_type key_type;
+
+    //! The rank_type of the container being used for calculations.
+    typedef typename container_type::rank_type rank_type;
+
+    //! The metric computing the distances between the nearest images.
+    typedef typename details::rebind_metric_difference
+    <Metric, details::Periodic_minus<difference_type, distance_type> >::type
+    image_metric;
+
+    //! The metric converting a gap along a dimension into a distance.
+    typedef typename details::rebind_metric_difference
+    <Metric, details::Constant_minus<distance_type> >::type gap_metric;
+
+  public:
+    //! The periods of the box, one per dimension of the container.
+    typedef details::Weights<rank_type, distance_type> periods_type;
+
+    /**
+     *  Builds a metric whose periods are all 1 for a \static_rank, and that
+     *  has no periods otherwise. It must be assigned a metric with periods
+     *  before it is used with a container of \dynamic_rank.
+     */
+    periodic() : _metric(), _period() { }
+
+    /**
+     *  Builds a metric with the periods in [\c first, \c last), one for each
+     *  dimension of the container, in order, and an optional \c metric
+     *  holding a custom difference type.
+     *  \throws invalid_rank if the number of periods does not match the rank
+     *  of a \static_rank.
+     *  \throws invalid_distance if a period is negative.
+     */
+    template <typename InputIterator>
+    periodic(InputIterator first, InputIterator last,
+             const Metric& metric = Metric())
+      : _metric(metric), _period(first, last) { }
+
+    /**
+     *  Compute the distance between the nearest images of \c origin and \c
+     *  key.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    { return image().distance_to_key(rank, origin, key); }
+
+    /**
+     *  Compute the distance between the nearest images of \c origin and \c
+     *  key, but stop once it is known to be greater than \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    { return image().distance_to_key_bounded(rank, origin, key, bound); }
+
+    /**
+     *  A lower bound of the distance between the point of \c origin and the
+     *  points whose coordinate along \c dim is on the other side of \c key.
+     *  Since the box wraps around, these points are either beyond the plane
+     *  crossing \c key, or beyond the boundary of the box behind \c origin,
+     *  whichever is closer.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type rank, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    {
+      difference_type diff = difference();
+      distance_type gap = diff(dim, key, origin);
+      distance_type coord
+        = details::coordinate<distance_type>(diff, dim, origin);
+      distance_type wrap;
+      if (gap > distance_type()) wrap = coord;
+      else { gap = -gap; wrap = _period[dim] - coord; }
+      if (wrap < gap) gap = wrap;
+      if (gap < distance_type()) gap = distance_type();
+      return gap_metric(details::Constant_minus<distance_type>(gap))
+        .distance_to_plane(rank, dim, origin, key);
+    }
+
+    //! Returns the periods of the box.
+    const periods_type& periods() const { return _period; }
+
+    //! Returns the metric used between the nearest images of the keys.
+    const Metric& metric() const { return _metric; }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const { return _metric.difference(); }
+
+  private:
+    image_metric image() const
+    {
+      return image_metric(details::Periodic_minus
+                          <difference_type, distance_type>
+                          (difference(), _period.data()));
+    }
+
+    Metric _metric;
+    periods_type _period;
+  };
+
+  namespace details
+  {
+    /**
+     *  Computes an estimate of the distance given by \c Metric, in the
+     *  narrower floating point type \c Narrow, within <tt>(rank + 3) *
+     *  epsilon</tt> of the distance, relatively, when the estimate is a
+     *  normal value of \c Narrow. It is specialized for the metrics that can
+     *  be used with \ref mixed_precision.
+     */
+    template <typename Metric>
+    struct narrow_distance { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct narrow_distance<euclidian<Ct, DistanceType, Diff> >
+    {
+      template <typename Narrow, typename Rank, typename Key,
+                typename Difference>
+      static Narrow estimate(Rank rank, const Key& origin, const Key& key,
+                             Difference diff)
+      {
+        return std::sqrt(math::narrow_square_sum_to_key
+                         <Key, Difference, DistanceType, Narrow>
+                         (rank, origin, key, diff));
+      }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct narrow_distance<quadrance<Ct, DistanceType, Diff> >
+    {
+      template <typename Narrow, typename Rank, typename Key,
+                typename Difference>
+      static Narrow estimate(Rank rank, const Key& origin, const Key& key,
+                             Difference diff)
+      {
+        return math::narrow_square_sum_to_key
+          <Key, Difference, DistanceType, Narrow>(rank, origin, key, diff);
+      }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct narrow_distance<manhattan<Ct, DistanceType, Diff> >
+    {
+      template <typename Narrow, typename Rank, typename Key,
+                typename Difference>
+      static Narrow estimate(Rank rank, const Key& origin, const Key& key,
+                             Difference diff)
+      {
+        return math::narrow_manhattan_sum_to_key
+          <Key, Difference, DistanceType, Narrow>(rank, origin, key, diff);
+      }
+    };
+  } // namespace details
+
+  /**
+   *  Defines a metric that gives the same distances as \c Metric, but
+   *  first estimates the distances to the keys in single precision, where
+   *  twice as many differences fit in a vector register, during the search
+   *  for the nearest neighbor. A key whose estimate, reduced by a margin
+   *  larger than its rounding errors, is further than the best neighbor
+   *  found so far is pruned on the estimate; the distances to the other
+   *  keys are computed in the precision of \c Metric. Therefore the
+   *  neighbors and their distances are exactly the same as with \c Metric.
+   *
+   *  \concept_metric
+   *
+   *  \c Metric must be \euclidian, \quadrance or \manhattan, with a floating
+   *  point distance type. The estimates only pay off when most keys are
+   *  pruned, and when the distance type is wider than \c float.
+   *
+   *  \tparam Metric The metric giving the distances.
+   */
+  template <typename Metric>
+  class mixed_precision
+  {
+    // Check that the distance type is a fundamental floating point type
+    typedef typename enable_if<import::is_floating_point
+                               <typename Metric::distance_type> >::type
+    check_concept_distance_type_is_floating_point;
+
+  public:
+    typedef typename Metric::distance_type distance_type;
+    typedef typename Metric::difference_type difference_type;
+
+  private:
+    typedef typename details::rebind_metric_difference
+    <Metric, difference_type>::container_type container_type;
+
+    //! The key_type of the container being used for calculations.
+    typedef typename container_type::key_type key_type;
+
+    //! The rank_type of the container being used for calculations.
+    typedef typename container_type::rank_type rank_type;
+
+  public:
+    //! Builds a metric giving the same distances as \c metric.
+    explicit mixed_precision(const Metric& metric = Metric())
+      : _metric(metric) { }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  in the precision of \c Metric.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const key_type& origin, const key_type& key) const
+    { return _metric.distance_to_key(rank, origin, key); }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  unless its single precision estimate shows that it is greater than
+     *  \c bound.
+     *  \return The distance if it is not greater than \c bound, otherwise a
+     *  value greater than \c bound and not greater than the distance.
+     */
+    distance_type
+    distance_to_key_bounded(dimension_type rank, const key_type& origin,
+                            const key_type& key, distance_type bound) const
+    {
+      float estimate = details::narrow_distance<Metric>::template estimate
+        <float>(details::Rank_argument<rank_type>::make(rank), origin, key,
+                difference());
+      if (estimate >= (std::numeric_limits<float>::min)()
+          && estimate <= (std::numeric_limits<float>::max)())
+        {
+          distance_type lower = static_cast<distance_type>(estimate)
+            * (1 - static_cast<distance_type>(rank + 4)
+               * static_cast<distance_type>
+               (std::numeric_limits<float>::epsilon()));
+          if (lower > bound) return lower;
+        }
+      return _metric.distance_to_key_bounded(rank, origin, key, bound);
+    }
+
+    /**
+     *  The distance between the point of \c origin and the closest point to
+     *  the plane orthogonal to the axis of dimension \c dim and crossing \c
+     *  key, in the precision of \c Metric.
+     *  \return The resulting distance.
+     */
+    distance_type
+    distance_to_plane(dimension_type rank, dimension_type dim,
+                      const key_type& origin, const key_type& key) const
+    { return _metric.distance_to_plane(rank, dim, origin, key); }
+
+    //! Returns the metric giving the distances.
+    const Metric& metric() const { return _metric; }
+
+    /**
+     *  Returns the difference functor used in this type.
+     */
+    difference_type difference() const { return _metric.difference(); }
+
+  private:
+    Metric _metric;
+  };
+
+  namespace details
+  {
+    /**
+     *  Combines the largest distances to the planes bounding a cell, along
+     *  each dimension, into an upper bound of the distance between the origin
+     *  and any key in the cell. This is used to prune the search for the
+     *  furthest neighbor.
+     *
+     *  A metric that does not specialize this type cannot be bounded from its
+     *  distances to planes, and the search for the furthest neighbor visits
+     *  all elements of the container.
+     */
+    template <typename Metric>
+    struct furthest_bound : import::false_type { };
+
+    //! Sums \c terms, and saturates instead of overflowing.
+    template <typename DistanceType>
+    inline DistanceType
+    saturated_sum(const std::vector<DistanceType>& terms)
+    {
+      const DistanceType max = (std::numeric_limits<DistanceType>::max)();
+      DistanceType sum = DistanceType();
+      for (typename std::vector<DistanceType>::const_iterator
+             i = terms.begin(); i != terms.end(); ++i)
+        {
+          if (*i > max - sum) return max;
+          sum += *i;
+        }
+      return sum;
+    }
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct furthest_bound<euclidian<Ct, DistanceType, Diff> >
+      : import::true_type
+    {
+      static DistanceType
+      combine(const std::vector<DistanceType>& terms)
+      {
+        DistanceType sum = DistanceType();
+        for (typename std::vector<DistanceType>::const_iterator
+               i = terms.begin(); i != terms.end(); ++i)
+          { sum += *i * *i; }
+        // Inflated by a few ulps, so that rounding in the computation of
+        // distances never makes the bound smaller than an actual distance.
+        return std::sqrt(sum)
+          * (1 + 4 * std::numeric_limits<DistanceType>::epsilon());
+      }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct furthest_bound<quadrance<Ct, DistanceType, Diff> >
+      : import::true_type
+    {
+      static DistanceType
+      combine(const std::vector<DistanceType>& terms)
+      { return saturated_sum(terms); }
+    };
+
+    template <typename Ct, typename Unit, typename Diff>
+    struct furthest_bound<wide_quadrance<Ct, Unit, Diff> >
+      : furthest_bound<quadrance<Ct, typename wide_integer<Unit>::type,
+                                 Diff> > { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct furthest_bound<manhattan<Ct, DistanceType, Diff> >
+      : import::true_type
+    {
+      static DistanceType
+      combine(const std::vector<DistanceType>& terms)
+      { return saturated_sum(terms); }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct furthest_bound<chebyshev<Ct, DistanceType, Diff> >
+      : import::true_type
+    {
+      static DistanceType
+      combine(const std::vector<DistanceType>& terms)
+      {
+        DistanceType max = DistanceType();
+        for (typename std::vector<DistanceType>::const_iterator
+               i = terms.begin(); i != terms.end(); ++i)
+          { if (*i > max) max = *i; }
+        return max;
+      }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff,
+              unsigned int P>
+    struct furthest_bound<minkowski<Ct, DistanceType, Diff, P> >
+      : import::true_type
+    {
+      static DistanceType
+      combine(const std::vector<DistanceType>& terms)
+      {
+        DistanceType sum = DistanceType();
+        for (typename std::vector<DistanceType>::const_iterator
+               i = terms.begin(); i != terms.end(); ++i)
+          { sum += Power<P>::of(*i); }
+        return Root<P>::of(sum)
+          * (1 + static_cast<DistanceType>(4 * P)
+             * std::numeric_limits<DistanceType>::epsilon());
+      }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct furthest_bound<weighted_euclidian<Ct, DistanceType, Diff> >
+      : furthest_bound<euclidian<Ct, DistanceType, Diff> > { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct furthest_bound<weighted_quadrance<Ct, DistanceType, Diff> >
+      : furthest_bound<quadrance<Ct, DistanceType, Diff> > { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct furthest_bound<weighted_manhattan<Ct, DistanceType, Diff> >
+      : furthest_bound<manhattan<Ct, DistanceType, Diff> > { };
+
+    template <typename Metric>
+    struct furthest_bound<mixed_precision<Metric> > : furthest_bound<Metric>
+    { };
+
+    /**
+     *  Combines the distances to the planes bounding a cell, along each
+     *  dimension, into a lower bound of the distance between the origin and
+     *  any key in the cell, after Arya and Mount. The bound is kept as a sum
+     *  of one term per dimension: \c term() converts a distance to a plane
+     *  into a term, and \c combine() converts the sum into a distance. This is
+     *  used to prune the search for the nearest neighbor, where the sum is
+     *  updated in constant time each time the search enters a far sub-tree.
+     *
+     *  A metric that does not specialize this type only bounds the distance
+     *  to a sub-tree by the distance to the plane of its parent.
+     */
+    template <typename Metric>
+    struct nearest_bound : import::false_type { };
+
+    /**
+     *  Floating point sums updated incrementally are deflated by a few
+     *  hundred ulps, so that the rounding of the updates never makes a lower
+     *  bound greater than an actual distance.
+     */
+    ///@{
+    template <typename DistanceType>
+    inline typename enable_if<import::is_floating_point<DistanceType>,
+                              DistanceType>::type
+    deflate(DistanceType x)
+    { return x * (1 - 256 * std::numeric_limits<DistanceType>::epsilon()); }
+
+    template <typename DistanceType>
+    inline typename enable_if_c<!import::is_floating_point<DistanceType>::value,
+                                DistanceType>::type
+    deflate(DistanceType x)
+    { return x; }
+    ///@}
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct nearest_bound<euclidian<Ct, DistanceType, Diff> >
+      : import::true_type
+    {
+      static DistanceType term(DistanceType plane) { return plane * plane; }
+      static DistanceType combine(DistanceType sum)
+      { return deflate(std::sqrt(sum)); }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct nearest_bound<quadrance<Ct, DistanceType, Diff> >
+      : import::true_type
+    {
+      static DistanceType term(DistanceType plane) { return plane; }
+      static DistanceType combine(DistanceType sum) { return deflate(sum); }
+    };
+
+    template <typename Ct, typename Unit, typename Diff>
+    struct nearest_bound<wide_quadrance<Ct, Unit, Diff> >
+      : nearest_bound<quadrance<Ct, typename wide_integer<Unit>::type,
+                                Diff> > { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct nearest_bound<manhattan<Ct, DistanceType, Diff> >
+      : import::true_type
+    {
+      static DistanceType term(DistanceType plane) { return plane; }
+      static DistanceType combine(DistanceType sum) { return deflate(sum); }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff,
+              unsigned int P>
+    struct nearest_bound<minkowski<Ct, DistanceType, Diff, P> >
+      : import::true_type
+    {
+      static DistanceType term(DistanceType plane)
+      { return Power<P>::of(plane); }
+      static DistanceType combine(DistanceType sum)
+      { return deflate(Root<P>::of(sum)); }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct nearest_bound<weighted_euclidian<Ct, DistanceType, Diff> >
+      : nearest_bound<euclidian<Ct, DistanceType, Diff> > { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct nearest_bound<weighted_quadrance<Ct, DistanceType, Diff> >
+      : nearest_bound<quadrance<Ct, DistanceType, Diff> > { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct nearest_bound<weighted_manhattan<Ct, DistanceType, Diff> >
+      : nearest_bound<manhattan<Ct, DistanceType, Diff> > { };
+
+    /**
+     *  Along each dimension, the distance to the plane of a far sub-tree
+     *  only grows as the search goes down, even across the boundaries of the
+     *  box: the cells are bounded in the same way as for \c Metric.
+     */
+    template <typename Metric>
+    struct nearest_bound<periodic<Metric> > : nearest_bound<Metric> { };
+
+    template <typename Metric>
+    struct nearest_bound<mixed_precision<Metric> > : nearest_bound<Metric>
+    { };
+
+    /**
+     *  Tells whether the metric provides \c distance_to_key_bounded(), which
+     *  stops computing the distance to a key once it is known to be greater
+     *  than a bound. The search for the nearest neighbor uses it to skip the
+     *  remaining dimensions of the keys that are further than the best
+     *  neighbor found so far.
+     *
+     *  \c distance_to_key_bounded() must return the distance when it is not
+     *  greater than the bound, and otherwise a value greater than the bound
+     *  and not greater than the distance.
+     */
+    template <typename Metric>
+    struct bounded_distance : import::false_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct bounded_distance<euclidian<Ct, DistanceType, Diff> >
+      : import::true_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct bounded_distance<quadrance<Ct, DistanceType, Diff> >
+      : import::true_type { };
+
+    template <typename Ct, typename Unit, typename Diff>
+    struct bounded_distance<wide_quadrance<Ct, Unit, Diff> >
+      : import::true_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct bounded_distance<manhattan<Ct, DistanceType, Diff> >
+      : import::true_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct bounded_distance<chebyshev<Ct, DistanceType, Diff> >
+      : import::true_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff,
+              unsigned int P>
+    struct bounded_distance<minkowski<Ct, DistanceType, Diff, P> >
+      : import::true_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct bounded_distance<weighted_euclidian<Ct, DistanceType, Diff> >
+      : import::true_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct bounded_distance<weighted_quadrance<Ct, DistanceType, Diff> >
+      : import::true_type { };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct bounded_distance<weighted_manhattan<Ct, DistanceType, Diff> >
+      : import::true_type { };
+
+    template <typename Metric>
+    struct bounded_distance<periodic<Metric> > : bounded_distance<Metric> { };
+
+    template <typename Metric>
+    struct bounded_distance<mixed_precision<Metric> > : import::true_type
+    { };
+
+    /**
+     *  Returns the distance between \c origin and \c key, or a value greater
+     *  than \c bound and not greater than the distance, if the distance is
+     *  greater than \c bound. When the metric does not provide a \ref
+     *  bounded_distance, the distance is always returned.
+     */
+    ///@{
+    template <typename Metric, typename Key>
+    inline typename enable_if_c<!bounded_distance<Metric>::value,
+                                typename Metric::distance_type>::type
+    distance_to_key_bounded(const Metric& met, dimension_type rank,
+                            const Key& origin, const Key& key,
+                            typename Metric::distance_type)
+    { return met.distance_to_key(rank, origin, key); }
+
+    template <typename Metric, typename Key>
+    inline typename enable_if<bounded_distance<Metric>,
+                              typename Metric::distance_type>::type
+    distance_to_key_bounded(const Metric& met, dimension_type rank,
+                            const Key& origin, const Key& key,
+                            typename Metric::distance_type bound)
+    { return met.distance_to_key_bounded(rank, origin, key, bound); }
+    ///@}
+  } // namespace details
 } // namespace spatial
 
 #endif // SPATIAL_METRIC_HPP
@@ -17,5 +17,8 @@
 #include "bits/spatial_euclidian_neighbor.hpp"
 #include "bits/spatial_quadrance_neighbor.hpp"
 #include "bits/spatial_manhattan_neighbor.hpp"
+#include "bits/spatial_neighbor_visit.hpp"
+#include "bits/spatial_box_neighbor.hpp"
+#include "bits/spatial_ray_visit.hpp"
 
 #endif // SPATIAL_NEIGHBOR_ITERATOR_HPP
@@ -23,22 +23,34 @@ namespace spatial
   /**
    *  These containers are mapped containers and store values in space that can
    *  be represented as points.
+   *
+   *  When a \c Monoid is given, each node of the container also holds the
+   *  aggregate of the values below it, such as the sum of a field of the
+   *  mapped type, which \ref region_aggregate() uses to summarize a region
+   *  without visiting every element in it.
+   *
+   *  When a \c Hash is given, the container also keeps a hash index of its
+   *  elements, which find() and erase() use to reach the elements equal to a
+   *  key without walking the tree; this pays off when many elements share
+   *  coordinates. \see details::Relaxed_kdtree for the requirements on \c
+   *  Hash.
    */
   template<dimension_type Rank, typename Key, typename Mapped,
            typename Compare = bracket_less<Key>,
            typename BalancingPolicy = loose_balancing,
-           typename Alloc = std::allocator<std::pair<const Key, Mapped> > >
+           typename Alloc = std::allocator<std::pair<const Key, Mapped> >,
+           typename Monoid = void, typename Hash = void>
   struct point_multimap
     : details::Relaxed_kdtree<details::Static_rank<Rank>, const Key,
                               std::pair<const Key, Mapped>, Compare,
-                              BalancingPolicy, Alloc>
+                              BalancingPolicy, Alloc, Monoid, Hash>
   {
   private:
     typedef details::Relaxed_kdtree
     <details::Static_rank<Rank>, const Key, std::pair<const Key, Mapped>,
-     Compare, BalancingPolicy, Alloc>         base_type;
+     Compare, BalancingPolicy, Alloc, Monoid, Hash> base_type;
     typedef point_multimap<Rank, Key, Mapped, Compare,
-                     BalancingPolicy, Alloc>  Self;
+                     BalancingPolicy, Alloc, Monoid, Hash> Self;
 
   public:
     typedef Mapped                            mapped_type;
@@ -72,18 +84,20 @@ namespace spatial
    *  be determined at run time and does not need to be fixed at compile time.
    */
   template<typename Key, typename Mapped, typename Compare,
-           typename BalancingPolicy, typename Alloc>
-  struct point_multimap<0, Key, Mapped, Compare, BalancingPolicy, Alloc>
+           typename BalancingPolicy, typename Alloc, typename Monoid,
+           typename Hash>
+  struct point_multimap<0, Key, Mapped, Compare, BalancingPolicy, Alloc, Monoid,
+                        Hash>
     : details::Relaxed_kdtree<details::Dynamic_rank, const Key,
                               std::pair<const Key, Mapped>, Compare,
-                              BalancingPolicy, Alloc>
+                              BalancingPolicy, Alloc, Monoid, Hash>
   {
   private:
     typedef details::Relaxed_kdtree
     <details::Dynamic_rank, const Key, std::pair<const Key, Mapped>,
-     Compare, BalancingPolicy, Alloc>       base_type;
-    typedef point_multimap<0, Key, Mapped, Compare, BalancingPolicy, Alloc>
-    Self;
+     Compare, BalancingPolicy, Alloc, Monoid, Hash> base_type;
+    typedef point_multimap<0, Key, Mapped, Compare, BalancingPolicy, Alloc,
+                           Monoid, Hash> Self;
 
   public:
     typedef Mapped mapped_type;
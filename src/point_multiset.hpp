@@ -33,16 +33,19 @@ namespace spatial
   template<dimension_type Rank, typename Key,
            typename Compare = bracket_less<Key>,
            typename BalancingPolicy = loose_balancing,
-           typename Alloc = std::allocator<Key> >
+           typename Alloc = std::allocator<Key>,
+           typename Monoid = void, typename Hash = void>
   struct point_multiset
     : details::Relaxed_kdtree<details::Static_rank<Rank>, const Key, const Key,
-                              Compare, BalancingPolicy, Alloc>
+                              Compare, BalancingPolicy, Alloc, Monoid, Hash>
   {
   private:
     typedef
     details::Relaxed_kdtree<details::Static_rank<Rank>, const Key, const Key,
-                            Compare, BalancingPolicy, Alloc>      base_type;
-    typedef point_multiset<Rank, Key, Compare, BalancingPolicy, Alloc>  Self;
+                            Compare, BalancingPolicy, Alloc, Monoid, Hash>
+    base_type;
+    typedef point_multiset<Rank, Key, Compare, BalancingPolicy, Alloc, Monoid,
+                           Hash> Self;
 
   public:
     point_multiset() { }
@@ -80,15 +83,17 @@ namespace spatial
    *  \endcode
    */
   template<typename Key, typename Compare, typename BalancingPolicy,
-           typename Alloc>
-  struct point_multiset<0, Key, Compare, BalancingPolicy, Alloc>
+           typename Alloc, typename Monoid, typename Hash>
+  struct point_multiset<0, Key, Compare, BalancingPolicy, Alloc, Monoid, Hash>
     : details::Relaxed_kdtree<details::Dynamic_rank, const Key, const Key,
-                              Compare, BalancingPolicy, Alloc>
+                              Compare, BalancingPolicy, Alloc, Monoid, Hash>
   {
   private:
     typedef details::Relaxed_kdtree<details::Dynamic_rank, const Key, const Key,
-                                    Compare, BalancingPolicy, Alloc> base_type;
-    typedef point_multiset<0, Key, Compare, BalancingPolicy, Alloc>        Self;
+                                    Compare, BalancingPolicy, Alloc, Monoid,
+                                    Hash> base_type;
+    typedef point_multiset<0, Key, Compare, BalancingPolicy, Alloc, Monoid,
+                           Hash> Self;
 
   public:
     point_multiset() { }
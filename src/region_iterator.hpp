@@ -19,5 +19,9 @@
 #include "bits/spatial_closed_region.hpp"
 #include "bits/spatial_enclosed_region.hpp"
 #include "bits/spatial_overlap_region.hpp"
+#include "bits/spatial_region_count.hpp"
+#include "bits/spatial_region_aggregate.hpp"
+#include "bits/spatial_region_visit.hpp"
+#include "bits/spatial_skyline.hpp"
 
 #endif // SPATIAL_REGION_ITERATOR_HPP
@@ -0,0 +1,140 @@
+#include <iostream>
+#include <vector>
+#include <sstream>
+
+#include "../../src/point_multiset.hpp"
+#include "../../src/idle_point_multiset.hpp"
+#include "../../src/neighbor_iterator.hpp"
+#include "../../src/join.hpp"
+
+#include "chrono.hpp"
+#include "random.hpp"
+#include "point_type.hpp"
+
+// Accumulates the distances to avoid the search being optimized out.
+template <typename Iterator>
+struct sum_distances
+{
+  sum_distances() : sum(0.0) { }
+  void operator()
+  (Iterator, const std::vector<std::pair<Iterator, double> >& neighbors)
+  { if (!neighbors.empty()) sum += neighbors.back().second; }
+  double sum;
+};
+
+template <typename Container>
+double iterate_neighbors(const Container& cobaye, std::size_t k)
+{
+  double sum = 0.0;
+  for (typename Container::const_iterator
+         i = cobaye.begin(); i != cobaye.end(); ++i)
+    {
+      spatial::neighbor_iterator<const Container> n
+        = spatial::neighbor_cbegin(cobaye, *i);
+      // Skip the element itself
+      ++n;
+      for (std::size_t j = 1;
+           j < k && n != spatial::neighbor_cend(cobaye, *i); ++j) ++n;
+      if (n != spatial::neighbor_cend(cobaye, *i)) sum += distance(n);
+    }
+  return sum;
+}
+
+template <spatial::dimension_type N, typename Point, typename Distribution>
+void compare_libraries
+(std::size_t data_size, std::size_t k, const Distribution& distribution)
+{
+  std::cout << "\t" << N << " dimensions, " << data_size << " objects, "
+            << k << " neighbors:" << std::endl;
+  std::vector<Point> data;
+  data.reserve(data_size);
+  for (std::size_t i = 0; i < data_size; ++i)
+    {
+      data.push_back(Point(distribution));
+    }
+  {
+    // Neighbor iteration for each element of an idle_point_multiset
+    std::cout << "\t\tidle_point_multiset (neighbor_begin):\t" << std::flush;
+    spatial::idle_point_multiset<N, Point> cobaye;
+    cobaye.insert_rebalance(data.begin(), data.end());
+    utils::time_point start = utils::process_timer_now();
+    iterate_neighbors(cobaye, k);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+  {
+    // All nearest neighbors in an idle_point_multiset
+    typedef spatial::idle_point_multiset<N, Point> container_type;
+    std::cout << "\t\tidle_point_multiset (all_neighbors):\t" << std::flush;
+    container_type cobaye;
+    cobaye.insert_rebalance(data.begin(), data.end());
+    utils::time_point start = utils::process_timer_now();
+    spatial::all_neighbors
+      (cobaye, k, sum_distances<typename container_type::const_iterator>());
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+  {
+    // Neighbor iteration for each element of a point_multiset
+    std::cout << "\t\tpoint_multiset (neighbor_begin):\t" << std::flush;
+    spatial::point_multiset<N, Point> cobaye;
+    cobaye.insert(data.begin(), data.end());
+    utils::time_point start = utils::process_timer_now();
+    iterate_neighbors(cobaye, k);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+  {
+    // All nearest neighbors in a point_multiset
+    typedef spatial::point_multiset<N, Point> container_type;
+    std::cout << "\t\tpoint_multiset (all_neighbors):\t" << std::flush;
+    container_type cobaye;
+    cobaye.insert(data.begin(), data.end());
+    utils::time_point start = utils::process_timer_now();
+    spatial::all_neighbors
+      (cobaye, k, sum_distances<typename container_type::const_iterator>());
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+}
+
+int main (int argc, char **argv)
+{
+  if (argc != 3)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " <sample size: integer> <neighbors: integer>"
+                << std::endl;
+      return 1;
+    }
+
+  // Build initialization memory
+  std::istringstream argbuf1(argv[1]);
+  std::size_t data_size;
+  argbuf1 >> data_size;
+  std::istringstream argbuf2(argv[2]);
+  std::size_t k;
+  argbuf2 >> k;
+  utils::random_engine engine(43278322);
+
+  std::cout << "Uniform distribution:" << std::endl;
+  utils::uniform_double_distribution uniform(engine, -1.0, 1.0);
+  compare_libraries<3, point3_type, utils::uniform_double_distribution>
+    (data_size, k, uniform);
+  compare_libraries<9, point9_type, utils::uniform_double_distribution>
+    (data_size, k, uniform);
+
+  std::cout << "Normal distribution:" << std::endl;
+  utils::normal_double_distribution normal(engine, -1.0, 1.0);
+  compare_libraries<3, point3_type, utils::normal_double_distribution>
+    (data_size, k, normal);
+  compare_libraries<9, point9_type, utils::normal_double_distribution>
+    (data_size, k, normal);
+
+  std::cout << "Narrow normal distribution:" << std::endl;
+  utils::narrow_double_distribution narrow(engine, -1.0, 1.0);
+  compare_libraries<3, point3_type, utils::narrow_double_distribution>
+    (data_size, k, narrow);
+  compare_libraries<9, point9_type, utils::narrow_double_distribution>
+    (data_size, k, narrow);
+}
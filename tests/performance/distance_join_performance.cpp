@@ -0,0 +1,137 @@
+#include <iostream>
+#include <vector>
+#include <sstream>
+
+#include "../../src/point_multiset.hpp"
+#include "../../src/idle_point_multiset.hpp"
+#include "../../src/neighbor_iterator.hpp"
+#include "../../src/join.hpp"
+
+#include "chrono.hpp"
+#include "random.hpp"
+#include "point_type.hpp"
+
+// Counts the pairs to avoid the search being optimized out.
+template <typename IteratorA, typename IteratorB>
+struct count_pairs
+{
+  count_pairs() : count(0) { }
+  void operator()(IteratorA, IteratorB, double) { ++count; }
+  std::size_t count;
+};
+
+template <typename Container>
+std::size_t iterate_neighbors(const Container& a, const Container& b,
+                              double radius)
+{
+  std::size_t count = 0;
+  for (typename Container::const_iterator i = a.begin(); i != a.end(); ++i)
+    {
+      for (spatial::neighbor_iterator<const Container> n
+             = spatial::neighbor_cbegin(b, *i);
+           n != spatial::neighbor_cend(b, *i) && distance(n) <= radius; ++n)
+        ++count;
+    }
+  return count;
+}
+
+template <typename Container>
+void compare_joins(const std::vector<typename Container::key_type>& data_a,
+                   const std::vector<typename Container::key_type>& data_b,
+                   double radius)
+{
+  typedef typename Container::const_iterator const_iterator;
+  Container a, b;
+  a.insert(data_a.begin(), data_a.end());
+  b.insert(data_b.begin(), data_b.end());
+  {
+    std::cout << "\t\t\tneighbor iteration:\t" << std::flush;
+    utils::time_point start = utils::process_timer_now();
+    std::size_t count = iterate_neighbors(a, b, radius);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << " pairs)"
+              << std::endl;
+  }
+  {
+    std::cout << "\t\t\tdistance_join:\t" << std::flush;
+    utils::time_point start = utils::process_timer_now();
+    std::size_t count = spatial::distance_join
+      (a, b, radius, count_pairs<const_iterator, const_iterator>()).count;
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << " pairs)"
+              << std::endl;
+  }
+  {
+    std::cout << "\t\t\tparallel_distance_join:\t" << std::flush;
+    utils::time_point start = utils::process_timer_now();
+    std::size_t count = spatial::parallel_distance_join
+      (a, b, radius, count_pairs<const_iterator, const_iterator>()).count;
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << " pairs)"
+              << std::endl;
+  }
+}
+
+template <spatial::dimension_type N, typename Point, typename Distribution>
+void compare_libraries
+(std::size_t data_size, double radius, const Distribution& distribution)
+{
+  std::cout << "\t" << N << " dimensions, " << data_size << " objects, "
+            << "radius " << radius << ":" << std::endl;
+  std::vector<Point> data_a;
+  std::vector<Point> data_b;
+  data_a.reserve(data_size);
+  data_b.reserve(data_size);
+  for (std::size_t i = 0; i < data_size; ++i)
+    {
+      data_a.push_back(Point(distribution));
+      data_b.push_back(Point(distribution));
+    }
+  std::cout << "\t\tidle_point_multiset:" << std::endl;
+  compare_joins<spatial::idle_point_multiset<N, Point> >
+    (data_a, data_b, radius);
+  std::cout << "\t\tpoint_multiset:" << std::endl;
+  compare_joins<spatial::point_multiset<N, Point> >
+    (data_a, data_b, radius);
+}
+
+int main (int argc, char **argv)
+{
+  if (argc != 3)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " <sample size: integer> <radius: double>"
+                << std::endl;
+      return 1;
+    }
+
+  // Build initialization memory
+  std::istringstream argbuf1(argv[1]);
+  std::size_t data_size;
+  argbuf1 >> data_size;
+  std::istringstream argbuf2(argv[2]);
+  double radius;
+  argbuf2 >> radius;
+  utils::random_engine engine(43278322);
+
+  std::cout << "Uniform distribution:" << std::endl;
+  utils::uniform_double_distribution uniform(engine, -1.0, 1.0);
+  compare_libraries<3, point3_type, utils::uniform_double_distribution>
+    (data_size, radius, uniform);
+  compare_libraries<9, point9_type, utils::uniform_double_distribution>
+    (data_size, radius, uniform);
+
+  std::cout << "Normal distribution:" << std::endl;
+  utils::normal_double_distribution normal(engine, -1.0, 1.0);
+  compare_libraries<3, point3_type, utils::normal_double_distribution>
+    (data_size, radius, normal);
+  compare_libraries<9, point9_type, utils::normal_double_distribution>
+    (data_size, radius, normal);
+
+  std::cout << "Narrow normal distribution:" << std::endl;
+  utils::narrow_double_distribution narrow(engine, -1.0, 1.0);
+  compare_libraries<3, point3_type, utils::narrow_double_distribution>
+    (data_size, radius, narrow);
+  compare_libraries<9, point9_type, utils::narrow_double_distribution>
+    (data_size, radius, narrow);
+}
@@ -7,6 +7,7 @@
 #include "../../src/equal_iterator.hpp"
 
 #include "chrono.hpp"
+#include "random.hpp"
 #include "point_type.hpp"
 
 double total = 0.;
@@ -38,6 +39,48 @@ void compare_libraries(std::size_t data_size)
     stop = utils::process_timer_now();
     std::cout << (stop - start) << "sec" << std::endl;
     total += stop - start;
+    std::cout << "\t\tpoint_multiset (count):\t" << std::flush;
+    start = utils::process_timer_now();
+    std::size_t count = cobaye.count(p);
+    stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+    total += stop - start;
+  }
+}
+
+//! Counts the points equal to each of the first 1000 points of the data,
+//! with an equal_iterator range and with count().
+template <spatial::dimension_type N, typename Point, typename Distribution>
+void compare_duplicates
+(std::size_t data_size, const Distribution& distribution)
+{
+  std::cout << "\t" << N << " dimensions, " << data_size << " objects:" << std::endl;
+  std::vector<Point> data;
+  data.reserve(data_size);
+  for (std::size_t i = 0; i < data_size; ++i)
+    data.push_back(Point(distribution));
+  std::size_t queries = data_size < 1000 ? data_size : 1000;
+  {
+    spatial::point_multiset<N, Point> cobaye;
+    cobaye.insert(data.begin(), data.end());
+    std::cout << "\t\tpoint_multiset:\t" << std::flush;
+    utils::time_point start = utils::process_timer_now();
+    std::size_t count = 0;
+    for (std::size_t q = 0; q < queries; ++q)
+      for (spatial::equal_iterator<spatial::point_multiset<N, Point> >
+             i = equal_begin(cobaye, data[q]);
+           i != equal_end(cobaye, data[q]); ++i, ++count);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+    total += stop - start;
+    std::cout << "\t\tpoint_multiset (count):\t" << std::flush;
+    start = utils::process_timer_now();
+    count = 0;
+    for (std::size_t q = 0; q < queries; ++q)
+      count += cobaye.count(data[q]);
+    stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+    total += stop - start;
   }
 }
 
@@ -58,5 +101,13 @@ int main (int argc, char **argv)
   compare_libraries<3, point3_type>(data_size);
   compare_libraries<9, point9_type>(data_size);
 
+  std::cout << "Duplicate-heavy distribution:" << std::endl;
+  utils::random_engine engine(12384328);
+  utils::discrete_double_distribution discrete(engine, -1.0, 1.0, 3);
+  compare_duplicates<3, point3_type, utils::discrete_double_distribution>
+    (data_size, discrete);
+  compare_duplicates<9, point9_type, utils::discrete_double_distribution>
+    (data_size, discrete);
+
   std::cout << "Total: " << total << std::endl;
 }
@@ -10,6 +10,20 @@
 #include "random.hpp"
 #include "point_type.hpp"
 
+//! Hashes the coordinates of a point, for the equal index of
+//! point_multiset.
+template <spatial::dimension_type N, typename Point>
+struct point_hash
+{
+  std::size_t operator()(const Point& p) const
+  {
+    std::size_t h = 0;
+    for (spatial::dimension_type i = 0; i < N; ++i)
+      h = h * 31 + static_cast<std::size_t>(static_cast<long>(p[i] * 1e6));
+    return h;
+  }
+};
+
 template <spatial::dimension_type N, typename Point, typename Distribution>
 void compare_libraries
 (std::size_t data_size, const Distribution& distribution)
@@ -31,6 +45,21 @@ void compare_libraries
     utils::time_point stop = utils::process_timer_now();
     std::cout << (stop - start) << "sec" << std::endl;
   }
+  {
+    // Find into a point_multiset with an equal index
+    std::cout << "\t\tpoint_multiset (indexed):\t" << std::flush;
+    spatial::point_multiset<N, Point, spatial::bracket_less<Point>,
+                            spatial::loose_balancing, std::allocator<Point>,
+                            void, point_hash<N, Point> > cobaye;
+    cobaye.insert(data.begin(), data.end());
+    utils::time_point start = utils::process_timer_now();
+    std::size_t found = 0;
+    for (typename std::vector<Point>::const_iterator i = data.begin();
+         i != data.end(); ++i)
+      if (cobaye.find(*i) != cobaye.end()) ++found;
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << found << ")" << std::endl;
+  }
   {
     // Find into an idle_point_multiset
     std::cout << "\t\tidle_point_multiset:\t" << std::flush;
@@ -93,4 +122,11 @@ int main (int argc, char **argv)
     (data_size, narrow);
   compare_libraries<9, point9_type, utils::narrow_double_distribution>
     (data_size, narrow);
+
+  std::cout << "Duplicate-heavy distribution:" << std::endl;
+  utils::discrete_double_distribution discrete(engine, -1.0, 1.0, 3);
+  compare_libraries<3, point3_type, utils::discrete_double_distribution>
+    (data_size, discrete);
+  compare_libraries<9, point9_type, utils::discrete_double_distribution>
+    (data_size, discrete);
 }
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <iterator>
 #include <sstream>
 
 #include "../../src/point_multiset.hpp"
@@ -65,6 +66,35 @@ void compare_libraries
     stop = utils::process_timer_now();
     std::cout << (stop - start) << "sec" << std::endl;
   }
+  {
+    // Top 100 along a dimension, in a single traversal or by iteration
+    spatial::point_multiset<N, Point> cobaye;
+    cobaye.insert(data.begin(), data.end());
+    typedef typename spatial::point_multiset<N, Point>::iterator iterator;
+    std::vector<iterator> top;
+    top.reserve(100);
+    std::cout << "\t\tpoint_multiset (top 100):\t" << std::flush;
+    utils::time_point start = utils::process_timer_now();
+    for (int j = 0; j != N; ++j)
+      {
+        top.clear();
+        spatial::top_k_mapping(cobaye, 0, 100, std::back_inserter(top));
+      }
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+    std::cout << "\t\tpoint_multiset (top 100, reverse):\t" << std::flush;
+    start = utils::process_timer_now();
+    for (int j = 0; j != N; ++j)
+      {
+        top.clear();
+        spatial::mapping_iterator<spatial::point_multiset<N, Point> >
+          i = mapping_end(cobaye, 0);
+        for (int n = 0; n != 100; ++n)
+          { --i; top.push_back(iterator(i.node)); }
+      }
+    stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
 }
 
 int main (int argc, char **argv)
@@ -64,6 +64,112 @@ void compare_libraries
   }
 }
 
+//! Same as spatial::bracket_minus, but hides the contiguous coordinates of
+//! the keys from the metric, which computes distances one coordinate at a
+//! time.
+struct scalar_minus
+{
+  double operator()(spatial::dimension_type n, const std::vector<double>& x,
+                    const std::vector<double>& y) const
+  { return x[n] - y[n]; }
+};
+
+//! Compares the distances computed with the vectorized kernels and one
+//! coordinate at a time, on descriptors stored in std::vector.
+template <typename Distribution>
+void compare_kernels
+(std::size_t data_size, spatial::dimension_type dim,
+ const Distribution& distribution)
+{
+  typedef std::vector<double> descriptor;
+  typedef spatial::point_multiset<0, descriptor> container_type;
+  std::cout << "\t" << dim << " dimensions, " << data_size << " descriptors:"
+            << std::endl;
+  std::vector<descriptor> data;
+  std::vector<descriptor> targets;
+  for (std::size_t i = 0; i < data_size; ++i)
+    {
+      data.push_back(descriptor(dim));
+      targets.push_back(descriptor(dim));
+      for (spatial::dimension_type d = 0; d < dim; ++d)
+        { data.back()[d] = distribution(); targets.back()[d] = distribution(); }
+    }
+  container_type cobaye(dim);
+  cobaye.insert(data.begin(), data.end());
+  {
+    std::cout << "\t\tpoint_multiset (simd):\t" << std::flush;
+    spatial::euclidian<container_type, double,
+                       spatial::bracket_minus<descriptor, double> > metric;
+    utils::time_point start = utils::process_timer_now();
+    for (std::vector<descriptor>::const_iterator
+           i = targets.begin(); i != targets.end(); ++i)
+      neighbor_begin(cobaye, metric, *i);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+  {
+    std::cout << "\t\tpoint_multiset (scalar):\t" << std::flush;
+    spatial::euclidian<container_type, double, scalar_minus> metric;
+    utils::time_point start = utils::process_timer_now();
+    for (std::vector<descriptor>::const_iterator
+           i = targets.begin(); i != targets.end(); ++i)
+      neighbor_begin(cobaye, metric, *i);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+}
+
+//! Same as Metric, but not known to provide distance_to_key_bounded(), so
+//! that the distance to each key is computed along all dimensions.
+template <typename Metric>
+struct unbounded : Metric { };
+
+//! Compares the search for the nearest neighbor when the distance to a key
+//! is abandoned as soon as it exceeds the best distance found, and when it
+//! is always computed along all dimensions.
+template <typename Distribution>
+void compare_bounded
+(std::size_t data_size, spatial::dimension_type dim,
+ const Distribution& distribution)
+{
+  typedef std::vector<double> descriptor;
+  typedef spatial::point_multiset<0, descriptor> container_type;
+  typedef spatial::quadrance<container_type, double, scalar_minus> metric_type;
+  std::cout << "\t" << dim << " dimensions, " << data_size << " descriptors:"
+            << std::endl;
+  std::vector<descriptor> data;
+  std::vector<descriptor> targets;
+  for (std::size_t i = 0; i < data_size; ++i)
+    {
+      data.push_back(descriptor(dim));
+      targets.push_back(descriptor(dim));
+      for (spatial::dimension_type d = 0; d < dim; ++d)
+        { data.back()[d] = distribution(); targets.back()[d] = distribution(); }
+    }
+  container_type cobaye(dim);
+  cobaye.insert(data.begin(), data.end());
+  {
+    std::cout << "\t\tpoint_multiset (bounded):\t" << std::flush;
+    metric_type metric;
+    utils::time_point start = utils::process_timer_now();
+    for (std::vector<descriptor>::const_iterator
+           i = targets.begin(); i != targets.end(); ++i)
+      neighbor_begin(cobaye, metric, *i);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+  {
+    std::cout << "\t\tpoint_multiset (unbounded):\t" << std::flush;
+    unbounded<metric_type> metric;
+    utils::time_point start = utils::process_timer_now();
+    for (std::vector<descriptor>::const_iterator
+           i = targets.begin(); i != targets.end(); ++i)
+      neighbor_begin(cobaye, metric, *i);
+    utils::time_point stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec" << std::endl;
+  }
+}
+
 int main (int argc, char **argv)
 {
   if (argc != 2)
@@ -99,4 +205,11 @@ int main (int argc, char **argv)
     (data_size, narrow);
   compare_libraries<9, point9_type, utils::narrow_double_distribution>
     (data_size, narrow);
+
+  std::cout << "Descriptors, uniform distribution:" << std::endl;
+  compare_kernels(data_size, 16, uniform);
+
+  std::cout << "Early abandon, uniform distribution:" << std::endl;
+  compare_bounded(data_size, 16, uniform);
+  compare_bounded(data_size, 32, uniform);
 }
@@ -115,6 +115,36 @@ namespace utils
     double _radius;
   };
 
+  /**
+   *  This distribution returns one of a few evenly spaced numbers, so that
+   *  many points drawn from it share some or all of their coordinates.
+   */
+  class discrete_double_distribution
+  {
+  public:
+    /// \defctor
+    discrete_double_distribution
+    (random_engine = random_engine(), double min = 0.0, double max = 1.0,
+     int levels = 3)
+      : _min(min), _step((max - min) / (levels - 1)), _levels(levels) { }
+
+    /// Pick one of the levels uniformly
+    double operator() () const
+    {
+      return _min + _step * details::randomize(0, _levels);
+    }
+
+  private:
+    /// The lower bound
+    double _min;
+
+    /// The distance between two levels
+    double _step;
+
+    /// The number of levels
+    int _levels;
+  };
+
   template<typename Tp>
   class uniform_sphere_distribution
   {
@@ -1,10 +1,12 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <iterator>
 
 #include "../../src/point_multiset.hpp"
 #include "../../src/idle_point_multiset.hpp"
 #include "../../src/region_iterator.hpp"
+#include "../../src/neighbor_iterator.hpp"
 
 #include "chrono.hpp"
 #include "random.hpp"
@@ -12,6 +14,149 @@
 
 double total = 0.;
 
+//! Counts the elements given by for_each_in_region() and
+//! for_each_in_regions().
+struct count_visitor
+{
+  count_visitor() : count(0) { }
+  template <typename Iterator>
+  bool operator()(Iterator) { ++count; return true; }
+  template <typename Iterator>
+  bool operator()(spatial::size_type, Iterator) { ++count; return true; }
+  std::size_t count;
+};
+
+//! Compares one region query per tile with a single query for all tiles.
+//! The tiles are adjacent squares over the first 2 dimensions.
+template <typename Container, typename Point>
+void compare_tiles(const Container& cobaye, const char* name)
+{
+  typedef spatial::bounds<Point, typename Container::key_compare> bounds_type;
+  std::vector<bounds_type> tiles;
+  const int side = 32;
+  for (int x = 0; x < side; ++x)
+    for (int y = 0; y < side; ++y)
+      {
+        Point low(-10.0), high(10.0);
+        low[0] = -1.0 + 2.0 * x / side; high[0] = -1.0 + 2.0 * (x + 1) / side;
+        low[1] = -1.0 + 2.0 * y / side; high[1] = -1.0 + 2.0 * (y + 1) / side;
+        tiles.push_back(make_bounds(cobaye, low, high));
+      }
+  std::cout << "\t\t" << name << " (tiles):\t" << std::flush;
+  utils::time_point start = utils::process_timer_now();
+  std::size_t count = 0;
+  for (std::size_t t = 0; t < tiles.size(); ++t)
+    count += for_each_in_region(cobaye, tiles[t], count_visitor()).count;
+  utils::time_point stop = utils::process_timer_now();
+  std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+  total += stop - start;
+  std::cout << "\t\t" << name << " (tiles, batched):\t" << std::flush;
+  start = utils::process_timer_now();
+  count = for_each_in_regions(cobaye, tiles.begin(), tiles.end(),
+                              count_visitor()).count;
+  stop = utils::process_timer_now();
+  std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+  total += stop - start;
+}
+
+//! Compares skyline() with a scan of the container that compares each
+//! element with the skyline of the elements scanned before it.
+template <typename Container>
+void compare_skyline(const Container& cobaye, const char* name)
+{
+  typedef typename Container::const_iterator iterator;
+  std::cout << "\t\t" << name << " (skyline):\t" << std::flush;
+  utils::time_point start = utils::process_timer_now();
+  std::vector<iterator> sky;
+  skyline(cobaye, std::back_inserter(sky));
+  utils::time_point stop = utils::process_timer_now();
+  std::cout << (stop - start) << "sec (" << sky.size() << ")" << std::endl;
+  total += stop - start;
+  std::cout << "\t\t" << name << " (skyline, scan):\t" << std::flush;
+  start = utils::process_timer_now();
+  sky.clear();
+  for (iterator i = cobaye.begin(); i != cobaye.end(); ++i)
+    {
+      bool dominated = false;
+      for (std::size_t j = 0; j < sky.size() && !dominated;)
+        {
+          bool sky_less = false, i_less = false;
+          for (spatial::dimension_type d = 0; d < cobaye.dimension(); ++d)
+            {
+              if ((*sky[j])[d] < (*i)[d]) sky_less = true;
+              else if ((*i)[d] < (*sky[j])[d]) i_less = true;
+            }
+          if (sky_less && !i_less) dominated = true;
+          else if (i_less && !sky_less)
+            { sky[j] = sky.back(); sky.pop_back(); }
+          else ++j;
+        }
+      if (!dominated) sky.push_back(i);
+    }
+  stop = utils::process_timer_now();
+  std::cout << (stop - start) << "sec (" << sky.size() << ")" << std::endl;
+  total += stop - start;
+}
+
+//! Stops after k elements, counting only the elements that match a region
+//! when one is given.
+template <typename Rank, typename Predicate>
+struct knn_visitor
+{
+  knn_visitor(std::size_t k, Rank rank, const Predicate& pred)
+    : count(0), limit(k), _rank(rank), _pred(pred) { }
+  template <typename Iterator>
+  bool operator()(Iterator i, double)
+  {
+    if (spatial::details::match_key(_rank, *i, _pred)) ++count;
+    return count < limit;
+  }
+  std::size_t count;
+  std::size_t limit;
+  Rank _rank;
+  Predicate _pred;
+};
+
+//! Compares the k nearest elements in a small region found by filtering the
+//! elements given by for_each_neighbor(), with the same search done by
+//! for_each_neighbor_in_region().
+template <typename Container, typename Point>
+void compare_region_knn(const Container& cobaye, const char* name)
+{
+  typedef spatial::bounds<Point, typename Container::key_compare> bounds_type;
+  typedef typename Container::rank_type rank_type;
+  Point low(-10.0), high(10.0);
+  low[0] = 0.5; high[0] = 0.6;
+  low[1] = 0.5; high[1] = 0.6;
+  bounds_type region = make_bounds(cobaye, low, high);
+  std::vector<Point> targets;
+  utils::random_engine engine(1234);
+  utils::uniform_double_distribution uniform(engine, -1.0, 1.0);
+  for (int i = 0; i < 100; ++i) targets.push_back(Point(uniform));
+  spatial::details::Any_region any;
+  std::cout << "\t\t" << name << " (knn, filtered):\t" << std::flush;
+  utils::time_point start = utils::process_timer_now();
+  std::size_t count = 0;
+  for (std::size_t t = 0; t < targets.size(); ++t)
+    count += for_each_neighbor
+      (cobaye, targets[t],
+       knn_visitor<rank_type, bounds_type>(10, cobaye.rank(), region)).count;
+  utils::time_point stop = utils::process_timer_now();
+  std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+  total += stop - start;
+  std::cout << "\t\t" << name << " (knn, in region):\t" << std::flush;
+  start = utils::process_timer_now();
+  count = 0;
+  for (std::size_t t = 0; t < targets.size(); ++t)
+    count += for_each_neighbor_in_region
+      (cobaye, targets[t], region,
+       knn_visitor<rank_type, spatial::details::Any_region>
+       (10, cobaye.rank(), any)).count;
+  stop = utils::process_timer_now();
+  std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+  total += stop - start;
+}
+
 template <spatial::dimension_type N, typename Point, typename Distribution>
 void compare_libraries
 (std::size_t data_size, const Distribution& distribution)
@@ -40,6 +185,20 @@ void compare_libraries
     stop = utils::process_timer_now();
     std::cout << (stop - start) << "sec" << std::endl;
     total += stop - start;
+    std::cout << "\t\tidle_point_multiset (for_each):\t" << std::flush;
+    start = utils::process_timer_now();
+    std::size_t visited
+      = for_each_in_region(cobaye, p0, p1, count_visitor()).count;
+    stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << visited << ")" << std::endl;
+    total += stop - start;
+    std::cout << "\t\tidle_point_multiset (count):\t" << std::flush;
+    start = utils::process_timer_now();
+    std::size_t count = region_count(cobaye, p0, p1);
+    stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+    total += stop - start;
+    compare_tiles<spatial::idle_point_multiset<N, Point>, Point>(cobaye, "idle_point_multiset");
   }
   {
     spatial::point_multiset<N, Point> cobaye;
@@ -59,6 +218,23 @@ void compare_libraries
     stop = utils::process_timer_now();
     std::cout << (stop - start) << "sec" << std::endl;
     total += stop - start;
+    std::cout << "\t\tpoint_multiset (for_each):\t" << std::flush;
+    start = utils::process_timer_now();
+    std::size_t visited
+      = for_each_in_region(cobaye, p0, p1, count_visitor()).count;
+    stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << visited << ")" << std::endl;
+    total += stop - start;
+    std::cout << "\t\tpoint_multiset (count):\t" << std::flush;
+    start = utils::process_timer_now();
+    std::size_t count = region_count(cobaye, p0, p1);
+    stop = utils::process_timer_now();
+    std::cout << (stop - start) << "sec (" << count << ")" << std::endl;
+    total += stop - start;
+    compare_tiles<spatial::point_multiset<N, Point>, Point>(cobaye, "point_multiset");
+    compare_skyline(cobaye, "point_multiset");
+    compare_region_knn<spatial::point_multiset<N, Point>, Point>
+      (cobaye, "point_multiset");
   }
 }
 
@@ -8,6 +8,7 @@
 #define BOOST_TEST_DYN_LINK
 #define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
 
+#include <vector>
 #include <boost/test/unit_test.hpp>
 #include "../../src/bits/spatial_condition.hpp"
 #include "../../src/bits/spatial_rank.hpp"
@@ -52,6 +53,40 @@ BOOST_AUTO_TEST_CASE( test_details_incr_decr_dim_dynamic )
   BOOST_CHECK_EQUAL(decr_dim(rank, 1), 0u);
 }
 
+//! Records the dimensions given by for_each_dim(), and stops at \c last.
+struct record_dims
+{
+  explicit record_dims(dimension_type l) : last(l) { }
+  bool operator()(dimension_type dim)
+  { dims.push_back(dim); return dim != last; }
+  dimension_type last;
+  std::vector<dimension_type> dims;
+};
+
+//! Checks that for_each_dim() gives all dimensions of \c rank in order,
+//! and stops when the functor returns false.
+template <typename Rank>
+void check_for_each_dim(Rank rank)
+{
+  record_dims all(rank());
+  BOOST_CHECK(details::for_each_dim(rank, all));
+  BOOST_REQUIRE_EQUAL(all.dims.size(), rank());
+  for (dimension_type i = 0; i < rank(); ++i)
+    BOOST_CHECK_EQUAL(all.dims[i], i);
+  record_dims half(rank() / 2);
+  BOOST_CHECK(!details::for_each_dim(rank, half));
+  BOOST_CHECK_EQUAL(half.dims.size(), rank() / 2 + 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_details_for_each_dim )
+{
+  check_for_each_dim(details::Static_rank<1>());
+  check_for_each_dim(details::Static_rank<7>());
+  check_for_each_dim(details::Static_rank<details::max_unrolled_rank>());
+  check_for_each_dim(details::Static_rank<details::max_unrolled_rank + 3>());
+  check_for_each_dim(details::Dynamic_rank(5));
+}
+
 BOOST_AUTO_TEST_CASE( test_details_template_swap )
 {
   int2 z = zeros;
@@ -8,9 +8,12 @@
 #define BOOST_TEST_DYN_LINK
 #define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
 
+#include <vector>
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
-#include "../../src/equal_iterator.hpp"
 #include "spatial_test_fixtures.hpp"
+#include "../../src/equal_iterator.hpp"
+#include "../../src/region_iterator.hpp"
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(test_equal_basics, Tp, every_quad)
 {
@@ -299,3 +302,137 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( test_equal_decrement, Tp, quad_sets )
     BOOST_CHECK(j == equal_begin(fix.container, model));
   }
 }
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_equal_count, Tp, every_quad )
+{
+  typedef typename Tp::container_type container_type;
+  {
+    Tp fix(0);
+    BOOST_CHECK_EQUAL(fix.container.count(quad(0, 0, 0, 0)), 0u);
+  }
+  {
+    // Many duplicates, so that whole sub-trees are equal to the key
+    Tp fix(1000, randomize(-2, 2));
+    const container_type& container = fix.container;
+    for (typename container_type::const_iterator i = container.begin();
+         i != container.end(); ++i)
+      {
+        const quad& key = details::const_key(i.node);
+        BOOST_CHECK_EQUAL
+          (container.count(key),
+           static_cast<size_type>(std::distance(equal_begin(container, key),
+                                                equal_end(container, key))));
+      }
+    BOOST_CHECK_EQUAL(container.count(quad(2, 2, 2, 2)), 0u);
+    BOOST_CHECK_EQUAL(container.count(quad(-1, -1, -1, 2)), 0u);
+  }
+  {
+    Tp fix(100, same());
+    BOOST_CHECK_EQUAL(fix.container.count(quad(100, 100, 100, 100)), 100u);
+    BOOST_CHECK_EQUAL(fix.container.count(quad(100, 100, 100, 99)), 0u);
+  }
+}
+
+//! Hashes an \c int2, for the equal index of the containers.
+struct int2_hash
+{
+  std::size_t operator()(const int2& key) const
+  { return static_cast<std::size_t>(key[0] * 31 + key[1]); }
+};
+
+BOOST_AUTO_TEST_CASE( test_equal_index )
+{
+  typedef point_multiset<2, int2, bracket_less<int2>, loose_balancing,
+                         std::allocator<int2>, void, int2_hash> indexed_type;
+  indexed_type container;
+  BOOST_CHECK(container.find(int2(0, 0)) == container.end());
+  BOOST_CHECK_EQUAL(container.erase(int2(0, 0)), 0u);
+  std::vector<int2> keys;
+  for (int i = 0; i < 1000; ++i)
+    {
+      int2 key(std::rand() % 10 - 5, std::rand() % 10 - 5);
+      keys.push_back(key);
+      container.insert(key);
+    }
+  for (int x = -6; x < 6; ++x)
+    for (int y = -6; y < 6; ++y)
+      {
+        int2 key(x, y);
+        size_type expected
+          = static_cast<size_type>(std::count(keys.begin(), keys.end(), key));
+        BOOST_CHECK_EQUAL(container.count(key), expected);
+        indexed_type::const_iterator i = container.find(key);
+        if (expected == 0) { BOOST_CHECK(i == container.end()); }
+        else { BOOST_REQUIRE(i != container.end()); BOOST_CHECK(*i == key); }
+      }
+  // Copies and swaps index their own nodes
+  indexed_type copy(container);
+  indexed_type other;
+  other.insert(int2(100, 100));
+  other = copy;
+  BOOST_CHECK(other.find(int2(100, 100)) == other.end());
+  other.swap(copy);
+  indexed_type::iterator i = copy.find(keys.front());
+  BOOST_REQUIRE(i != copy.end());
+  BOOST_CHECK(std::find(copy.begin(), copy.end(), *i) != copy.end());
+  // Erasing through the index keeps the tree and the index in sync
+  size_type before = container.size();
+  size_type erased = container.erase(keys.front());
+  BOOST_CHECK_EQUAL(erased,
+                    static_cast<size_type>(std::count(keys.begin(), keys.end(),
+                                                      keys.front())));
+  BOOST_CHECK_EQUAL(container.size(), before - erased);
+  BOOST_CHECK(container.find(keys.front()) == container.end());
+  BOOST_CHECK_EQUAL(container.count(keys.front()), 0u);
+  while (!container.empty())
+    {
+      int2 key = *container.begin();
+      container.erase(container.begin());
+      indexed_type::iterator j = container.find(key);
+      BOOST_CHECK(j == container.end() || *j == key);
+    }
+  BOOST_CHECK(container.find(keys.back()) == container.end());
+  copy.clear();
+  BOOST_CHECK(copy.find(keys.back()) == copy.end());
+  BOOST_CHECK(other.find(keys.back()) != other.end());
+}
+
+//! Counts the elements of a container, for the aggregate of its nodes.
+struct count_elements
+{
+  typedef size_type aggregate_type;
+  aggregate_type identity() const { return 0; }
+  aggregate_type map(const int2&) const { return 1; }
+  aggregate_type combine(aggregate_type a, aggregate_type b) const
+  { return a + b; }
+};
+
+BOOST_AUTO_TEST_CASE( test_equal_index_duplicates )
+{
+  // The nodes hold both the aggregate and their position in the index
+  typedef point_multiset<2, int2, bracket_less<int2>, loose_balancing,
+                         std::allocator<int2>, count_elements, int2_hash>
+    indexed_type;
+  indexed_type container;
+  for (int i = 0; i < 2000; ++i)
+    container.insert(int2(std::rand() % 3, std::rand() % 2));
+  int2 l(0, 0), h(3, 2);
+  size_type remaining = container.size();
+  while (!container.empty())
+    {
+      // Erase duplicates from the middle of their chains
+      indexed_type::iterator i = container.begin();
+      std::advance(i, static_cast<std::ptrdiff_t>
+                 (static_cast<size_type>(std::rand()) % remaining));
+      int2 key = *i;
+      size_type count = container.count(key);
+      container.erase(i);
+      --remaining;
+      BOOST_CHECK_EQUAL(container.count(key), count - 1);
+      BOOST_CHECK_EQUAL(container.find(key) == container.end(), count == 1);
+      BOOST_CHECK_EQUAL(region_aggregate(container, l, h), remaining);
+    }
+  for (int i = 0; i < 100; ++i) container.insert(int2(1, 1));
+  BOOST_CHECK_EQUAL(container.erase(int2(1, 1)), 100u);
+  BOOST_CHECK(container.empty());
+}
@@ -0,0 +1,345 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#define BOOST_TEST_DYN_LINK
+#define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
+
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#include <boost/test/unit_test.hpp>
+#include "spatial_test_fixtures.hpp"
+#include "../../src/join.hpp"
+
+/**
+ *  Checks the neighbors given for each element against a brute force
+ *  computation of the distance to all other elements in the container.
+ */
+template <typename Container, typename Metric>
+struct check_all_neighbors
+{
+  typedef typename Container::const_iterator const_iterator;
+  typedef typename Metric::distance_type distance_type;
+
+  check_all_neighbors(const Container& c, const Metric& m, std::size_t n)
+    : container(&c), metric(m), k(n), count(0) { }
+
+  void operator()
+  (const_iterator element,
+   const std::vector<std::pair<const_iterator, distance_type> >& neighbors)
+  {
+    std::vector<distance_type> expected;
+    for (const_iterator i = container->begin(); i != container->end(); ++i)
+      {
+        if (i == element) continue;
+        expected.push_back(metric.distance_to_key
+                           (container->dimension(), *element, *i));
+      }
+    std::sort(expected.begin(), expected.end());
+    if (expected.size() > k) expected.resize(k);
+    BOOST_REQUIRE_EQUAL(neighbors.size(), expected.size());
+    for (std::size_t i = 0; i < neighbors.size(); ++i)
+      {
+        const_iterator neighbor = neighbors[i].first;
+        BOOST_CHECK(neighbor != element);
+        BOOST_CHECK_CLOSE(static_cast<double>(neighbors[i].second),
+                          static_cast<double>(expected[i]), .0000000001);
+        BOOST_CHECK_CLOSE(static_cast<double>(neighbors[i].second),
+                          static_cast<double>
+                          (metric.distance_to_key(container->dimension(),
+                                                  *element, *neighbor)),
+                          .0000000001);
+      }
+    ++count;
+  }
+
+  const Container* container;
+  Metric metric;
+  std::size_t k;
+  std::size_t count;
+};
+
+template <typename Container>
+check_all_neighbors<Container,
+                    euclidian<Container, double,
+                              typename details::with_builtin_difference
+                              <Container>::type> >
+make_check_all_neighbors(const Container& container, std::size_t k)
+{
+  return check_all_neighbors
+    <Container, euclidian<Container, double,
+                          typename details::with_builtin_difference
+                          <Container>::type> >
+    (container,
+     euclidian<Container, double,
+               typename details::with_builtin_difference<Container>::type>
+     (details::with_builtin_difference<Container>()(container)), k);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_all_neighbors_empty, Tp, double6_sets )
+{
+  Tp fix(0);
+  BOOST_CHECK_EQUAL(all_neighbors(fix.container, 3,
+                                  make_check_all_neighbors(fix.container, 3))
+                    .count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_all_neighbors_small, Tp, double6_sets )
+{
+  {
+    Tp fix(1, randomize(-20, 20));
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix.container, 3,
+                       make_check_all_neighbors(fix.container, 3)).count, 1u);
+  }
+  {
+    Tp fix(5, randomize(-20, 20));
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix.container, 0,
+                       make_check_all_neighbors(fix.container, 0)).count, 5u);
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix.container, 10,
+                       make_check_all_neighbors(fix.container, 10)).count, 5u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_all_neighbors, Tp, double6_sets )
+{
+  {
+    Tp fix(100, randomize(-20, 20));
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix.container, 1,
+                       make_check_all_neighbors(fix.container, 1)).count,
+                      100u);
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix.container, 7,
+                       make_check_all_neighbors(fix.container, 7)).count,
+                      100u);
+  }
+  {
+    // All elements are the same, all distances are null
+    Tp fix(50, same());
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix.container, 4,
+                       make_check_all_neighbors(fix.container, 4)).count,
+                      50u);
+  }
+  {
+    // Very unbalanced trees
+    Tp fix1(40, increase());
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix1.container, 3,
+                       make_check_all_neighbors(fix1.container, 3)).count,
+                      40u);
+    Tp fix2(40, decrease());
+    BOOST_CHECK_EQUAL(all_neighbors
+                      (fix2.container, 3,
+                       make_check_all_neighbors(fix2.container, 3)).count,
+                      40u);
+  }
+}
+
+#ifdef _OPENMP
+/**
+ *  Records the keys of the neighbors given for each element, and their
+ *  distances, in the order in which the elements are visited.
+ */
+template <typename Container>
+struct record_all_neighbors
+{
+  typedef typename Container::const_iterator const_iterator;
+  typedef std::vector<std::pair<const_iterator, double> > neighbor_list;
+
+  void operator()(const_iterator element, const neighbor_list& neighbors)
+  {
+    elements.push_back(&*element);
+    for (typename neighbor_list::const_iterator i = neighbors.begin();
+         i != neighbors.end(); ++i)
+      {
+        const_iterator neighbor = i->first;
+        keys.push_back(&*neighbor);
+        distances.push_back(i->second);
+      }
+  }
+
+  std::vector<const typename Container::value_type*> elements;
+  std::vector<const typename Container::value_type*> keys;
+  std::vector<double> distances;
+};
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_all_neighbors_parallel, Tp, double6_sets )
+{
+  // The sub-trees searched in parallel give the same neighbors as a single
+  // thread, with enough elements to cut the tree in many tasks
+  typedef typename Tp::container_type container_type;
+  Tp fix(2000, randomize(-20, 20));
+  int threads = omp_get_max_threads();
+  omp_set_num_threads(1);
+  record_all_neighbors<container_type> serial
+    = all_neighbors(fix.container, 5, record_all_neighbors<container_type>());
+  omp_set_num_threads(threads < 4 ? 4 : threads);
+  record_all_neighbors<container_type> parallel
+    = all_neighbors(fix.container, 5, record_all_neighbors<container_type>());
+  omp_set_num_threads(threads);
+  BOOST_CHECK_EQUAL(serial.elements.size(), 2000u);
+  BOOST_CHECK(serial.elements == parallel.elements);
+  BOOST_CHECK(serial.keys == parallel.keys);
+  BOOST_CHECK(serial.distances == parallel.distances);
+  BOOST_CHECK_EQUAL(all_neighbors
+                    (fix.container, 5,
+                     make_check_all_neighbors(fix.container, 5)).count,
+                    2000u);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_all_neighbors_metric, Tp, quad_sets )
+{
+  // Many elements with equal keys and integer distances
+  Tp fix(100, randomize(-3, 3));
+  typedef quadrance<typename Tp::container_type, int, quad_diff> metric_type;
+  BOOST_CHECK_EQUAL(all_neighbors
+                    (fix.container, metric_type(), 5,
+                     check_all_neighbors
+                     <typename Tp::container_type, metric_type>
+                     (fix.container, metric_type(), 5)).count, 100u);
+}
+
+/**
+ *  Checks the pairs given against the distances between their elements, and
+ *  counts them.
+ */
+template <typename ContainerA, typename ContainerB, typename Metric>
+struct check_distance_join
+{
+  typedef typename Metric::distance_type distance_type;
+
+  check_distance_join(const Metric& m, distance_type r)
+    : metric(m), radius(r), count(0) { }
+
+  void operator()(typename ContainerA::const_iterator a,
+                  typename ContainerB::const_iterator b, distance_type dist)
+  {
+    BOOST_CHECK_LE(dist, radius);
+    BOOST_CHECK_CLOSE(static_cast<double>(dist),
+                      static_cast<double>
+                      (metric.distance_to_key
+                       (dimension_traits<typename ContainerA::key_type>::value,
+                        *a, *b)), .0000000001);
+    ++count;
+  }
+
+  Metric metric;
+  distance_type radius;
+  std::size_t count;
+};
+
+template <typename ContainerA, typename ContainerB, typename Metric>
+std::size_t brute_distance_join(const ContainerA& a, const ContainerB& b,
+                                const Metric& metric,
+                                typename Metric::distance_type radius)
+{
+  std::size_t count = 0;
+  for (typename ContainerA::const_iterator i = a.begin(); i != a.end(); ++i)
+    for (typename ContainerB::const_iterator j = b.begin(); j != b.end(); ++j)
+      if (!(radius < metric.distance_to_key(a.dimension(), *i, *j))) ++count;
+  return count;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_distance_join, Tp, double6_sets )
+{
+  typedef typename Tp::container_type container_type;
+  typedef euclidian<container_type, double,
+                    typename details::with_builtin_difference
+                    <container_type>::type> metric_type;
+  typedef check_distance_join<container_type, container_type, metric_type>
+    check_type;
+  {
+    // Empty containers produce no pairs
+    Tp fix1(0);
+    Tp fix2(10, randomize(-20, 20));
+    BOOST_CHECK_EQUAL(distance_join(fix1.container, fix2.container, 10.0,
+                                    check_type(metric_type(), 10.0)).count,
+                      0u);
+    BOOST_CHECK_EQUAL(distance_join(fix2.container, fix1.container, 10.0,
+                                    check_type(metric_type(), 10.0)).count,
+                      0u);
+  }
+  {
+    Tp fix1(100, randomize(-20, 20));
+    Tp fix2(70, randomize(-20, 20));
+    const double radii[] = { 0.0, 5.0, 20.0, 100.0 };
+    for (int i = 0; i < 4; ++i)
+      {
+        std::size_t expected = brute_distance_join
+          (fix1.container, fix2.container, metric_type(), radii[i]);
+        BOOST_CHECK_EQUAL(distance_join(fix1.container, fix2.container,
+                                        radii[i],
+                                        check_type(metric_type(), radii[i]))
+                          .count, expected);
+        BOOST_CHECK_EQUAL(parallel_distance_join
+                          (fix1.container, fix2.container, radii[i],
+                           check_type(metric_type(), radii[i])).count,
+                          expected);
+      }
+  }
+  {
+    // Joining a container with itself at a null distance
+    Tp fix(50, same());
+    BOOST_CHECK_EQUAL(distance_join(fix.container, fix.container, 0.0,
+                                    check_type(metric_type(), 0.0)).count,
+                      2500u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_distance_join_mixed, Tp, quad_sets )
+{
+  // Join between different types of containers, with integer distances
+  typedef typename Tp::container_type container_type;
+  typedef idle_point_multiset<4, quad, quad_less> other_type;
+  typedef manhattan<container_type, int, quad_diff> metric_type;
+  Tp fix(100, randomize(-10, 10));
+  other_type other;
+  for (int i = 0; i < 80; ++i)
+    {
+      quad q;
+      randomize(-10, 10)(q, i, 80);
+      other.insert(q);
+    }
+  other.rebalance();
+  std::size_t expected
+    = brute_distance_join(fix.container, other, metric_type(), 6);
+  BOOST_CHECK_EQUAL
+    (distance_join(fix.container, other, metric_type(), 6,
+                   check_distance_join<container_type, other_type,
+                   metric_type>(metric_type(), 6)).count, expected);
+  BOOST_CHECK_EQUAL
+    (parallel_distance_join(other, fix.container, metric_type(), 6,
+                            check_distance_join<other_type, container_type,
+                            metric_type>(metric_type(), 6)).count, expected);
+}
+
+BOOST_AUTO_TEST_CASE( test_distance_join_rank )
+{
+  point_multiset<0, double6> a(6);
+  point_multiset<0, double6> b(5);
+  typedef euclidian<point_multiset<0, double6>, double,
+                    bracket_minus<double6, double> > metric_type;
+  BOOST_CHECK_THROW
+    (distance_join(a, b, 1.0,
+                   check_distance_join<point_multiset<0, double6>,
+                   point_multiset<0, double6>, metric_type>
+                   (metric_type(), 1.0)), invalid_rank);
+}
@@ -8,8 +8,10 @@
 #define BOOST_TEST_DYN_LINK
 #define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
 
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
 #include "../../src/mapping_iterator.hpp"
+#include "../../src/region_iterator.hpp"
 #include "spatial_test_fixtures.hpp"
 
 BOOST_AUTO_TEST_CASE_TEMPLATE
@@ -647,3 +649,98 @@ BOOST_AUTO_TEST_CASE_TEMPLATE
     BOOST_CHECK(pair2.second == mapping_cend(fix.container, 3u));
   }
 }
+
+//! Returns the coordinates along dimension dim of the elements pointed to by
+//! the iterators in found, and checks that they are all different.
+template <typename Iterator>
+std::vector<int>
+quad_coordinates(const std::vector<Iterator>& found, dimension_type dim)
+{
+  std::vector<int> coords;
+  std::vector<typename Iterator::node_ptr> nodes;
+  for (std::size_t i = 0; i < found.size(); ++i)
+    {
+      coords.push_back(quad_access()(dim, details::const_key(found[i].node)));
+      nodes.push_back(found[i].node);
+    }
+  std::sort(nodes.begin(), nodes.end());
+  BOOST_CHECK(std::adjacent_find(nodes.begin(), nodes.end()) == nodes.end());
+  return coords;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_top_k_mapping, Tp, every_quad )
+{
+  typedef typename Tp::container_type container_type;
+  typedef typename container_type::const_iterator const_iterator;
+  {
+    Tp fix(0);
+    std::vector<const_iterator> found;
+    top_k_mapping(fix.container, 0, 3, std::back_inserter(found));
+    BOOST_CHECK(found.empty());
+    BOOST_CHECK_THROW(top_k_mapping(fix.container, 4, 3,
+                                    std::back_inserter(found)),
+                      invalid_dimension);
+    BOOST_CHECK_THROW(bottom_k_mapping(fix.container, 4, 3,
+                                       std::back_inserter(found)),
+                      invalid_dimension);
+  }
+  Tp fix(300, randomize(-50, 50));
+  const container_type& container = fix.container;
+  quad lower(-30, -30, -30, -30), upper(30, 30, 30, 30);
+  const size_type ks[] = { 0, 1, 7, 100, 300, 1000 };
+  for (dimension_type dim = 0; dim < 4; ++dim)
+    {
+      std::vector<int> all, region;
+      for (const_iterator i = container.begin(); i != container.end(); ++i)
+        {
+          const quad& key = details::const_key(i.node);
+          all.push_back(quad_access()(dim, key));
+          if (key.x >= -30 && key.x <= 30 && key.y >= -30 && key.y <= 30
+              && key.z >= -30 && key.z <= 30 && key.w >= -30 && key.w <= 30)
+            region.push_back(quad_access()(dim, key));
+        }
+      std::sort(all.begin(), all.end());
+      std::sort(region.begin(), region.end());
+      for (std::size_t j = 0; j < sizeof(ks) / sizeof(ks[0]); ++j)
+        {
+          size_type k = ks[j];
+          std::vector<const_iterator> found;
+          bottom_k_mapping(container, dim, k, std::back_inserter(found));
+          std::vector<int> coords = quad_coordinates(found, dim);
+          BOOST_CHECK_EQUAL_COLLECTIONS
+            (coords.begin(), coords.end(), all.begin(),
+             all.begin() + static_cast<std::ptrdiff_t>
+             (std::min(k, all.size())));
+          found.clear();
+          top_k_mapping(container, dim, k, std::back_inserter(found));
+          coords = quad_coordinates(found, dim);
+          BOOST_CHECK_EQUAL_COLLECTIONS
+            (coords.begin(), coords.end(), all.rbegin(),
+             all.rbegin() + static_cast<std::ptrdiff_t>
+             (std::min(k, all.size())));
+          found.clear();
+          top_k_mapping(container, dim, k,
+                        make_closed_bounds(container, lower, upper),
+                        std::back_inserter(found));
+          coords = quad_coordinates(found, dim);
+          BOOST_CHECK_EQUAL_COLLECTIONS
+            (coords.begin(), coords.end(), region.rbegin(),
+             region.rbegin() + static_cast<std::ptrdiff_t>
+             (std::min(k, region.size())));
+          found.clear();
+          bottom_k_mapping(container, dim, k,
+                           make_closed_bounds(container, lower, upper),
+                           std::back_inserter(found));
+          coords = quad_coordinates(found, dim);
+          BOOST_CHECK_EQUAL_COLLECTIONS
+            (coords.begin(), coords.end(), region.begin(),
+             region.begin() + static_cast<std::ptrdiff_t>
+             (std::min(k, region.size())));
+        }
+    }
+  // Mutable iterators are written for a mutable container
+  std::vector<typename container_type::iterator> mutable_found;
+  top_k_mapping(fix.container, 2, 5, std::back_inserter(mutable_found));
+  BOOST_CHECK_EQUAL(mutable_found.size(), 5u);
+}
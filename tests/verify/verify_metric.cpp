@@ -9,6 +9,7 @@
 #define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
 
 #include <boost/test/unit_test.hpp>
+#include <boost/array.hpp>
 #include "../../src/metric.hpp"
 #include "spatial_test_fixtures.hpp"
 
@@ -188,3 +189,736 @@ BOOST_AUTO_TEST_CASE( test_manhattan_distance_to_key )
       }
   }
 }
+
+//! Compares the distances between contiguous keys of \c Tp, computed with
+//! bracket_minus, with a sum over each coordinate, for ranks that do and do
+//! not fill the vector registers.
+template <typename Tp>
+void check_contiguous_distance_to_key()
+{
+  typedef std::vector<Tp> key_type;
+  typedef bracket_minus<key_type, Tp> diff_type;
+  for (dimension_type rank = 1; rank < 40; ++rank)
+    {
+      key_type p(rank), q(rank);
+      for (dimension_type i = 0; i < rank; ++i)
+        {
+          p[i] = static_cast<Tp>(std::rand() % 80 - 40);
+          q[i] = static_cast<Tp>(std::rand() % 80 - 40);
+        }
+      Tp square = Tp(), sum = Tp();
+      for (dimension_type i = 0; i < rank; ++i)
+        {
+          square += (p[i] - q[i]) * (p[i] - q[i]);
+          sum += (p[i] < q[i]) ? q[i] - p[i] : p[i] - q[i];
+        }
+      // Integral coordinates are summed exactly, in any order
+      BOOST_CHECK_EQUAL((math::square_euclid_distance_to_key
+                         <key_type, diff_type, Tp>
+                         (rank, p, q, diff_type())), square);
+      BOOST_CHECK_EQUAL((math::manhattan_distance_to_key
+                         <key_type, diff_type, Tp>
+                         (rank, p, q, diff_type())), sum);
+      BOOST_CHECK_EQUAL((math::square_euclid_distance_to_key
+                         <key_type, diff_type, Tp>
+                         (rank, p, p, diff_type())), Tp());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_contiguous_distance_to_key )
+{
+  BOOST_CHECK((!details::simd_distance
+               <int2, bracket_minus<int2, int>, int>::value));
+  BOOST_CHECK((!details::simd_distance
+               <std::vector<float>, bracket_minus<std::vector<float>, double>,
+                double>::value));
+  check_contiguous_distance_to_key<double>();
+  check_contiguous_distance_to_key<float>();
+  check_contiguous_distance_to_key<int>();
+  // Through a metric, with a rank known at run time
+  typedef point_multiset<0, std::vector<double> > container_type;
+  euclidian<container_type, double,
+            bracket_minus<std::vector<double>, double> > metric;
+  std::vector<double> p(17, 1.0), q(17, 1.0);
+  q[16] = 4.0; q[3] = -3.0;
+  BOOST_CHECK_CLOSE(metric.distance_to_key(17, p, q), 5.0, .0000001);
+}
+
+BOOST_AUTO_TEST_CASE( test_contiguous_arrays )
+{
+  BOOST_CHECK((contiguous_key<double[3]>::value));
+  BOOST_CHECK((contiguous_key<boost::array<float, 5> >::value));
+  BOOST_CHECK((contiguous_key<import::array<int, 2> >::value));
+  BOOST_CHECK((!contiguous_key<int2>::value));
+  BOOST_CHECK((import::is_same<contiguous_key<double6>::value_type,
+                               double>::value));
+  // Keys that are arrays give the same distances as vectors
+  typedef bracket_minus<double6, double> diff_type;
+  typedef bracket_minus<std::vector<double>, double> vector_diff_type;
+  for (int i = 0; i < 100; ++i)
+    {
+      double6 p, q;
+      randomize(-40, 40)(p, 0, 0);
+      randomize(-40, 40)(q, 0, 0);
+      std::vector<double> vp(p.begin(), p.end()), vq(q.begin(), q.end());
+      BOOST_CHECK_CLOSE((math::square_euclid_distance_to_key
+                         <double6, diff_type, double>
+                         (6, p, q, diff_type())),
+                        (math::square_euclid_distance_to_key
+                         <std::vector<double>, vector_diff_type, double>
+                         (6, vp, vq, vector_diff_type())), .0000001);
+      BOOST_CHECK_CLOSE((math::manhattan_distance_to_key
+                         <double6, diff_type, double>
+                         (6, p, q, diff_type())),
+                        (math::manhattan_distance_to_key
+                         <std::vector<double>, vector_diff_type, double>
+                         (6, vp, vq, vector_diff_type())), .0000001);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_static_rank_distance_to_key )
+{
+  // The distances computed with a static rank, in unrolled loops, equal the
+  // distances computed with the same rank given at run time.
+  typedef point_multiset<4, quad, quad_less> static_type;
+  typedef point_multiset<0, quad, quad_less> dynamic_type;
+  typedef accessor_minus<quad_access, quad, int> diff_type;
+  typedef accessor_minus<quad_access, quad, double> double_diff_type;
+  for (int i = 0; i < 100; ++i)
+    {
+      quad p, q;
+      randomize(-40, 40)(p, 0, 0);
+      randomize(-40, 40)(q, 0, 0);
+      BOOST_CHECK_EQUAL
+        ((quadrance<static_type, int, diff_type>().distance_to_key(4, p, q)),
+         (quadrance<dynamic_type, int, diff_type>()
+          .distance_to_key(4, p, q)));
+      BOOST_CHECK_EQUAL
+        ((manhattan<static_type, int, diff_type>().distance_to_key(4, p, q)),
+         (manhattan<dynamic_type, int, diff_type>()
+          .distance_to_key(4, p, q)));
+      BOOST_CHECK_EQUAL
+        ((euclidian<static_type, double, double_diff_type>()
+          .distance_to_key(4, p, q)),
+         (euclidian<dynamic_type, double, double_diff_type>()
+          .distance_to_key(4, p, q)));
+    }
+}
+
+template <typename Metric, typename Key>
+void check_distance_to_key_bounded(const Metric& met, dimension_type rank,
+                                   const Key& p, const Key& q,
+                                   typename Metric::distance_type bound)
+{
+  typename Metric::distance_type dist = met.distance_to_key(rank, p, q);
+  typename Metric::distance_type partial
+    = met.distance_to_key_bounded(rank, p, q, bound);
+  if (dist <= bound) { BOOST_CHECK_EQUAL(partial, dist); }
+  else { BOOST_CHECK(partial > bound && partial <= dist); }
+}
+
+BOOST_AUTO_TEST_CASE( test_distance_to_key_bounded )
+{
+  // The distance is exact when it is not greater than the bound; otherwise
+  // the partial distance is greater than the bound, and not greater than the
+  // distance.
+  typedef point_multiset<4, quad, quad_less> static_type;
+  typedef point_multiset<0, quad, quad_less> dynamic_type;
+  typedef accessor_minus<quad_access, quad, int> diff_type;
+  typedef accessor_minus<quad_access, quad, double> double_diff_type;
+  typedef point_multiset<0, std::vector<int> > vector_type;
+  typedef bracket_minus<std::vector<int>, int> vector_diff_type;
+  BOOST_CHECK((details::bounded_distance
+               <quadrance<static_type, int, diff_type> >::value));
+  BOOST_CHECK((!details::bounded_distance
+               <box_quadrance<static_type, int, diff_type> >::value));
+  for (int i = 0; i < 100; ++i)
+    {
+      quad p, q;
+      randomize(-40, 40)(p, 0, 0);
+      randomize(-40, 40)(q, 0, 0);
+      int bound = std::rand() % 6400;
+      check_distance_to_key_bounded
+        (quadrance<static_type, int, diff_type>(), 4, p, q, bound);
+      check_distance_to_key_bounded
+        (quadrance<dynamic_type, int, diff_type>(), 4, p, q, bound);
+      check_distance_to_key_bounded
+        (manhattan<static_type, int, diff_type>(), 4, p, q, bound / 20);
+      check_distance_to_key_bounded
+        (manhattan<dynamic_type, int, diff_type>(), 4, p, q, bound / 20);
+      check_distance_to_key_bounded
+        (euclidian<static_type, double, double_diff_type>(), 4, p, q,
+         std::sqrt(static_cast<double>(bound)));
+      check_distance_to_key_bounded
+        (euclidian<dynamic_type, double, double_diff_type>(), 4, p, q,
+         std::sqrt(static_cast<double>(bound)));
+      // Along more dimensions, bounds reached part way are not exceeded yet
+      std::vector<int> u(11), v(11);
+      for (std::size_t j = 0; j < 11; ++j)
+        { u[j] = std::rand() % 20; v[j] = std::rand() % 20; }
+      int square = 0, sum = 0;
+      for (std::size_t j = 0; j < 11; ++j)
+        {
+          square += (u[j] - v[j]) * (u[j] - v[j]);
+          sum += std::abs(u[j] - v[j]);
+          check_distance_to_key_bounded
+            (quadrance<vector_type, int, vector_diff_type>(), 11, u, v,
+             square);
+          check_distance_to_key_bounded
+            (manhattan<vector_type, int, vector_diff_type>(), 11, u, v, sum);
+        }
+    }
+}
+
+//! Compares the weighted distances between contiguous keys of \c Tp with a
+//! sum over each coordinate, for ranks that do and do not fill the vector
+//! registers.
+template <typename Tp>
+void check_contiguous_weighted_distance_to_key()
+{
+  typedef std::vector<Tp> key_type;
+  typedef bracket_minus<key_type, Tp> diff_type;
+  for (dimension_type rank = 1; rank < 40; ++rank)
+    {
+      key_type p(rank), q(rank), w(rank);
+      for (dimension_type i = 0; i < rank; ++i)
+        {
+          p[i] = static_cast<Tp>(std::rand() % 80 - 40);
+          q[i] = static_cast<Tp>(std::rand() % 80 - 40);
+          w[i] = static_cast<Tp>(std::rand() % 5);
+        }
+      Tp square = Tp(), sum = Tp();
+      for (dimension_type i = 0; i < rank; ++i)
+        {
+          square += w[i] * (p[i] - q[i]) * (p[i] - q[i]);
+          sum += w[i] * ((p[i] < q[i]) ? q[i] - p[i] : p[i] - q[i]);
+        }
+      // Small integral values are summed exactly, in any order
+      BOOST_CHECK_EQUAL((math::weighted_square_euclid_distance_to_key
+                         <key_type, diff_type, Tp>
+                         (details::Dynamic_rank(rank), p, q, diff_type(),
+                          &w[0])), square);
+      BOOST_CHECK_EQUAL((math::weighted_manhattan_distance_to_key
+                         <key_type, diff_type, Tp>
+                         (details::Dynamic_rank(rank), p, q, diff_type(),
+                          &w[0])), sum);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_weighted_distance_to_key )
+{
+  typedef point_multiset<4, quad, quad_less> static_type;
+  typedef point_multiset<0, quad, quad_less> dynamic_type;
+  typedef accessor_minus<quad_access, quad, int> diff_type;
+  typedef accessor_minus<quad_access, quad, double> double_diff_type;
+  typedef weighted_quadrance<static_type, int, diff_type> static_quad;
+  typedef weighted_quadrance<dynamic_type, int, diff_type> dynamic_quad;
+  typedef weighted_manhattan<dynamic_type, int, diff_type> dynamic_manhattan;
+  typedef weighted_euclidian<static_type, double, double_diff_type>
+    static_euclid;
+  BOOST_CHECK((details::bounded_distance<static_quad>::value));
+  BOOST_CHECK((details::nearest_bound<static_euclid>::value));
+  BOOST_CHECK((details::furthest_bound<dynamic_manhattan>::value));
+  int iw[] = { 1, 2, 3, 0 };
+  double dw[] = { 1.0, 4.0, 0.25, 2.0 };
+  static_quad s_quad(iw, iw + 4);
+  dynamic_quad d_quad(iw, iw + 4);
+  dynamic_manhattan d_manhattan(iw, iw + 4);
+  static_euclid s_euclid(dw, dw + 4);
+  // Weights are all 1 by default for a static rank
+  BOOST_CHECK_EQUAL(static_quad().weights()[3], 1);
+  BOOST_CHECK_THROW(static_quad(iw, iw + 3), invalid_rank);
+  BOOST_CHECK_THROW(dynamic_quad(iw, iw), invalid_rank);
+  int negative[] = { 1, -1, 1, 1 };
+  BOOST_CHECK_THROW(dynamic_quad(negative, negative + 4), invalid_distance);
+  for (int i = 0; i < 100; ++i)
+    {
+      quad p, q;
+      randomize(-40, 40)(p, 0, 0);
+      randomize(-40, 40)(q, 0, 0);
+      int square = iw[0] * (p.x - q.x) * (p.x - q.x)
+        + iw[1] * (p.y - q.y) * (p.y - q.y)
+        + iw[2] * (p.z - q.z) * (p.z - q.z)
+        + iw[3] * (p.w - q.w) * (p.w - q.w);
+      int sum = iw[0] * std::abs(p.x - q.x) + iw[1] * std::abs(p.y - q.y)
+        + iw[2] * std::abs(p.z - q.z) + iw[3] * std::abs(p.w - q.w);
+      double euclid = std::sqrt
+        (dw[0] * (p.x - q.x) * (p.x - q.x) + dw[1] * (p.y - q.y) * (p.y - q.y)
+         + dw[2] * (p.z - q.z) * (p.z - q.z)
+         + dw[3] * (p.w - q.w) * (p.w - q.w));
+      BOOST_CHECK_EQUAL(s_quad.distance_to_key(4, p, q), square);
+      BOOST_CHECK_EQUAL(d_quad.distance_to_key(4, p, q), square);
+      BOOST_CHECK_EQUAL(d_manhattan.distance_to_key(4, p, q), sum);
+      BOOST_CHECK_CLOSE(s_euclid.distance_to_key(4, p, q), euclid, .0000001);
+      int bound = std::rand() % 6400;
+      check_distance_to_key_bounded(s_quad, 4, p, q, bound);
+      check_distance_to_key_bounded(d_manhattan, 4, p, q, bound / 20);
+      check_distance_to_key_bounded
+        (s_euclid, 4, p, q, std::sqrt(static_cast<double>(bound)));
+      // The distance to a plane never exceeds the distance to a key on it
+      for (dimension_type dim = 0; dim < 4; ++dim)
+        {
+          BOOST_CHECK_LE(s_quad.distance_to_plane(4, dim, p, q), square);
+          BOOST_CHECK_LE(d_manhattan.distance_to_plane(4, dim, p, q), sum);
+          BOOST_CHECK_LE(s_euclid.distance_to_plane(4, dim, p, q),
+                         euclid * (1 + 1e-12));
+        }
+      BOOST_CHECK_EQUAL(d_quad.distance_to_plane(4, 2, p, q),
+                        iw[2] * (p.z - q.z) * (p.z - q.z));
+      BOOST_CHECK_CLOSE(s_euclid.distance_to_plane(4, 1, p, q) + 1.0,
+                        2.0 * std::abs(p.y - q.y) + 1.0, .0000001);
+    }
+  check_contiguous_weighted_distance_to_key<double>();
+  check_contiguous_weighted_distance_to_key<float>();
+  check_contiguous_weighted_distance_to_key<int>();
+}
+
+//! Compares the chebyshev distances between contiguous keys of \c Tp with
+//! the largest difference over each coordinate.
+template <typename Tp>
+void check_contiguous_chebyshev_distance_to_key()
+{
+  typedef std::vector<Tp> key_type;
+  typedef bracket_minus<key_type, Tp> diff_type;
+  for (dimension_type rank = 1; rank < 40; ++rank)
+    {
+      key_type p(rank), q(rank);
+      for (dimension_type i = 0; i < rank; ++i)
+        {
+          p[i] = static_cast<Tp>(std::rand() % 80 - 40);
+          q[i] = static_cast<Tp>(std::rand() % 80 - 40);
+        }
+      Tp max = Tp();
+      for (dimension_type i = 0; i < rank; ++i)
+        {
+          Tp d = (p[i] < q[i]) ? q[i] - p[i] : p[i] - q[i];
+          if (d > max) max = d;
+        }
+      BOOST_CHECK_EQUAL((math::chebyshev_distance_to_key
+                         <key_type, diff_type, Tp>
+                         (details::Dynamic_rank(rank), p, q, diff_type())),
+                        max);
+    }
+}
+
+//! Returns the exact sum of the squares of the differences between \c p
+//! and \c q.
+template <typename Tp>
+int64_t exact_square_sum(const std::vector<Tp>& p, const std::vector<Tp>& q)
+{
+  int64_t sum = 0;
+  for (std::size_t i = 0; i < p.size(); ++i)
+    {
+      int64_t d = static_cast<int64_t>(p[i]) - static_cast<int64_t>(q[i]);
+      sum += d * d;
+    }
+  return sum;
+}
+
+BOOST_AUTO_TEST_CASE( test_wide_quadrance_distance_to_key )
+{
+  typedef std::vector<short> short_key;
+  typedef std::vector<int> int_key;
+  typedef wide_quadrance<point_multiset<0, short_key>, short,
+                         bracket_minus<short_key, short> > short_metric;
+  typedef wide_quadrance<point_multiset<0, int_key>, int,
+                         bracket_minus<int_key, int> > int_metric;
+  BOOST_CHECK((import::is_same<short_metric::distance_type, int64_t>::value));
+  BOOST_CHECK((details::bounded_distance<int_metric>::value));
+  BOOST_CHECK((details::nearest_bound<int_metric>::value));
+  BOOST_CHECK((details::furthest_bound<int_metric>::value));
+  // The squares of differences over the whole range of short, and of
+  // differences below 2^29 for int, are added exactly, for ranks that use
+  // all the widths of registers
+  for (dimension_type rank = 1; rank < 20; ++rank)
+    for (int i = 0; i < 50; ++i)
+      {
+        short_key sp(rank), sq(rank);
+        int_key ip(rank), iq(rank);
+        for (dimension_type j = 0; j < rank; ++j)
+          {
+            sp[j] = static_cast<short>(std::rand() % 65536 - 32768);
+            sq[j] = static_cast<short>(std::rand() % 65536 - 32768);
+            ip[j] = (std::rand() % 65536 - 32768) * 8192 + std::rand() % 8192;
+            iq[j] = (std::rand() % 65536 - 32768) * 8192 + std::rand() % 8192;
+          }
+        int64_t s = exact_square_sum(sp, sq);
+        int64_t n = exact_square_sum(ip, iq);
+        BOOST_CHECK_EQUAL(short_metric().distance_to_key(rank, sp, sq), s);
+        BOOST_CHECK_EQUAL(int_metric().distance_to_key(rank, ip, iq), n);
+        BOOST_CHECK_EQUAL(int_metric().distance_to_key_bounded
+                          (rank, ip, iq, n), n);
+        int64_t r = int_metric().distance_to_key_bounded(rank, ip, iq, n / 2);
+        BOOST_CHECK_GT(r, n / 2);
+        BOOST_CHECK_LE(r, n);
+      }
+  // The largest differences of int are exact in 2 dimensions
+  int_key p(2), q(2);
+  p[0] = p[1] = 1073741823;
+  q[0] = q[1] = -1073741824;
+  BOOST_CHECK_EQUAL(int_metric().distance_to_key(2, p, q),
+                    exact_square_sum(p, q));
+  BOOST_CHECK_EQUAL(int_metric().distance_to_plane(2, 1, p, q),
+                    exact_square_sum(p, q) / 2);
+  // Keys that are not contiguous are added up one dimension at a time
+  typedef wide_quadrance<point_multiset<2, int2>, int,
+                         bracket_minus<int2, int> > int2_metric;
+  int2 x(1073741823, -5), y(-1073741824, 7);
+  BOOST_CHECK_EQUAL(int2_metric().distance_to_key(2, x, y),
+                    static_cast<int64_t>(2147483647) * 2147483647 + 144);
+}
+
+BOOST_AUTO_TEST_CASE( test_narrow_sum_to_key )
+{
+  // The single precision sums are within (rank + 3) * epsilon of the exact
+  // sums, for ranks that use all the widths of registers
+  typedef bracket_minus<std::vector<double>, double> diff_type;
+  const double eps = std::numeric_limits<float>::epsilon();
+  for (dimension_type rank = 1; rank < 20; ++rank)
+    for (int i = 0; i < 100; ++i)
+      {
+        std::vector<double> p(rank), q(rank);
+        double scale = std::pow(10.0, drand() * 20.0 - 10.0);
+        for (dimension_type j = 0; j < rank; ++j)
+          {
+            p[j] = (drand() - 0.5) * scale + 1000.0;
+            q[j] = (drand() - 0.5) * scale + 1000.0;
+          }
+        double square = math::square_euclid_distance_to_key
+          <std::vector<double>, diff_type, double>(rank, p, q, diff_type());
+        double sum = math::manhattan_distance_to_key
+          <std::vector<double>, diff_type, double>(rank, p, q, diff_type());
+        float narrow_square = math::narrow_square_sum_to_key
+          <std::vector<double>, diff_type, double, float>
+          (details::Dynamic_rank(rank), p, q, diff_type());
+        float narrow_sum = math::narrow_manhattan_sum_to_key
+          <std::vector<double>, diff_type, double, float>
+          (details::Dynamic_rank(rank), p, q, diff_type());
+        BOOST_CHECK_LE(std::abs(narrow_square - square),
+                       static_cast<double>(rank + 3) * eps * square);
+        BOOST_CHECK_LE(std::abs(narrow_sum - sum),
+                       static_cast<double>(rank + 3) * eps * sum);
+      }
+}
+
+BOOST_AUTO_TEST_CASE( test_mixed_precision_distance_to_key )
+{
+  typedef point_multiset<6, double6> container_type;
+  typedef bracket_minus<double6, double> diff_type;
+  typedef euclidian<container_type, double, diff_type> euclid_type;
+  typedef manhattan<container_type, double, diff_type> manhattan_type;
+  typedef mixed_precision<euclid_type> metric_type;
+  BOOST_CHECK((details::bounded_distance<metric_type>::value));
+  BOOST_CHECK((details::nearest_bound<metric_type>::value));
+  BOOST_CHECK((details::furthest_bound<metric_type>::value));
+  metric_type met;
+  mixed_precision<manhattan_type> manh;
+  for (int i = 0; i < 1000; ++i)
+    {
+      double6 p, q;
+      randomize(-20, 20)(p, 0, 0);
+      randomize(-20, 20)(q, 0, 0);
+      dimension_type dim = static_cast<dimension_type>(i % 6);
+      q[dim] += drand() * 1e-3;
+      double d = euclid_type().distance_to_key(6, p, q);
+      double m = manhattan_type().distance_to_key(6, p, q);
+      // The distances are those of the wrapped metric
+      BOOST_CHECK_EQUAL(met.distance_to_key(6, p, q), d);
+      BOOST_CHECK_EQUAL(met.distance_to_key_bounded(6, p, q, d), d);
+      BOOST_CHECK_EQUAL(manh.distance_to_key_bounded(6, p, q, m), m);
+      BOOST_CHECK_EQUAL(met.distance_to_plane(6, dim, p, q),
+                        euclid_type().distance_to_plane(6, dim, p, q));
+      // Below the distance, the result is between the bound and the
+      // distance, whether the key is pruned on its estimate or not
+      double bounds[] = { d * 0.5, d * (1 - 1e-5), d * (1 - 1e-12) };
+      for (int b = 0; b < 3; ++b)
+        {
+          double r = met.distance_to_key_bounded(6, p, q, bounds[b]);
+          BOOST_CHECK_GT(r, bounds[b]);
+          BOOST_CHECK_LE(r, d);
+        }
+      double r = manh.distance_to_key_bounded(6, p, q, m * (1 - 1e-12));
+      BOOST_CHECK_GT(r, m * (1 - 1e-12));
+      BOOST_CHECK_LE(r, m);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_chebyshev_distance_to_key )
+{
+  typedef point_multiset<4, quad, quad_less> static_type;
+  typedef point_multiset<0, quad, quad_less> dynamic_type;
+  typedef accessor_minus<quad_access, quad, int> diff_type;
+  typedef chebyshev<static_type, int, diff_type> static_metric;
+  typedef chebyshev<dynamic_type, int, diff_type> dynamic_metric;
+  BOOST_CHECK((details::bounded_distance<static_metric>::value));
+  BOOST_CHECK((details::furthest_bound<static_metric>::value));
+  for (int i = 0; i < 100; ++i)
+    {
+      quad p, q;
+      randomize(-40, 40)(p, 0, 0);
+      randomize(-40, 40)(q, 0, 0);
+      int max = (std::max)((std::max)(std::abs(p.x - q.x),
+                                      std::abs(p.y - q.y)),
+                           (std::max)(std::abs(p.z - q.z),
+                                      std::abs(p.w - q.w)));
+      BOOST_CHECK_EQUAL(static_metric().distance_to_key(4, p, q), max);
+      BOOST_CHECK_EQUAL(dynamic_metric().distance_to_key(4, p, q), max);
+      int bound = std::rand() % 80;
+      check_distance_to_key_bounded(static_metric(), 4, p, q, bound);
+      check_distance_to_key_bounded(dynamic_metric(), 4, p, q, bound);
+      for (dimension_type dim = 0; dim < 4; ++dim)
+        {
+          BOOST_CHECK_LE(static_metric().distance_to_plane(4, dim, p, q),
+                         max);
+        }
+    }
+  check_contiguous_chebyshev_distance_to_key<double>();
+  check_contiguous_chebyshev_distance_to_key<float>();
+  check_contiguous_chebyshev_distance_to_key<int>();
+}
+
+//! Compares the Minkowski distances of order \c P between keys of rank \c
+//! rank with a sum computed with \c std::pow().
+template <unsigned int P, typename Container, typename Key>
+void check_minkowski_distance_to_key(dimension_type rank, const Key& p,
+                                     const Key& q)
+{
+  typedef minkowski<Container, double, bracket_minus<Key, double>, P>
+    metric_type;
+  double sum = 0.0;
+  for (dimension_type i = 0; i < rank; ++i)
+    { sum += std::pow(std::abs(p[i] - q[i]), static_cast<double>(P)); }
+  double dist = std::pow(sum, 1.0 / P);
+  BOOST_CHECK_CLOSE(metric_type().distance_to_key(rank, p, q) + 1.0,
+                    dist + 1.0, .0000001);
+  check_distance_to_key_bounded(metric_type(), rank, p, q, dist * 0.99);
+  check_distance_to_key_bounded(metric_type(), rank, p, q, dist);
+  check_distance_to_key_bounded(metric_type(), rank, p, q, dist * 1.01);
+  // Even where the root is not exact, the distance to a plane does not
+  // exceed the distance to a key on it
+  for (dimension_type dim = 0; dim < rank; ++dim)
+    {
+      BOOST_CHECK_LE(metric_type().distance_to_plane(rank, dim, p, q),
+                     metric_type().distance_to_key(rank, p, q));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_minkowski_distance_to_key )
+{
+  typedef point_multiset<6, double6> static_type;
+  typedef point_multiset<0, std::vector<double> > vector_type;
+  typedef minkowski<static_type, double, bracket_minus<double6, double>, 3>
+    metric_type;
+  BOOST_CHECK((details::bounded_distance<metric_type>::value));
+  BOOST_CHECK((details::nearest_bound<metric_type>::value));
+  BOOST_CHECK((details::furthest_bound<metric_type>::value));
+  for (int i = 0; i < 100; ++i)
+    {
+      double6 p, q;
+      randomize(-40, 40)(p, 0, 0);
+      randomize(-40, 40)(q, 0, 0);
+      check_minkowski_distance_to_key<1, static_type>(6, p, q);
+      check_minkowski_distance_to_key<2, static_type>(6, p, q);
+      check_minkowski_distance_to_key<3, static_type>(6, p, q);
+      check_minkowski_distance_to_key<4, static_type>(6, p, q);
+      check_minkowski_distance_to_key<5, static_type>(6, p, q);
+      // The orders 1 and 2 match the manhattan and euclidian metrics
+      BOOST_CHECK_EQUAL
+        ((minkowski<static_type, double, bracket_minus<double6, double>, 1>()
+          .distance_to_key(6, p, q)),
+         (manhattan<static_type, double, bracket_minus<double6, double> >()
+          .distance_to_key(6, p, q)));
+      BOOST_CHECK_CLOSE
+        ((minkowski<static_type, double, bracket_minus<double6, double>, 2>()
+          .distance_to_key(6, p, q) + 1.0),
+         (euclidian<static_type, double, bracket_minus<double6, double> >()
+          .distance_to_key(6, p, q) + 1.0), .0000001);
+      // With contiguous keys, for ranks that do and do not fill the vector
+      // registers
+      dimension_type rank = static_cast<dimension_type>(1 + i % 23);
+      std::vector<double> u(rank), v(rank);
+      for (dimension_type j = 0; j < rank; ++j)
+        {
+          u[j] = static_cast<double>(std::rand() % 80 - 40);
+          v[j] = static_cast<double>(std::rand() % 80 - 40);
+        }
+      check_minkowski_distance_to_key<1, vector_type>(rank, u, v);
+      check_minkowski_distance_to_key<2, vector_type>(rank, u, v);
+      check_minkowski_distance_to_key<3, vector_type>(rank, u, v);
+    }
+}
+
+//! Returns a point on the sphere at latitude \c lat and longitude \c lon.
+inline std::vector<double> lat_lon(double lat, double lon)
+{
+  std::vector<double> p(2);
+  p[0] = lat; p[1] = lon;
+  return p;
+}
+
+//! Returns a random point on the sphere, which is on a pole, on the
+//! antimeridian or on the coordinates of \c near, once in a while.
+inline std::vector<double> random_lat_lon(const std::vector<double>& near)
+{
+  std::vector<double> p = lat_lon(drand() * 180.0 - 90.0,
+                                  drand() * 360.0 - 180.0);
+  switch (std::rand() % 8)
+    {
+    case 0: p[0] = near[0]; break;
+    case 1: p[1] = near[1]; break;
+    case 2: p[0] = (std::rand() % 2) ? 90.0 : -90.0; break;
+    case 3: p[1] = (std::rand() % 2) ? 180.0 : -180.0; break;
+    default: break;
+    }
+  return p;
+}
+
+//! Checks that the distance to a plane never exceeds the distance to the
+//! points on the other side of it, or on it.
+template <typename Metric>
+void check_sphere_distance_to_plane(const Metric& met)
+{
+  for (int i = 0; i < 200; ++i)
+    {
+      std::vector<double> split = random_lat_lon(lat_lon(0.0, 0.0));
+      std::vector<double> origin = random_lat_lon(split);
+      for (int j = 0; j < 50; ++j)
+        {
+          std::vector<double> p = random_lat_lon(split);
+          for (dimension_type dim = 0; dim < 2; ++dim)
+            {
+              if ((p[dim] - split[dim]) * (origin[dim] - split[dim]) > 0.0)
+                continue;
+              BOOST_CHECK_LE(met.distance_to_plane(2, dim, origin, split),
+                             met.distance_to_key(2, origin, p));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_great_circle_distance_to_key )
+{
+  typedef point_multiset<2, std::vector<double> > container_type;
+  typedef bracket_minus<std::vector<double>, double> diff_type;
+  typedef great_circle<container_type, double, diff_type> metric_type;
+  const double pi = 4.0 * std::atan(1.0);
+  const double degree = pi / 180.0;
+  metric_type met;
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(0, 0), lat_lon(0, 90)),
+                    pi / 2, .0000001);
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(0, 0), lat_lon(-90, 0)),
+                    pi / 2, .0000001);
+  // Across the antimeridian and the poles
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(0, 179), lat_lon(0, -179)),
+                    2 * degree, .0000001);
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(89, 0), lat_lon(89, 180)),
+                    2 * degree, .0000001);
+  // Antipodal points are accurate
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(45, 10),
+                                        lat_lon(-45, -170)),
+                    pi, .00000000001);
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(12, 0), lat_lon(-12, 180)),
+                    pi, .00000000001);
+  // From London to Paris, in kilometers
+  BOOST_CHECK_CLOSE(metric_type(6371.0)
+                    .distance_to_key(2, lat_lon(51.5074, -0.1278),
+                                     lat_lon(48.8566, 2.3522)),
+                    343.5, 0.1);
+  BOOST_CHECK_THROW(metric_type(-1.0), invalid_distance);
+  // Against the textbook haversine formula, away from antipodal points
+  for (int i = 0; i < 1000; ++i)
+    {
+      std::vector<double> p = random_lat_lon(lat_lon(0.0, 0.0));
+      std::vector<double> q = random_lat_lon(p);
+      double dlat = (q[0] - p[0]) * degree, dlon = (q[1] - p[1]) * degree;
+      double a = std::sin(dlat / 2) * std::sin(dlat / 2)
+        + std::cos(p[0] * degree) * std::cos(q[0] * degree)
+        * std::sin(dlon / 2) * std::sin(dlon / 2);
+      if (a > 0.99) continue;
+      double expect = 2 * std::asin(std::sqrt(a));
+      BOOST_CHECK_CLOSE(met.distance_to_key(2, p, q) + 1.0, expect + 1.0,
+                        .0000001);
+    }
+  check_sphere_distance_to_plane(met);
+}
+
+BOOST_AUTO_TEST_CASE( test_equirectangular_distance_to_key )
+{
+  typedef point_multiset<2, std::vector<double> > container_type;
+  typedef bracket_minus<std::vector<double>, double> diff_type;
+  typedef equirectangular<container_type, double, diff_type> metric_type;
+  typedef great_circle<container_type, double, diff_type> exact_type;
+  metric_type met;
+  // Close to the great circle distance for short distances, also across
+  // the antimeridian
+  for (int i = 0; i < 1000; ++i)
+    {
+      std::vector<double> p = lat_lon(drand() * 160.0 - 80.0,
+                                      drand() * 360.0 - 180.0);
+      std::vector<double> q = lat_lon(p[0] + drand() * 0.2 - 0.1,
+                                      p[1] + drand() * 0.2 - 0.1);
+      if (q[1] > 180.0) q[1] -= 360.0;
+      if (q[1] < -180.0) q[1] += 360.0;
+      BOOST_CHECK_CLOSE(met.distance_to_key(2, p, q),
+                        exact_type().distance_to_key(2, p, q), 0.1);
+    }
+  BOOST_CHECK_CLOSE(metric_type(2.0)
+                    .distance_to_key(2, lat_lon(60, 179.5),
+                                     lat_lon(60, -179.5)),
+                    2.0 * 4.0 * std::atan(1.0) / 360.0, .0000001);
+  check_sphere_distance_to_plane(met);
+}
+
+BOOST_AUTO_TEST_CASE( test_periodic_distance_to_key )
+{
+  typedef point_multiset<2, std::vector<double> > container_type;
+  typedef bracket_minus<std::vector<double>, double> diff_type;
+  typedef periodic<euclidian<container_type, double, diff_type> >
+    metric_type;
+  double periods[] = { 10.0, 4.0 };
+  metric_type met(periods, periods + 2);
+  // The nearest images are found across the boundaries of the box
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(1.0, 1.0),
+                                        lat_lon(9.0, 3.0)),
+                    std::sqrt(8.0), .0000001);
+  BOOST_CHECK_CLOSE(met.distance_to_key(2, lat_lon(5.0, 0.5),
+                                        lat_lon(2.0, 1.5)),
+                    std::sqrt(10.0), .0000001);
+  BOOST_CHECK_CLOSE(met.distance_to_key_bounded(2, lat_lon(1.0, 1.0),
+                                                lat_lon(9.0, 3.0), 10.0),
+                    std::sqrt(8.0), .0000001);
+  periodic<manhattan<container_type, double, diff_type> >
+    manh(periods, periods + 2);
+  BOOST_CHECK_CLOSE(manh.distance_to_key(2, lat_lon(0.5, 3.5),
+                                         lat_lon(9.5, 0.5)),
+                    2.0, .0000001);
+  // Integral distances are supported
+  typedef point_multiset<2, int2> int_container_type;
+  int int_periods[] = { 8, 8 };
+  periodic<quadrance<int_container_type, int, bracket_minus<int2, int> > >
+    quad(int_periods, int_periods + 2);
+  int2 x(1, 7), y(7, 1);
+  BOOST_CHECK_EQUAL(quad.distance_to_key(2, x, y), 8);
+  BOOST_CHECK_EQUAL(quad.distance_to_plane(2, 0, x, y), 1);
+  BOOST_CHECK_THROW(metric_type(periods, periods + 1), invalid_rank);
+  // The distance to a plane is never greater than the distance to the keys
+  // on the other side of it, even across the boundaries of the box
+  for (int i = 0; i < 200; ++i)
+    {
+      std::vector<double> split = lat_lon(drand() * 10.0, drand() * 4.0);
+      std::vector<double> origin = lat_lon(drand() * 10.0, drand() * 4.0);
+      for (int j = 0; j < 50; ++j)
+        {
+          std::vector<double> p = lat_lon(drand() * 10.0, drand() * 4.0);
+          for (dimension_type dim = 0; dim < 2; ++dim)
+            {
+              if ((p[dim] - split[dim]) * (origin[dim] - split[dim]) > 0.0)
+                continue;
+              BOOST_CHECK_LE(met.distance_to_plane(2, dim, origin, split),
+                             met.distance_to_key(2, origin, p));
+              BOOST_CHECK_LE(manh.distance_to_plane(2, dim, origin, split),
+                             manh.distance_to_key(2, origin, p));
+            }
+        }
+    }
+}
@@ -8,9 +8,12 @@
 #define BOOST_TEST_DYN_LINK
 #define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
 
+#include <limits>
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
-#include "../../src/neighbor_iterator.hpp"
 #include "spatial_test_fixtures.hpp"
+#include "../../src/neighbor_iterator.hpp"
+#include "../../src/region_iterator.hpp"
 
 BOOST_AUTO_TEST_CASE_TEMPLATE
 ( test_neighbor_default, Tp, every_quad )
@@ -454,6 +457,97 @@ BOOST_AUTO_TEST_CASE_TEMPLATE
   }
 }
 
+/**
+ *  Checks that the pruned search of the furthest neighbor finds the same
+ *  node as the exhaustive search, so that iterating backward from it is
+ *  consistent with iterating forward.
+ */
+template <typename Container, typename Metric>
+void check_last_neighbor(const Container& container, const Metric& metric,
+                         const typename Container::key_type& target)
+{
+  typename Container::mode_type::const_node_ptr root
+    = container.end().node->parent;
+  BOOST_CHECK(import::get<0>(details::last_neighbor
+                             (root, 0, container.rank(),
+                              container.key_comp(), metric, target))
+              == import::get<0>(details::last_neighbor_sub
+                                (root, 0, container.rank(),
+                                 container.key_comp(), metric, target,
+                                 typename Metric::distance_type())));
+}
+
+/**
+ *  Checks that the pruned search of the previous neighbor finds the same
+ *  node as the walk back and forth from the current node, for all the nodes
+ *  of the container iterated backward.
+ */
+template <typename Container, typename Metric>
+void check_decrement_neighbor(const Container& container,
+                              const Metric& metric,
+                              const typename Container::key_type& target)
+{
+  typedef typename Container::mode_type::const_node_ptr node_ptr;
+  typedef typename Metric::distance_type distance_type;
+  node_ptr root = container.end().node->parent;
+  import::tuple<node_ptr, dimension_type, distance_type> triplet
+    = details::last_neighbor(root, 0, container.rank(), container.key_comp(),
+                             metric, target);
+  typename Container::size_type count = 1;
+  for (;;)
+    {
+      import::tuple<node_ptr, dimension_type, distance_type> pruned
+        = details::decrement_neighbor
+        (import::get<0>(triplet), import::get<1>(triplet), container.rank(),
+         container.key_comp(), metric, target, import::get<2>(triplet));
+      triplet = details::decrement_neighbor_sub
+        (import::get<0>(triplet), import::get<1>(triplet), container.rank(),
+         container.key_comp(), metric, target, import::get<2>(triplet));
+      BOOST_REQUIRE(import::get<0>(pruned) == import::get<0>(triplet));
+      if (details::header(import::get<0>(triplet))) break;
+      BOOST_CHECK_EQUAL(import::get<1>(pruned), import::get<1>(triplet));
+      BOOST_CHECK_EQUAL(import::get<2>(pruned), import::get<2>(triplet));
+      ++count;
+    }
+  BOOST_CHECK_EQUAL(count, container.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_maximum_pruned, Tp, int2_sets )
+{
+  // The tree must be deep enough for the search to be pruned
+  Tp fix(1000, randomize(-100, 100));
+  typedef typename neighbor_iterator<typename Tp::container_type>
+    ::metric_type metric_type;
+  for (int i = 0; i < 20; ++i)
+    {
+      int2 target;
+      randomize(-150, 150)(target, 0, 0);
+      check_last_neighbor(fix.container, metric_type(), target);
+      check_decrement_neighbor(fix.container, metric_type(), target);
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_maximum_ties, Tp, int2_sets )
+{
+  // Many elements at the same distance
+  Tp fix(1000, randomize(-4, 4));
+  typedef quadrance<typename Tp::container_type, int,
+                    bracket_minus<int2, int> > quad_metric;
+  typedef manhattan<typename Tp::container_type, int,
+                    bracket_minus<int2, int> > manh_metric;
+  for (int i = 0; i < 20; ++i)
+    {
+      int2 target;
+      randomize(-5, 5)(target, 0, 0);
+      check_last_neighbor(fix.container, quad_metric(), target);
+      check_last_neighbor(fix.container, manh_metric(), target);
+      check_decrement_neighbor(fix.container, quad_metric(), target);
+      check_decrement_neighbor(fix.container, manh_metric(), target);
+    }
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE
 ( test_neighbor_increment, Tp, int2_maps )
 {
@@ -550,6 +644,153 @@ BOOST_AUTO_TEST_CASE_TEMPLATE
   }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_increment_cells, Tp, double6_sets )
+{
+  // In 4 dimensions or more, the far sub-trees are pruned by the distance to
+  // their cells: every node is still iterated once, in order of distance
+  typedef typename Tp::container_type container_type;
+  typedef manhattan<container_type, double,
+                    bracket_minus<double6, double> > manhattan_type;
+  Tp fix(200, randomize(-20, 20));
+  for (int i = 0; i < 20; ++i)
+    {
+      double6 target;
+      randomize(-22, 22)(target, 0, 0);
+      std::vector<double> expect;
+      for (typename container_type::iterator it = fix.container.begin();
+           it != fix.container.end(); ++it)
+        {
+          expect.push_back(neighbor_begin(fix.container, target)
+                           .metric().distance_to_key(6, target, *it));
+        }
+      std::sort(expect.begin(), expect.end());
+      neighbor_iterator<container_type>
+        iter = neighbor_begin(fix.container, target),
+        end = neighbor_end(fix.container, target);
+      std::vector<double>::const_iterator e = expect.begin();
+      for (; iter != end && e != expect.end(); ++iter, ++e)
+        { BOOST_CHECK_EQUAL(distance(iter), *e); }
+      BOOST_CHECK(iter == end);
+      BOOST_CHECK(e == expect.end());
+      manhattan_type met;
+      expect.clear();
+      for (typename container_type::iterator it = fix.container.begin();
+           it != fix.container.end(); ++it)
+        { expect.push_back(met.distance_to_key(6, target, *it)); }
+      std::sort(expect.begin(), expect.end());
+      neighbor_iterator<container_type, manhattan_type>
+        m_iter = neighbor_begin(fix.container, met, target),
+        m_end = neighbor_end(fix.container, met, target);
+      e = expect.begin();
+      for (; m_iter != m_end && e != expect.end(); ++m_iter, ++e)
+        { BOOST_CHECK_EQUAL(distance(m_iter), *e); }
+      BOOST_CHECK(m_iter == m_end);
+      BOOST_CHECK(e == expect.end());
+    }
+}
+
+//! Checks that the neighbors of random targets in \c fix are iterated once
+//! each, in order of their distance under \c met, and that the last one is
+//! the furthest.
+template <typename Tp, typename Metric>
+void check_neighbor_order(Tp& fix, const Metric& met)
+{
+  typedef typename Tp::container_type container_type;
+  for (int i = 0; i < 20; ++i)
+    {
+      double6 target;
+      randomize(-22, 22)(target, 0, 0);
+      std::vector<double> expect;
+      for (typename container_type::iterator it = fix.container.begin();
+           it != fix.container.end(); ++it)
+        { expect.push_back(met.distance_to_key(6, target, *it)); }
+      std::sort(expect.begin(), expect.end());
+      neighbor_iterator<container_type, Metric>
+        iter = neighbor_begin(fix.container, met, target),
+        end = neighbor_end(fix.container, met, target);
+      std::vector<double>::const_iterator e = expect.begin();
+      for (; iter != end && e != expect.end(); ++iter, ++e)
+        { BOOST_CHECK_EQUAL(distance(iter), *e); }
+      BOOST_CHECK(iter == end);
+      BOOST_CHECK(e == expect.end());
+      --end;
+      BOOST_CHECK_EQUAL(distance(end), expect.back());
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_weighted, Tp, double6_sets )
+{
+  // With weighted metrics, every node is iterated once, in order of the
+  // weighted distance, in both directions
+  typedef typename Tp::container_type container_type;
+  double weights[] = { 1.0, 9.0, 0.25, 0.0, 4.0, 1.0 };
+  Tp fix(200, randomize(-20, 20));
+  check_neighbor_order
+    (fix, weighted_euclidian<container_type, double,
+                             bracket_minus<double6, double> >
+     (weights, weights + 6));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_chebyshev_minkowski, Tp, double6_sets )
+{
+  typedef typename Tp::container_type container_type;
+  Tp fix(200, randomize(-20, 20));
+  check_neighbor_order
+    (fix, chebyshev<container_type, double,
+                    bracket_minus<double6, double> >());
+  check_neighbor_order
+    (fix, minkowski<container_type, double,
+                    bracket_minus<double6, double>, 3>());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_mixed_precision, Tp, double6_sets )
+{
+  // Pruning on single precision estimates gives the same neighbors and
+  // distances as the wrapped metric
+  typedef typename Tp::container_type container_type;
+  typedef bracket_minus<double6, double> diff_type;
+  Tp fix(200, randomize(-20, 20));
+  check_neighbor_order
+    (fix, mixed_precision<euclidian<container_type, double, diff_type> >());
+  check_neighbor_order
+    (fix, mixed_precision<manhattan<container_type, double, diff_type> >());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_wide_quadrance, Tp, quad_sets )
+{
+  // The squares of the distances are given in a wider type, in order
+  typedef wide_quadrance<typename Tp::container_type, int, quad_diff>
+    metric_type;
+  typedef typename metric_type::distance_type distance_type;
+  Tp fix(100, randomize(-20, 20));
+  metric_type metric;
+  for (int i = 0; i < 20; ++i)
+    {
+      quad target;
+      randomize(-22, 22)(target, 0, 0);
+      std::vector<distance_type> expect;
+      for (typename Tp::container_type::iterator it = fix.container.begin();
+           it != fix.container.end(); ++it)
+        { expect.push_back(metric.distance_to_key(4, target, *it)); }
+      std::sort(expect.begin(), expect.end());
+      neighbor_iterator<typename Tp::container_type, metric_type>
+        iter = neighbor_begin(fix.container, metric, target),
+        end = neighbor_end(fix.container, metric, target);
+      typename std::vector<distance_type>::const_iterator e = expect.begin();
+      for (; iter != end && e != expect.end(); ++iter, ++e)
+        { BOOST_CHECK_EQUAL(distance(iter), *e); }
+      BOOST_CHECK(iter == end);
+      BOOST_CHECK(e == expect.end());
+      --end;
+      BOOST_CHECK_EQUAL(distance(end), expect.back());
+    }
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE
 ( test_neighbor_lower_bound, Tp, quad_sets )
 {
@@ -829,3 +1070,622 @@ BOOST_AUTO_TEST_CASE_TEMPLATE
   }
   // Need to test the pair
 }
+
+//! Records the nodes and distances given by for_each_neighbor(), and stops
+//! after limit.
+template <typename Iterator, typename Distance>
+struct record_neighbor
+{
+  explicit record_neighbor(std::size_t n) : limit(n) { }
+  bool operator()(Iterator i, Distance d)
+  {
+    nodes.push_back(i.node);
+    distances.push_back(d);
+    return nodes.size() < limit;
+  }
+  std::size_t limit;
+  std::vector<typename Iterator::node_ptr> nodes;
+  std::vector<Distance> distances;
+};
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_for_each_neighbor, Tp, int2_sets )
+{
+  typedef typename Tp::container_type container_type;
+  typedef quadrance<container_type, int, bracket_minus<int2, int> >
+    metric_type;
+  typedef record_neighbor<typename container_type::const_iterator, int>
+    record;
+  const std::size_t all = std::numeric_limits<std::size_t>::max();
+  {
+    Tp fix(0);
+    BOOST_CHECK(for_each_neighbor(fix.container, metric_type(), int2(0, 0),
+                                  record(all)).nodes.empty());
+  }
+  {
+    Tp fix(500, randomize(-20, 20));
+    const container_type& container = fix.container;
+    for (int n = 0; n < 10; ++n)
+      {
+        int2 target;
+        randomize(-25, 25)(target, 0, 0);
+        std::vector<int> expected;
+        for (typename container_type::const_iterator i = container.begin();
+             i != container.end(); ++i)
+          {
+            typename container_type::const_iterator j = i;
+            expected.push_back(metric_type().distance_to_key
+                               (container.dimension(), target, *j));
+          }
+        std::sort(expected.begin(), expected.end());
+        record r = for_each_neighbor(container, metric_type(), target,
+                                     record(all));
+        BOOST_CHECK_EQUAL_COLLECTIONS(r.distances.begin(), r.distances.end(),
+                                      expected.begin(), expected.end());
+        for (std::size_t i = 0; i < r.nodes.size(); ++i)
+          BOOST_CHECK_EQUAL(r.distances[i],
+                            metric_type().distance_to_key
+                            (container.dimension(), target,
+                             details::const_key(r.nodes[i])));
+        std::sort(r.nodes.begin(), r.nodes.end());
+        BOOST_CHECK(std::unique(r.nodes.begin(), r.nodes.end())
+                    == r.nodes.end());
+        // The visitor stops the traversal
+        r = for_each_neighbor(container, metric_type(), target, record(7));
+        BOOST_CHECK_EQUAL_COLLECTIONS(r.distances.begin(), r.distances.end(),
+                                      expected.begin(), expected.begin() + 7);
+      }
+  }
+  { // An unbalanced tree, with the default metric
+    Tp fix(100, decrease());
+    typedef record_neighbor<typename container_type::iterator, double>
+      record_double;
+    int2 target(50, 50);
+    record_double r = for_each_neighbor(fix.container, target,
+                                        record_double(1));
+    BOOST_REQUIRE_EQUAL(r.nodes.size(), 1u);
+    BOOST_CHECK(details::const_key(r.nodes[0]) == target);
+    BOOST_CHECK_CLOSE(r.distances[0], 0.0, .0000001);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_for_each_neighbor_in_region, Tp, int2_sets )
+{
+  typedef typename Tp::container_type container_type;
+  typedef quadrance<container_type, int, bracket_minus<int2, int> >
+    metric_type;
+  typedef record_neighbor<typename container_type::const_iterator, int>
+    record;
+  typedef closed_bounds<int2, bracket_less<int2> > bounds_type;
+  const std::size_t all = std::numeric_limits<std::size_t>::max();
+  {
+    Tp fix(0);
+    BOOST_CHECK(for_each_neighbor_in_region
+                (fix.container, metric_type(), int2(0, 0),
+                 make_closed_bounds(fix.container, int2(-1, -1), int2(1, 1)),
+                 record(all)).nodes.empty());
+  }
+  {
+    Tp fix(500, randomize(-20, 20));
+    const container_type& container = fix.container;
+    for (int n = 0; n < 10; ++n)
+      {
+        int2 target, low, high;
+        randomize(-25, 25)(target, 0, 0);
+        randomize(-20, 20)(low, 0, 0);
+        randomize(-20, 20)(high, 0, 0);
+        if (high[0] < low[0]) std::swap(low[0], high[0]);
+        if (high[1] < low[1]) std::swap(low[1], high[1]);
+        bounds_type bounds = make_closed_bounds(container, low, high);
+        std::vector<int> expected;
+        for (typename container_type::const_iterator i = container.begin();
+             i != container.end(); ++i)
+          {
+            if ((*i)[0] < low[0] || (*i)[0] > high[0]
+                || (*i)[1] < low[1] || (*i)[1] > high[1]) continue;
+            expected.push_back(metric_type().distance_to_key
+                               (container.dimension(), target, *i));
+          }
+        std::sort(expected.begin(), expected.end());
+        record r = for_each_neighbor_in_region(container, metric_type(),
+                                               target, bounds, record(all));
+        BOOST_CHECK_EQUAL_COLLECTIONS(r.distances.begin(), r.distances.end(),
+                                      expected.begin(), expected.end());
+        for (std::size_t i = 0; i < r.nodes.size(); ++i)
+          BOOST_CHECK(details::match_key(container.rank(),
+                                         details::const_key(r.nodes[i]),
+                                         bounds));
+        // The visitor stops the traversal
+        std::ptrdiff_t k
+          = static_cast<std::ptrdiff_t>(std::min(expected.size(),
+                                                 std::size_t(3)));
+        r = for_each_neighbor_in_region(container, metric_type(), target,
+                                        bounds, record(3));
+        BOOST_CHECK_EQUAL_COLLECTIONS(r.distances.begin(), r.distances.end(),
+                                      expected.begin(), expected.begin() + k);
+      }
+  }
+  { // An unbalanced tree, with the default metric
+    Tp fix(100, decrease());
+    typedef record_neighbor<typename container_type::iterator, double>
+      record_double;
+    record_double r = for_each_neighbor_in_region
+      (fix.container, int2(50, 50),
+       make_closed_bounds(fix.container, int2(60, 60), int2(99, 99)),
+       record_double(1));
+    BOOST_REQUIRE_EQUAL(r.nodes.size(), 1u);
+    BOOST_CHECK(details::const_key(r.nodes[0]) == int2(60, 60));
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE
+( test_neighbor_in_region_iterator, Tp, int2_sets )
+{
+  typedef typename Tp::container_type container_type;
+  typedef quadrance<container_type, int, bracket_minus<int2, int> >
+    metric_type;
+  typedef record_neighbor<typename container_type::const_iterator, int>
+    record;
+  typedef closed_bounds<int2, bracket_less<int2> > bounds_type;
+  typedef neighbor_in_region_iterator<const container_type, bounds_type,
+                                      metric_type> iterator_type;
+  const std::size_t all = std::numeric_limits<std::size_t>::max();
+  {
+    Tp fix(0);
+    bounds_type bounds
+      = make_closed_bounds(fix.container, int2(-1, -1), int2(1, 1));
+    const container_type& container = fix.container;
+    BOOST_CHECK(neighbor_in_region_begin(container, metric_type(),
+                                         int2(0, 0), bounds)
+                == neighbor_in_region_end(container, metric_type(),
+                                          int2(0, 0), bounds));
+  }
+  {
+    Tp fix(500, randomize(-20, 20));
+    const container_type& container = fix.container;
+    for (int n = 0; n < 10; ++n)
+      {
+        int2 target, low, high;
+        randomize(-25, 25)(target, 0, 0);
+        randomize(-20, 20)(low, 0, 0);
+        randomize(-20, 20)(high, 0, 0);
+        if (high[0] < low[0]) std::swap(low[0], high[0]);
+        if (high[1] < low[1]) std::swap(low[1], high[1]);
+        bounds_type bounds = make_closed_bounds(container, low, high);
+        // The iterator gives the elements visited, in the same order
+        record r = for_each_neighbor_in_region(container, metric_type(),
+                                               target, bounds, record(all));
+        std::pair<iterator_type, iterator_type> range
+          = neighbor_in_region_range(container, metric_type(), target,
+                                     bounds);
+        std::size_t count = 0;
+        for (iterator_type i = range.first; i != range.second; ++i, ++count)
+          {
+            BOOST_REQUIRE(count < r.nodes.size());
+            BOOST_CHECK(i.node == r.nodes[count]);
+            BOOST_CHECK_EQUAL(distance(i), r.distances[count]);
+            BOOST_CHECK(*i == details::const_key(r.nodes[count]));
+          }
+        BOOST_CHECK_EQUAL(count, r.nodes.size());
+        // Copies resume the traversal independently
+        iterator_type i = range.first;
+        if (i == range.second) continue;
+        iterator_type j = i++;
+        BOOST_CHECK(j == range.first);
+        if (i == range.second) continue;
+        ++j;
+        BOOST_CHECK(i == j);
+        BOOST_CHECK(++i == ++j);
+      }
+  }
+  { // An unbalanced tree, with the default metric
+    Tp fix(100, decrease());
+    neighbor_in_region_iterator<container_type, bounds_type> i
+      = neighbor_in_region_begin
+      (fix.container, int2(50, 50),
+       make_closed_bounds(fix.container, int2(60, 60), int2(99, 99)));
+    BOOST_CHECK(*i == int2(60, 60));
+    BOOST_CHECK_CLOSE(distance(i), std::sqrt(200.0), .0000001);
+    BOOST_CHECK(neighbor_in_region_range
+                (fix.container, int2(50, 50),
+                 make_closed_bounds(fix.container, int2(60, 60),
+                                    int2(99, 99))).second
+                == neighbor_in_region_end
+                (fix.container, int2(50, 50),
+                 make_closed_bounds(fix.container, int2(60, 60),
+                                    int2(99, 99))));
+  }
+}
+
+//! Builds a 2-dimensional box in each layout, from its lower corner (x1, y1)
+//! and its higher corner (x2, y2).
+///@{
+inline quad
+make_quad_box(int x1, int y1, int x2, int y2, llhh_layout_tag)
+{ return quad(x1, y1, x2, y2); }
+
+inline quad
+make_quad_box(int x1, int y1, int x2, int y2, lhlh_layout_tag)
+{ return quad(x1, x2, y1, y2); }
+
+inline quad
+make_quad_box(int x1, int y1, int x2, int y2, hhll_layout_tag)
+{ return quad(x2, y2, x1, y1); }
+
+inline quad
+make_quad_box(int x1, int y1, int x2, int y2, hlhl_layout_tag)
+{ return quad(x2, x1, y2, y1); }
+///@}
+
+//! The square distance from the point (x, y) to the box [x1, x2] x [y1, y2].
+inline int
+brute_box_quadrance(int x, int y, int x1, int y1, int x2, int y2)
+{
+  int dx = (x < x1) ? x1 - x : ((x > x2) ? x - x2 : 0);
+  int dy = (y < y1) ? y1 - y : ((y > y2) ? y - y2 : 0);
+  return dx * dx + dy * dy;
+}
+
+typedef boost::mpl::list<llhh_layout_tag, lhlh_layout_tag, hhll_layout_tag,
+                         hlhl_layout_tag> every_layout;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_box_metric, Layout, every_layout )
+{
+  typedef boxset_fix<quad>::container_type container_type;
+  typedef box_quadrance<container_type, int, quad_diff, Layout> metric_type;
+  typedef record_neighbor<container_type::const_iterator, int> record;
+  const Layout layout = Layout();
+  metric_type metric;
+  quad box = make_quad_box(0, 0, 2, 2, layout);
+  BOOST_CHECK_EQUAL(metric.distance_to_key
+                    (4, make_quad_box(1, 1, 1, 1, layout), box), 0);
+  BOOST_CHECK_EQUAL(metric.distance_to_key
+                    (4, make_quad_box(2, 0, 2, 0, layout), box), 0);
+  BOOST_CHECK_EQUAL(metric.distance_to_key
+                    (4, make_quad_box(5, 1, 5, 1, layout), box), 9);
+  BOOST_CHECK_EQUAL(metric.distance_to_key
+                    (4, make_quad_box(-1, -2, -1, -2, layout), box), 5);
+  // Compare the neighbor iterator and the visitor against a brute search
+  boxset_fix<quad> fix;
+  std::vector<quad> corners;
+  for (int i = 0; i < 300; ++i)
+    {
+      quad q;
+      randomize(-20, 20)(q, 0, 0);
+      quad c(std::min(q.x, q.z), std::min(q.y, q.w),
+             std::max(q.x, q.z), std::max(q.y, q.w));
+      corners.push_back(c);
+      fix.container.insert(make_quad_box(c.x, c.y, c.z, c.w, layout));
+    }
+  const container_type& container = fix.container;
+  for (int n = 0; n < 10; ++n)
+    {
+      quad p;
+      randomize(-25, 25)(p, 0, 0);
+      quad target = make_quad_box(p.x, p.y, p.x, p.y, layout);
+      std::vector<int> expected;
+      for (std::size_t i = 0; i < corners.size(); ++i)
+        expected.push_back(brute_box_quadrance(p.x, p.y, corners[i].x,
+                                               corners[i].y, corners[i].z,
+                                               corners[i].w));
+      std::sort(expected.begin(), expected.end());
+      std::vector<int> found;
+      for (neighbor_iterator<const container_type, metric_type>
+             i = neighbor_begin(container, metric, target);
+           i != neighbor_end(container, metric, target); ++i)
+        found.push_back(distance(i));
+      BOOST_CHECK_EQUAL_COLLECTIONS(found.begin(), found.end(),
+                                    expected.begin(), expected.end());
+      record r = for_each_neighbor(container, metric, target,
+                                   record(corners.size()));
+      BOOST_CHECK_EQUAL_COLLECTIONS(r.distances.begin(), r.distances.end(),
+                                    expected.begin(), expected.end());
+      neighbor_iterator<const container_type, metric_type> i
+        = neighbor_lower_bound(container, metric, target, 10);
+      std::vector<int>::iterator j
+        = std::lower_bound(expected.begin(), expected.end(), 10);
+      if (j == expected.end())
+        { BOOST_CHECK(i == neighbor_end(container, metric, target)); }
+      else
+        { BOOST_CHECK_EQUAL(distance(i), *j); }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_box_neighbor_default )
+{
+  typedef boxset_fix<double6>::container_type container_type;
+  boxset_fix<double6> fix;
+  for (int i = 0; i < 300; ++i)
+    {
+      double6 b;
+      randomize(-20, 20)(b, 0, 0);
+      for (dimension_type d = 0; d < 3; ++d)
+        if (b[d] > b[d + 3]) std::swap(b[d], b[d + 3]);
+      fix.container.insert(b);
+    }
+  double6 target;
+  randomize(-25, 25)(target, 0, 0);
+  target[3] = target[0]; target[4] = target[1]; target[5] = target[2];
+  std::vector<double> expected;
+  for (container_type::const_iterator i = fix.container.begin();
+       i != fix.container.end(); ++i)
+    {
+      double sum = 0;
+      for (dimension_type d = 0; d < 3; ++d)
+        {
+          double gap = (target[d] < (*i)[d]) ? (*i)[d] - target[d]
+            : ((target[d] > (*i)[d + 3]) ? target[d] - (*i)[d + 3] : 0);
+          sum += gap * gap;
+        }
+      expected.push_back(std::sqrt(sum));
+    }
+  std::sort(expected.begin(), expected.end());
+  box_neighbor_iterator<container_type> i
+    = box_neighbor_begin(fix.container, target);
+  BOOST_CHECK_CLOSE(distance(i), expected[0], .0000001);
+  const container_type& container = fix.container;
+  box_neighbor_iterator<const container_type, llhh_layout_tag> j
+    = box_neighbor_end(container, target, llhh_layout_tag());
+  BOOST_CHECK(j == container.end());
+  i = box_neighbor_upper_bound(fix.container, target, expected[2]);
+  BOOST_CHECK(distance(i) > expected[2]);
+  i = box_neighbor_lower_bound(fix.container, target, expected[2]);
+  BOOST_CHECK_EQUAL(distance(i), expected[2]);
+  typedef record_neighbor<container_type::const_iterator, double> record;
+  record r = for_each_box_neighbor(container, target, record(5));
+  BOOST_REQUIRE_EQUAL(r.distances.size(), 5u);
+  for (std::size_t k = 0; k < 5; ++k)
+    BOOST_CHECK_CLOSE(r.distances[k], expected[k], .0000001);
+  std::swap(target[0], target[3]);
+  target[0] += 1;
+  BOOST_CHECK_THROW(box_neighbor_begin(fix.container, target), invalid_box);
+}
+
+//! Returns true if the ray from (x, y) along (dx, dy) crosses the box [x1,
+//! x2] x [y1, y2] before the parameter t_max, and sets enter to the
+//! parameter where it enters the box.
+inline bool
+brute_ray_enter(int x, int y, int dx, int dy, int x1, int y1, int x2, int y2,
+                double t_max, double& enter)
+{
+  enter = 0.0;
+  double exit = t_max;
+  const int o[2] = { x, y }, d[2] = { dx, dy };
+  const int l[2] = { x1, y1 }, h[2] = { x2, y2 };
+  for (int i = 0; i < 2; ++i)
+    {
+      if (d[i] == 0)
+        {
+          if (o[i] < l[i] || o[i] > h[i]) return false;
+          continue;
+        }
+      double t1 = static_cast<double>(l[i] - o[i]) / d[i];
+      double t2 = static_cast<double>(h[i] - o[i]) / d[i];
+      if (t2 < t1) std::swap(t1, t2);
+      enter = std::max(enter, t1);
+      exit = std::min(exit, t2);
+      if (exit < enter) return false;
+    }
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_for_each_ray_intersection, Layout,
+                               every_layout )
+{
+  typedef boxset_fix<quad>::container_type container_type;
+  typedef record_neighbor<container_type::const_iterator, double> record;
+  const Layout layout = Layout();
+  const std::size_t all = std::numeric_limits<std::size_t>::max();
+  boxset_fix<quad> fix;
+  BOOST_CHECK(for_each_ray_intersection
+              (fix.container, quad_diff(), quad(0, 0, 0, 0),
+               quad(1, 1, 1, 1), layout, record(all)).nodes.empty());
+  std::vector<quad> corners;
+  for (int i = 0; i < 300; ++i)
+    {
+      quad q;
+      randomize(-20, 20)(q, 0, 0);
+      quad c(std::min(q.x, q.z), std::min(q.y, q.w),
+             std::min(q.x, q.z) + std::abs(q.x - q.z) / 4,
+             std::min(q.y, q.w) + std::abs(q.y - q.w) / 4);
+      corners.push_back(c);
+      fix.container.insert(make_quad_box(c.x, c.y, c.z, c.w, layout));
+    }
+  const container_type& container = fix.container;
+  for (int n = 0; n < 20; ++n)
+    {
+      quad p;
+      randomize(-25, 25)(p, 0, 0);
+      if (n == 0) { p.z = p.x; } // a ray parallel to an axis
+      quad first = make_quad_box(p.x, p.y, p.x, p.y, layout);
+      quad last = make_quad_box(p.z, p.w, p.z, p.w, layout);
+      double scale = std::sqrt(static_cast<double>
+                               ((p.z - p.x) * (p.z - p.x)
+                                + (p.w - p.y) * (p.w - p.y)));
+      for (int segment = 0; segment < 2; ++segment)
+        {
+          double t_max = segment ? 1.0
+            : std::numeric_limits<double>::infinity();
+          std::vector<double> expected;
+          for (std::size_t i = 0; i < corners.size(); ++i)
+            {
+              double enter;
+              if (brute_ray_enter(p.x, p.y, p.z - p.x, p.w - p.y,
+                                  corners[i].x, corners[i].y, corners[i].z,
+                                  corners[i].w, t_max, enter))
+                expected.push_back(enter * scale);
+            }
+          std::sort(expected.begin(), expected.end());
+          record r = segment
+            ? for_each_segment_intersection(container, quad_diff(), first,
+                                            last, layout, record(all))
+            : for_each_ray_intersection(container, quad_diff(), first, last,
+                                        layout, record(all));
+          BOOST_REQUIRE_EQUAL(r.distances.size(), expected.size());
+          for (std::size_t i = 0; i < expected.size(); ++i)
+            BOOST_CHECK_CLOSE(r.distances[i], expected[i], .0000001);
+          std::sort(r.nodes.begin(), r.nodes.end());
+          BOOST_CHECK(std::unique(r.nodes.begin(), r.nodes.end())
+                      == r.nodes.end());
+          if (expected.empty()) continue;
+          // The visitor stops at the first hit
+          r = for_each_ray_intersection(container, quad_diff(), first, last,
+                                        layout, record(1));
+          BOOST_REQUIRE_EQUAL(r.distances.size(), 1u);
+          BOOST_CHECK_CLOSE(r.distances[0], expected[0], .0000001);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_for_each_segment_intersection_default )
+{
+  typedef boxset_fix<double6>::container_type container_type;
+  typedef record_neighbor<container_type::iterator, double> record;
+  const std::size_t all = std::numeric_limits<std::size_t>::max();
+  boxset_fix<double6> fix;
+  // A row of unit cubes along the first axis
+  for (int i = 0; i < 10; ++i)
+    {
+      double6 b;
+      b[0] = 2 * i; b[1] = 0; b[2] = 0;
+      b[3] = 2 * i + 1; b[4] = 1; b[5] = 1;
+      fix.container.insert(b);
+    }
+  double6 first, last;
+  first[0] = first[3] = -1.5; first[1] = first[4] = .5;
+  first[2] = first[5] = .5;
+  last = first;
+  last[0] = last[3] = 8.5;
+  record r = for_each_segment_intersection(fix.container, first, last,
+                                           record(all));
+  BOOST_REQUIRE_EQUAL(r.distances.size(), 5u);
+  for (std::size_t i = 0; i < 5; ++i)
+    {
+      BOOST_CHECK_CLOSE(r.distances[i], 1.5 + 2.0 * static_cast<double>(i),
+                        .0000001);
+      BOOST_CHECK_CLOSE(details::const_key(r.nodes[i])[0],
+                        2.0 * static_cast<double>(i), .0000001);
+    }
+  r = for_each_ray_intersection(fix.container, first, last, record(all));
+  BOOST_CHECK_EQUAL(r.distances.size(), 10u);
+  last[1] = last[4] = 3.0;
+  r = for_each_ray_intersection(fix.container, first, last, record(all));
+  BOOST_CHECK_EQUAL(r.distances.size(), 1u);
+  last[0] = 9.5;
+  BOOST_CHECK_THROW(for_each_ray_intersection(fix.container, first, last,
+                                              record(all)), invalid_box);
+}
+
+//! Checks that the neighbors of random targets in \c container are iterated
+//! once each, in order of their distance under \c met.
+template <typename Container, typename Metric, typename Key>
+void check_neighbor_order(Container& container, const Metric& met,
+                          const Key& target)
+{
+  std::vector<double> expect;
+  for (typename Container::iterator it = container.begin();
+       it != container.end(); ++it)
+    { expect.push_back(met.distance_to_key(6, target, *it)); }
+  std::sort(expect.begin(), expect.end());
+  neighbor_iterator<Container, Metric>
+    iter = neighbor_begin(container, met, target),
+    end = neighbor_end(container, met, target);
+  std::vector<double>::const_iterator e = expect.begin();
+  for (; iter != end && e != expect.end(); ++iter, ++e)
+    { BOOST_CHECK_EQUAL(distance(iter), *e); }
+  BOOST_CHECK(iter == end);
+  BOOST_CHECK(e == expect.end());
+  --end;
+  BOOST_CHECK_EQUAL(distance(end), expect.back());
+  double median = expect[expect.size() / 2];
+  iter = neighbor_upper_bound(container, met, target, median);
+  BOOST_CHECK_EQUAL(distance(iter),
+                    *std::upper_bound(expect.begin(), expect.end(), median));
+}
+
+BOOST_AUTO_TEST_CASE( test_neighbor_periodic )
+{
+  // Points in a periodic box are iterated in order of the distance between
+  // their nearest images, without ghost copies near the boundaries
+  typedef double6 point_type;
+  typedef point_multiset<6, point_type> container_type;
+  typedef bracket_minus<point_type, double> diff_type;
+  double periods[] = { 10.0, 10.0, 4.0, 1.0, 20.0, 10.0 };
+  container_type container;
+  point_type p;
+  for (int i = 0; i < 500; ++i)
+    {
+      for (dimension_type j = 0; j < 6; ++j) p[j] = drand() * periods[j];
+      container.insert(p);
+    }
+  periodic<euclidian<container_type, double, diff_type> >
+    euclid(periods, periods + 6);
+  periodic<manhattan<container_type, double, diff_type> >
+    manh(periods, periods + 6);
+  periodic<chebyshev<container_type, double, diff_type> >
+    cheb(periods, periods + 6);
+  for (int t = 0; t < 10; ++t)
+    {
+      // Targets near the corners of the box, and anywhere in the box
+      for (dimension_type j = 0; j < 6; ++j)
+        p[j] = (t < 5 ? (t % 2 == 0 ? 0.01 : 0.99) : drand()) * periods[j];
+      check_neighbor_order(container, euclid, p);
+      check_neighbor_order(container, manh, p);
+      check_neighbor_order(container, cheb, p);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_neighbor_sphere )
+{
+  // Points on a sphere are iterated in order of their distance, across the
+  // poles and the antimeridian; the other dimensions are ignored
+  typedef double6 point_type;
+  typedef point_multiset<6, point_type> container_type;
+  typedef bracket_minus<point_type, double> diff_type;
+  typedef great_circle<container_type, double, diff_type> circle_type;
+  typedef equirectangular<container_type, double, diff_type> plane_type;
+  container_type container;
+  point_type p;
+  std::fill(p.begin(), p.end(), 0.0);
+  for (int i = 0; i < 1000; ++i)
+    {
+      p[0] = drand() * 180.0 - 90.0;
+      p[1] = drand() * 360.0 - 180.0;
+      container.insert(p);
+    }
+  double targets[][2] = { { 0.0, 0.0 }, { 89.5, 20.0 }, { -10.0, 180.0 },
+                          { 30.0, -179.9 }, { -90.0, 0.0 }, { 60.0, 179.0 } };
+  for (std::size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); ++t)
+    {
+      p[0] = targets[t][0];
+      p[1] = targets[t][1];
+      circle_type circle;
+      plane_type plane;
+      std::vector<double> circle_expect, plane_expect;
+      for (container_type::iterator it = container.begin();
+           it != container.end(); ++it)
+        {
+          circle_expect.push_back(circle.distance_to_key(6, p, *it));
+          plane_expect.push_back(plane.distance_to_key(6, p, *it));
+        }
+      std::sort(circle_expect.begin(), circle_expect.end());
+      std::sort(plane_expect.begin(), plane_expect.end());
+      neighbor_iterator<container_type, circle_type>
+        c_iter = neighbor_begin(container, circle, p),
+        c_end = neighbor_end(container, circle, p);
+      std::vector<double>::const_iterator e = circle_expect.begin();
+      for (; c_iter != c_end && e != circle_expect.end(); ++c_iter, ++e)
+        { BOOST_CHECK_EQUAL(distance(c_iter), *e); }
+      BOOST_CHECK(c_iter == c_end);
+      BOOST_CHECK(e == circle_expect.end());
+      neighbor_iterator<container_type, plane_type>
+        p_iter = neighbor_begin(container, plane, p),
+        p_end = neighbor_end(container, plane, p);
+      e = plane_expect.begin();
+      for (; p_iter != p_end && e != plane_expect.end(); ++p_iter, ++e)
+        { BOOST_CHECK_EQUAL(distance(p_iter), *e); }
+      BOOST_CHECK(p_iter == p_end);
+      BOOST_CHECK(e == plane_expect.end());
+    }
+}
@@ -11,8 +11,8 @@
 #include <boost/test/unit_test.hpp>
 
 #define  SPATIAL_SAFER_ARITHMETICS
-#include "../../src/neighbor_iterator.hpp"
 #include "spatial_test_fixtures.hpp"
+#include "../../src/neighbor_iterator.hpp"
 
 BOOST_AUTO_TEST_CASE_TEMPLATE
 ( test_neighbor_decrement, Tp, int2_maps )
@@ -9,8 +9,8 @@
 #define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
 
 #include <boost/test/unit_test.hpp>
-#include "../../src/ordered_iterator.hpp"
 #include "spatial_test_fixtures.hpp"
+#include "../../src/ordered_iterator.hpp"
 
 BOOST_AUTO_TEST_CASE_TEMPLATE
 ( test_ordered_basics, Tp, every_quad )
@@ -8,9 +8,12 @@
 #define BOOST_TEST_DYN_LINK
 #define SPATIAL_ENABLE_ASSERT // detect interal issues that should not occur
 
+#include <limits>
+#include <algorithm>
+#include <iterator>
 #include <boost/test/unit_test.hpp>
-#include "../../src/region_iterator.hpp"
 #include "spatial_test_fixtures.hpp"
+#include "../../src/region_iterator.hpp"
 
 BOOST_AUTO_TEST_CASE( test_open_bounds )
 {
@@ -89,6 +92,104 @@ inline bool match_all(const Rank& rank, const Key& key, const Pred& pred)
   return (d == rank());
 }
 
+BOOST_AUTO_TEST_CASE( test_match_key )
+{
+  typedef bounds<int2, bracket_less<int2> > bounds_type;
+  typedef closed_bounds<int2, bracket_less<int2> > closed_type;
+  typedef open_bounds<int2, bracket_less<int2> > open_type;
+  pointset_fix<int2> fix(0);
+  int2 l(1, 1), h(3, 3);
+  bounds_type b = make_bounds(fix.container, l, h);
+  closed_type c = make_closed_bounds(fix.container, l, h);
+  open_type o = make_open_bounds(fix.container, l, h);
+  BOOST_CHECK(details::is_whole_key_predicate<bounds_type>::value);
+  BOOST_CHECK(details::is_whole_key_predicate<closed_type>::value);
+  BOOST_CHECK(details::is_whole_key_predicate<open_type>::value);
+  for (int x = 0; x < 5; ++x)
+    for (int y = 0; y < 5; ++y)
+      {
+        int2 k(x, y);
+        BOOST_CHECK_EQUAL(details::match_key(fix.container.rank(), k, b),
+                          match_all(fix.container.rank(), k, b));
+        BOOST_CHECK_EQUAL(details::match_key(fix.container.rank(), k, c),
+                          match_all(fix.container.rank(), k, c));
+        BOOST_CHECK_EQUAL(details::match_key(fix.container.rank(), k, o),
+                          match_all(fix.container.rank(), k, o));
+      }
+  // User-defined comparators are tested one dimension at a time
+  pointset_fix<quad, quad_less> quad_fix(0);
+  typedef closed_bounds<quad, quad_less> quad_closed_type;
+  quad_closed_type q
+    = make_closed_bounds(quad_fix.container, quad(0, 0, 0, 0),
+                         quad(1, 1, 1, 1));
+  BOOST_CHECK(!details::is_whole_key_predicate<quad_closed_type>::value);
+  BOOST_CHECK(details::match_key(quad_fix.container.rank(),
+                                 quad(1, 0, 1, 0), q));
+  BOOST_CHECK(!details::match_key(quad_fix.container.rank(),
+                                  quad(1, 0, 2, 0), q));
+  // The dimension already tested by the caller is not tested again
+  BOOST_CHECK(details::match_key(fix.container.rank(), int2(0, 2), b, 0));
+  BOOST_CHECK(!details::match_key(fix.container.rank(), int2(0, 2), b, 1));
+  BOOST_CHECK(details::match_key(fix.container.rank(), int2(2, 4), c, 1));
+  BOOST_CHECK(!details::match_key(fix.container.rank(), int2(2, 4), o, 0));
+  BOOST_CHECK(details::match_key(quad_fix.container.rank(),
+                                 quad(1, 0, 2, 0), q, 2));
+  BOOST_CHECK(!details::match_key(quad_fix.container.rank(),
+                                  quad(1, 0, 2, 0), q, 3));
+}
+
+//! Checks that the one-sided tests of a predicate agree with its operator,
+//! for all keys with coordinates in [0, 4).
+template <typename Rank, typename Pred>
+void check_two_sided(const Rank& rank, const Pred& pred)
+{
+  BOOST_CHECK(details::is_two_sided_predicate<Pred>::value);
+  for (int i = 0; i < 256; ++i)
+    {
+      quad k(i & 3, (i >> 2) & 3, (i >> 4) & 3, (i >> 6) & 3);
+      for (dimension_type d = 0; d < rank(); ++d)
+        {
+          BOOST_CHECK_EQUAL(pred.less_than_lower_bound(d, rank(), k),
+                            pred(d, rank(), k) == below);
+          BOOST_CHECK_EQUAL(pred.greater_than_upper_bound(d, rank(), k),
+                            pred(d, rank(), k) == above);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_two_sided_bounds )
+{
+  boxset_fix<quad> fix(0);
+  quad l(1, 1, 1, 2), h(2, 3, 3, 3);
+  check_two_sided(fix.container.rank(), make_bounds(fix.container, l, h));
+  check_two_sided(fix.container.rank(),
+                  make_closed_bounds(fix.container, l, h));
+  check_two_sided(fix.container.rank(),
+                  make_open_bounds(fix.container, l, h));
+  check_two_sided(fix.container.rank(),
+                  make_overlap_bounds(fix.container, quad(1, 1, 2, 2)));
+  check_two_sided(fix.container.rank(),
+                  make_overlap_bounds(fix.container, quad(1, 1, 2, 2),
+                                      lhlh_layout));
+  check_two_sided(fix.container.rank(),
+                  make_overlap_bounds(fix.container, quad(2, 1, 2, 1),
+                                      hhll_layout));
+  check_two_sided(fix.container.rank(),
+                  make_overlap_bounds(fix.container, quad(2, 1, 2, 1),
+                                      hlhl_layout));
+  check_two_sided(fix.container.rank(),
+                  make_enclosed_bounds(fix.container, quad(1, 0, 2, 2)));
+  check_two_sided(fix.container.rank(),
+                  make_enclosed_bounds(fix.container, quad(1, 2, 0, 2),
+                                       lhlh_layout));
+  check_two_sided(fix.container.rank(),
+                  make_enclosed_bounds(fix.container, quad(2, 2, 1, 0),
+                                       hhll_layout));
+  check_two_sided(fix.container.rank(),
+                  make_enclosed_bounds(fix.container, quad(2, 1, 2, 0),
+                                       hlhl_layout));
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE( test_overlap_bounds, Tp, every_quad )
 {
   Tp fix(0);
@@ -753,3 +854,506 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( test_region_decrement, Tp, double6_sets )
       }
   }
 }
+
+template <typename Container, typename Predicate>
+std::size_t brute_region_count(const Container& container,
+                               const Predicate& pred)
+{
+  std::size_t count = 0;
+  for (typename Container::const_iterator i = container.begin();
+       i != container.end(); ++i)
+    if (match_all(container.rank(), *i, pred)) ++count;
+  return count;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_region_count, Tp, double6_sets )
+{
+  {
+    Tp fix(0);
+    double6 l = make_double6(-1.), h = make_double6(1.);
+    BOOST_CHECK_EQUAL(region_count(fix.container, l, h), 0u);
+  }
+  {
+    Tp fix(200, randomize(-5, 5));
+    double6 l = make_double6(-2.), h = make_double6(3.);
+    double6 b; b[0] = b[1] = b[2] = -4.; b[3] = b[4] = b[5] = 4.;
+    while (!fix.container.empty())
+      {
+        BOOST_CHECK_EQUAL(region_count(fix.container, l, h),
+                          brute_region_count
+                          (fix.container,
+                           make_bounds(fix.container, l, h)));
+        BOOST_CHECK_EQUAL(region_count(fix.container,
+                                       make_closed_bounds
+                                       (fix.container, l, h)),
+                          brute_region_count
+                          (fix.container,
+                           make_closed_bounds(fix.container, l, h)));
+        BOOST_CHECK_EQUAL(region_count(fix.container,
+                                       make_open_bounds
+                                       (fix.container, l, h)),
+                          brute_region_count
+                          (fix.container,
+                           make_open_bounds(fix.container, l, h)));
+        BOOST_CHECK_EQUAL(region_count(fix.container,
+                                       make_enclosed_bounds
+                                       (fix.container, b)),
+                          brute_region_count
+                          (fix.container,
+                           make_enclosed_bounds(fix.container, b)));
+        BOOST_CHECK_EQUAL(region_count(fix.container,
+                                       make_overlap_bounds
+                                       (fix.container, b)),
+                          brute_region_count
+                          (fix.container,
+                           make_overlap_bounds(fix.container, b)));
+        // Erase a few elements at a time, to check counts with weights that
+        // are maintained by erasure and rebalancing
+        for (int i = 0; i < 7 && !fix.container.empty(); ++i)
+          fix.container.erase(fix.container.begin());
+      }
+  }
+  { // A tree where all elements are the same (= 100.0)!
+    Tp fix(100, same());
+    double6 l = make_double6(99.), h = make_double6(101.);
+    BOOST_CHECK_EQUAL(region_count(fix.container, l, h), 100u);
+    BOOST_CHECK_EQUAL(region_count(fix.container,
+                                   make_closed_bounds
+                                   (fix.container, h, h)), 0u);
+    l = make_double6(100.);
+    BOOST_CHECK_EQUAL(region_count(fix.container,
+                                   make_closed_bounds
+                                   (fix.container, l, l)), 100u);
+  }
+  { // An unbalanced tree
+    Tp fix(100, increase());
+    double6 l = make_double6(20.), h = make_double6(60.);
+    BOOST_CHECK_EQUAL(region_count(fix.container, l, h),
+                      brute_region_count(fix.container,
+                                         make_bounds(fix.container, l, h)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_region_count_dense, Tp, int2_sets )
+{
+  // Many elements with equal keys, so that entire sub-trees are counted
+  Tp fix(1000, randomize(-10, 10));
+  int2 l(-6, -7), h(5, 8);
+  BOOST_CHECK_EQUAL(region_count(fix.container, l, h),
+                    brute_region_count(fix.container,
+                                       make_bounds(fix.container, l, h)));
+  BOOST_CHECK_EQUAL(region_count(fix.container,
+                                 make_closed_bounds(fix.container, l, h)),
+                    brute_region_count(fix.container,
+                                       make_closed_bounds
+                                       (fix.container, l, h)));
+}
+
+//! Sums the mapped integers of a point_multimap.
+struct sum_mapped
+{
+  typedef long aggregate_type;
+  aggregate_type identity() const { return 0; }
+  aggregate_type map(const std::pair<const int2, int>& value) const
+  { return value.second; }
+  aggregate_type combine(aggregate_type a, aggregate_type b) const
+  { return a + b; }
+};
+
+//! Finds the smallest first coordinate among keys.
+struct min_first
+{
+  typedef int aggregate_type;
+  aggregate_type identity() const { return std::numeric_limits<int>::max(); }
+  aggregate_type map(const int2& value) const { return value[0]; }
+  aggregate_type combine(aggregate_type a, aggregate_type b) const
+  { return a < b ? a : b; }
+};
+
+template <typename Container, typename Predicate>
+typename Container::monoid_type::aggregate_type
+brute_region_aggregate(const Container& container, const Predicate& pred)
+{
+  typename Container::monoid_type monoid = container.monoid();
+  typename Container::monoid_type::aggregate_type aggregate
+    = monoid.identity();
+  for (typename Container::const_iterator i = container.begin();
+       i != container.end(); ++i)
+    {
+      typename Container::const_iterator j = i;
+      if (match_all(container.rank(), j->first, pred))
+        aggregate = monoid.combine(aggregate, monoid.map(*j));
+    }
+  return aggregate;
+}
+
+BOOST_AUTO_TEST_CASE( test_region_aggregate_sum )
+{
+  typedef point_multimap<2, int2, int, bracket_less<int2>, loose_balancing,
+                         std::allocator<std::pair<const int2, int> >,
+                         sum_mapped> container_type;
+  container_type container;
+  int2 l(-6, -7), h(5, 8);
+  BOOST_CHECK_EQUAL(region_aggregate(container, l, h), 0);
+  for (int i = 0; i < 500; ++i)
+    {
+      int2 p;
+      randomize(-10, 10)(p, i, 500);
+      container.insert(std::make_pair(p, i));
+    }
+  BOOST_CHECK_EQUAL(region_aggregate(container, l, h),
+                    brute_region_aggregate
+                    (container, make_bounds(container, l, h)));
+  BOOST_CHECK_EQUAL(region_aggregate(container,
+                                     make_open_bounds(container, l, h)),
+                    brute_region_aggregate
+                    (container, make_open_bounds(container, l, h)));
+  // The whole container is summed from the root's aggregate
+  l = int2(-10, -10); h = int2(11, 11);
+  BOOST_CHECK_EQUAL(region_aggregate(container, l, h), 499 * 500 / 2);
+  // Aggregates are maintained by erasure, rebalancing, copy and swap
+  l = int2(-3, -5); h = int2(7, 2);
+  container_type copy(container);
+  while (!container.empty())
+    {
+      BOOST_CHECK_EQUAL(region_aggregate(container, l, h),
+                        brute_region_aggregate
+                        (container, make_bounds(container, l, h)));
+      for (int i = 0; i < 13 && !container.empty(); ++i)
+        container.erase(container.begin());
+      container.erase(int2(0, 0));
+    }
+  container.swap(copy);
+  BOOST_CHECK(copy.empty());
+  BOOST_CHECK_EQUAL(region_aggregate(container, l, h),
+                    brute_region_aggregate
+                    (container, make_bounds(container, l, h)));
+}
+
+BOOST_AUTO_TEST_CASE( test_region_aggregate_min )
+{
+  typedef point_multiset<0, int2, bracket_less<int2>, tight_balancing,
+                         std::allocator<int2>, min_first> container_type;
+  container_type container(2);
+  int2 l(-2, -4), h(9, 3);
+  BOOST_CHECK_EQUAL(region_aggregate(container, l, h),
+                    std::numeric_limits<int>::max());
+  for (int i = 0; i < 300; ++i)
+    {
+      int2 p;
+      decrease()(p, i, 300);
+      container.insert(p);
+      randomize(-10, 10)(p, i, 300);
+      container.insert(p);
+    }
+  while (!container.empty())
+    {
+      int expected = std::numeric_limits<int>::max();
+      for (container_type::const_iterator i = container.begin();
+           i != container.end(); ++i)
+        {
+          container_type::const_iterator j = i;
+          if (match_all(container.rank(), *j, make_bounds(container, l, h))
+              && (*j)[0] < expected)
+            expected = (*j)[0];
+        }
+      BOOST_CHECK_EQUAL(region_aggregate(container, l, h), expected);
+      for (int i = 0; i < 17 && !container.empty(); ++i)
+        container.erase(container.begin());
+    }
+}
+
+//! Records the nodes given by for_each_in_region(), and stops after limit.
+template <typename Iterator>
+struct record_region
+{
+  explicit record_region(std::size_t n) : limit(n) { }
+  bool operator()(Iterator i)
+  { nodes.push_back(i.node); return nodes.size() < limit; }
+  std::size_t limit;
+  std::vector<typename Iterator::node_ptr> nodes;
+};
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_for_each_in_region, Tp, double6_sets )
+{
+  typedef typename Tp::container_type container_type;
+  typedef record_region<typename container_type::const_iterator> record;
+  {
+    Tp fix(0);
+    double6 l = make_double6(-1.), h = make_double6(1.);
+    BOOST_CHECK(for_each_in_region(fix.container, l, h, record(10))
+                .nodes.empty());
+  }
+  {
+    Tp fix(200, randomize(-5, 5));
+    const container_type& container = fix.container;
+    double6 l = make_double6(-2.), h = make_double6(3.);
+    double6 b; b[0] = b[1] = b[2] = -4.; b[3] = b[4] = b[5] = 4.;
+    std::size_t all = std::numeric_limits<std::size_t>::max();
+    record r = for_each_in_region(container, l, h, record(all));
+    std::sort(r.nodes.begin(), r.nodes.end());
+    BOOST_CHECK(std::unique(r.nodes.begin(), r.nodes.end())
+                == r.nodes.end());
+    BOOST_CHECK_EQUAL(r.nodes.size(),
+                      brute_region_count(container,
+                                         make_bounds(container, l, h)));
+    for (std::size_t i = 0; i < r.nodes.size(); ++i)
+      BOOST_CHECK(match_all(container.rank(),
+                            details::const_key(r.nodes[i]),
+                            make_bounds(container, l, h)));
+    r = for_each_in_region(container, make_enclosed_bounds(container, b),
+                           record(all));
+    BOOST_CHECK_EQUAL(r.nodes.size(),
+                      brute_region_count
+                      (container, make_enclosed_bounds(container, b)));
+    // The visitor stops the traversal
+    l = make_double6(-4.); h = make_double6(4.);
+    std::size_t count
+      = brute_region_count(container, make_closed_bounds(container, l, h));
+    BOOST_REQUIRE(count > 3);
+    r = for_each_in_region(container, make_closed_bounds(container, l, h),
+                           record(3));
+    BOOST_CHECK_EQUAL(r.nodes.size(), 3u);
+  }
+  { // An unbalanced tree
+    Tp fix(100, increase());
+    double6 l = make_double6(20.), h = make_double6(60.);
+    BOOST_CHECK_EQUAL(for_each_in_region
+                      (fix.container, l, h,
+                       record(std::numeric_limits<std::size_t>::max()))
+                      .nodes.size(),
+                      brute_region_count(fix.container,
+                                         make_bounds(fix.container, l, h)));
+  }
+}
+
+//! Writes into the mapped values given by for_each_in_region().
+template <typename Iterator>
+struct write_region
+{
+  bool operator()(Iterator i) { i->second = "visited"; return true; }
+};
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_for_each_in_region_mutable, Tp,
+                               double6_maps )
+{
+  typedef typename Tp::container_type container_type;
+  Tp fix(100, randomize(-2, 2));
+  double6 l = make_double6(-1.), h = make_double6(1.);
+  for_each_in_region(fix.container, l, h,
+                     write_region<typename container_type::iterator>());
+  std::size_t count = 0;
+  for (typename container_type::iterator i = fix.container.begin();
+       i != fix.container.end(); ++i)
+    {
+      BOOST_CHECK_EQUAL(i->second == "visited",
+                        match_all(fix.container.rank(), i->first,
+                                  make_bounds(fix.container, l, h)));
+      if (i->second == "visited") ++count;
+    }
+  BOOST_CHECK_EQUAL(count, region_count(fix.container, l, h));
+}
+
+//! Records the pairs given by for_each_in_regions(), and stops after limit.
+template <typename Iterator>
+struct record_regions
+{
+  explicit record_regions(std::size_t n) : limit(n) { }
+  bool operator()(size_type q, Iterator i)
+  {
+    pairs.push_back(std::make_pair(q, i.node));
+    return pairs.size() < limit;
+  }
+  std::size_t limit;
+  std::vector<std::pair<size_type, typename Iterator::node_ptr> > pairs;
+};
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_for_each_in_regions, Tp, int2_sets )
+{
+  typedef typename Tp::container_type container_type;
+  typedef record_regions<typename container_type::const_iterator> record;
+  typedef closed_bounds<int2, typename container_type::key_compare>
+    closed_type;
+  const std::size_t all = std::numeric_limits<std::size_t>::max();
+  Tp fix(1000, randomize(-20, 20));
+  const container_type& container = fix.container;
+  std::vector<closed_type> tiles;
+  BOOST_CHECK(for_each_in_regions(container, tiles.begin(), tiles.end(),
+                                  record(all)).pairs.empty());
+  // Adjacent tiles, that cover the container and some space around it
+  for (int x = -24; x < 24; x += 4)
+    for (int y = -24; y < 24; y += 6)
+      tiles.push_back(make_closed_bounds(container, int2(x, y),
+                                         int2(x + 4, y + 6)));
+  record r = for_each_in_regions(container, tiles.begin(), tiles.end(),
+                                 record(all));
+  std::size_t expected = 0;
+  for (size_type q = 0; q < tiles.size(); ++q)
+    {
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < r.pairs.size(); ++i)
+        {
+          if (r.pairs[i].first != q) continue;
+          ++count;
+          BOOST_CHECK(match_all(container.rank(),
+                                details::const_key(r.pairs[i].second),
+                                tiles[q]));
+        }
+      BOOST_CHECK_EQUAL(count, brute_region_count(container, tiles[q]));
+      expected += count;
+    }
+  BOOST_CHECK_EQUAL(r.pairs.size(), expected);
+  std::sort(r.pairs.begin(), r.pairs.end());
+  BOOST_CHECK(std::unique(r.pairs.begin(), r.pairs.end()) == r.pairs.end());
+  // The visitor stops the traversal
+  r = for_each_in_regions(container, tiles.begin(), tiles.end(), record(11));
+  BOOST_CHECK_EQUAL(r.pairs.size(), 11u);
+  // Overlapping regions of another kind
+  std::vector<open_bounds<int2, typename container_type::key_compare> >
+    open_tiles;
+  open_tiles.push_back(make_open_bounds(container, int2(-10, -10),
+                                        int2(10, 10)));
+  open_tiles.push_back(make_open_bounds(container, int2(-5, -15),
+                                        int2(5, 15)));
+  open_tiles.push_back(make_open_bounds(container, int2(3, 3),
+                                        int2(4, 4)));
+  r = for_each_in_regions(container, open_tiles.begin(), open_tiles.end(),
+                          record(all));
+  BOOST_CHECK_EQUAL(r.pairs.size(),
+                    brute_region_count(container, open_tiles[0])
+                    + brute_region_count(container, open_tiles[1])
+                    + brute_region_count(container, open_tiles[2]));
+}
+
+//! Returns true if \c a dominates \c b according to the key compare functor
+//! of \c container.
+template <typename Container>
+bool dominates(const Container& container,
+               const typename Container::key_type& a,
+               const typename Container::key_type& b)
+{
+  bool strict = false;
+  for (dimension_type dim = 0; dim < container.dimension(); ++dim)
+    {
+      if (container.key_comp()(dim, b, a)) return false;
+      if (container.key_comp()(dim, a, b)) strict = true;
+    }
+  return strict;
+}
+
+//! Returns the sorted nodes of the skyline of the elements of \c container
+//! that match \c pred, found by comparing all elements with each other.
+template <typename Container, typename Predicate>
+std::vector<typename Container::const_iterator::node_ptr>
+brute_skyline(const Container& container, const Predicate& pred)
+{
+  std::vector<typename Container::const_iterator::node_ptr> result;
+  for (typename Container::const_iterator i = container.begin();
+       i != container.end(); ++i)
+    {
+      if (!match_all(container.rank(), details::const_key(i.node), pred))
+        continue;
+      typename Container::const_iterator j = container.begin();
+      for (; j != container.end(); ++j)
+        if (match_all(container.rank(), details::const_key(j.node), pred)
+            && dominates(container, details::const_key(j.node),
+                         details::const_key(i.node))) break;
+      if (j == container.end()) result.push_back(i.node);
+    }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+//! Returns the sorted nodes of \c iterators.
+template <typename Iterator>
+std::vector<typename Iterator::node_ptr>
+sorted_nodes(const std::vector<Iterator>& iterators)
+{
+  std::vector<typename Iterator::node_ptr> result;
+  for (std::size_t i = 0; i < iterators.size(); ++i)
+    result.push_back(iterators[i].node);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+//! A \region_predicate matching the keys that are not smaller than \c pivot
+//! on any dimension.
+template <typename Key, typename Compare>
+struct not_below
+{
+  not_below(const Key& pivot_, const Compare& compare_)
+    : pivot(pivot_), compare(compare_) { }
+  relative_order
+  operator()(dimension_type dim, dimension_type, const Key& key) const
+  { return compare(dim, key, pivot) ? below : matching; }
+  Key pivot;
+  Compare compare;
+};
+
+template <typename Container>
+void check_skyline(const Container& container)
+{
+  typedef typename Container::const_iterator iterator;
+  typedef typename Container::key_type key_type;
+  std::vector<iterator> sky;
+  skyline(container, std::back_inserter(sky));
+  std::vector<typename iterator::node_ptr> nodes = sorted_nodes(sky);
+  BOOST_CHECK(std::unique(nodes.begin(), nodes.end()) == nodes.end());
+  std::vector<typename iterator::node_ptr> expected
+    = brute_skyline(container, details::Any_region());
+  BOOST_CHECK_EQUAL(nodes.size(), expected.size());
+  BOOST_CHECK(nodes == expected);
+  // Restricted to the keys that are not below the key of an element
+  iterator pivot = container.begin();
+  std::advance(pivot, container.size() / 3);
+  std::vector<iterator> region_sky;
+  not_below<key_type, typename Container::key_compare>
+    region(details::const_key(pivot.node), container.key_comp());
+  skyline(container, region, std::back_inserter(region_sky));
+  BOOST_CHECK(!region_sky.empty());
+  BOOST_CHECK(sorted_nodes(region_sky) == brute_skyline(container, region));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_skyline, Tp, every_quad )
+{
+  {
+    Tp fix;
+    std::vector<typename Tp::container_type::iterator> sky;
+    skyline(fix.container, std::back_inserter(sky));
+    BOOST_CHECK(sky.empty());
+  }
+  {
+    Tp fix(1, same());
+    std::vector<typename Tp::container_type::iterator> sky;
+    skyline(fix.container, std::back_inserter(sky));
+    BOOST_CHECK_EQUAL(sky.size(), 1u);
+    BOOST_CHECK(sky.front() == fix.container.begin());
+  }
+  {
+    // All equal keys do not dominate each other
+    Tp fix(30, same());
+    std::vector<typename Tp::container_type::iterator> sky;
+    skyline(fix.container, std::back_inserter(sky));
+    BOOST_CHECK_EQUAL(sky.size(), 30u);
+  }
+  {
+    Tp fix(500, randomize(-100, 100));
+    check_skyline(fix.container);
+  }
+  {
+    // Keys increasing on all dimensions: the first dominates all others
+    Tp fix(100, increase());
+    std::vector<typename Tp::container_type::iterator> sky;
+    skyline(fix.container, std::back_inserter(sky));
+    BOOST_CHECK_EQUAL(sky.size(), 1u);
+    BOOST_CHECK(sky.front() == fix.container.begin());
+    check_skyline(fix.container);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( test_skyline_dense, Tp, int2_sets )
+{
+  // Many elements with equal keys, on and off the skyline
+  Tp fix(1000, randomize(-10, 10));
+  check_skyline(fix.container);
+}